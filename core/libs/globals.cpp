@@ -31,6 +31,7 @@
 #include "tlibs/file/file.h"
 #include "tlibs/string/string.h"
 #include "tlibs/helper/proc.h"
+#include "tlibs/helper/thread.h"
 
 #include <thread>
 
@@ -70,7 +71,11 @@ unsigned int g_iMaxProcesses = std::thread::hardware_concurrency();
 unsigned int get_max_threads()
 {
 	unsigned int iMaxThreads = std::thread::hardware_concurrency();
-	return std::min(iMaxThreads, g_iMaxThreads);
+	iMaxThreads = std::min(iMaxThreads, g_iMaxThreads);
+
+	// all thread pools share the workers of the scheduler, so this is the limit for the whole process
+	tl::Scheduler::Get().SetMaxThreads(std::max(1u, iMaxThreads));
+	return iMaxThreads;
 }
 
 unsigned int get_max_processes()
@@ -36,6 +36,7 @@
 #include "libs/globals_qt.h"
 
 #include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iomanip>
 #include <memory>
@@ -653,18 +654,210 @@ void MyQwtRasterData::SetZRange(t_real_qwt dMin, t_real_qwt dMax)
 }
 
 
-void MyQwtRasterData::SetZRange()	// automatically determined range
+/**
+ * automatically determined range, only the changed tiles are rescanned
+ */
+void MyQwtRasterData::SetZRange()
 {
-	if(!m_pData) return;
+	if(!m_pData || !m_pCache || !m_iW || !m_iH) return;
+	std::lock_guard<std::mutex> lock(m_pCache->mtx);
+
+	RasterCache& cache = *m_pCache;
+	const t_real_qwt *pData = m_pData.get();
+
+	for(std::size_t iTileY=0; iTileY<cache.iTilesY; ++iTileY)
+	{
+		for(std::size_t iTileX=0; iTileX<cache.iTilesX; ++iTileX)
+		{
+			const std::size_t iTile = iTileY*cache.iTilesX + iTileX;
+			if(!cache.vecTileZDirty[iTile])
+				continue;
 
-	auto minmax = std::minmax_element(m_pData.get(), m_pData.get()+m_iW*m_iH);
-	m_dZRange[0] = *minmax.first; m_dZRange[1] = *minmax.second;
+			const std::size_t iX0 = iTileX*s_iTileSize, iY0 = iTileY*s_iTileSize;
+			const std::size_t iX1 = std::min(iX0+s_iTileSize, m_iW);
+			const std::size_t iY1 = std::min(iY0+s_iTileSize, m_iH);
+
+			auto minmax = std::minmax_element(pData + iY0*m_iW + iX0, pData + iY0*m_iW + iX1);
+			t_real_qwt dMin = *minmax.first, dMax = *minmax.second;
+			for(std::size_t iY=iY0+1; iY<iY1; ++iY)
+			{
+				minmax = std::minmax_element(pData + iY*m_iW + iX0, pData + iY*m_iW + iX1);
+				dMin = std::min(dMin, *minmax.first);
+				dMax = std::max(dMax, *minmax.second);
+			}
+
+			cache.vecTileMin[iTile] = dMin;
+			cache.vecTileMax[iTile] = dMax;
+			cache.vecTileZDirty[iTile] = false;
+		}
+	}
+
+	m_dZRange[0] = *std::min_element(cache.vecTileMin.begin(), cache.vecTileMin.end());
+	m_dZRange[1] = *std::max_element(cache.vecTileMax.begin(), cache.vecTileMax.end());
 #if QWT_VERSION < 0x060200
 	setInterval(Qt::ZAxis, QwtInterval(m_dZRange[0], m_dZRange[1]));
 #endif
 }
 
 
+/**
+ * sets up the tile grid and the mipmap pyramid, all tiles start out invalid
+ */
+void MyQwtRasterData::InitCache()
+{
+	m_pCache = std::make_shared<RasterCache>();
+	m_iLevel = 0;
+
+	RasterCache& cache = *m_pCache;
+	cache.iTilesX = (m_iW + s_iTileSize-1) / s_iTileSize;
+	cache.iTilesY = (m_iH + s_iTileSize-1) / s_iTileSize;
+
+	const std::size_t iNumTiles = cache.iTilesX * cache.iTilesY;
+	cache.vecTileMin.resize(iNumTiles, t_real_qwt(0));
+	cache.vecTileMax.resize(iNumTiles, t_real_qwt(0));
+	cache.vecTileZDirty.resize(iNumTiles, true);
+	cache.vecTileMipDirty.resize(iNumTiles, true);
+
+	std::size_t iW = m_iW, iH = m_iH;
+	while(iW > 1 || iH > 1)
+	{
+		iW = (iW+1) / 2;
+		iH = (iH+1) / 2;
+
+		cache.vecMipSizes.emplace_back(std::make_pair(iW, iH));
+		cache.vecMips.emplace_back(std::vector<t_real_qwt>(iW*iH, t_real_qwt(0)));
+	}
+}
+
+
+/**
+ * marks the tile containing the given pixel as changed
+ */
+void MyQwtRasterData::SetDirty(std::size_t iX, std::size_t iY)
+{
+	if(!m_pCache) return;
+	std::lock_guard<std::mutex> lock(m_pCache->mtx);
+
+	const std::size_t iTile = (iY/s_iTileSize)*m_pCache->iTilesX + iX/s_iTileSize;
+	m_pCache->vecTileZDirty[iTile] = true;
+	m_pCache->vecTileMipDirty[iTile] = true;
+}
+
+
+/**
+ * recalculates the mipmap regions belonging to the changed tiles
+ */
+void MyQwtRasterData::UpdateMips()
+{
+	if(!m_pData || !m_pCache) return;
+	std::lock_guard<std::mutex> lock(m_pCache->mtx);
+
+	RasterCache& cache = *m_pCache;
+
+	for(std::size_t iTileY=0; iTileY<cache.iTilesY; ++iTileY)
+	{
+		for(std::size_t iTileX=0; iTileX<cache.iTilesX; ++iTileX)
+		{
+			const std::size_t iTile = iTileY*cache.iTilesX + iTileX;
+			if(!cache.vecTileMipDirty[iTile])
+				continue;
+
+			for(std::size_t iLevel=1; iLevel<=cache.vecMips.size(); ++iLevel)
+			{
+				const std::size_t iW = cache.vecMipSizes[iLevel-1].first;
+				const std::size_t iH = cache.vecMipSizes[iLevel-1].second;
+				const std::size_t iScale = std::size_t(1) << iLevel;
+
+				// tile region in this level's pixels
+				const std::size_t iX0 = iTileX*s_iTileSize / iScale;
+				const std::size_t iY0 = iTileY*s_iTileSize / iScale;
+				const std::size_t iX1 = std::min(iW, ((iTileX+1)*s_iTileSize + iScale-1) / iScale);
+				const std::size_t iY1 = std::min(iH, ((iTileY+1)*s_iTileSize + iScale-1) / iScale);
+
+				// previous level's dimensions
+				const std::size_t iPrevW = iLevel==1 ? m_iW : cache.vecMipSizes[iLevel-2].first;
+				const std::size_t iPrevH = iLevel==1 ? m_iH : cache.vecMipSizes[iLevel-2].second;
+
+				for(std::size_t iY=iY0; iY<iY1; ++iY)
+				{
+					for(std::size_t iX=iX0; iX<iX1; ++iX)
+					{
+						// average over the 2x2 block of the previous level
+						const std::size_t iXa = 2*iX, iXb = std::min(2*iX+1, iPrevW-1);
+						const std::size_t iYa = 2*iY, iYb = std::min(2*iY+1, iPrevH-1);
+
+						t_real_qwt dSum = GetPixel(iXa, iYa, iLevel-1) + GetPixel(iXb, iYa, iLevel-1)
+							+ GetPixel(iXa, iYb, iLevel-1) + GetPixel(iXb, iYb, iLevel-1);
+						cache.vecMips[iLevel-1][iY*iW + iX] = dSum * t_real_qwt(0.25);
+					}
+				}
+			}
+
+			cache.vecTileMipDirty[iTile] = false;
+		}
+	}
+}
+
+
+/**
+ * gets a pixel of the given mipmap level, level 0 is the full-resolution raster
+ */
+t_real_qwt MyQwtRasterData::GetPixel(std::size_t iX, std::size_t iY, std::size_t iLevel) const
+{
+	if(iLevel == 0 || !m_pCache)
+		return GetPixel(iX, iY);
+
+	const std::size_t iW = m_pCache->vecMipSizes[iLevel-1].first;
+	return m_pCache->vecMips[iLevel-1][iY*iW + iX];
+}
+
+
+/**
+ * selects the mipmap level matching the screen resolution before rendering
+ */
+void MyQwtRasterData::initRaster(const QRectF& rectArea, const QSize& sizeRaster)
+{
+	m_iLevel = 0;
+	if(!m_pCache || !m_pCache->vecMips.size() || sizeRaster.width() <= 0 || sizeRaster.height() <= 0)
+		return;
+
+	const t_real_qwt dXRange = std::abs(m_dXRange[1] - m_dXRange[0]);
+	const t_real_qwt dYRange = std::abs(m_dYRange[1] - m_dYRange[0]);
+	if(tl::float_equal<t_real_qwt>(dXRange, 0.) || tl::float_equal<t_real_qwt>(dYRange, 0.))
+		return;
+
+	// number of raster pixels per screen pixel
+	const t_real_qwt dPixPerScreenX = t_real_qwt(m_iW) * rectArea.width() / dXRange / t_real_qwt(sizeRaster.width());
+	const t_real_qwt dPixPerScreenY = t_real_qwt(m_iH) * rectArea.height() / dYRange / t_real_qwt(sizeRaster.height());
+	const t_real_qwt dPixPerScreen = std::min(std::abs(dPixPerScreenX), std::abs(dPixPerScreenY));
+	if(dPixPerScreen < t_real_qwt(2))
+		return;
+
+	UpdateMips();
+	m_iLevel = std::min<std::size_t>(std::size_t(std::log2(dPixPerScreen)), m_pCache->vecMips.size());
+}
+
+
+void MyQwtRasterData::discardRaster()
+{
+	m_iLevel = 0;
+}
+
+
+/**
+ * size of a raster pixel, lets qwt render small rasters at their own resolution
+ */
+QRectF MyQwtRasterData::pixelHint(const QRectF&) const
+{
+	if(!m_iW || !m_iH)
+		return QRectF();
+
+	const t_real_qwt dW = std::abs(m_dXRange[1] - m_dXRange[0]) / t_real_qwt(m_iW);
+	const t_real_qwt dH = std::abs(m_dYRange[1] - m_dYRange[0]) / t_real_qwt(m_iH);
+	return QRectF(std::min(m_dXRange[0], m_dXRange[1]), std::min(m_dYRange[0], m_dYRange[1]), dW, dH);
+}
+
+
 t_real_qwt MyQwtRasterData::value(t_real_qwt dx, t_real_qwt dy) const
 {
 	t_real_qwt dXMin = std::min(m_dXRange[0], m_dXRange[1]);
@@ -678,7 +871,7 @@ t_real_qwt MyQwtRasterData::value(t_real_qwt dx, t_real_qwt dy) const
 	std::size_t iX = tl::tic_trafo_inv(m_iW, m_dXRange[0], m_dXRange[1], 0, dx);
 	std::size_t iY = tl::tic_trafo_inv(m_iH, m_dYRange[0], m_dYRange[1], 0, dy);
 
-	return GetPixel(iX, iY);
+	return GetPixel(iX >> m_iLevel, iY >> m_iLevel, m_iLevel);
 }
 
 
@@ -699,6 +892,7 @@ MyQwtRasterData::MyQwtRasterData(const MyQwtRasterData& dat)
 const MyQwtRasterData& MyQwtRasterData::operator=(const MyQwtRasterData& dat)
 {
 	m_pData = dat.m_pData;
+	m_pCache = dat.m_pCache;
 	m_iW = dat.m_iW;
 	m_iH = dat.m_iH;
 
@@ -811,10 +1005,18 @@ void MyQwtCurve::drawDots(QPainter* pPainter,
 	pPainter->setPen(oldpen);
 	pPainter->setBrush(oldpen.color());
 
+	QPoint ptLastPix(-1, -1);
 	for(int iPt=iPtFirst; iPt<=iPtLast; ++iPt)
 	{
 		QPointF pt = data()->sample(iPt);
 		QPointF ptMid(scX.transform(pt.x()), scY.transform(pt.y()));
+
+		// skip points landing on the same screen pixel as the previous one
+		QPoint ptPix = ptMid.toPoint();
+		if(iPt > iPtFirst && ptPix == ptLastPix)
+			continue;
+		ptLastPix = ptPix;
+
 		pPainter->drawEllipse(ptMid, 2, 2);
 	}
 
@@ -825,6 +1027,76 @@ void MyQwtCurve::drawDots(QPainter* pPainter,
 }
 
 
+/**
+ * draws long curves decimated to the first, minimum, maximum and last point
+ * per screen pixel column, which keeps the visible envelope of the data
+ */
+void MyQwtCurve::drawLines(QPainter* pPainter,
+	const QwtScaleMap& scX, const QwtScaleMap& scY,
+	const QRectF& rect, int iPtFirst, int iPtLast) const
+{
+	const int iLeft = int(std::floor(rect.left())) - 1;
+	const int iRight = int(std::ceil(rect.right())) + 1;
+
+	// short or fitted curves are drawn as usual
+	if(iPtLast - iPtFirst + 1 <= 4*(iRight - iLeft + 1)
+		|| testCurveAttribute(QwtPlotCurve::Fitted)
+		|| brush().style() != Qt::NoBrush)
+	{
+		QwtPlotCurve::drawLines(pPainter, scX, scY, rect, iPtFirst, iPtLast);
+		return;
+	}
+
+	QPolygonF poly;
+	poly.reserve(4*(iRight - iLeft + 1) + 4);
+
+	// points of the current pixel column in drawing order
+	int iCol = 0;
+	QPointF ptFirst, ptMin, ptMax, ptLast;
+	int iIdxMin = 0, iIdxMax = 0;
+
+	auto flush_column = [&poly, &ptFirst, &ptMin, &ptMax, &ptLast, &iIdxMin, &iIdxMax]()
+	{
+		const QPointF* pts[] = { &ptFirst,
+			iIdxMin < iIdxMax ? &ptMin : &ptMax,
+			iIdxMin < iIdxMax ? &ptMax : &ptMin,
+			&ptLast };
+
+		for(const QPointF* pt : pts)
+			if(!poly.size() || poly.back() != *pt)
+				poly.push_back(*pt);
+	};
+
+	for(int iPt=iPtFirst; iPt<=iPtLast; ++iPt)
+	{
+		const QPointF ptData = data()->sample(iPt);
+		const QPointF pt(scX.transform(ptData.x()), scY.transform(ptData.y()));
+
+		// all points outside the canvas are collected in the columns next to it
+		const int iPtCol = tl::clamp(int(std::floor(pt.x())), iLeft, iRight);
+
+		if(iPt == iPtFirst || iPtCol != iCol)
+		{
+			if(iPt != iPtFirst)
+				flush_column();
+
+			iCol = iPtCol;
+			ptFirst = ptMin = ptMax = ptLast = pt;
+			iIdxMin = iIdxMax = iPt;
+			continue;
+		}
+
+		// screen y axis points downwards
+		if(pt.y() > ptMin.y()) { ptMin = pt; iIdxMin = iPt; }
+		if(pt.y() < ptMax.y()) { ptMax = pt; iIdxMax = iPt; }
+		ptLast = pt;
+	}
+	flush_column();
+
+	pPainter->drawPolyline(poly);
+}
+
+
 // ----------------------------------------------------------------------------
 
 
@@ -53,11 +53,41 @@ using t_real_qwt = double;   // qwt's intrinsic value type
 
 class MyQwtRasterData : public QwtRasterData
 {
+public:
+	// edge length of the cache tiles, has to be a power of two
+	static constexpr std::size_t s_iTileSize = 32;
+
 protected:
+	/**
+	 * z ranges of the raster tiles and a mipmap pyramid of the raster;
+	 * only tiles which changed since the last update are recalculated
+	 */
+	struct RasterCache
+	{
+		std::mutex mtx;
+
+		std::size_t iTilesX = 0, iTilesY = 0;
+		std::vector<t_real_qwt> vecTileMin, vecTileMax;
+		std::vector<bool> vecTileZDirty, vecTileMipDirty;
+
+		// mipmap levels 1, 2, ...; level i has ceil(w/2^i) x ceil(h/2^i) pixels
+		std::vector<std::vector<t_real_qwt>> vecMips;
+		std::vector<std::pair<std::size_t, std::size_t>> vecMipSizes;
+	};
+
 	std::shared_ptr<t_real_qwt> m_pData;
+	std::shared_ptr<RasterCache> m_pCache;
 	std::size_t m_iW=0, m_iH=0;
 	t_real_qwt m_dXRange[2], m_dYRange[2], m_dZRange[2];
 
+	// mipmap level used for the current rendering pass
+	std::size_t m_iLevel = 0;
+
+protected:
+	void InitCache();
+	void SetDirty(std::size_t iX, std::size_t iY);
+	void UpdateMips();
+
 public:
 	void Init(std::size_t iW, std::size_t iH)
 	{
@@ -68,6 +98,8 @@ public:
 
 		m_pData.reset(new t_real_qwt[iW*iH], [](t_real_qwt *pArr) { delete[] pArr; } );
 		std::fill(m_pData.get(), m_pData.get()+m_iW*m_iH, t_real_qwt(0));
+
+		InitCache();
 	}
 
 	MyQwtRasterData(std::size_t iW=0, std::size_t iH=0)
@@ -98,7 +130,10 @@ public:
 	void SetPixel(std::size_t iX, std::size_t iY, t_real_qwt dVal)
 	{
 		if(iX<m_iW && iY<m_iH)
+		{
 			m_pData.get()[iY*m_iW + iX] = dVal;
+			SetDirty(iX, iY);
+		}
 	}
 
 	t_real_qwt GetPixel(std::size_t iX, std::size_t iY) const
@@ -107,8 +142,14 @@ public:
 		return m_pData.get()[iY*m_iW + iX];
 	}
 
+	t_real_qwt GetPixel(std::size_t iX, std::size_t iY, std::size_t iLevel) const;
+
 	virtual t_real_qwt value(t_real_qwt dx, t_real_qwt dy) const override;
 
+	virtual void initRaster(const QRectF& rectArea, const QSize& sizeRaster) override;
+	virtual void discardRaster() override;
+	virtual QRectF pixelHint(const QRectF& rectArea) const override;
+
 	virtual QwtRasterData* clone() const;
 	virtual QwtRasterData* copy() const /*override only for qwt5*/;
 	virtual QwtInterval range() const /*override only for qwt5*/;
@@ -134,6 +175,10 @@ protected:
 		const QwtScaleMap& scX, const QwtScaleMap& scY,
 		const QRectF& rect, int iPtFirst, int iPtLast) const /*override*/;
 
+	virtual void drawLines(QPainter* pPainter,
+		const QwtScaleMap& scX, const QwtScaleMap& scY,
+		const QRectF& rect, int iPtFirst, int iPtLast) const override;
+
 public:
 	MyQwtCurve();
 	virtual ~MyQwtCurve();
@@ -0,0 +1,313 @@
+/**
+ * coalesced and deferred parameter updates between windows
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "update_sched.h"
+
+#include "tlibs/log/log.h"
+#include "tlibs/math/rand.h"
+
+
+UpdateScheduler::UpdateScheduler(QObject *pParent, int iIntervalMs)
+	: QObject(pParent)
+{
+	m_timer.setSingleShot(true);
+	m_timer.setInterval(iIntervalMs);
+
+	QObject::connect(&m_timer, &QTimer::timeout, this, &UpdateScheduler::Flush);
+}
+
+
+UpdateScheduler::~UpdateScheduler()
+{
+	m_timer.stop();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mtxJobs);
+		m_bStop = true;
+		m_mapJobs.clear();
+	}
+
+	for(auto& pair : m_mapCancel)
+		*pair.second = true;
+
+	m_condJobs.notify_all();
+	if(m_worker.joinable())
+		m_worker.join();
+}
+
+
+
+// ----------------------------------------------------------------------------
+// coalesced updates
+
+UpdateScheduler::t_chan UpdateScheduler::AddChannel(QObject *pRecv)
+{
+	Channel chan;
+	if(pRecv)
+	{
+		chan.pRecv = pRecv;
+		chan.bHasRecv = true;
+
+		// deliver held-back updates once the receiver is shown
+		if(pRecv->isWidgetType())
+			pRecv->installEventFilter(this);
+	}
+
+	m_vecChans.emplace_back(std::move(chan));
+	return m_vecChans.size() - 1;
+}
+
+
+/**
+ * updates for pRecv are also delivered while pWidget is visible,
+ * e.g. for a calculation dialog feeding a visible plot window
+ */
+void UpdateScheduler::AddWatch(const QObject *pRecv, QWidget *pWidget)
+{
+	if(!pRecv || !pWidget)
+		return;
+
+	m_mapWatch[pRecv].emplace_back(pWidget);
+	pWidget->installEventFilter(this);
+}
+
+
+bool UpdateScheduler::IsVisible(const Channel& chan) const
+{
+	if(!chan.bHasRecv)
+		return true;
+	if(!chan.pRecv)
+		return false;
+
+	const QWidget *pWidget = qobject_cast<const QWidget*>(chan.pRecv.data());
+	if(!pWidget || pWidget->isVisible())
+		return true;
+
+	auto iter = m_mapWatch.find(chan.pRecv.data());
+	if(iter != m_mapWatch.end())
+	{
+		for(const QPointer<QWidget>& pWatch : iter->second)
+		{
+			if(pWatch && pWatch->isVisible())
+				return true;
+		}
+	}
+
+	return false;
+}
+
+
+/**
+ * replace the pending update of a channel
+ */
+void UpdateScheduler::Post(t_chan chan, t_func func)
+{
+	if(chan >= m_vecChans.size())
+		return;
+
+	Channel& ch = m_vecChans[chan];
+	if(ch.bHasRecv && !ch.pRecv)	// receiver has been deleted
+		return;
+
+	ch.funcPending = std::move(func);
+
+	// throttle rather than debounce to keep continuous changes, e.g. dragging, responsive
+	if(!m_timer.isActive())
+		m_timer.start();
+}
+
+
+/**
+ * deliver all pending updates of visible receivers
+ */
+void UpdateScheduler::Flush()
+{
+	// e.g. a modal dialog opened by a receiver: try again later
+	if(m_bFlushing)
+	{
+		m_timer.start();
+		return;
+	}
+
+	m_bFlushing = true;
+
+	// channels can be added or updated during delivery, so don't keep references
+	for(std::size_t iChan = 0; iChan < m_vecChans.size(); ++iChan)
+	{
+		if(!m_vecChans[iChan].funcPending)
+			continue;
+
+		if(m_vecChans[iChan].bHasRecv && !m_vecChans[iChan].pRecv)
+		{
+			m_vecChans[iChan].funcPending = nullptr;
+			continue;
+		}
+
+		// keep until the receiver is shown
+		if(!IsVisible(m_vecChans[iChan]))
+			continue;
+
+		t_func func = std::move(m_vecChans[iChan].funcPending);
+		m_vecChans[iChan].funcPending = nullptr;
+
+		try
+		{
+			func();
+		}
+		catch(const std::exception& ex)
+		{
+			tl::log_err("Cannot deliver update: ", ex.what(), ".");
+		}
+	}
+
+	m_bFlushing = false;
+}
+
+
+bool UpdateScheduler::eventFilter(QObject *pObj, QEvent *pEvt)
+{
+	if(pEvt->type() == QEvent::Show)
+		QTimer::singleShot(0, this, &UpdateScheduler::Flush);
+
+	return QObject::eventFilter(pObj, pEvt);
+}
+
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// asynchronous jobs
+
+/**
+ * run a job on the worker thread, superseding all older jobs with the same key
+ */
+void UpdateScheduler::RunAsync(std::size_t iKey, t_job job)
+{
+	Cancel(iKey);
+	const std::size_t iGen = m_mapGen[iKey];
+
+	auto pCancel = std::make_shared<std::atomic<bool>>(false);
+	m_mapCancel[iKey] = pCancel;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mtxJobs);
+		if(m_bStop)
+			return;
+
+		// replaces a queued job which has not yet started
+		Job& newjob = m_mapJobs[iKey];
+		newjob.iGen = iGen;
+		newjob.func = std::move(job);
+		newjob.pCancel = pCancel;
+
+		if(!m_worker.joinable())
+			m_worker = std::thread(&UpdateScheduler::WorkerThread, this);
+	}
+
+	m_condJobs.notify_one();
+}
+
+
+/**
+ * cancel the queued or running job with the given key and discard its results
+ */
+void UpdateScheduler::Cancel(std::size_t iKey)
+{
+	++m_mapGen[iKey];
+
+	auto iterCancel = m_mapCancel.find(iKey);
+	if(iterCancel != m_mapCancel.end())
+	{
+		*iterCancel->second = true;
+		m_mapCancel.erase(iterCancel);
+	}
+
+	std::lock_guard<std::mutex> lock(m_mtxJobs);
+	m_mapJobs.erase(iKey);
+}
+
+
+void UpdateScheduler::WorkerThread()
+{
+	// the thread-local random engine is used by the Monte-Carlo calculations
+	tl::init_rand();
+
+	while(1)
+	{
+		std::size_t iKey = 0;
+		Job job;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mtxJobs);
+			m_condJobs.wait(lock, [this]() -> bool
+			{
+				return m_bStop || !m_mapJobs.empty();
+			});
+
+			if(m_bStop)
+				break;
+
+			auto iter = m_mapJobs.begin();
+			iKey = iter->first;
+			job = std::move(iter->second);
+			m_mapJobs.erase(iter);
+		}
+
+		if(*job.pCancel)
+			continue;
+
+		t_func funcApply;
+		try
+		{
+			funcApply = job.func(*job.pCancel);
+		}
+		catch(const std::exception& ex)
+		{
+			tl::log_err("Update calculation failed: ", ex.what(), ".");
+		}
+
+		if(!funcApply || *job.pCancel)
+			continue;
+
+		// apply the results in the gui thread if they are still the newest ones
+		QMetaObject::invokeMethod(this, [this, iKey, iGen = job.iGen, funcApply]()
+		{
+			auto iter = m_mapGen.find(iKey);
+			if(iter == m_mapGen.end() || iter->second != iGen)
+				return;
+
+			funcApply();
+		}, Qt::QueuedConnection);
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+
+#include "moc_update_sched.cpp"
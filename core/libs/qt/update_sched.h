@@ -0,0 +1,161 @@
+/**
+ * coalesced and deferred parameter updates between windows
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __UPDATE_SCHED_H__
+#define __UPDATE_SCHED_H__
+
+#include <QObject>
+#include <QWidget>
+#include <QTimer>
+#include <QPointer>
+#include <QEvent>
+
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+
+/**
+ * sits between a main window and its dependent dialogs:
+ *   - bursts of updates on a channel are coalesced, only the newest one is delivered,
+ *   - updates for hidden dialogs are held back until the dialog is shown,
+ *   - heavy calculations can be run on a worker thread; superseded jobs are
+ *     cancelled and only the result of the newest job is applied.
+ *
+ * pending updates are delivered in the order in which their channels were created.
+ */
+class UpdateScheduler : public QObject
+{ Q_OBJECT
+public:
+	using t_func = std::function<void()>;
+	// a job returns the function which applies its results in the gui thread
+	using t_job = std::function<t_func(const std::atomic<bool>& bCancel)>;
+	using t_chan = std::size_t;
+
+	static constexpr t_chan NO_CHAN = t_chan(-1);
+
+protected:
+	struct Channel
+	{
+		QPointer<QObject> pRecv;
+		bool bHasRecv = false;           // a null pRecv then means the receiver has been deleted
+		t_func funcPending;
+	};
+
+	struct Job
+	{
+		std::size_t iGen = 0;
+		t_job func;
+		std::shared_ptr<std::atomic<bool>> pCancel;
+	};
+
+	std::vector<Channel> m_vecChans;
+
+	// further widgets whose visibility keeps a receiver's updates alive
+	std::unordered_map<const QObject*, std::vector<QPointer<QWidget>>> m_mapWatch;
+
+	QTimer m_timer;
+	bool m_bFlushing = false;
+
+	// newest job generation and cancel flag per key, only used in the gui thread
+	std::unordered_map<std::size_t, std::size_t> m_mapGen;
+	std::unordered_map<std::size_t, std::shared_ptr<std::atomic<bool>>> m_mapCancel;
+
+	// queued jobs, at most one per key
+	std::unordered_map<std::size_t, Job> m_mapJobs;
+	std::mutex m_mtxJobs;
+	std::condition_variable m_condJobs;
+	bool m_bStop = false;
+	std::thread m_worker;
+
+protected:
+	bool IsVisible(const Channel& chan) const;
+	void WorkerThread();
+
+	virtual bool eventFilter(QObject *pObj, QEvent *pEvt) override;
+
+public:
+	UpdateScheduler(QObject *pParent = nullptr, int iIntervalMs = 25);
+	virtual ~UpdateScheduler();
+
+	void SetInterval(int iIntervalMs) { m_timer.setInterval(iIntervalMs); }
+
+	// a receiver of nullptr is always considered visible
+	t_chan AddChannel(QObject *pRecv = nullptr);
+	void AddWatch(const QObject *pRecv, QWidget *pWidget);
+
+	void Post(t_chan chan, t_func func);
+	void Flush();
+
+	void RunAsync(std::size_t iKey, t_job job);
+	void Cancel(std::size_t iKey);
+
+
+	/**
+	 * call a slot with the arguments stored in a tuple
+	 */
+	template<class t_recv, class t_slot, class t_tup, std::size_t ...idx>
+	static void CallSlot(t_recv *pRecv, t_slot pSlot, const t_tup& tupArgs, std::index_sequence<idx...>)
+	{
+		(pRecv->*pSlot)(std::get<idx>(tupArgs)...);
+	}
+
+
+	/**
+	 * forward a signal to a slot via a new channel,
+	 * the signal arguments are copied and only the newest ones are delivered
+	 */
+	template<class t_sender, class t_sigobj, class ...t_sigargs,
+		class t_recv, class t_slotobj, class ...t_slotargs>
+	t_chan Connect(t_sender *pSender, void (t_sigobj::*pSig)(t_sigargs...),
+		t_recv *pRecv, void (t_slotobj::*pSlot)(t_slotargs...))
+	{
+		const t_chan chan = AddChannel(pRecv);
+
+		QObject::connect(pSender, pSig, this, [this, chan, pRecv, pSlot](t_sigargs... args)
+		{
+			Post(chan, [pRecv, pSlot, tupArgs = std::make_tuple(std::decay_t<t_sigargs>(args)...)]()
+			{
+				CallSlot(pRecv, pSlot, tupArgs, std::index_sequence_for<t_sigargs...>());
+			});
+		});
+
+		return chan;
+	}
+};
+
+
+#endif
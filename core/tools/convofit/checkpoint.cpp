@@ -0,0 +1,288 @@
+/**
+ * checkpointing of long-running convolution fits
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "checkpoint.h"
+#include "tlibs/file/prop.h"
+#include "tlibs/string/string.h"
+#include "tlibs/math/rand.h"
+#include "tlibs/log/log.h"
+
+#include <sstream>
+#include <limits>
+#include <cstdio>
+
+using t_real = FitCheckpoint::t_real;
+using t_vec = FitCheckpoint::t_vec;
+
+
+// ----------------------------------------------------------------------------
+// helpers
+
+/**
+ * converts a vector to a string which reads back to the identical values
+ */
+static std::string vec_to_str(const t_vec& vec)
+{
+	std::ostringstream ostr;
+	ostr.precision(std::numeric_limits<t_real>::max_digits10);
+
+	for(std::size_t i=0; i<vec.size(); ++i)
+	{
+		if(i > 0)
+			ostr << " ";
+		ostr << vec[i];
+	}
+
+	return ostr.str();
+}
+
+
+static t_vec str_to_vec(const std::string& str)
+{
+	t_vec vec;
+	std::istringstream istr(str);
+
+	t_real dVal = 0;
+	while(istr >> dVal)
+		vec.push_back(dVal);
+
+	return vec;
+}
+
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// checkpoint
+
+FitCheckpoint::FitCheckpoint(const std::string& strFile, t_real dInterval)
+	: m_strFile(strFile), m_dInterval(dInterval),
+		m_idJobThread(std::this_thread::get_id()),
+		m_timeLastSave(std::chrono::steady_clock::now())
+{}
+
+
+bool FitCheckpoint::Load()
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+
+	tl::Prop<std::string> prop;
+	if(!prop.Load(m_strFile.c_str(), tl::PropType::INFO))
+		return false;
+	if(!prop.Exists("checkpoint/seed"))
+		return false;
+
+	m_iSeed = prop.Query<unsigned int>("checkpoint/seed", 0);
+	m_strRandState = prop.Query<std::string>("checkpoint/rand_state", "");
+	m_phase = Phase(prop.Query<int>("checkpoint/phase", int(Phase::START)));
+	m_bValidFit = prop.Query<bool>("checkpoint/valid", false);
+	m_iCalls = prop.Query<std::size_t>("checkpoint/calls", 0);
+
+	m_vecNames.clear();
+	tl::get_tokens<std::string, std::string>(
+		prop.Query<std::string>("state/names", ""), " \t", m_vecNames);
+	m_vecValues = str_to_vec(prop.Query<std::string>("state/values", ""));
+	m_vecErrors = str_to_vec(prop.Query<std::string>("state/errors", ""));
+	m_vecCov = str_to_vec(prop.Query<std::string>("state/covariance", ""));
+
+	if(m_vecValues.size() != m_vecNames.size() || m_vecErrors.size() != m_vecNames.size())
+	{
+		tl::log_warn("Ignoring invalid minimiser state in checkpoint \"", m_strFile, "\".");
+		m_vecNames.clear();
+		m_vecValues.clear();
+		m_vecErrors.clear();
+		m_vecCov.clear();
+		m_phase = Phase::START;
+	}
+
+	// each cache entry is stored as "chi2 param_0 param_1 ..."
+	m_mapCache.clear();
+	const std::size_t iNumCached = prop.Query<std::size_t>("cache/num", 0);
+	for(std::size_t iPt=0; iPt<iNumCached; ++iPt)
+	{
+		t_vec vec = str_to_vec(prop.Query<std::string>("cache/pt_" + tl::var_to_str(iPt), ""));
+		if(vec.size() < 1)
+			continue;
+
+		const t_real dChi2 = vec[0];
+		vec.erase(vec.begin());
+		m_mapCache.emplace(std::move(vec), dChi2);
+	}
+
+	m_timeLastSave = std::chrono::steady_clock::now();
+	return true;
+}
+
+
+bool FitCheckpoint::Save()
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+	return SaveUnlocked();
+}
+
+
+/**
+ * writes the checkpoint to a temporary file which then replaces the old one,
+ * so that an interruption while saving cannot corrupt the last checkpoint
+ */
+bool FitCheckpoint::SaveUnlocked()
+{
+	// only the job thread knows the state of its random engine
+	if(std::this_thread::get_id() == m_idJobThread)
+	{
+		std::ostringstream ostrRand;
+		ostrRand << tl::get_randeng();
+		m_strRandState = ostrRand.str();
+	}
+
+	tl::Prop<std::string> prop;
+	prop.Add("checkpoint/seed", tl::var_to_str(m_iSeed));
+	prop.Add("checkpoint/rand_state", m_strRandState);
+	prop.Add("checkpoint/phase", tl::var_to_str(int(m_phase)));
+	prop.Add("checkpoint/valid", std::string(m_bValidFit ? "1" : "0"));
+	prop.Add("checkpoint/calls", tl::var_to_str(m_iCalls));
+
+	std::string strNames;
+	for(std::size_t i=0; i<m_vecNames.size(); ++i)
+		strNames += (i > 0 ? " " : "") + m_vecNames[i];
+	prop.Add("state/names", strNames);
+	prop.Add("state/values", vec_to_str(m_vecValues));
+	prop.Add("state/errors", vec_to_str(m_vecErrors));
+	prop.Add("state/covariance", vec_to_str(m_vecCov));
+
+	prop.Add("cache/num", tl::var_to_str(m_mapCache.size()));
+	std::size_t iPt = 0;
+	for(const auto& pair : m_mapCache)
+	{
+		t_vec vec;
+		vec.reserve(pair.first.size() + 1);
+		vec.push_back(pair.second);
+		vec.insert(vec.end(), pair.first.begin(), pair.first.end());
+
+		prop.Add("cache/pt_" + tl::var_to_str(iPt), vec_to_str(vec));
+		++iPt;
+	}
+
+	const std::string strTmpFile = m_strFile + ".tmp";
+	if(!prop.Save(strTmpFile.c_str(), tl::PropType::INFO) ||
+		std::rename(strTmpFile.c_str(), m_strFile.c_str()) != 0)
+	{
+		tl::log_err("Cannot write checkpoint \"", m_strFile, "\".");
+		return false;
+	}
+
+	m_timeLastSave = std::chrono::steady_clock::now();
+	return true;
+}
+
+
+bool FitCheckpoint::Remove() const
+{
+	return std::remove(m_strFile.c_str()) == 0;
+}
+
+
+/**
+ * continue with the random engine where the checkpointed run left off
+ */
+void FitCheckpoint::RestoreRandState() const
+{
+	tl::init_rand_seed(m_iSeed);
+
+	if(m_strRandState != "")
+	{
+		std::istringstream istrRand(m_strRandState);
+		istrRand >> tl::get_randeng();
+	}
+}
+
+
+void FitCheckpoint::SetPhase(Phase phase, bool bValidFit)
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+	m_phase = phase;
+	m_bValidFit = bValidFit;
+}
+
+
+void FitCheckpoint::SetState(const std::vector<std::string>& vecNames,
+	const t_vec& vecValues, const t_vec& vecErrors, const t_vec& vecCov)
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+	m_vecNames = vecNames;
+	m_vecValues = vecValues;
+	m_vecErrors = vecErrors;
+	m_vecCov = vecCov;
+}
+
+
+void FitCheckpoint::ClearCache()
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+	m_mapCache.clear();
+}
+
+
+bool FitCheckpoint::Lookup(const t_vec& vecParams, t_real& dChi2)
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+
+	auto iter = m_mapCache.find(vecParams);
+	if(iter == m_mapCache.end())
+		return false;
+
+	dChi2 = iter->second;
+	++m_iCalls;
+	return true;
+}
+
+
+/**
+ * adds a newly evaluated point and saves the checkpoint if the interval has passed
+ */
+void FitCheckpoint::Insert(const t_vec& vecParams, t_real dChi2)
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+
+	m_mapCache[vecParams] = dChi2;
+	++m_iCalls;
+
+	if(m_dInterval <= t_real(0))
+		return;
+
+	const t_real dSecs = std::chrono::duration<t_real>(
+		std::chrono::steady_clock::now() - m_timeLastSave).count();
+	if(dSecs >= m_dInterval)
+	{
+		if(SaveUnlocked())
+			tl::log_debug("Saved checkpoint after ", m_iCalls, " function calls.");
+	}
+}
+
+// ----------------------------------------------------------------------------
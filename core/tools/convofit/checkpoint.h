@@ -0,0 +1,165 @@
+/**
+ * checkpointing of long-running convolution fits
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __CONVOFIT_CHECKPOINT_H__
+#define __CONVOFIT_CHECKPOINT_H__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <thread>
+
+#include "tlibs/fit/minuit.h"
+
+
+/**
+ * fit state which is periodically written to disk:
+ * the random seed and generator state, the last minimiser state with its
+ * covariance, the number of function calls and all evaluated chi^2 points.
+ *
+ * on resuming, the fit is restarted with the same seed and initial values,
+ * the minimiser then retraces its previous path using the cached chi^2
+ * values and only evaluates the convolution for new points.
+ */
+class FitCheckpoint
+{
+public:
+	using t_real = tl::t_real_min;
+	using t_vec = std::vector<t_real>;
+
+	// last completed stage of the fit
+	enum class Phase : int
+	{
+		START = 0,
+		SURROGATE = 1,      // surrogate minimisation finished, migrad running
+		DONE = 2,           // fit finished
+	};
+
+protected:
+	std::string m_strFile;
+	t_real m_dInterval = 60;                 // minimum time between periodic saves in s, <= 0: only explicit saves
+
+	unsigned int m_iSeed = 0;
+	std::string m_strRandState;              // state of the job thread's random engine
+	std::thread::id m_idJobThread;
+
+	Phase m_phase = Phase::START;
+	bool m_bValidFit = false;
+	std::size_t m_iCalls = 0;                // function calls, including the cached ones
+
+	// last minimiser state
+	std::vector<std::string> m_vecNames;
+	t_vec m_vecValues, m_vecErrors;
+	t_vec m_vecCov;                          // upper triangle of the covariance of the free parameters
+
+	std::map<t_vec, t_real> m_mapCache;      // chi^2 per full parameter vector
+	std::chrono::steady_clock::time_point m_timeLastSave;
+
+	mutable std::mutex m_mtx;
+
+protected:
+	bool SaveUnlocked();
+
+public:
+	FitCheckpoint(const std::string& strFile, t_real dInterval = 60);
+
+	bool Load();
+	bool Save();
+	bool Remove() const;
+
+	const std::string& GetFile() const { return m_strFile; }
+
+	void SetSeed(unsigned int iSeed) { m_iSeed = iSeed; }
+	unsigned int GetSeed() const { return m_iSeed; }
+	void RestoreRandState() const;
+
+	void SetPhase(Phase phase, bool bValidFit = false);
+	Phase GetPhase() const { return m_phase; }
+	bool IsValidFit() const { return m_bValidFit; }
+
+	void SetState(const std::vector<std::string>& vecNames,
+		const t_vec& vecValues, const t_vec& vecErrors, const t_vec& vecCov = {});
+	const std::vector<std::string>& GetStateNames() const { return m_vecNames; }
+	const t_vec& GetStateValues() const { return m_vecValues; }
+	const t_vec& GetStateErrors() const { return m_vecErrors; }
+	const t_vec& GetStateCovariance() const { return m_vecCov; }
+
+	bool Lookup(const t_vec& vecParams, t_real& dChi2);
+	void Insert(const t_vec& vecParams, t_real dChi2);
+	void ClearCache();
+
+	std::size_t GetNumCalls() const { return m_iCalls; }
+	std::size_t GetCacheSize() const { return m_mapCache.size(); }
+};
+
+
+
+/**
+ * chi^2 function answering from the checkpoint cache where possible
+ */
+class CheckpointChi2 : public ROOT::Minuit2::FCNBase
+{
+protected:
+	const ROOT::Minuit2::FCNBase& m_fcn;
+	FitCheckpoint& m_chk;
+
+	// additional key component, e.g. the number of neutrons of a multi-fidelity stage
+	bool m_bTag = false;
+	tl::t_real_min m_dTag = 0;
+
+public:
+	CheckpointChi2(const ROOT::Minuit2::FCNBase& fcn, FitCheckpoint& chk)
+		: m_fcn(fcn), m_chk(chk)
+	{}
+	virtual ~CheckpointChi2() = default;
+
+	void SetTag(tl::t_real_min dTag) { m_dTag = dTag; m_bTag = true; }
+	void ClearTag() { m_bTag = false; }
+
+	virtual tl::t_real_min operator()(const std::vector<tl::t_real_min>& vecParams) const override
+	{
+		std::vector<tl::t_real_min> vecKey = vecParams;
+		if(m_bTag)
+			vecKey.push_back(m_dTag);
+
+		tl::t_real_min dChi2 = 0;
+		if(m_chk.Lookup(vecKey, dChi2))
+			return dChi2;
+
+		dChi2 = m_fcn(vecParams);
+		m_chk.Insert(vecKey, dChi2);
+		return dChi2;
+	}
+
+	virtual tl::t_real_min Up() const override { return m_fcn.Up(); }
+};
+
+
+#endif
@@ -35,6 +35,8 @@
 #include <iostream>
 #include <fstream>
 #include <locale>
+#include <iomanip>
+#include <numeric>
 
 #include <boost/filesystem.hpp>
 namespace fs = boost::filesystem;
@@ -43,9 +45,13 @@ namespace fs = boost::filesystem;
 #include "convofit_import.h"
 #include "scan.h"
 #include "model.h"
+#include "surrogate.h"
+#include "checkpoint.h"
 #include "../monteconvo/monteconvo_common.h"
 #include "../monteconvo/sqwfactory.h"
+#include "../monteconvo/modules/composite.h"
 #include "../res/defs.h"
+#include "libs/globals.h"
 
 using t_real = t_real_reso;
 
@@ -124,6 +130,7 @@ Convofit::~Convofit()
 // global command line overrides
 bool g_bVerbose = false;
 bool g_bSkipFit = false;
+bool g_bResume = false;
 bool g_bUseValuesFromModel = false;
 unsigned int g_iNumNeutrons = 0;
 std::string g_strSetParams;
@@ -171,7 +178,7 @@ bool Convofit::run_job(const std::string& _strJob)
 	}
 
 
-	const unsigned iSeed = tl::get_rand_seed();
+	unsigned iSeed = tl::get_rand_seed();
 	tl::init_rand_seed(iSeed);
 
 	// Parameters
@@ -322,6 +329,13 @@ bool Convofit::run_job(const std::string& _strJob)
 	unsigned iNumNeutrons = prop.Query<unsigned>("montecarlo/neutrons", 1000);
 	unsigned iNumSample = prop.Query<unsigned>("montecarlo/sample_positions", 1);
 	bool bRecycleMC = prop.Query<bool>("montecarlo/recycle_neutrons", true);
+	bool bAnalyticConvo = prop.Query<bool>("montecarlo/analytic", false);
+	bool bCachePartials = prop.Query<bool>("montecarlo/cache_partials", bRecycleMC);
+	t_real dMaxDispCurv = prop.Query<t_real>("montecarlo/analytic_max_curvature", 0.5);
+	bool bNeutronPool = prop.Query<bool>("montecarlo/neutron_pool", false);
+	t_real dPoolFactor = prop.Query<t_real>("montecarlo/pool_factor", 8.);
+	t_real dPoolESS = prop.Query<t_real>("montecarlo/pool_ess", 1.);
+	unsigned iPoolRounds = prop.Query<unsigned>("montecarlo/pool_rounds", 4);
 
 	if(g_iNumNeutrons > 0)
 		iNumNeutrons = g_iNumNeutrons;
@@ -344,9 +358,32 @@ bool Convofit::run_job(const std::string& _strJob)
 	unsigned int iMaxFuncCalls = prop.Query<unsigned>("fitter/max_funccalls", 0);
 	t_real dTolerance = prop.Query<t_real>("fitter/tolerance", 0.5);
 
+	// surrogate minimiser, followed by migrad
+	unsigned int iSurrEvals = prop.Query<unsigned>("fitter/surrogate_evals", 0);
+	unsigned int iSurrInitial = prop.Query<unsigned>("fitter/surrogate_initial", 0);
+	unsigned int iSurrBatch = prop.Query<unsigned>("fitter/surrogate_batch", 0);
+	t_real dSurrRange = prop.Query<t_real>("fitter/surrogate_range", 3.);
+
+	// multi-fidelity schedule: migrad stages with increasing numbers of neutrons
+	bool bMultiFidelity = prop.Query<bool>("fitter/multi_fidelity", false);
+	unsigned int iFidelityStart = prop.Query<unsigned>("fitter/fidelity_start", std::max(iNumNeutrons/16u, 1u));
+	unsigned int iFidelityFactor = prop.Query<unsigned>("fitter/fidelity_factor", 4);
+	unsigned int iFidelityPasses = prop.Query<unsigned>("fitter/fidelity_passes", 3);
+	unsigned int iFidelityNoiseEvals = prop.Query<unsigned>("fitter/fidelity_noise_evals", 4);
+	t_real dFidelityNoiseRatio = prop.Query<t_real>("fitter/fidelity_noise_ratio", 0.5);
+	t_real dFidelitySmoothing = prop.Query<t_real>("fitter/fidelity_smoothing", 1.);
+	iFidelityFactor = std::max(iFidelityFactor, 2u);
+	iFidelityPasses = std::max(iFidelityPasses, 1u);
+	iFidelityNoiseEvals = std::max(iFidelityNoiseEvals, 2u);
+
+	// periodically save the fit state to be able to resume it
+	bool bCheckpoint = prop.Query<bool>("fitter/checkpoint", true);
+	t_real dCheckpointInterval = prop.Query<t_real>("fitter/checkpoint_interval", 60.);
+
 	std::string strScOutFile = prop.Query<std::string>("output/scan_file");
 	std::string strModOutFile = prop.Query<std::string>("output/model_file");
 	std::string strLogOutFile = prop.Query<std::string>("output/log_file");
+	std::string strChkOutFile = prop.Query<std::string>("output/checkpoint_file");
 	bool bPlot = prop.Query<bool>("output/plot", false);
 	bool bPlotIntermediate = prop.Query<bool>("output/plot_intermediate", false);
 
@@ -376,7 +413,9 @@ bool Convofit::run_job(const std::string& _strJob)
 	std::unique_ptr<std::ostream> ofstrLog;
 	if(strLogOutFile != "")
 	{
-		ofstrLog.reset(new std::ofstream(strLogOutFile));
+		// continue the log of a resumed fit
+		ofstrLog.reset(new std::ofstream(strLogOutFile,
+			g_bResume ? std::ios_base::app : std::ios_base::out));
 
 		for(tl::Log* plog : { &tl::log_info, &tl::log_warn, &tl::log_err, &tl::log_crit, &tl::log_debug })
 			plog->AddOstr(ofstrLog.get(), 0, 1);
@@ -477,6 +516,52 @@ bool Convofit::run_job(const std::string& _strJob)
 		strModOutFile += g_strOutFileSuffix;
 	}
 
+	if(strChkOutFile == "")
+		strChkOutFile = strModOutFile + ".chk";
+	else if(g_strOutFileSuffix != "")
+		strChkOutFile += g_strOutFileSuffix;
+
+
+	// --------------------------------------------------------------------
+	// checkpoint
+	std::unique_ptr<FitCheckpoint> pChk;
+	bool bSurrogateDone = false;
+	if(bDoFit && bCheckpoint)
+	{
+		pChk.reset(new FitCheckpoint(strChkOutFile, dCheckpointInterval));
+
+		if(g_bResume && pChk->Load())
+		{
+			if(pChk->GetPhase() == FitCheckpoint::Phase::DONE)
+			{
+				tl::log_info("Job was already finished according to checkpoint \"",
+					strChkOutFile, "\", skipping it.");
+
+				if(!!ofstrLog)
+				{
+					for(tl::Log* plog : { &tl::log_info, &tl::log_warn, &tl::log_err, &tl::log_crit, &tl::log_debug })
+						plog->RemoveOstr(ofstrLog.get());
+				}
+				return pChk->IsValidFit();
+			}
+
+			// continue with the previous random numbers
+			iSeed = pChk->GetSeed();
+			pChk->RestoreRandState();
+			bSurrogateDone = (pChk->GetPhase() == FitCheckpoint::Phase::SURROGATE);
+
+			tl::log_info("Resuming from checkpoint \"", strChkOutFile, "\" with ",
+				pChk->GetCacheSize(), " cached function values, seed: ", iSeed, ".");
+		}
+		else
+		{
+			if(g_bResume)
+				tl::log_warn("No valid checkpoint \"", strChkOutFile, "\" found, starting a new fit.");
+			pChk->SetSeed(iSeed);
+		}
+	}
+	// --------------------------------------------------------------------
+
 
 
 	// --------------------------------------------------------------------
@@ -658,9 +743,12 @@ bool Convofit::run_job(const std::string& _strJob)
 		}
 	});
 
+	// seed for recycled neutrons, only changed temporarily to estimate the monte-carlo noise
+	unsigned int iMCSeed = iSeed;
+
 	// callback for changed parameters
 	mod.AddParamsChangedSlot(
-	[&vecModTmpX, &vecModTmpY, bPlotIntermediate, iSeed, bRecycleMC](const std::string& strDescr)
+	[&vecModTmpX, &vecModTmpY, bPlotIntermediate, &iMCSeed, bRecycleMC](const std::string& strDescr)
 	{
 		tl::log_info("Changed model parameters: ", strDescr);
 
@@ -673,8 +761,8 @@ bool Convofit::run_job(const std::string& _strJob)
 		// do we use the same MC neutrons again?
 		if(bRecycleMC)
 		{
-			tl::init_rand_seed(iSeed);
-			tl::log_debug("Resetting random seed to ", iSeed, ".");
+			tl::init_rand_seed(iMCSeed);
+			tl::log_debug("Resetting random seed to ", iMCSeed, ".");
 		}
 	});
 
@@ -688,6 +776,27 @@ bool Convofit::run_job(const std::string& _strJob)
 	// execution has to be in a determined order to recycle the same neutrons
 	mod.SetUseThreads(!bRecycleMC);
 
+	if(bCachePartials && dynamic_cast<SqwComposite*>(pSqw.get()))
+	{
+		tl::log_info("Caching the partial intensities of the S(Q, E) components.");
+		mod.SetCachePartials(true);
+	}
+
+	if(bAnalyticConvo)
+	{
+		tl::log_info("Using analytic convolution for dispersion models where applicable.");
+		mod.SetAnalyticConvo(true);
+		mod.SetMaxDispCurvature(dMaxDispCurv);
+	}
+
+	if(bNeutronPool)
+	{
+		tl::log_info("Sharing the neutrons between all scan points.");
+		mod.SetNeutronPool(true, dPoolFactor, dPoolESS, iPoolRounds);
+		for(std::size_t iSc=0; iSc<vecSc.size(); ++iSc)
+			mod.SetPoolPositions(iSc, vecSc[iSc].vecX);
+	}
+
 	if(bTempOverride)
 	{
 		for(Scan& sc : vecSc)
@@ -791,13 +900,53 @@ bool Convofit::run_job(const std::string& _strJob)
 	mod.SetMinuitParams(params);
 
 
+	// answer the already evaluated points from the checkpoint
+	std::unique_ptr<CheckpointChi2> pChkFkt;
+	const minuit::FCNBase* pFkt = &chi2fkt;
+	if(pChk)
+	{
+		pChkFkt.reset(new CheckpointChi2(chi2fkt, *pChk));
+		pFkt = pChkFkt.get();
+	}
+
+	// saves the minimiser state to the checkpoint
+	auto save_checkpoint = [&pChk](const minuit::MnUserParameters& params,
+		FitCheckpoint::Phase phase, bool bValid, const std::vector<double>& vecCov)
+	{
+		if(!pChk)
+			return;
+
+		std::vector<std::string> vecNames;
+		for(const minuit::MinuitParameter& param : params.Parameters())
+			vecNames.push_back(param.GetName());
+
+		pChk->SetState(vecNames, params.Params(), params.Errors(), vecCov);
+		pChk->SetPhase(phase, bValid);
+		pChk->Save();
+	};
+
+
 	minuit::MnStrategy strat(iStrat);
 
+	const bool bSurrogate = (strMinimiser == "surrogate");
+
+	// the surrogate minimisation has already finished in the checkpointed run
+	if(bSurrogate && bSurrogateDone)
+	{
+		const std::vector<std::string>& vecNames = pChk->GetStateNames();
+		const std::vector<double>& vecValues = pChk->GetStateValues();
+		for(std::size_t iParam = 0; iParam < vecNames.size(); ++iParam)
+			params.SetValue(vecNames[iParam], vecValues[iParam]);
+		mod.SetMinuitParams(params);
+
+		tl::log_info("Skipping surrogate minimisation, using the values from the checkpoint.");
+	}
+
 	std::unique_ptr<minuit::MnApplication> pmini;
 	if(strMinimiser == "simplex")
-		pmini.reset(new minuit::MnSimplex(chi2fkt, params, strat));
-	else if(strMinimiser == "migrad")
-		pmini.reset(new minuit::MnMigrad(chi2fkt, params, strat));
+		pmini.reset(new minuit::MnSimplex(*pFkt, params, strat));
+	else if(strMinimiser == "migrad" || bSurrogate)
+		pmini.reset(new minuit::MnMigrad(*pFkt, params, strat));
 	else
 	{
 		tl::log_err("Invalid minimiser selected: \"", strMinimiser, "\".");
@@ -805,6 +954,164 @@ bool Convofit::run_job(const std::string& _strJob)
 	}
 
 	bool bValidFit = 0;
+	if(bDoFit && bSurrogate && !bSurrogateDone)
+	{
+		// search the free parameters within their limits or within a range of their errors
+		std::vector<std::size_t> vecFreeIdx;
+		std::vector<t_real> vecStart, vecMin, vecMax;
+		const std::vector<double> vecAllParams = params.Params();
+
+		for(std::size_t iParam = 0; iParam < params.Parameters().size(); ++iParam)
+		{
+			const minuit::MinuitParameter& param = params.Parameters()[iParam];
+			if(param.IsFixed() || param.IsConst())
+				continue;
+
+			t_real dMin = param.Value() - dSurrRange*std::abs(param.Error());
+			t_real dMax = param.Value() + dSurrRange*std::abs(param.Error());
+			if(param.HasLowerLimit())
+				dMin = std::max<t_real>(dMin, param.LowerLimit());
+			if(param.HasUpperLimit())
+				dMax = std::min<t_real>(dMax, param.UpperLimit());
+			if(!(dMax > dMin))
+				continue;
+
+			vecFreeIdx.push_back(iParam);
+			vecStart.push_back(param.Value());
+			vecMin.push_back(dMin);
+			vecMax.push_back(dMax);
+		}
+
+		auto funcChi2 = [pFkt, &vecAllParams, &vecFreeIdx](const std::vector<t_real>& vecFree) -> t_real
+		{
+			std::vector<double> vecParams = vecAllParams;
+			for(std::size_t i = 0; i < vecFreeIdx.size(); ++i)
+				vecParams[vecFreeIdx[i]] = vecFree[i];
+			return t_real((*pFkt)(vecParams));
+		};
+
+		// recycled neutrons and intermediate plots need a fixed evaluation order
+		unsigned int iSurrThreads = get_max_threads();
+		if(bRecycleMC || bPlotIntermediate)
+			iSurrThreads = 1;
+		if(!iSurrBatch)
+			iSurrBatch = iSurrThreads;
+
+		SurrogateMinimiser surr(funcChi2, vecStart, vecMin, vecMax, iSeed);
+		surr.SetMaxEvals(iSurrEvals);
+		surr.SetInitialEvals(iSurrInitial);
+		surr.SetBatchSize(iSurrBatch);
+		surr.SetMaxThreads(iSurrThreads);
+
+		tl::log_info("Performing surrogate minimisation of ", vecFreeIdx.size(), " parameter(s), ",
+			"batch size: ", iSurrBatch, ", threads: ", iSurrThreads, ".");
+		const std::vector<t_real>& vecBest = surr.Minimise();
+		tl::log_info("Surrogate minimisation took ", surr.GetNumEvals(),
+			" evaluations, best chi2 = ", surr.GetBestChi2(), ".");
+
+		for(std::size_t i = 0; i < vecFreeIdx.size(); ++i)
+			params.SetValue(vecFreeIdx[i], vecBest[i]);
+		mod.SetMinuitParams(params);
+		save_checkpoint(params, FitCheckpoint::Phase::SURROGATE, false, {});
+
+		// migrad polishes the result and calculates the errors
+		pmini.reset(new minuit::MnMigrad(*pFkt, params, strat));
+	}
+
+
+	// mean and standard deviation of chi^2 for different monte-carlo neutrons
+	auto estimate_noise = [&chi2fkt, &iMCSeed, iSeed, iFidelityNoiseEvals]
+		(const std::vector<double>& vecParams, t_real& dMean, t_real& dStdDev)
+	{
+		std::vector<t_real> vecChi2;
+		vecChi2.reserve(iFidelityNoiseEvals);
+
+		// without recycling, every evaluation uses new neutrons anyway
+		for(unsigned int iEval = 0; iEval < iFidelityNoiseEvals; ++iEval)
+		{
+			iMCSeed = iSeed + iEval + 1;
+			vecChi2.push_back(t_real(chi2fkt(vecParams)));
+		}
+		iMCSeed = iSeed;
+
+		dMean = std::accumulate(vecChi2.begin(), vecChi2.end(), t_real(0)) / t_real(vecChi2.size());
+		dStdDev = 0;
+		for(t_real dChi2 : vecChi2)
+			dStdDev += (dChi2 - dMean)*(dChi2 - dMean);
+		dStdDev = std::sqrt(dStdDev / t_real(vecChi2.size() - 1));
+	};
+
+	struct FidelityStage
+	{
+		unsigned int iNeutrons = 0;
+		t_real dUp = 0;
+		t_real dChi2Start = 0, dChi2End = 0, dNoise = 0;
+		unsigned int iCalls = 0;
+	};
+	std::vector<FidelityStage> vecStages;
+
+	if(bDoFit && bMultiFidelity && strMinimiser == "simplex")
+	{
+		tl::log_warn("Multi-fidelity schedule is only available for the migrad minimiser, ignoring it.");
+	}
+	else if(bDoFit && bMultiFidelity && iFidelityStart < iNumNeutrons)
+	{
+		tl::log_info("Performing multi-fidelity minimisation from ", iFidelityStart,
+			" to ", iNumNeutrons, " neutrons.");
+
+		unsigned int iNeutrons = iFidelityStart;
+		unsigned int iPasses = 0;
+
+		while(iNeutrons < iNumNeutrons)
+		{
+			mod.SetNumNeutrons(iNeutrons);
+			// the cached chi^2 values depend on the number of neutrons
+			if(pChkFkt)
+				pChkFkt->SetTag(tl::t_real_min(iNeutrons));
+
+			FidelityStage stage;
+			stage.iNeutrons = iNeutrons;
+			estimate_noise(params.Params(), stage.dChi2Start, stage.dNoise);
+
+			// smooth the chi^2 by raising migrad's error definition to the noise level,
+			// this also widens the steps of its numerical derivatives
+			stage.dUp = std::max(dSigma*dSigma, dFidelitySmoothing*stage.dNoise);
+			chi2fkt.SetSigma(std::sqrt(stage.dUp));
+
+			minuit::MnMigrad migrad(*pFkt, params, strat);
+			minuit::FunctionMinimum mini = migrad(iMaxFuncCalls, dTolerance);
+			params = mini.UserState().Parameters();
+			mod.SetMinuitParams(params);
+
+			stage.dChi2End = t_real(mini.Fval());
+			stage.iCalls = unsigned(mini.NFcn());
+			vecStages.push_back(stage);
+
+			const t_real dImprovement = stage.dChi2Start - stage.dChi2End;
+			tl::log_info("Multi-fidelity stage ", vecStages.size(), ": ", iNeutrons, " neutrons",
+				", chi2 = ", stage.dChi2Start, " -> ", stage.dChi2End,
+				", noise = ", stage.dNoise, ", error definition = ", stage.dUp,
+				", function calls: ", stage.iCalls, ".");
+
+			// raise the number of neutrons if the improvements drown in the monte-carlo noise
+			++iPasses;
+			if(dImprovement <= 0. || stage.dNoise >= dFidelityNoiseRatio*dImprovement
+				|| iPasses >= iFidelityPasses)
+			{
+				iNeutrons = unsigned(std::min<unsigned long>(
+					(unsigned long)iNeutrons * iFidelityFactor, iNumNeutrons));
+				iPasses = 0;
+			}
+		}
+
+		// the final migrad stage uses all neutrons and the unsmoothed chi^2 for the errors
+		mod.SetNumNeutrons(iNumNeutrons);
+		if(pChkFkt)
+			pChkFkt->ClearTag();
+		chi2fkt.SetSigma(dSigma);
+		pmini.reset(new minuit::MnMigrad(*pFkt, params, strat));
+	}
+
 	if(bDoFit)
 	{
 		tl::log_info("Performing fit.");
@@ -813,6 +1120,44 @@ bool Convofit::run_job(const std::string& _strJob)
 		bValidFit = mini.IsValid() && mini.HasValidParameters() && state.IsValid();
 		mod.SetMinuitParams(state);
 
+		if(vecStages.size())
+		{
+			// high-statistics evaluation at the final minimum
+			t_real dChi2 = 0, dNoise = 0;
+			estimate_noise(state.Parameters().Params(), dChi2, dNoise);
+
+			std::ostringstream ostrSched;
+			ostrSched.precision(g_iPrec);
+			ostrSched << "Multi-fidelity schedule:\n";
+			ostrSched << std::setw(8) << "stage" << std::setw(12) << "neutrons"
+				<< std::setw(16) << "chi2_start" << std::setw(16) << "chi2_end"
+				<< std::setw(16) << "noise" << std::setw(16) << "error_def"
+				<< std::setw(10) << "calls" << "\n";
+			for(std::size_t iStage = 0; iStage < vecStages.size(); ++iStage)
+			{
+				const FidelityStage& stage = vecStages[iStage];
+				ostrSched << std::setw(8) << (iStage+1) << std::setw(12) << stage.iNeutrons
+					<< std::setw(16) << stage.dChi2Start << std::setw(16) << stage.dChi2End
+					<< std::setw(16) << stage.dNoise << std::setw(16) << stage.dUp
+					<< std::setw(10) << stage.iCalls << "\n";
+			}
+			ostrSched << std::setw(8) << "final" << std::setw(12) << iNumNeutrons
+				<< std::setw(16) << "-" << std::setw(16) << mini.Fval()
+				<< std::setw(16) << dNoise << std::setw(16) << chi2fkt.Up()
+				<< std::setw(10) << mini.NFcn() << "\n";
+			ostrSched << "High-statistics chi2 at the minimum: " << dChi2 << " +- " << dNoise << ".";
+			tl::log_info(ostrSched.str());
+		}
+
+		// keep the final state and its covariance until the results are written
+		if(pChk)
+		{
+			tl::log_info("Fit took ", pChk->GetNumCalls(), " function calls at ",
+				pChk->GetCacheSize(), " distinct points.");
+			save_checkpoint(state.Parameters(), pChk->GetPhase(), bValidFit,
+				state.HasCovariance() ? state.Covariance().Data() : std::vector<double>{});
+		}
+
 		std::ostringstream ostrMini;
 		ostrMini << "Final fit results: " << mini << "\n";
 		tl::log_info(ostrMini.str(), "Fit valid: ", bValidFit);
@@ -843,6 +1188,14 @@ bool Convofit::run_job(const std::string& _strJob)
 		mod.Save(strCurModOutFile.c_str(), iPlotPoints, iPlotPointsSkipBegin, iPlotPointsSkipEnd);
 		save_file(strCurScOutFile.c_str(), sc);
 	}
+
+	// mark the job as finished, the cached function values are not needed anymore
+	if(pChk)
+	{
+		pChk->ClearCache();
+		pChk->SetPhase(FitCheckpoint::Phase::DONE, bValidFit);
+		pChk->Save();
+	}
 	// --------------------------------------------------------------------
 
 
@@ -84,6 +84,9 @@ int convofit_main(int argc, char** argv)
 		args.add(boost::make_shared<opts::option_description>(
 			"skip-fit", opts::bool_switch(&g_bSkipFit),
 			"skip the fitting step"));
+		args.add(boost::make_shared<opts::option_description>(
+			"resume", opts::bool_switch(&g_bResume),
+			"resume fits from their checkpoints and skip finished jobs"));
 		args.add(boost::make_shared<opts::option_description>(
 			"keep-model", opts::bool_switch(&g_bUseValuesFromModel),
 			"keep the initial values from the model file"));
@@ -126,6 +126,10 @@ std::string convert_monteconvo(
 		propMC.Query<std::string>("taz/monteconvo/sample_step_count", "1");
 	mapJob["montecarlo/recycle_neutrons"] =
 		propMC.Query<std::string>("taz/convofit/recycle_neutrons", "1");
+	mapJob["montecarlo/analytic"] =
+		propMC.Query<std::string>("taz/monteconvo/analytic_convo", "0");
+	mapJob["montecarlo/neutron_pool"] =
+		propMC.Query<std::string>("taz/monteconvo/neutron_pool", "0");
 
 	// fitting
 	std::string strMin = "simplex";
@@ -27,6 +27,7 @@
  */
 
 #include <fstream>
+#include <algorithm>
 
 #include "model.h"
 #include "tlibs/math/math.h"
@@ -37,6 +38,7 @@
 #include "../res/defs.h"
 #include "../res/ellipse.h"
 #include "convofit.h"
+#include "../monteconvo/modules/composite.h"
 
 
 using t_real = t_real_mod;
@@ -91,41 +93,233 @@ bool SqwFuncModel::SetTASPos(t_real dPrincipalX, TASReso& reso) const
 }
 
 
-tl::t_real_min SqwFuncModel::operator()(tl::t_real_min x_principal) const
+/**
+ * convolution of the S(Q, E) model at the given scan position, including R0 and background,
+ * for composite models, the scaled partial intensities of the components are also returned
+ */
+t_real SqwFuncModel::Convolve(TASReso& reso, t_real x_principal, std::vector<t_real>* pvecPartials) const
 {
-	TASReso/*&*/ reso = *GetTASReso();
-	if(!SetTASPos(t_real_mod(x_principal), reso))
-		return 0.;
-
 	const t_real xrange = t_real(m_dPrincipalAxisMax - m_dPrincipalAxisMin);
 	const t_real xscale = (t_real(x_principal) - t_real(m_dPrincipalAxisMin)) / xrange;
 	const ublas::vector<t_real> vecScanPos = m_vecScanOrigin + t_real(xscale)*m_vecScanDir;
 
-	std::vector<ublas::vector<t_real_reso>> vecNeutrons;
-	Ellipsoid4d<t_real_reso> elli;
-	if(m_bUseThreads)
-		elli = reso.GenerateMC(m_iNumNeutrons, vecNeutrons);
-	else
-		elli = reso.GenerateMC_deferred(m_iNumNeutrons, vecNeutrons);
+	const t_real dR0 = reso.GetResoResults().dR0 * reso.GetR0Scale();
+	const SqwComposite *pComp = dynamic_cast<const SqwComposite*>(m_pSqw.get());
+
+	// the monte-carlo sums are normalised to the neutrons per sample position,
+	// scale the means of the analytic and pooled convolutions accordingly
+	const t_real dSamplePos = t_real(reso.GetRandomSamplePos());
+
+	if(!pComp)
+	{
+		t_real dS = 0.;
+
+		// analytic convolution along the dispersion if possible, otherwise fall back to monte-carlo
+		t_real_reso dSDisp = 0.;
+		std::vector<t_real> vecPooled;
+		if(m_bAnalyticConvo && reso.ConvolveDisp(*m_pSqw, dSDisp, m_dMaxDispCurv))
+		{
+			dS = t_real(dSDisp) * dSamplePos;
+		}
+		else if(ConvolvePooled(x_principal, vecPooled))
+		{
+			dS = vecPooled[0] * dSamplePos;
+		}
+		else
+		{
+			std::vector<ublas::vector<t_real_reso>> vecNeutrons;
+			if(m_bUseThreads)
+				reso.GenerateMC(m_iNumNeutrons, vecNeutrons);
+			else
+				reso.GenerateMC_deferred(m_iNumNeutrons, vecNeutrons);
+
+			for(const ublas::vector<t_real_reso>& vecHKLE : vecNeutrons)
+				dS += t_real((*m_pSqw)(vecHKLE[0], vecHKLE[1], vecHKLE[2], vecHKLE[3]));
+
+			dS /= t_real(m_iNumNeutrons);
+		}
+
+		dS += m_pSqw->GetBackground(vecScanPos[0], vecScanPos[1], vecScanPos[2], vecScanPos[3]);
+
+		if(pvecPartials)
+			pvecPartials->clear();
+		return dS * dR0;
+	}
+
+
+	// composite model: all components are evaluated on the same neutrons
+	const std::size_t iNumComps = pComp->GetComponentCount();
+	std::vector<t_real> vecPartials;
+	bool bCached = false;
+
+	std::string strShapeKey;
+	const auto cacheKey = std::make_tuple(m_iCurParamSet, m_iNumNeutrons, t_real(x_principal));
+	if(m_bCachePartials && m_pPartialCache)
+	{
+		strShapeKey = pComp->GetShapeKey();
+
+		std::lock_guard<std::mutex> lock(m_pPartialCache->mtx);
+		auto iter = m_pPartialCache->mapEntries.find(cacheKey);
+		if(iter != m_pPartialCache->mapEntries.end() && iter->second.strShapeKey == strShapeKey)
+		{
+			vecPartials = iter->second.vecPartials;
+			bCached = true;
+		}
+	}
+
+	if(!bCached)
+	{
+		vecPartials.resize(iNumComps, t_real(0));
+		std::vector<t_real_reso> vecCur;
+
+		if(ConvolvePooled(x_principal, vecPartials))
+		{
+			for(std::size_t iComp=0; iComp<iNumComps; ++iComp)
+				vecPartials[iComp] *= dSamplePos;
+		}
+		else
+		{
+			vecPartials.assign(iNumComps, t_real(0));
+
+			std::vector<ublas::vector<t_real_reso>> vecNeutrons;
+			if(m_bUseThreads)
+				reso.GenerateMC(m_iNumNeutrons, vecNeutrons);
+			else
+				reso.GenerateMC_deferred(m_iNumNeutrons, vecNeutrons);
+
+			for(const ublas::vector<t_real_reso>& vecHKLE : vecNeutrons)
+			{
+				pComp->GetPartials(vecHKLE[0], vecHKLE[1], vecHKLE[2], vecHKLE[3], vecCur);
+				for(std::size_t iComp=0; iComp<iNumComps; ++iComp)
+					vecPartials[iComp] += t_real(vecCur[iComp]);
+			}
+
+			for(std::size_t iComp=0; iComp<iNumComps; ++iComp)
+				vecPartials[iComp] /= t_real(m_iNumNeutrons);
+		}
+
+		pComp->GetPartialBackgrounds(vecScanPos[0], vecScanPos[1], vecScanPos[2], vecScanPos[3], vecCur);
+		for(std::size_t iComp=0; iComp<iNumComps; ++iComp)
+		{
+			vecPartials[iComp] += t_real(vecCur[iComp]);
+			vecPartials[iComp] *= dR0;
+		}
+
+		if(m_bCachePartials && m_pPartialCache)
+		{
+			std::lock_guard<std::mutex> lock(m_pPartialCache->mtx);
+			m_pPartialCache->mapEntries[cacheKey] = PartialCacheEntry{strShapeKey, vecPartials};
+		}
+	}
 
 	t_real dS = 0.;
-	t_real dhklE_mean[4] = { 0., 0., 0., 0. };
+	for(std::size_t iComp=0; iComp<iNumComps; ++iComp)
+	{
+		vecPartials[iComp] *= t_real(pComp->GetComponentScale(iComp));
+		dS += vecPartials[iComp];
+	}
+
+	if(pvecPartials)
+		*pvecPartials = std::move(vecPartials);
+	return dS;
+}
+
+
+/**
+ * mean S(Q, E), or the mean partial intensities of a composite model, at a scan position
+ * using the neutron pool of the current param set, which is built on first use.
+ * returns false if no pool is used or if the position is not part of it.
+ */
+bool SqwFuncModel::ConvolvePooled(t_real x_principal, std::vector<t_real>& vecVals) const
+{
+	if(!m_pPoolCache)
+		return false;
 
-	for(const ublas::vector<t_real_reso>& vecHKLE : vecNeutrons)
+	PoolCacheEntry entry;
 	{
-		dS += t_real((*m_pSqw)(vecHKLE[0], vecHKLE[1], vecHKLE[2], vecHKLE[3]));
+		std::lock_guard<std::mutex> lock(m_pPoolCache->mtx);
+
+		const auto cacheKey = std::make_tuple(m_iCurParamSet, m_iNumNeutrons);
+		auto iter = m_pPoolCache->mapEntries.find(cacheKey);
+		if(iter == m_pPoolCache->mapEntries.end())
+		{
+			auto iterPos = m_pPoolCache->mapPositions.find(m_iCurParamSet);
+			if(iterPos == m_pPoolCache->mapPositions.end())
+				return false;
+
+			PoolCacheEntry newentry;
+			newentry.pPool = std::make_shared<NeutronPool>();
+			for(t_real dX : iterPos->second)
+			{
+				TASReso reso = *GetTASReso();
+				if(!SetTASPos(dX, reso) || !newentry.pPool->AddPoint(reso))
+					continue;
+				newentry.vecX.push_back(dX);
+			}
+
+			tl::log_info("Building neutron pool for scan group ", m_iCurParamSet, ".");
+			newentry.pPool->Build(m_iNumNeutrons, m_dPoolFactor, m_dPoolESS, m_iPoolRounds);
+			newentry.pPool->LogStats();
 
-		for(int i = 0; i < 4; ++i)
-			dhklE_mean[i] += t_real(vecHKLE[i]);
+			iter = m_pPoolCache->mapEntries.emplace(cacheKey, std::move(newentry)).first;
+		}
+
+		entry = iter->second;
+	}
+
+	auto iterX = std::find(entry.vecX.begin(), entry.vecX.end(), x_principal);
+	if(iterX == entry.vecX.end())
+		return false;
+
+	// evaluate the model once on all pool neutrons for the current parameters
+	if(m_pEvaluatedPool != entry.pPool)
+	{
+		const SqwComposite *pComp = dynamic_cast<const SqwComposite*>(m_pSqw.get());
+
+		if(pComp)
+		{
+			const std::size_t iNumComps = pComp->GetComponentCount();
+			m_vecPoolResults = entry.pPool->Evaluate([pComp, iNumComps](
+				const NeutronPool::t_vec& vecHKLE, std::vector<t_real_reso>& vecCur)
+			{
+				pComp->GetPartials(vecHKLE[0], vecHKLE[1], vecHKLE[2], vecHKLE[3], vecCur);
+				vecCur.resize(iNumComps);
+			}, iNumComps);
+		}
+		else
+		{
+			const SqwBase *pSqw = m_pSqw.get();
+			m_vecPoolResults = entry.pPool->Evaluate([pSqw](
+				const NeutronPool::t_vec& vecHKLE, std::vector<t_real_reso>& vecCur)
+			{
+				vecCur[0] = (*pSqw)(vecHKLE[0], vecHKLE[1], vecHKLE[2], vecHKLE[3]);
+			});
+		}
+
+		m_pEvaluatedPool = entry.pPool;
 	}
 
-	dS /= t_real(m_iNumNeutrons);
-	dS += m_pSqw->GetBackground(vecScanPos[0], vecScanPos[1], vecScanPos[2], vecScanPos[3]);
+	vecVals = m_vecPoolResults[iterX - entry.vecX.begin()];
+	return !vecVals.empty();
+}
+
+
+
+/**
+ * model intensity at the given scan position,
+ * optionally also returns the scaled intensities of the components of composite models
+ */
+t_real SqwFuncModel::Eval(t_real x_principal, std::vector<t_real>* pvecComps) const
+{
+	TASReso/*&*/ reso = *GetTASReso();
+	if(!SetTASPos(t_real_mod(x_principal), reso))
+		return 0.;
 
-	for(int i = 0; i < 4; ++i)
-		dhklE_mean[i] /= t_real(m_iNumNeutrons);
+	const t_real xrange = t_real(m_dPrincipalAxisMax - m_dPrincipalAxisMin);
+	const t_real xscale = (t_real(x_principal) - t_real(m_dPrincipalAxisMin)) / xrange;
+	const ublas::vector<t_real> vecScanPos = m_vecScanOrigin + t_real(xscale)*m_vecScanDir;
 
-	dS *= reso.GetResoResults().dR0 * reso.GetR0Scale();
+	t_real dS = Convolve(reso, x_principal, pvecComps);
 	//if(reso.GetResoParams().flags & CALC_RESVOL)
 	//	dS /= reso.GetResoResults().dResVol * tl::get_pi<t_real>() * t_real(3.);
 
@@ -133,12 +327,72 @@ tl::t_real_min SqwFuncModel::operator()(tl::t_real_min x_principal) const
 	if(dYVal < 0.)
 		dYVal = 0.;
 
+	if(pvecComps)
+	{
+		for(t_real& dComp : *pvecComps)
+			dComp *= m_dScale;
+	}
+
 	if(m_psigFuncResult)
 	{
 		(*m_psigFuncResult)(vecScanPos[0], vecScanPos[1], vecScanPos[2], vecScanPos[3],
 			dYVal, m_iCurParamSet);
 	}
-	return tl::t_real_min(dYVal);
+	return dYVal;
+}
+
+
+tl::t_real_min SqwFuncModel::operator()(tl::t_real_min x_principal) const
+{
+	return tl::t_real_min(Eval(t_real(x_principal)));
+}
+
+
+void SqwFuncModel::SetCachePartials(bool b)
+{
+	m_bCachePartials = b;
+	if(m_bCachePartials && !m_pPartialCache)
+		m_pPartialCache = std::make_shared<PartialCache>();
+	else if(!m_bCachePartials)
+		m_pPartialCache.reset();
+}
+
+
+void SqwFuncModel::SetNeutronPool(bool b, t_real dFactor, t_real dESS, unsigned int iRounds)
+{
+	m_dPoolFactor = dFactor;
+	m_dPoolESS = dESS;
+	m_iPoolRounds = iRounds;
+
+	if(b && !m_pPoolCache)
+		m_pPoolCache = std::make_shared<PoolCache>();
+	else if(!b)
+		m_pPoolCache.reset();
+
+	m_vecPoolResults.clear();
+	m_pEvaluatedPool.reset();
+}
+
+
+/**
+ * sets the scan positions of a param set which are convoluted using a neutron pool
+ */
+void SqwFuncModel::SetPoolPositions(std::size_t iSet, const std::vector<t_real>& vecX)
+{
+	if(!m_pPoolCache)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_pPoolCache->mtx);
+	m_pPoolCache->mapPositions[iSet] = vecX;
+
+	// rebuild the pools of this param set
+	for(auto iter = m_pPoolCache->mapEntries.begin(); iter != m_pPoolCache->mapEntries.end();)
+	{
+		if(std::get<0>(iter->first) == iSet)
+			iter = m_pPoolCache->mapEntries.erase(iter);
+		else
+			++iter;
+	}
 }
 
 
@@ -155,6 +409,14 @@ SqwFuncModel* SqwFuncModel::copy() const
 
 	pMod->m_iNumNeutrons = this->m_iNumNeutrons;
 	pMod->m_bUseThreads = this->m_bUseThreads;
+	pMod->m_bAnalyticConvo = this->m_bAnalyticConvo;
+	pMod->m_dMaxDispCurv = this->m_dMaxDispCurv;
+	pMod->m_bCachePartials = this->m_bCachePartials;
+	pMod->m_pPartialCache = this->m_pPartialCache;
+	pMod->m_pPoolCache = this->m_pPoolCache;
+	pMod->m_dPoolFactor = this->m_dPoolFactor;
+	pMod->m_dPoolESS = this->m_dPoolESS;
+	pMod->m_iPoolRounds = this->m_iPoolRounds;
 
 	pMod->m_dScale = this->m_dScale;
 	pMod->m_dSlope = this->m_dSlope;
@@ -202,6 +464,9 @@ void SqwFuncModel::SetOtherParams(t_real dTemperature, t_real dField)
 	if(m_strFieldParamName != "")
 		vecVars.push_back(std::make_tuple(m_strFieldParamName, "double", tl::var_to_str(dField, NUM_PREC)));
 	m_pSqw->SetVars(vecVars);
+
+	m_vecPoolResults.clear();
+	m_pEvaluatedPool.reset();
 }
 
 
@@ -219,6 +484,9 @@ void SqwFuncModel::SetModelParams()
 	}
 
 	m_pSqw->SetVars(vecVars);
+
+	m_vecPoolResults.clear();
+	m_pEvaluatedPool.reset();
 }
 
 
@@ -483,7 +751,15 @@ bool SqwFuncModel::Save(const char *pcFile, std::size_t iNum, std::size_t iSkipB
 		}
 
 		ofstr << "## Data columns: (1) scan axis, (2) intensity";
-		ofstr << ", (3) Bragg Qx (rlu), (4) Bragg Qy (rlu), (5) Bragg Qz (rlu), (6) Bragg E (meV)\n";
+		ofstr << ", (3) Bragg Qx (rlu), (4) Bragg Qy (rlu), (5) Bragg Qz (rlu), (6) Bragg E (meV)";
+
+		// additional columns for the components of composite models
+		if(const SqwComposite *pComp = dynamic_cast<const SqwComposite*>(m_pSqw.get()))
+		{
+			for(std::size_t iComp=0; iComp<pComp->GetComponentCount(); ++iComp)
+				ofstr << ", (" << (iComp+7) << ") intensity of " << pComp->GetComponentName(iComp);
+		}
+		ofstr << "\n";
 
 		std::vector<t_real> vecFWHMs[4];
 
@@ -492,7 +768,8 @@ bool SqwFuncModel::Save(const char *pcFile, std::size_t iNum, std::size_t iSkipB
 		for(std::size_t i=iSkipBegin; i<iNum-iSkipEnd; ++i)
 		{
 			t_real dX = tl::lerp(t_real(m_dPrincipalAxisMin), t_real(m_dPrincipalAxisMax), t_real(i)/t_real(iNum-1));
-			t_real dY = (*this)(dX);
+			std::vector<t_real> vecComps;
+			t_real dY = Eval(dX, &vecComps);
 
 			ofstr << std::left << std::setw(NUM_PREC*2) << dX << " "
 				<< std::left << std::setw(NUM_PREC*2) << dY << " ";
@@ -517,6 +794,8 @@ bool SqwFuncModel::Save(const char *pcFile, std::size_t iNum, std::size_t iSkipB
 
 			for(t_real dFwhm : vecFwhms)
 				ofstr << std::left << std::setw(NUM_PREC*2) << dFwhm << " ";
+			for(t_real dComp : vecComps)
+				ofstr << std::left << std::setw(NUM_PREC*2) << dComp << " ";
 			ofstr << "\n";
 
 			ofstr.flush();
@@ -556,6 +835,8 @@ void SqwFuncModel::SetParamSet(std::size_t iSet)
 	}
 
 	m_iCurParamSet = iSet;
+	m_vecPoolResults.clear();
+	m_pEvaluatedPool.reset();
 
 	// parameters that are not part of the S(Q, E) model
 	static const std::unordered_set<std::string> ignored_parms{{ "scale", "slope", "offs" }};
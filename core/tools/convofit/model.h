@@ -32,6 +32,8 @@
 #include <memory>
 #include <vector>
 #include <string>
+#include <map>
+#include <mutex>
 
 #include "tlibs/fit/minuit.h"
 #include <Minuit2/FunctionMinimum.h>
@@ -43,6 +45,7 @@
 
 #include "../monteconvo/sqwbase.h"
 #include "../monteconvo/TASReso.h"
+#include "../monteconvo/neutron_pool.h"
 #include "../res/defs.h"
 #include "scan.h"
 
@@ -62,6 +65,10 @@ protected:
 	unsigned int m_iNumNeutrons = 1000;
 	bool m_bUseThreads = true;
 
+	// use analytic convolution for dispersion models if possible
+	bool m_bAnalyticConvo = false;
+	t_real_mod m_dMaxDispCurv = 0.5;
+
 	ublas::vector<t_real_mod> m_vecScanOrigin;	// hklE
 	ublas::vector<t_real_mod> m_vecScanDir;		// hklE
 	t_real_mod m_dPrincipalAxisMin, m_dPrincipalAxisMax;
@@ -78,6 +85,53 @@ protected:
 	std::string m_strTempParamName = "T";
 	std::string m_strFieldParamName = "";
 
+	// -------------------------------------------------------------------------
+	// cached partial intensities of composite models, shared between copies;
+	// refits of the component amplitudes then need no new convolution
+	struct PartialCacheEntry
+	{
+		std::string strShapeKey;
+		std::vector<t_real_mod> vecPartials;
+	};
+
+	struct PartialCache
+	{
+		std::mutex mtx;
+		// key: [param set, neutron count, scan position]
+		std::map<std::tuple<std::size_t, unsigned int, t_real_mod>, PartialCacheEntry> mapEntries;
+	};
+
+	bool m_bCachePartials = false;
+	std::shared_ptr<PartialCache> m_pPartialCache;
+	// -------------------------------------------------------------------------
+
+	// -------------------------------------------------------------------------
+	// neutrons shared by all scan points, see NeutronPool;
+	// the pools are shared between copies and kept for the whole fit
+	struct PoolCacheEntry
+	{
+		std::vector<t_real_mod> vecX;
+		std::shared_ptr<NeutronPool> pPool;
+	};
+
+	struct PoolCache
+	{
+		std::mutex mtx;
+		// scan positions per param set
+		std::map<std::size_t, std::vector<t_real_mod>> mapPositions;
+		// key: [param set, neutron count]
+		std::map<std::tuple<std::size_t, unsigned int>, PoolCacheEntry> mapEntries;
+	};
+
+	std::shared_ptr<PoolCache> m_pPoolCache;
+	t_real_mod m_dPoolFactor = 8., m_dPoolESS = 1.;
+	unsigned int m_iPoolRounds = 4;
+
+	// results for the current parameters, not shared between copies
+	mutable std::vector<std::vector<t_real_mod>> m_vecPoolResults;
+	mutable std::shared_ptr<const NeutronPool> m_pEvaluatedPool;
+	// -------------------------------------------------------------------------
+
 	// -------------------------------------------------------------------------
 	// optional, for multi-fits
 	std::size_t m_iCurParamSet = 0;
@@ -116,6 +170,10 @@ protected:
 
 	std::size_t GetNonSQEParamIdx(const std::string& param) const;
 
+	t_real_mod Convolve(TASReso& reso, t_real_mod dX, std::vector<t_real_mod>* pvecPartials) const;
+	bool ConvolvePooled(t_real_mod dX, std::vector<t_real_mod>& vecVals) const;
+	t_real_mod Eval(t_real_mod dX, std::vector<t_real_mod>* pvecComps = nullptr) const;
+
 
 public:
 	SqwFuncModel(std::shared_ptr<SqwBase> pSqw, const TASReso& reso);
@@ -160,6 +218,11 @@ public:
 	void SetSqwParamOverrides(const std::vector<std::string>& params) { m_vecSqwParams = params; }
 	void SetNumNeutrons(unsigned int iNum) { m_iNumNeutrons = iNum; }
 	void SetUseThreads(bool b) { m_bUseThreads = b; }
+	void SetAnalyticConvo(bool b) { m_bAnalyticConvo = b; }
+	void SetMaxDispCurvature(t_real_mod dCurv) { m_dMaxDispCurv = dCurv; }
+	void SetCachePartials(bool b);
+	void SetNeutronPool(bool b, t_real_mod dFactor = 8., t_real_mod dESS = 1., unsigned int iRounds = 4);
+	void SetPoolPositions(std::size_t iSet, const std::vector<t_real_mod>& vecX);
 
 	void SetScanOrigin(t_real_mod h, t_real_mod k, t_real_mod l, t_real_mod E)
 	{ m_vecScanOrigin = tl::make_vec({h,k,l,E}); }
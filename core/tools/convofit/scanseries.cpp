@@ -314,12 +314,13 @@ bool invoke_new(const char* pcFile)
 			const std::string& strModFile = vecMod[iNr];
 			const std::string& strScFile = vecScn[iNr];
 
+			// skip the fits which have not (yet) finished
 			if(!tl::file_exists(strScFile.c_str()) ||
 				!tl::file_exists(strModFile.c_str()))
 			{
-				tl::log_err("Cannot open files \"", strScFile,
+				tl::log_warn("Skipping dataset ", iNr+1, ", cannot open files \"", strScFile,
 					"\" and \"", strModFile, "\".");
-				break;
+				continue;
 			}
 
 			tl::log_info("Processing dataset ", iNr+1, ": \"", strModFile, "\".");
@@ -335,7 +336,8 @@ bool invoke_new(const char* pcFile)
 				ofstr << std::left << std::setw(20) << iter->second.second << " ";
 			}
 
-			ofstr << "\n";
+			// keep the results of the finished datasets if the series is interrupted
+			ofstr << std::endl;
 		}
 
 		tl::log_info("Wrote \"", strOut, "\".");
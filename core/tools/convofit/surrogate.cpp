@@ -0,0 +1,474 @@
+/**
+ * surrogate-assisted minimisation of expensive and noisy chi^2 functions
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "surrogate.h"
+
+#include "tlibs/helper/thread.h"
+#include "tlibs/math/math.h"
+#include "tlibs/log/log.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <numeric>
+
+using t_real = GPSurrogate::t_real;
+using t_vec = GPSurrogate::t_vec;
+
+
+// ----------------------------------------------------------------------------
+// gaussian process
+
+void GPSurrogate::SetData(const std::vector<t_vec>& vecX, const t_vec& vecY)
+{
+	m_vecX = vecX;
+	m_vecY = vecY;
+}
+
+
+void GPSurrogate::AddPoint(const t_vec& x, t_real y)
+{
+	m_vecX.push_back(x);
+	m_vecY.push_back(y);
+}
+
+
+/**
+ * squared-exponential kernel without the signal variance
+ */
+t_real GPSurrogate::Kernel(const t_vec& x1, const t_vec& x2) const
+{
+	t_real dDist2 = 0;
+	for(std::size_t i=0; i<x1.size(); ++i)
+		dDist2 += (x1[i]-x2[i]) * (x1[i]-x2[i]);
+
+	return std::exp(-dDist2 / (t_real(2)*m_dLength*m_dLength));
+}
+
+
+/**
+ * cholesky decomposition of the kernel matrix for the current hyperparameters
+ * @returns the log likelihood with the signal variance profiled out
+ */
+bool GPSurrogate::Decompose(t_real& dLogLikelihood)
+{
+	const std::size_t N = m_vecX.size();
+	m_vecL.assign(N*N, t_real(0));
+
+	for(std::size_t i=0; i<N; ++i)
+	{
+		for(std::size_t j=0; j<=i; ++j)
+		{
+			t_real dSum = Kernel(m_vecX[i], m_vecX[j]);
+			if(i == j)
+				dSum += m_dNoise;
+
+			for(std::size_t k=0; k<j; ++k)
+				dSum -= m_vecL[i*N + k] * m_vecL[j*N + k];
+
+			if(i == j)
+			{
+				if(dSum <= t_real(0))
+					return false;
+				m_vecL[i*N + i] = std::sqrt(dSum);
+			}
+			else
+			{
+				m_vecL[i*N + j] = dSum / m_vecL[j*N + j];
+			}
+		}
+	}
+
+	// alpha = L^(-T) L^(-1) (y - mean)
+	m_vecAlpha.resize(N);
+	for(std::size_t i=0; i<N; ++i)
+	{
+		t_real dSum = m_vecY[i] - m_dMean;
+		for(std::size_t k=0; k<i; ++k)
+			dSum -= m_vecL[i*N + k] * m_vecAlpha[k];
+		m_vecAlpha[i] = dSum / m_vecL[i*N + i];
+	}
+
+	t_real dQuad = 0, dLogDet = 0;
+	for(std::size_t i=0; i<N; ++i)
+	{
+		dQuad += m_vecAlpha[i] * m_vecAlpha[i];
+		dLogDet += t_real(2) * std::log(m_vecL[i*N + i]);
+	}
+
+	for(std::size_t _i=N; _i>0; --_i)
+	{
+		const std::size_t i = _i - 1;
+		t_real dSum = m_vecAlpha[i];
+		for(std::size_t k=i+1; k<N; ++k)
+			dSum -= m_vecL[k*N + i] * m_vecAlpha[k];
+		m_vecAlpha[i] = dSum / m_vecL[i*N + i];
+	}
+
+	m_dSigVar = std::max(dQuad / t_real(N), std::numeric_limits<t_real>::epsilon());
+	dLogLikelihood = -t_real(0.5) * (t_real(N)*std::log(m_dSigVar) + dLogDet);
+	return true;
+}
+
+
+/**
+ * fits the surrogate, optionally choosing the kernel length and
+ * the noise level with the largest marginal likelihood
+ */
+bool GPSurrogate::Fit(bool bOptimiseHyper)
+{
+	if(!m_vecY.size())
+		return false;
+
+	m_dMean = std::accumulate(m_vecY.begin(), m_vecY.end(), t_real(0)) / t_real(m_vecY.size());
+
+	t_real dLogLike = 0;
+	if(!bOptimiseHyper)
+		return Decompose(dLogLike);
+
+	// distances in the unit cube grow with the square root of the dimension
+	const t_real dDimScale = std::sqrt(t_real(m_vecX[0].size()));
+	const t_real dLengths[] = { 0.05, 0.1, 0.15, 0.25, 0.4, 0.6, 1., 1.5 };
+	const t_real dNoises[] = { 1e-6, 1e-4, 1e-3, 1e-2, 5e-2, 2e-1 };
+
+	t_real dBestLogLike = -std::numeric_limits<t_real>::max();
+	t_real dBestLength = m_dLength, dBestNoise = m_dNoise;
+
+	for(t_real dLength : dLengths)
+	{
+		for(t_real dNoise : dNoises)
+		{
+			m_dLength = dLength * dDimScale;
+			m_dNoise = dNoise;
+
+			if(Decompose(dLogLike) && dLogLike > dBestLogLike)
+			{
+				dBestLogLike = dLogLike;
+				dBestLength = m_dLength;
+				dBestNoise = m_dNoise;
+			}
+		}
+	}
+
+	m_dLength = dBestLength;
+	m_dNoise = dBestNoise;
+	return Decompose(dLogLike);
+}
+
+
+/**
+ * posterior mean and variance of the noise-free function
+ */
+void GPSurrogate::Predict(const t_vec& x, t_real& dMean, t_real& dVar) const
+{
+	const std::size_t N = m_vecX.size();
+
+	t_vec vecK(N), vecV(N);
+	for(std::size_t i=0; i<N; ++i)
+		vecK[i] = Kernel(x, m_vecX[i]);
+
+	dMean = m_dMean;
+	for(std::size_t i=0; i<N; ++i)
+		dMean += vecK[i] * m_vecAlpha[i];
+
+	// v = L^(-1) k
+	t_real dVarRed = 0;
+	for(std::size_t i=0; i<N; ++i)
+	{
+		t_real dSum = vecK[i];
+		for(std::size_t k=0; k<i; ++k)
+			dSum -= m_vecL[i*N + k] * vecV[k];
+		vecV[i] = dSum / m_vecL[i*N + i];
+		dVarRed += vecV[i] * vecV[i];
+	}
+
+	dVar = m_dSigVar * std::max(t_real(1) - dVarRed, t_real(0));
+}
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// minimiser
+
+SurrogateMinimiser::SurrogateMinimiser(const t_func& func, const t_vec& vecStart,
+	const t_vec& vecMin, const t_vec& vecMax, unsigned int iSeed)
+	: m_func{func}, m_vecStart{vecStart}, m_vecMin{vecMin}, m_vecMax{vecMax}, m_rng{iSeed}
+{}
+
+
+t_vec SurrogateMinimiser::ToUnit(const t_vec& x) const
+{
+	t_vec u(x.size());
+	for(std::size_t i=0; i<x.size(); ++i)
+		u[i] = (x[i] - m_vecMin[i]) / (m_vecMax[i] - m_vecMin[i]);
+	return u;
+}
+
+
+t_vec SurrogateMinimiser::FromUnit(const t_vec& u) const
+{
+	t_vec x(u.size());
+	for(std::size_t i=0; i<u.size(); ++i)
+		x[i] = m_vecMin[i] + u[i]*(m_vecMax[i] - m_vecMin[i]);
+	return x;
+}
+
+
+/**
+ * the surrogate models log(1 + chi^2) to even out the large dynamic range
+ */
+t_real SurrogateMinimiser::ToSurrogate(t_real dChi2)
+{
+	return std::log1p(std::max(dChi2, t_real(0)));
+}
+
+
+/**
+ * evaluates the chi^2 function at the given points, in parallel if requested
+ */
+void SurrogateMinimiser::Evaluate(const std::vector<t_vec>& vecUnitPts)
+{
+	std::vector<t_vec> vecPts;
+	vecPts.reserve(vecUnitPts.size());
+	for(const t_vec& u : vecUnitPts)
+		vecPts.emplace_back(FromUnit(u));
+
+	t_vec vecChi2;
+	vecChi2.reserve(vecPts.size());
+
+	if(m_iThreads <= 1 || vecPts.size() <= 1)
+	{
+		for(const t_vec& x : vecPts)
+			vecChi2.push_back(m_func(x));
+	}
+	else
+	{
+		tl::ThreadPool<t_real()> tp(std::min<unsigned int>(m_iThreads, vecPts.size()));
+		for(const t_vec& x : vecPts)
+			tp.AddTask([this, &x]() -> t_real { return m_func(x); });
+
+		tp.Start();
+		for(auto& fut : tp.GetResults())
+			vecChi2.push_back(fut.get());
+	}
+
+	for(std::size_t i=0; i<vecPts.size(); ++i)
+	{
+		m_vecX.emplace_back(std::move(vecPts[i]));
+		m_vecY.push_back(vecChi2[i]);
+	}
+}
+
+
+/**
+ * the best point is the evaluated one with the lowest surrogate mean,
+ * which is less prone to lucky monte-carlo fluctuations than the lowest raw value
+ */
+void SurrogateMinimiser::UpdateBest()
+{
+	t_real dBestMean = std::numeric_limits<t_real>::max();
+
+	for(std::size_t i=0; i<m_vecX.size(); ++i)
+	{
+		if(!std::isfinite(m_vecY[i]))
+			continue;
+
+		t_real dMean = 0, dVar = 0;
+		m_gp.Predict(ToUnit(m_vecX[i]), dMean, dVar);
+		if(dMean < dBestMean)
+		{
+			dBestMean = dMean;
+			m_vecBest = m_vecX[i];
+			m_dBest = m_vecY[i];
+		}
+	}
+}
+
+
+/**
+ * chooses the next points by maximising the expected improvement over random candidates;
+ * for batches, the chosen points are added with their predicted values ("kriging believer")
+ */
+std::vector<t_vec> SurrogateMinimiser::ProposeBatch()
+{
+	const std::size_t iDim = m_vecStart.size();
+	std::uniform_real_distribution<t_real> distUnif(0, 1);
+	std::normal_distribution<t_real> distNorm(0, 1);
+
+	const t_vec vecBestUnit = ToUnit(m_vecBest);
+	t_real dBestMean = 0, dBestVar = 0;
+	m_gp.Predict(vecBestUnit, dBestMean, dBestVar);
+
+	// candidates: half of them uniformly, half of them around the best point
+	std::vector<t_vec> vecCands;
+	vecCands.reserve(m_iCandidates);
+	for(unsigned int iCand=0; iCand<m_iCandidates; ++iCand)
+	{
+		t_vec u(iDim);
+		const bool bLocal = (iCand % 2 == 1);
+		const t_real dSigma = (iCand % 4 == 1) ? t_real(0.1) : t_real(0.02);
+
+		for(std::size_t i=0; i<iDim; ++i)
+		{
+			if(bLocal)
+				u[i] = tl::clamp(vecBestUnit[i] + dSigma*distNorm(m_rng), t_real(0), t_real(1));
+			else
+				u[i] = distUnif(m_rng);
+		}
+		vecCands.emplace_back(std::move(u));
+	}
+
+	std::vector<t_vec> vecBatch;
+	for(unsigned int iPt=0; iPt<m_iBatch; ++iPt)
+	{
+		t_real dBestEI = -1;
+		std::size_t iBestCand = 0;
+
+		for(std::size_t iCand=0; iCand<vecCands.size(); ++iCand)
+		{
+			t_real dMean = 0, dVar = 0;
+			m_gp.Predict(vecCands[iCand], dMean, dVar);
+
+			const t_real dSig = std::sqrt(dVar);
+			t_real dEI = 0;
+			if(dSig > std::numeric_limits<t_real>::epsilon())
+			{
+				const t_real z = (dBestMean - dMean) / dSig;
+				const t_real dCdf = t_real(0.5) * std::erfc(-z / std::sqrt(t_real(2)));
+				const t_real dPdf = std::exp(-t_real(0.5)*z*z) / std::sqrt(t_real(2)*tl::get_pi<t_real>());
+				dEI = (dBestMean - dMean)*dCdf + dSig*dPdf;
+			}
+
+			if(dEI > dBestEI)
+			{
+				dBestEI = dEI;
+				iBestCand = iCand;
+			}
+		}
+
+		vecBatch.push_back(vecCands[iBestCand]);
+		if(iPt+1 < m_iBatch)
+		{
+			t_real dMean = 0, dVar = 0;
+			m_gp.Predict(vecCands[iBestCand], dMean, dVar);
+			m_gp.AddPoint(vecCands[iBestCand], dMean);
+			m_gp.Fit(false);
+		}
+		vecCands.erase(vecCands.begin() + iBestCand);
+	}
+
+	return vecBatch;
+}
+
+
+/**
+ * runs the minimisation
+ * @returns the best parameters
+ */
+const t_vec& SurrogateMinimiser::Minimise()
+{
+	const std::size_t iDim = m_vecStart.size();
+	unsigned int iMaxEvals = m_iMaxEvals ? m_iMaxEvals : unsigned(15*(iDim+1));
+	unsigned int iInitial = m_iInitial ? m_iInitial : unsigned(2*iDim + 2);
+	iInitial = std::min(iInitial, iMaxEvals);
+
+	m_vecX.clear();
+	m_vecY.clear();
+	m_vecBest = m_vecStart;
+
+	if(iDim == 0 || iMaxEvals == 0)
+		return m_vecBest;
+
+	// initial design: the start point and a latin hypercube
+	std::vector<t_vec> vecInitial;
+	vecInitial.push_back(ToUnit(m_vecStart));
+
+	std::vector<std::vector<unsigned int>> vecPerms(iDim);
+	for(std::vector<unsigned int>& perm : vecPerms)
+	{
+		perm.resize(iInitial-1);
+		std::iota(perm.begin(), perm.end(), 0);
+		std::shuffle(perm.begin(), perm.end(), m_rng);
+	}
+
+	std::uniform_real_distribution<t_real> distUnif(0, 1);
+	for(unsigned int iPt=0; iPt+1<iInitial; ++iPt)
+	{
+		t_vec u(iDim);
+		for(std::size_t i=0; i<iDim; ++i)
+			u[i] = (t_real(vecPerms[i][iPt]) + distUnif(m_rng)) / t_real(iInitial-1);
+		vecInitial.emplace_back(std::move(u));
+	}
+
+	tl::log_info("Surrogate minimiser: evaluating ", vecInitial.size(), " initial points.");
+	Evaluate(vecInitial);
+
+	while(true)
+	{
+		// non-finite values are replaced by the worst finite one
+		t_real dWorst = 0;
+		for(t_real dChi2 : m_vecY)
+			if(std::isfinite(dChi2))
+				dWorst = std::max(dWorst, dChi2);
+
+		std::vector<t_vec> vecUnitX;
+		t_vec vecSurY;
+		vecUnitX.reserve(m_vecX.size());
+		vecSurY.reserve(m_vecY.size());
+		for(std::size_t i=0; i<m_vecX.size(); ++i)
+		{
+			vecUnitX.emplace_back(ToUnit(m_vecX[i]));
+			vecSurY.push_back(ToSurrogate(std::isfinite(m_vecY[i]) ? m_vecY[i] : dWorst));
+		}
+
+		m_gp.SetData(vecUnitX, vecSurY);
+		if(!m_gp.Fit(true))
+		{
+			tl::log_err("Surrogate minimiser: cannot fit the surrogate model.");
+			break;
+		}
+		UpdateBest();
+
+		tl::log_info("Surrogate minimiser: ", m_vecY.size(), " evaluations, best chi2 = ", m_dBest,
+			", kernel length = ", m_gp.GetLength(), ", noise variance = ", m_gp.GetNoise(), ".");
+
+		if(m_vecY.size() >= iMaxEvals)
+			break;
+
+		const unsigned int iBatch = m_iBatch;
+		m_iBatch = std::min<unsigned int>(m_iBatch, iMaxEvals - m_vecY.size());
+		std::vector<t_vec> vecBatch = ProposeBatch();
+		m_iBatch = iBatch;
+
+		Evaluate(vecBatch);
+	}
+
+	return m_vecBest;
+}
+// ----------------------------------------------------------------------------
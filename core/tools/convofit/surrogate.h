@@ -0,0 +1,139 @@
+/**
+ * surrogate-assisted minimisation of expensive and noisy chi^2 functions
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * @desc gaussian process regression and expected improvement, see e.g.:
+ *       C. E. Rasmussen and C. K. I. Williams, "Gaussian Processes for Machine Learning" (2006), ch. 2 and 5;
+ *       D. R. Jones et al., J. Glob. Optim. 13 (1998) pp. 455-492, doi: 10.1023/A:1008306431147
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __CONVOFIT_SURROGATE_H__
+#define __CONVOFIT_SURROGATE_H__
+
+#include <vector>
+#include <functional>
+#include <random>
+
+#include "../res/defs.h"
+
+
+/**
+ * gaussian process regression of the function values sampled so far,
+ * the noise level of the values is fitted alongside the kernel length
+ */
+class GPSurrogate
+{
+public:
+	using t_real = t_real_reso;
+	using t_vec = std::vector<t_real>;
+
+protected:
+	std::vector<t_vec> m_vecX;      // sample points, scaled to the unit cube
+	t_vec m_vecY;                   // function values
+
+	t_real m_dLength = 0.25;        // length of the squared-exponential kernel
+	t_real m_dNoise = 1e-4;         // noise variance relative to the signal variance
+	t_real m_dMean = 0;             // constant prior mean
+	t_real m_dSigVar = 1;           // signal variance
+
+	t_vec m_vecL;                   // cholesky factor of the kernel matrix, row-major
+	t_vec m_vecAlpha;               // K^(-1) (y - mean)
+
+protected:
+	t_real Kernel(const t_vec& x1, const t_vec& x2) const;
+	bool Decompose(t_real& dLogLikelihood);
+
+public:
+	void SetData(const std::vector<t_vec>& vecX, const t_vec& vecY);
+	void AddPoint(const t_vec& x, t_real y);
+
+	bool Fit(bool bOptimiseHyper = true);
+	void Predict(const t_vec& x, t_real& dMean, t_real& dVar) const;
+
+	t_real GetLength() const { return m_dLength; }
+	t_real GetNoise() const { return m_dNoise * m_dSigVar; }
+};
+
+
+/**
+ * minimiser sampling a chi^2 function where the expected improvement
+ * over the surrogate's best prediction is largest
+ */
+class SurrogateMinimiser
+{
+public:
+	using t_real = t_real_reso;
+	using t_vec = std::vector<t_real>;
+	using t_func = std::function<t_real(const t_vec&)>;
+
+protected:
+	t_func m_func;
+	t_vec m_vecStart, m_vecMin, m_vecMax;
+
+	unsigned int m_iMaxEvals = 0;       // 0: choose by dimension
+	unsigned int m_iInitial = 0;        // 0: choose by dimension
+	unsigned int m_iBatch = 1;          // points to evaluate per step
+	unsigned int m_iThreads = 1;        // 1: evaluate sequentially
+	unsigned int m_iCandidates = 4096;  // random candidates per acquisition
+
+	std::mt19937 m_rng;
+
+	// all evaluated points (in parameter units) and their function values
+	std::vector<t_vec> m_vecX;
+	t_vec m_vecY;
+
+	GPSurrogate m_gp;
+	t_vec m_vecBest;
+	t_real m_dBest = 0;
+
+protected:
+	t_vec ToUnit(const t_vec& x) const;
+	t_vec FromUnit(const t_vec& u) const;
+	static t_real ToSurrogate(t_real dChi2);
+
+	void Evaluate(const std::vector<t_vec>& vecUnitPts);
+	std::vector<t_vec> ProposeBatch();
+	void UpdateBest();
+
+public:
+	SurrogateMinimiser(const t_func& func, const t_vec& vecStart,
+		const t_vec& vecMin, const t_vec& vecMax, unsigned int iSeed = 0);
+
+	void SetMaxEvals(unsigned int iNum) { m_iMaxEvals = iNum; }
+	void SetInitialEvals(unsigned int iNum) { m_iInitial = iNum; }
+	void SetBatchSize(unsigned int iNum) { m_iBatch = iNum ? iNum : 1; }
+	void SetMaxThreads(unsigned int iNum) { m_iThreads = iNum ? iNum : 1; }
+	void SetCandidates(unsigned int iNum) { m_iCandidates = iNum; }
+
+	const t_vec& Minimise();
+
+	const t_vec& GetBest() const { return m_vecBest; }
+	t_real GetBestChi2() const { return m_dBest; }
+	std::size_t GetNumEvals() const { return m_vecY.size(); }
+};
+
+
+#endif
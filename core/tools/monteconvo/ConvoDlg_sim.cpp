@@ -347,7 +347,12 @@ void ConvoDlg::StartSim1D(bool bForceDeferred, unsigned int seed)
 		unsigned int iStep = 0;
 		for(auto &fut : lstFuts)
 		{
-			if(this->StopRequested()) break;
+			if(this->StopRequested())
+			{
+				// don't start the remaining tasks
+				tp.Cancel();
+				break;
+			}
 
 			// deferred (in main thread), eval this task manually
 			if(iNumThreads == 0)
@@ -357,7 +362,12 @@ void ConvoDlg::StartSim1D(bool bForceDeferred, unsigned int seed)
 			}
 
 			std::pair<bool, t_real> pairS = fut.get();
-			if(!pairS.first) break;
+			if(!pairS.first)
+			{
+				// don't start the remaining tasks
+				tp.Cancel();
+				break;
+			}
 			t_real dS = pairS.second;
 			if(tl::is_nan_or_inf(dS))
 			{
@@ -861,7 +871,12 @@ void ConvoDlg::Start2D()
 		unsigned int iStep = 0;
 		for(auto &fut : lstFuts)
 		{
-			if(this->StopRequested()) break;
+			if(this->StopRequested())
+			{
+				// don't start the remaining tasks
+				tp.Cancel();
+				break;
+			}
 
 			// deferred (in main thread), eval this task manually
 			if(iNumThreads == 0)
@@ -871,7 +886,12 @@ void ConvoDlg::Start2D()
 			}
 
 			std::pair<bool, t_real> pairS = fut.get();
-			if(!pairS.first) break;
+			if(!pairS.first)
+			{
+				// don't start the remaining tasks
+				tp.Cancel();
+				break;
+			}
 			t_real dS = pairS.second;
 			if(tl::is_nan_or_inf(dS))
 			{
@@ -1090,7 +1110,12 @@ void ConvoDlg::StartDisp()
 		unsigned int iStep = 0;
 		for(auto &fut : lstFuts)
 		{
-			if(this->StopRequested()) break;
+			if(this->StopRequested())
+			{
+				// don't start the remaining tasks
+				tp.Cancel();
+				break;
+			}
 
 			// deferred (in main thread), eval this task manually
 			if(iNumThreads == 0)
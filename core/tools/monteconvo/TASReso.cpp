@@ -27,9 +27,11 @@
  */
 
 #include "TASReso.h"
+#include "sqwbase.h"
 #include "libs/version.h"
 #include "tlibs/phys/lattice.h"
 #include "tlibs/math/rand.h"
+#include "tlibs/math/numint.h"
 #include "tlibs/file/prop.h"
 #include "tlibs/log/log.h"
 #include "tlibs/helper/thread.h"
@@ -710,3 +712,173 @@ Ellipsoid4d<t_real> TASReso::GenerateMC_deferred(std::size_t iNum, std::vector<t
 
 	return ell4dret;
 }
+
+
+
+/**
+ * densities of the neutrons generated by GenerateMC, one per random sample position
+ */
+bool TASReso::GetMCDensities(std::vector<McGaussian<t_vec, t_mat>>& vecGauss) const
+{
+	vecGauss.clear();
+	vecGauss.reserve(m_res.size());
+
+	for(const ResoResults& resores : m_res)
+	{
+		Ellipsoid4d<t_real> ell4d = calc_res_ellipsoid4d<t_real>(
+			resores.reso, resores.reso_v, resores.reso_s, resores.Q_avg);
+
+		McGaussian<t_vec, t_mat> gauss;
+		if(!mc_gaussian<t_vec, t_mat>(ell4d, m_opts, gauss))
+			return false;
+		vecGauss.emplace_back(std::move(gauss));
+	}
+
+	return true;
+}
+
+
+
+/**
+ * analytic convolution for models providing a dispersion E(Q):
+ * the resolution gaussian is projected onto the local normal of every
+ * dispersion branch, which leaves a one-dimensional energy convolution
+ * of the model's S(Q, E) at the ellipsoid centre.
+ * dS receives the same (R0-less) mean as the monte-carlo version.
+ * returns false if the model has no dispersion or if the dispersion is
+ * too strongly curved within the ellipsoid, in which case the caller
+ * should fall back to the monte-carlo integration.
+ */
+bool TASReso::ConvolveDisp(const SqwBase& sqw, t_real& dS, t_real dMaxCurv) const
+{
+	dS = t_real(0);
+	const t_real dEps = tl::get_epsilon<t_real>();
+
+	// trafo from (Q||, ...) 1/A system to the neutron coordinate system, see mc_neutrons()
+	t_mat matQVec0 = tl::rotation_matrix_2d(-m_opts.dAngleQVec0);
+	tl::resize_unity(matQVec0, 4);
+
+	t_mat matTrafo = tl::unit_m<t_mat>(4);
+	if(m_opts.coords == McNeutronCoords::ANGS)
+		matTrafo = matQVec0;
+	else if(m_opts.coords == McNeutronCoords::RLU)
+		matTrafo = ublas::prod(m_opts.matUBinv, matQVec0);
+
+	auto get_disp = [&sqw](const t_vec& vecHKLE) -> std::vector<t_real>
+	{
+		return std::get<0>(sqw.disp(vecHKLE[0], vecHKLE[1], vecHKLE[2]));
+	};
+
+	// iterate over random sample positions
+	for(const ResoResults& resores : m_res)
+	{
+		Ellipsoid4d<t_real> ell4d = calc_res_ellipsoid4d<t_real>(
+			resores.reso, resores.reso_v, resores.reso_s, resores.Q_avg);
+
+		const t_real dSigmas[] = {
+			ell4d.x_hwhm*tl::get_HWHM2SIGMA<t_real>(),
+			ell4d.y_hwhm*tl::get_HWHM2SIGMA<t_real>(),
+			ell4d.z_hwhm*tl::get_HWHM2SIGMA<t_real>(),
+			ell4d.w_hwhm*tl::get_HWHM2SIGMA<t_real>() };
+
+		t_vec vecCentre = tl::make_vec<t_vec>({ 0., 0., 0., 0. });
+		if(!m_opts.bCenter)
+			vecCentre = tl::make_vec<t_vec>({ ell4d.x_offs, ell4d.y_offs, ell4d.z_offs, ell4d.w_offs });
+		vecCentre = ublas::prod(matTrafo, vecCentre);
+
+		// principal axes of the ellipsoid in the neutron coordinate system
+		const t_mat matAxes = ublas::prod(matTrafo, ell4d.rot);
+
+		const std::vector<t_real> vecE0 = get_disp(vecCentre);
+		if(vecE0.size() == 0)
+			return false;
+
+		// width of the resolution gaussian projected onto each branch's normal,
+		// the quadratic terms of the dispersion are included in their first two moments
+		std::vector<t_real> vecSig(vecE0.size(), 0.), vecShift(vecE0.size(), 0.);
+		std::vector<t_real> vecCurv(vecE0.size(), 0.);
+
+		for(std::size_t iAxis=0; iAxis<4; ++iAxis)
+		{
+			const t_vec vecStep = ublas::column(matAxes, iAxis) * dSigmas[iAxis];
+			const std::vector<t_real> vecEp = get_disp(vecCentre + vecStep);
+			const std::vector<t_real> vecEm = get_disp(vecCentre - vecStep);
+
+			if(vecEp.size() != vecE0.size() || vecEm.size() != vecE0.size())
+				return false;
+
+			for(std::size_t iBranch=0; iBranch<vecE0.size(); ++iBranch)
+			{
+				// central differences per standard deviation along the axis
+				t_real dGrad = t_real(0.5) * (vecEp[iBranch] - vecEm[iBranch]);
+				t_real dCurv = vecEp[iBranch] + vecEm[iBranch] - t_real(2)*vecE0[iBranch];
+				t_real dProj = vecStep[3] - dGrad;
+
+				vecSig[iBranch] += dProj*dProj + t_real(0.5)*dCurv*dCurv;
+				vecShift[iBranch] += t_real(0.5) * dCurv;
+				vecCurv[iBranch] += t_real(0.5) * std::abs(dCurv);
+			}
+		}
+
+		t_real dSigMin = std::numeric_limits<t_real>::max();
+		t_real dSigMax = t_real(0);
+		for(std::size_t iBranch=0; iBranch<vecE0.size(); ++iBranch)
+		{
+			vecSig[iBranch] = std::sqrt(vecSig[iBranch]);
+
+			if(tl::is_nan_or_inf(vecSig[iBranch]) || vecSig[iBranch] < dEps)
+				return false;
+			if(vecCurv[iBranch] > dMaxCurv*vecSig[iBranch])
+			{
+				tl::log_debug("Dispersion branch ", iBranch, " is too strongly curved at ",
+					"(", vecCentre[0], " ", vecCentre[1], " ", vecCentre[2], ") for an analytic convolution.");
+				return false;
+			}
+
+			dSigMin = std::min(dSigMin, vecSig[iBranch]);
+			dSigMax = std::max(dSigMax, vecSig[iBranch]);
+		}
+
+		// energy convolution with the width of the closest branch
+		std::function<t_real(t_real)> fkt = [&sqw, &vecCentre, &vecE0, &vecSig, &vecShift](t_real dE) -> t_real
+		{
+			std::size_t iBranch = 0;
+			for(std::size_t iCur=1; iCur<vecE0.size(); ++iCur)
+			{
+				if(std::abs(dE - vecE0[iCur]) < std::abs(dE - vecE0[iBranch]))
+					iBranch = iCur;
+			}
+
+			return sqw(vecCentre[0], vecCentre[1], vecCentre[2], dE) *
+				tl::gauss_model<t_real>(dE, vecCentre[3] - vecShift[iBranch], vecSig[iBranch], 1., 0.);
+		};
+
+		t_real dRange = t_real(0);
+		for(t_real dShift : vecShift)
+			dRange = std::max(dRange, std::abs(dShift));
+		dRange += t_real(5) * dSigMax;
+		std::size_t iNumE = std::size_t(std::ceil(t_real(8) * dRange / dSigMin));
+		iNumE = tl::clamp<std::size_t>(iNumE + iNumE%2, 64, 4096);
+
+		// the model's own energy width can be narrower than the resolution,
+		// refine the grid until the integral converges
+		t_real dSCur = tl::numint_simpN<t_real, t_real>(fkt,
+			vecCentre[3] - dRange, vecCentre[3] + dRange, iNumE);
+		for(; iNumE < 65536; iNumE *= 2)
+		{
+			t_real dSFine = tl::numint_simpN<t_real, t_real>(fkt,
+				vecCentre[3] - dRange, vecCentre[3] + dRange, 2*iNumE);
+			bool bConverged = std::abs(dSFine - dSCur) <= t_real(1e-3)*std::abs(dSFine) + dEps;
+			dSCur = dSFine;
+
+			if(bConverged)
+				break;
+		}
+
+		dS += dSCur;
+	}
+
+	dS /= t_real(m_res.size());
+
+	return !tl::is_nan_or_inf(dS);
+}
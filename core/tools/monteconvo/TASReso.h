@@ -37,6 +37,9 @@
 #include <vector>
 
 
+class SqwBase;
+
+
 enum class ResoFocus : unsigned
 {
 	FOC_UNCHANGED = 0,
@@ -87,11 +90,16 @@ public:
 	bool SetHKLE(t_real_reso h, t_real_reso k, t_real_reso l, t_real_reso E);
 	Ellipsoid4d<t_real_reso> GenerateMC(std::size_t iNum, std::vector<ublas::vector<t_real_reso>>&) const;
 	Ellipsoid4d<t_real_reso> GenerateMC_deferred(std::size_t iNum, std::vector<ublas::vector<t_real_reso>>&) const;
+	bool ConvolveDisp(const SqwBase& sqw, t_real_reso& dS, t_real_reso dMaxCurv = 0.5) const;
+	bool GetMCDensities(std::vector<McGaussian<ublas::vector<t_real_reso>, ublas::matrix<t_real_reso>>>&) const;
 
 	void SetKiFix(bool bKiFix) { m_bKiFix = bKiFix; }
 	void SetKFix(t_real_reso dKFix) { m_dKFix = dKFix; }
 
 	void SetAlgo(ResoAlgo algo) { m_algo = algo; }
+	ResoAlgo GetAlgo() const { return m_algo; }
+	bool GetKiFix() const { return m_bKiFix; }
+	t_real_reso GetKFix() const { return m_dKFix; }
 	void SetOptimalFocus(ResoFocus foc) { m_foc = foc; }
 	void SetPlaneDistTolerance(t_real_reso eps) { m_dPlaneDistTolerance = eps; }
 
@@ -105,6 +113,7 @@ public:
 	const ResoResults& GetResoResults() const { return m_res[0]; }
 
 	void SetRandomSamplePos(std::size_t iNum) { m_res.resize(iNum); }
+	std::size_t GetRandomSamplePos() const { return m_res.size(); }
 };
 
 #endif
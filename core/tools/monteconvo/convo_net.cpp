@@ -0,0 +1,838 @@
+/**
+ * distributed convolution -- coordinator and worker over tcp
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "convo_net.h"
+
+#include "tlibs/string/string.h"
+#include "tlibs/math/rand.h"
+#include "tlibs/log/log.h"
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <deque>
+#include <list>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+
+namespace asio = boost::asio;
+namespace ip = boost::asio::ip;
+namespace sys = boost::system;
+namespace fs = boost::filesystem;
+
+using t_real = t_real_reso;
+
+
+
+// ----------------------------------------------------------------------------
+// helpers
+
+/**
+ * splits off the first word of a line
+ */
+static std::pair<std::string, std::string> split_first(const std::string& str)
+{
+	std::size_t iPos = str.find(' ');
+	if(iPos == std::string::npos)
+		return std::make_pair(str, std::string(""));
+
+	return std::make_pair(str.substr(0, iPos), str.substr(iPos+1));
+}
+
+
+/**
+ * writes a real value without loss of precision
+ */
+static std::string real_to_str(t_real val)
+{
+	std::ostringstream ostr;
+	ostr.precision(std::numeric_limits<t_real>::max_digits10);
+	ostr << val;
+	return ostr.str();
+}
+
+
+/**
+ * reads a line from the socket, returns false on connection errors
+ */
+static bool read_line(ip::tcp::socket& sock, asio::streambuf& buf, std::string& strLine)
+{
+	sys::error_code err;
+	asio::read_until(sock, buf, '\n', err);
+	if(err)
+		return false;
+
+	std::istream istr(&buf);
+	std::getline(istr, strLine);
+	if(strLine.size() && strLine[strLine.size()-1] == '\r')
+		strLine.resize(strLine.size()-1);
+	return true;
+}
+
+
+/**
+ * reads a line from the socket, throws if no complete line arrives
+ * within the timeout (in seconds, 0: no timeout) or on connection errors
+ */
+static void read_line_timeout(asio::io_service& service, ip::tcp::socket& sock,
+	asio::streambuf& buf, std::string& strLine, unsigned int iTimeout)
+{
+	if(iTimeout == 0)
+	{
+		if(!read_line(sock, buf, strLine))
+			throw std::runtime_error("Connection lost");
+		return;
+	}
+
+	asio::steady_timer timer(service);
+	timer.expires_from_now(std::chrono::seconds(iTimeout));
+
+	bool bRead = false, bTimeout = false;
+	sys::error_code errRead;
+
+	asio::async_read_until(sock, buf, '\n',
+		[&bRead, &errRead, &timer](const sys::error_code& err, std::size_t)
+	{
+		bRead = true;
+		errRead = err;
+		timer.cancel();
+	});
+
+	timer.async_wait([&bTimeout, &sock](const sys::error_code& err)
+	{
+		if(err == asio::error::operation_aborted)
+			return;
+
+		// aborts the pending read
+		bTimeout = true;
+		sys::error_code errCancel;
+		sock.cancel(errCancel);
+	});
+
+	// run until both handlers have been called
+	service.reset();
+	service.run();
+
+	if(!bRead || errRead)
+	{
+		if(bTimeout)
+			throw std::runtime_error("No answer within " + tl::var_to_str(iTimeout) + " s");
+		throw std::runtime_error("Connection lost");
+	}
+
+	std::istream istr(&buf);
+	std::getline(istr, strLine);
+	if(strLine.size() && strLine[strLine.size()-1] == '\r')
+		strLine.resize(strLine.size()-1);
+}
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// worker
+
+ConvoNetWorker::ConvoNetWorker(unsigned short iPort, unsigned int iNumThreads,
+	const t_convonet_backend_factory& factory)
+	: m_iPort(iPort), m_iNumThreads(iNumThreads ? iNumThreads : 1), m_factory(factory)
+{}
+
+
+
+/**
+ * opens the listening socket, a port of 0 picks a free one
+ */
+bool ConvoNetWorker::Listen()
+{
+	try
+	{
+		const ip::address addr = ip::address::from_string(m_strBindAddr);
+
+		// the worker runs whatever job it is sent, only accept anonymous coordinators locally
+		if(!addr.is_loopback() && m_strSecret == "")
+		{
+			tl::log_err("Convolution worker needs a shared secret to listen on ", m_strBindAddr, ".");
+			return false;
+		}
+
+		m_pAcceptor.reset(new ip::tcp::acceptor(m_service,
+			ip::tcp::endpoint(addr, m_iPort)));
+		m_iPort = m_pAcceptor->local_endpoint().port();
+	}
+	catch(const std::exception& ex)
+	{
+		tl::log_err("Convolution worker cannot listen on ", m_strBindAddr, ":", m_iPort, ": ", ex.what(), ".");
+		m_pAcceptor.reset();
+		return false;
+	}
+
+	tl::log_info("Convolution worker listening on ", m_strBindAddr, ":", m_iPort,
+		", using ", m_iNumThreads, (m_iNumThreads == 1 ? " thread." : " threads."));
+	return true;
+}
+
+
+
+/**
+ * accepts coordinator connections until Stop() is called
+ */
+bool ConvoNetWorker::Run()
+{
+	if(!m_pAcceptor && !Listen())
+		return false;
+
+	// running sessions and their finished flags
+	std::list<std::pair<std::thread, std::shared_ptr<std::atomic<bool>>>> lstSessions;
+
+	// joins the sessions which have already ended
+	auto reap_sessions = [&lstSessions](bool bAll)
+	{
+		for(auto iter = lstSessions.begin(); iter != lstSessions.end();)
+		{
+			if(bAll || *iter->second)
+			{
+				iter->first.join();
+				iter = lstSessions.erase(iter);
+			}
+			else
+			{
+				++iter;
+			}
+		}
+	};
+
+	while(!m_bStop)
+	{
+		auto pSock = std::make_shared<ip::tcp::socket>(m_service);
+
+		sys::error_code err;
+		m_pAcceptor->accept(*pSock, err);
+		reap_sessions(false);
+		if(m_bStop)
+			break;
+		if(err)
+		{
+			tl::log_err("Convolution worker cannot accept connection: ", err.message(), ".");
+			continue;
+		}
+
+		auto pDone = std::make_shared<std::atomic<bool>>(false);
+		lstSessions.emplace_back(std::thread([this, pSock, pDone]()
+		{
+			this->Session(pSock);
+			*pDone = true;
+		}), pDone);
+	}
+
+	reap_sessions(true);
+
+	m_pAcceptor.reset();
+	return true;
+}
+
+
+
+/**
+ * stops accepting new connections, running sessions are finished
+ */
+void ConvoNetWorker::Stop()
+{
+	m_bStop = true;
+
+	// wake up the blocking accept
+	try
+	{
+		ip::address addr = ip::address::from_string(m_strBindAddr);
+		if(addr.is_unspecified())
+			addr = ip::address_v4::loopback();
+
+		asio::io_service service;
+		ip::tcp::socket sock(service);
+		sock.connect(ip::tcp::endpoint(addr, m_iPort));
+	}
+	catch(const std::exception&)
+	{}
+}
+
+
+
+/**
+ * checks the shared secret sent by the coordinator
+ */
+bool ConvoNetWorker::Authenticate(ip::tcp::socket& sock, asio::streambuf& buf) const
+{
+	std::string strLine, strCmd, strSecret;
+	if(!read_line(sock, buf, strLine))
+		return false;
+	std::tie(strCmd, strSecret) = split_first(strLine);
+
+	// compare the whole string to not leak the length of the matching prefix
+	bool bOk = (strCmd == "auth" && strSecret.size() == m_strSecret.size());
+	unsigned char iDiff = 0;
+	for(std::size_t i=0; i<std::min(strSecret.size(), m_strSecret.size()); ++i)
+		iDiff |= static_cast<unsigned char>(strSecret[i] ^ m_strSecret[i]);
+	bOk = bOk && iDiff == 0;
+
+	sys::error_code err;
+	asio::write(sock, asio::buffer(std::string(bOk ? "welcome\n" : "error Authentication failed.\n")), err);
+	return bOk && !err;
+}
+
+
+
+/**
+ * handles the connection to one coordinator
+ */
+void ConvoNetWorker::Session(std::shared_ptr<ip::tcp::socket> pSock) const
+{
+	std::string strPeer = "<unknown>";
+	{
+		sys::error_code err;
+		ip::tcp::endpoint endpoint = pSock->remote_endpoint(err);
+		if(!err)
+			strPeer = endpoint.address().to_string() + ":" + tl::var_to_str(endpoint.port());
+	}
+
+	// limit the buffered input to one file and its command
+	asio::streambuf buf(m_iMaxFileSize + 4096);
+	if(!Authenticate(*pSock, buf))
+	{
+		tl::log_err("Rejected coordinator ", strPeer, ": authentication failed.");
+		sys::error_code err;
+		pSock->close(err);
+		return;
+	}
+	tl::log_info("Coordinator ", strPeer, " connected.");
+
+	ConvoNetBackend::t_map mapFiles, mapOpts;
+	std::shared_ptr<ConvoNetBackend> pBackend;
+	fs::path pathTmp;
+
+	// output to coordinator
+	std::mutex mtxWrite;
+	auto send = [&pSock, &mtxWrite](const std::string& str)
+	{
+		std::lock_guard<std::mutex> lock(mtxWrite);
+		sys::error_code err;
+		asio::write(*pSock, asio::buffer(str), err);
+	};
+
+	// points to calculate
+	std::deque<std::pair<std::string, std::array<t_real, 4>>> queue;
+	std::mutex mtxQueue;
+	std::condition_variable cvQueue;
+	bool bFinished = false;
+	std::list<std::thread> lstThreads;
+
+	auto calc_loop = [&]()
+	{
+		tl::init_rand();
+
+		while(1)
+		{
+			std::pair<std::string, std::array<t_real, 4>> pt;
+			{
+				std::unique_lock<std::mutex> lock(mtxQueue);
+				cvQueue.wait(lock, [&queue, &bFinished]() { return bFinished || queue.size(); });
+				if(queue.empty())
+					break;
+
+				pt = std::move(queue.front());
+				queue.pop_front();
+			}
+
+			try
+			{
+				std::pair<bool, t_real> res = pBackend->Calc(pt.second[0], pt.second[1], pt.second[2], pt.second[3]);
+				if(res.first)
+					send("result " + pt.first + " " + real_to_str(res.second) + "\n");
+				else
+					send("failed " + pt.first + "\n");
+			}
+			catch(const std::exception& ex)
+			{
+				tl::log_err("Convolution worker fault: ", ex.what(), ". Dropping connection to ", strPeer, ".");
+
+				// let the coordinator re-distribute the points
+				sys::error_code err;
+				pSock->shutdown(ip::tcp::socket::shutdown_both, err);
+				break;
+			}
+		}
+	};
+
+
+	std::string strLine;
+	while(read_line(*pSock, buf, strLine))
+	{
+		std::string strCmd, strArgs;
+		std::tie(strCmd, strArgs) = split_first(strLine);
+
+		if(strCmd == "calc")
+		{
+			std::vector<std::string> vecArgs;
+			tl::get_tokens<std::string, std::string>(strArgs, " ", vecArgs);
+			if(vecArgs.size() != 5)
+			{
+				tl::log_err("Invalid calculation request: \"", strLine, "\".");
+				continue;
+			}
+
+			if(!pBackend)
+			{
+				send("failed " + vecArgs[0] + "\n");
+				continue;
+			}
+
+			std::array<t_real, 4> arrHKLE;
+			for(int i=0; i<4; ++i)
+				arrHKLE[i] = tl::str_to_var<t_real>(vecArgs[i+1]);
+
+			{
+				std::lock_guard<std::mutex> lock(mtxQueue);
+				queue.emplace_back(std::make_pair(vecArgs[0], arrHKLE));
+			}
+			cvQueue.notify_one();
+		}
+		else if(strCmd == "file")
+		{
+			std::string strSize, strName;
+			std::tie(strSize, strName) = split_first(strArgs);
+			const std::size_t iSize = tl::str_to_var<std::size_t>(strSize);
+			if(iSize > m_iMaxFileSize)
+			{
+				tl::log_err("File \"", strName, "\" from ", strPeer, " exceeds the maximum size of ",
+					m_iMaxFileSize, " bytes. Dropping connection.");
+				break;
+			}
+
+			// read the file contents following the command
+			sys::error_code err;
+			if(buf.size() < iSize)
+				asio::read(*pSock, buf, asio::transfer_exactly(iSize - buf.size()), err);
+			if(err)
+				break;
+
+			std::string strContents(iSize, 0);
+			std::istream istr(&buf);
+			istr.read(&strContents[0], iSize);
+
+			if(pathTmp.empty())
+			{
+				pathTmp = fs::temp_directory_path() / fs::unique_path("takin_convo_%%%%%%%%");
+				fs::create_directories(pathTmp);
+			}
+
+			// keep the file name, but use a distinct directory for each file
+			const fs::path pathDir = pathTmp / tl::var_to_str(mapFiles.size());
+			fs::create_directories(pathDir);
+			const fs::path pathFile = pathDir / fs::path(strName).filename();
+
+			std::ofstream ofstr(pathFile.string(), std::ios_base::binary);
+			ofstr.write(strContents.data(), strContents.size());
+			mapFiles[strName] = pathFile.string();
+
+			tl::log_debug("Received file \"", strName, "\" (", iSize, " bytes).");
+		}
+		else if(strCmd == "opt")
+		{
+			std::string strKey, strVal;
+			std::tie(strKey, strVal) = split_first(strArgs);
+			mapOpts[strKey] = strVal;
+		}
+		else if(strCmd == "setup")
+		{
+			if(pBackend)
+			{
+				send("error Already set up.\n");
+				continue;
+			}
+
+			std::shared_ptr<ConvoNetBackend> pNewBackend = m_factory();
+			if(!pNewBackend || !pNewBackend->Setup(mapFiles, mapOpts))
+			{
+				send("error Setup failed, see worker log.\n");
+				continue;
+			}
+
+			pBackend = pNewBackend;
+			for(unsigned int iThread=0; iThread<m_iNumThreads; ++iThread)
+				lstThreads.emplace_back(calc_loop);
+
+			send("ready " + tl::var_to_str(m_iNumThreads) + "\n");
+			tl::log_info("Convolution set up for ", strPeer, ".");
+		}
+		else if(strCmd == "quit")
+		{
+			break;
+		}
+		else
+		{
+			tl::log_err("Unknown command: \"", strLine, "\".");
+		}
+	}
+
+
+	// stop calculations, nobody is listening anymore
+	{
+		std::lock_guard<std::mutex> lock(mtxQueue);
+		queue.clear();
+		bFinished = true;
+	}
+	cvQueue.notify_all();
+	for(std::thread& th : lstThreads)
+		th.join();
+
+	sys::error_code err;
+	pSock->close(err);
+
+	if(!pathTmp.empty())
+		fs::remove_all(pathTmp, err);
+
+	tl::log_info("Coordinator ", strPeer, " disconnected.");
+}
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// coordinator
+
+/**
+ * state shared between the worker connections
+ */
+struct ConvoNetCoordinator::Job
+{
+	const std::vector<t_point> *pPoints = nullptr;
+
+	std::vector<t_result> vecResults;
+	std::vector<bool> vecDone;
+	std::vector<unsigned int> vecAttempts;
+
+	// points still to be assigned to a worker
+	std::deque<std::size_t> queue;
+	// points which could not be calculated remotely
+	std::vector<std::size_t> vecUnassigned;
+	// points without a result
+	std::size_t iOutstanding = 0;
+
+	std::mutex mtx;
+	std::condition_variable cv;
+};
+
+
+
+/**
+ * adds a comma-separated list of "host:port" workers
+ */
+bool ConvoNetCoordinator::AddWorkers(const std::string& strWorkers)
+{
+	std::vector<std::string> vecWorkers;
+	tl::get_tokens<std::string, std::string>(strWorkers, ",;", vecWorkers);
+
+	for(std::string strWorker : vecWorkers)
+	{
+		tl::trim(strWorker);
+		if(strWorker == "")
+			continue;
+
+		std::size_t iPos = strWorker.rfind(':');
+		if(iPos == std::string::npos)
+		{
+			tl::log_err("Invalid worker \"", strWorker, "\", expected \"host:port\".");
+			return false;
+		}
+
+		AddWorker(strWorker.substr(0, iPos), strWorker.substr(iPos+1));
+	}
+
+	return true;
+}
+
+
+void ConvoNetCoordinator::AddWorker(const std::string& strHost, const std::string& strPort)
+{
+	m_vecWorkers.emplace_back(std::make_pair(strHost, strPort));
+}
+
+
+
+/**
+ * adds a file which is shipped to the workers under the given name
+ */
+bool ConvoNetCoordinator::AddFile(const std::string& strName, const std::string& strFile)
+{
+	std::ifstream ifstr(strFile, std::ios_base::binary);
+	if(!ifstr)
+	{
+		tl::log_err("Cannot open file \"", strFile, "\" for the workers.");
+		return false;
+	}
+
+	std::ostringstream ostr;
+	ostr << ifstr.rdbuf();
+	AddFileContents(strName, ostr.str());
+	return true;
+}
+
+
+void ConvoNetCoordinator::AddFileContents(const std::string& strName, const std::string& strContents)
+{
+	m_vecFiles.emplace_back(std::make_pair(strName, strContents));
+}
+
+
+void ConvoNetCoordinator::SetOpt(const std::string& strKey, const std::string& strVal)
+{
+	m_mapOpts[strKey] = strVal;
+}
+
+
+
+/**
+ * handles the connection to one worker, reconnecting if it fails
+ */
+void ConvoNetCoordinator::WorkerLoop(const std::string& strHost, const std::string& strPort, Job& job) const
+{
+	const std::string strWorker = strHost + ":" + strPort;
+
+	for(unsigned int iTry=0; iTry<=m_iMaxRetries; ++iTry)
+	{
+		{
+			// wait before reconnecting, unless the other workers finish the job
+			std::unique_lock<std::mutex> lock(job.mtx);
+			if(iTry > 0)
+				job.cv.wait_for(lock, std::chrono::seconds(iTry), [&job]() { return job.iOutstanding == 0; });
+			if(job.iOutstanding == 0)
+				return;
+		}
+
+		if(iTry > 0)
+			tl::log_info("Reconnecting to worker ", strWorker, ", attempt ", iTry, " of ", m_iMaxRetries, ".");
+
+		// points sent to this worker
+		std::list<std::size_t> lstInFlight;
+
+		try
+		{
+			asio::io_service service;
+			ip::tcp::resolver resolver(service);
+			ip::tcp::socket sock(service);
+			asio::connect(sock, resolver.resolve(ip::tcp::resolver::query(strHost, strPort)));
+			sock.set_option(asio::socket_base::keep_alive(true));
+			sock.set_option(ip::tcp::no_delay(true));
+
+			asio::streambuf buf;
+			std::string strLine, strCmd, strArgs;
+
+			// authenticate
+			asio::write(sock, asio::buffer("auth " + m_strSecret + "\n"));
+			read_line_timeout(service, sock, buf, strLine, m_iTimeout);
+			if(strLine != "welcome")
+			{
+				// a wrong secret is not fixed by retrying
+				tl::log_err("Worker ", strWorker, " rejected the connection: ", split_first(strLine).second);
+				return;
+			}
+
+			// transfer the configuration
+			for(const auto& pairFile : m_vecFiles)
+			{
+				asio::write(sock, asio::buffer("file " + tl::var_to_str(pairFile.second.size())
+					+ " " + pairFile.first + "\n"));
+				asio::write(sock, asio::buffer(pairFile.second));
+			}
+			for(const auto& pairOpt : m_mapOpts)
+				asio::write(sock, asio::buffer("opt " + pairOpt.first + " " + pairOpt.second + "\n"));
+			asio::write(sock, asio::buffer(std::string("setup\n")));
+			read_line_timeout(service, sock, buf, strLine, m_iTimeout);
+
+			std::tie(strCmd, strArgs) = split_first(strLine);
+			if(strCmd != "ready")
+			{
+				// configuration errors are not fixed by retrying
+				tl::log_err("Worker ", strWorker, " could not be set up: ", strArgs);
+				return;
+			}
+
+			const std::size_t iWindow = std::max<std::size_t>(1,
+				tl::str_to_var<std::size_t>(strArgs)) * m_iPointsPerThread;
+			tl::log_info("Worker ", strWorker, " is ready, ", strArgs, " thread(s).");
+
+			while(1)
+			{
+				// send new points
+				std::ostringstream ostrReq;
+				ostrReq.precision(std::numeric_limits<t_real>::max_digits10);
+				{
+					std::unique_lock<std::mutex> lock(job.mtx);
+					if(lstInFlight.empty())
+					{
+						job.cv.wait(lock, [&job]() { return job.queue.size() || job.iOutstanding == 0; });
+						if(job.iOutstanding == 0)
+							break;
+					}
+
+					while(lstInFlight.size() < iWindow && job.queue.size())
+					{
+						std::size_t iPt = job.queue.front();
+						job.queue.pop_front();
+						lstInFlight.push_back(iPt);
+
+						const t_point& pt = (*job.pPoints)[iPt];
+						ostrReq << "calc " << iPt << " " << pt[0] << " " << pt[1]
+							<< " " << pt[2] << " " << pt[3] << "\n";
+					}
+				}
+
+				const std::string strReq = ostrReq.str();
+				if(strReq.size())
+					asio::write(sock, asio::buffer(strReq));
+
+				// receive a result, a worker which does not answer in time
+				// is dropped and its points are given to the other workers
+				read_line_timeout(service, sock, buf, strLine, m_iTimeout);
+
+				std::tie(strCmd, strArgs) = split_first(strLine);
+				std::vector<std::string> vecArgs;
+				tl::get_tokens<std::string, std::string>(strArgs, " ", vecArgs);
+				if((strCmd != "result" && strCmd != "failed") || vecArgs.size() < 1)
+				{
+					tl::log_err("Invalid answer from worker ", strWorker, ": \"", strLine, "\".");
+					continue;
+				}
+
+				std::size_t iPt = tl::str_to_var<std::size_t>(vecArgs[0]);
+				auto iterPt = std::find(lstInFlight.begin(), lstInFlight.end(), iPt);
+				if(iterPt == lstInFlight.end())
+					continue;
+				lstInFlight.erase(iterPt);
+
+				std::lock_guard<std::mutex> lock(job.mtx);
+				if(!job.vecDone[iPt])
+				{
+					job.vecDone[iPt] = true;
+					if(strCmd == "result" && vecArgs.size() >= 2)
+						job.vecResults[iPt] = t_result(true, tl::str_to_var<t_real>(vecArgs[1]));
+					else
+						job.vecResults[iPt] = t_result(false, t_real(0));
+
+					if(--job.iOutstanding == 0)
+						job.cv.notify_all();
+				}
+			}
+
+			asio::write(sock, asio::buffer(std::string("quit\n")));
+			return;
+		}
+		catch(const std::exception& ex)
+		{
+			tl::log_err("Worker ", strWorker, " failed: ", ex.what(), ".");
+		}
+
+		// give the points back to the other workers
+		std::lock_guard<std::mutex> lock(job.mtx);
+		for(std::size_t iPt : lstInFlight)
+		{
+			if(job.vecDone[iPt])
+				continue;
+
+			if(++job.vecAttempts[iPt] > m_iMaxRetries)
+			{
+				// the point itself may crash the workers
+				job.vecUnassigned.push_back(iPt);
+				if(--job.iOutstanding == 0)
+					job.cv.notify_all();
+			}
+			else
+			{
+				job.queue.push_back(iPt);
+			}
+		}
+		job.cv.notify_all();
+	}
+
+	tl::log_err("Giving up on worker ", strWorker, ".");
+}
+
+
+
+/**
+ * calculates the points on the workers, points which cannot be
+ * calculated remotely are passed to the local function (if given)
+ */
+std::vector<ConvoNetCoordinator::t_result> ConvoNetCoordinator::Calc(
+	const std::vector<t_point>& vecPoints, const t_localfunc& funcLocal) const
+{
+	Job job;
+	job.pPoints = &vecPoints;
+	job.vecResults.resize(vecPoints.size(), t_result(false, t_real(0)));
+	job.vecDone.resize(vecPoints.size(), false);
+	job.vecAttempts.resize(vecPoints.size(), 0);
+	job.iOutstanding = vecPoints.size();
+	for(std::size_t iPt=0; iPt<vecPoints.size(); ++iPt)
+		job.queue.push_back(iPt);
+
+	std::list<std::thread> lstThreads;
+	for(const auto& pairWorker : m_vecWorkers)
+	{
+		lstThreads.emplace_back([this, &pairWorker, &job]()
+		{
+			this->WorkerLoop(pairWorker.first, pairWorker.second, job);
+		});
+	}
+
+	for(std::thread& th : lstThreads)
+		th.join();
+
+
+	// remaining points if all workers failed
+	std::vector<std::size_t> vecLocal = job.vecUnassigned;
+	vecLocal.insert(vecLocal.end(), job.queue.begin(), job.queue.end());
+
+	if(vecLocal.size())
+	{
+		if(funcLocal)
+		{
+			tl::log_warn("Calculating ", vecLocal.size(), " point(s) locally.");
+			for(std::size_t iPt : vecLocal)
+				job.vecResults[iPt] = funcLocal(vecPoints[iPt]);
+		}
+		else
+		{
+			tl::log_err(vecLocal.size(), " point(s) could not be calculated.");
+		}
+	}
+
+	return job.vecResults;
+}
+// ----------------------------------------------------------------------------
@@ -0,0 +1,180 @@
+/**
+ * distributed convolution -- coordinator and worker over tcp
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+/*
+ * line-based protocol, one connection per coordinator and worker:
+ *
+ *   coordinator -> worker                  worker -> coordinator
+ *   -------------------------------------  --------------------------------
+ *   auth <secret>\n                        welcome\n | error <msg>\n
+ *   file <size> <name>\n<size bytes>
+ *   opt <key> <value>\n
+ *   setup\n                                ready <threads>\n | error <msg>\n
+ *   calc <id> <h> <k> <l> <E>\n            result <id> <S>\n | failed <id>\n
+ *   quit\n
+ *
+ * the configuration (files and options) is only transferred once per
+ * connection, afterwards only the scan points and the intensities are sent.
+ * a worker which does not answer within the coordinator's timeout is
+ * disconnected and its points are re-distributed.
+ *
+ * the worker only listens on the loopback interface unless another address
+ * is given, in which case a shared secret is required. the secret is checked
+ * before any other command is accepted.
+ */
+
+#ifndef __MONTECONVO_NET_H__
+#define __MONTECONVO_NET_H__
+
+#include <string>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <mutex>
+
+#include <boost/asio.hpp>
+
+#include "tools/res/defs.h"
+
+
+/**
+ * calculates the convolution on the worker side
+ */
+class ConvoNetBackend
+{
+public:
+	using t_map = std::unordered_map<std::string, std::string>;
+
+public:
+	virtual ~ConvoNetBackend() = default;
+
+	// files: [original name -> local file], opts: [key -> value]
+	virtual bool Setup(const t_map& files, const t_map& opts) = 0;
+
+	// has to be thread-safe, throwing an exception drops the connection
+	virtual std::pair<bool, t_real_reso> Calc(
+		t_real_reso h, t_real_reso k, t_real_reso l, t_real_reso E) const = 0;
+};
+
+
+using t_convonet_backend_factory = std::function<std::shared_ptr<ConvoNetBackend>()>;
+
+
+
+/**
+ * worker: waits for coordinators and evaluates their points
+ */
+class ConvoNetWorker
+{
+protected:
+	unsigned short m_iPort = 0;
+	unsigned int m_iNumThreads = 1;
+	t_convonet_backend_factory m_factory;
+
+	std::string m_strBindAddr = "127.0.0.1";
+	std::string m_strSecret;
+	std::size_t m_iMaxFileSize = 64*1024*1024;
+
+	boost::asio::io_service m_service;
+	std::unique_ptr<boost::asio::ip::tcp::acceptor> m_pAcceptor;
+	std::atomic<bool> m_bStop{false};
+
+protected:
+	void Session(std::shared_ptr<boost::asio::ip::tcp::socket> pSock) const;
+	bool Authenticate(boost::asio::ip::tcp::socket& sock, boost::asio::streambuf& buf) const;
+
+public:
+	ConvoNetWorker(unsigned short iPort, unsigned int iNumThreads,
+		const t_convonet_backend_factory& factory);
+	~ConvoNetWorker() = default;
+
+	bool Listen();
+	bool Run();
+	void Stop();
+
+	void SetBindAddress(const std::string& strAddr) { m_strBindAddr = strAddr; }
+	void SetSecret(const std::string& strSecret) { m_strSecret = strSecret; }
+	void SetMaxFileSize(std::size_t iSize) { m_iMaxFileSize = iSize; }
+
+	unsigned short GetPort() const { return m_iPort; }
+};
+
+
+
+/**
+ * coordinator: distributes points over the workers and
+ * re-distributes the points of failed workers
+ */
+class ConvoNetCoordinator
+{
+public:
+	using t_point = std::array<t_real_reso, 4>;
+	using t_result = std::pair<bool, t_real_reso>;
+	using t_localfunc = std::function<t_result(const t_point&)>;
+
+protected:
+	// [host, port]
+	std::vector<std::pair<std::string, std::string>> m_vecWorkers;
+
+	// [name, contents]
+	std::vector<std::pair<std::string, std::string>> m_vecFiles;
+	ConvoNetBackend::t_map m_mapOpts;
+	std::string m_strSecret;
+
+	unsigned int m_iMaxRetries = 2;
+	unsigned int m_iPointsPerThread = 2;
+	unsigned int m_iTimeout = 600;     // in seconds, 0: no timeout
+
+protected:
+	struct Job;
+	void WorkerLoop(const std::string& strHost, const std::string& strPort, Job& job) const;
+
+public:
+	ConvoNetCoordinator() = default;
+	~ConvoNetCoordinator() = default;
+
+	bool AddWorkers(const std::string& strWorkers);
+	void AddWorker(const std::string& strHost, const std::string& strPort);
+	bool AddFile(const std::string& strName, const std::string& strFile);
+	void AddFileContents(const std::string& strName, const std::string& strContents);
+	void SetOpt(const std::string& strKey, const std::string& strVal);
+
+	void SetMaxRetries(unsigned int iNum) { m_iMaxRetries = iNum; }
+	void SetTimeout(unsigned int iSecs) { m_iTimeout = iSecs; }
+	void SetSecret(const std::string& strSecret) { m_strSecret = strSecret; }
+	std::size_t GetNumWorkers() const { return m_vecWorkers.size(); }
+
+	std::vector<t_result> Calc(const std::vector<t_point>& vecPoints,
+		const t_localfunc& funcLocal = nullptr) const;
+};
+
+
+#endif
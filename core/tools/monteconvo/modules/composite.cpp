@@ -0,0 +1,288 @@
+/**
+ * composite S(Q, E) model consisting of several scaled sub-models
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "composite.h"
+#include "../sqwfactory.h"
+#include "libs/globals.h"
+
+#include "tlibs/string/string.h"
+#include "tlibs/file/file.h"
+#include "tlibs/log/log.h"
+
+#include <fstream>
+#include <sstream>
+
+using t_real = SqwComposite::t_real;
+
+
+/**
+ * loads the components, one per line: name, model identifier, model config file, [scale]
+ */
+SqwComposite::SqwComposite(const char* pcFile)
+{
+	std::ifstream ifstr(pcFile);
+	if(!ifstr)
+	{
+		tl::log_err("Cannot open config file \"", pcFile, "\".");
+		return;
+	}
+
+	const std::string strDir = tl::get_dir(std::string(pcFile));
+
+	std::string strLine;
+	while(std::getline(ifstr, strLine))
+	{
+		tl::trim(strLine);
+		if(strLine.length()==0 || strLine[0]=='#')
+			continue;
+
+		std::istringstream istr(strLine);
+		Component comp;
+		std::string strCfg;
+		istr >> comp.strName >> comp.strModel >> strCfg;
+		if(!(istr >> comp.dScale))
+			comp.dScale = 1.;
+
+		if(comp.strName == "" || comp.strModel == "" || strCfg == "")
+		{
+			tl::log_err("Invalid composite S(Q, E) component definition: \"", strLine, "\".");
+			return;
+		}
+
+		if(comp.strName.find('.') != std::string::npos)
+		{
+			tl::log_err("S(Q, E) component names must not contain a \".\".");
+			return;
+		}
+
+		if(comp.strModel == "composite")
+		{
+			tl::log_err("Composite S(Q, E) models cannot be nested.");
+			return;
+		}
+
+		if(GetComponentIdx(comp.strName + ".scale") < m_vecComps.size())
+		{
+			tl::log_err("Duplicate S(Q, E) component name \"", comp.strName, "\".");
+			return;
+		}
+
+		// config file paths are relative to the composite's config file
+		std::string strCfgFile = strCfg;
+		if(strDir != "" && strCfg[0] != '/' && tl::file_exists((strDir + "/" + strCfg).c_str()))
+			strCfgFile = strDir + "/" + strCfg;
+		else
+			strCfgFile = find_file_in_global_paths(strCfg);
+
+		comp.pSqw = construct_sqw(comp.strModel, strCfgFile);
+		if(!comp.pSqw || !comp.pSqw->IsOk())
+		{
+			tl::log_err("Could not create S(Q, E) component \"", comp.strName,
+				"\" using model \"", comp.strModel, "\".");
+			return;
+		}
+
+		m_vecComps.emplace_back(std::move(comp));
+	}
+
+	tl::log_info("Number of S(Q, E) components: ", m_vecComps.size(), ".");
+	SqwBase::m_bOk = (m_vecComps.size() != 0);
+}
+
+
+/**
+ * finds the component a prefixed variable name belongs to
+ */
+std::size_t SqwComposite::GetComponentIdx(const std::string& strVar, std::string* pstrSubVar) const
+{
+	const std::size_t iDot = strVar.find('.');
+	if(iDot == std::string::npos)
+		return m_vecComps.size();
+
+	const std::string strComp = strVar.substr(0, iDot);
+	for(std::size_t iComp=0; iComp<m_vecComps.size(); ++iComp)
+	{
+		if(m_vecComps[iComp].strName == strComp)
+		{
+			if(pstrSubVar)
+				*pstrSubVar = strVar.substr(iDot+1);
+			return iComp;
+		}
+	}
+
+	return m_vecComps.size();
+}
+
+
+void SqwComposite::GetPartials(t_real dh, t_real dk, t_real dl, t_real dE,
+	std::vector<t_real>& vecPartials) const
+{
+	vecPartials.resize(m_vecComps.size());
+	for(std::size_t iComp=0; iComp<m_vecComps.size(); ++iComp)
+		vecPartials[iComp] = (*m_vecComps[iComp].pSqw)(dh, dk, dl, dE);
+}
+
+
+void SqwComposite::GetPartialBackgrounds(t_real dh, t_real dk, t_real dl, t_real dE,
+	std::vector<t_real>& vecPartials) const
+{
+	vecPartials.resize(m_vecComps.size());
+	for(std::size_t iComp=0; iComp<m_vecComps.size(); ++iComp)
+		vecPartials[iComp] = m_vecComps[iComp].pSqw->GetBackground(dh, dk, dl, dE);
+}
+
+
+t_real SqwComposite::operator()(t_real dh, t_real dk, t_real dl, t_real dE) const
+{
+	t_real dS = 0.;
+	for(const Component& comp : m_vecComps)
+		dS += comp.dScale * (*comp.pSqw)(dh, dk, dl, dE);
+	return dS;
+}
+
+
+t_real SqwComposite::GetBackground(t_real dh, t_real dk, t_real dl, t_real dE) const
+{
+	t_real dBkg = 0.;
+	for(const Component& comp : m_vecComps)
+		dBkg += comp.dScale * comp.pSqw->GetBackground(dh, dk, dl, dE);
+	return dBkg;
+}
+
+
+/**
+ * the component variables which change the shape of the partial intensities,
+ * two models with the same key only differ in their amplitudes
+ */
+std::string SqwComposite::GetShapeKey() const
+{
+	std::ostringstream ostr;
+	for(const Component& comp : m_vecComps)
+	{
+		ostr << comp.strName << ":";
+		for(const SqwBase::t_var& var : comp.pSqw->GetVars())
+			ostr << std::get<0>(var) << "=" << std::get<2>(var) << ";";
+		ostr << "|";
+	}
+	return ostr.str();
+}
+
+
+std::vector<SqwBase::t_var> SqwComposite::GetVars() const
+{
+	std::vector<SqwBase::t_var> vecVars;
+
+	for(const Component& comp : m_vecComps)
+	{
+		vecVars.push_back(SqwBase::t_var{comp.strName + ".scale", "double", tl::var_to_str(comp.dScale)});
+
+		for(const SqwBase::t_var& var : comp.pSqw->GetVars())
+		{
+			vecVars.push_back(SqwBase::t_var{comp.strName + "." + std::get<0>(var),
+				std::get<1>(var), std::get<2>(var)});
+		}
+	}
+
+	return vecVars;
+}
+
+
+/**
+ * variables without a component prefix, e.g. the temperature, are passed on to all components
+ */
+void SqwComposite::SetVars(const std::vector<SqwBase::t_var>& vecVars)
+{
+	if(vecVars.size() == 0)
+		return;
+
+	std::vector<std::vector<SqwBase::t_var>> vecCompVars(m_vecComps.size());
+
+	for(const SqwBase::t_var& var : vecVars)
+	{
+		const std::string& strVar = std::get<0>(var);
+
+		std::string strSubVar;
+		std::size_t iComp = GetComponentIdx(strVar, &strSubVar);
+
+		if(iComp < m_vecComps.size())
+		{
+			if(strSubVar == "scale")
+				m_vecComps[iComp].dScale = tl::str_to_var_parse<t_real>(std::get<2>(var));
+			else
+				vecCompVars[iComp].push_back(SqwBase::t_var{strSubVar, std::get<1>(var), std::get<2>(var)});
+		}
+		else
+		{
+			for(std::vector<SqwBase::t_var>& vecComp : vecCompVars)
+				vecComp.push_back(var);
+		}
+	}
+
+	for(std::size_t iComp=0; iComp<m_vecComps.size(); ++iComp)
+	{
+		if(vecCompVars[iComp].size())
+			m_vecComps[iComp].pSqw->SetVars(vecCompVars[iComp]);
+	}
+}
+
+
+bool SqwComposite::SetVarIfAvail(const std::string& strKey, const std::string& strNewVal)
+{
+	std::string strSubVar;
+	std::size_t iComp = GetComponentIdx(strKey, &strSubVar);
+
+	if(iComp < m_vecComps.size())
+	{
+		if(strSubVar == "scale")
+		{
+			m_vecComps[iComp].dScale = tl::str_to_var_parse<t_real>(strNewVal);
+			return true;
+		}
+
+		return m_vecComps[iComp].pSqw->SetVarIfAvail(strSubVar, strNewVal);
+	}
+
+	// unprefixed variable: set it in all components which know it
+	bool bFound = false;
+	for(Component& comp : m_vecComps)
+		bFound = comp.pSqw->SetVarIfAvail(strKey, strNewVal) || bFound;
+	return bFound;
+}
+
+
+SqwBase* SqwComposite::shallow_copy() const
+{
+	SqwComposite *pComp = new SqwComposite();
+	*static_cast<SqwBase*>(pComp) = *static_cast<const SqwBase*>(this);
+
+	pComp->m_vecComps = m_vecComps;
+	for(Component& comp : pComp->m_vecComps)
+		comp.pSqw = std::shared_ptr<SqwBase>(comp.pSqw->shallow_copy());
+
+	return pComp;
+}
@@ -0,0 +1,92 @@
+/**
+ * composite S(Q, E) model consisting of several scaled sub-models
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __MCONV_SQWMOD_COMPOSITE_H__
+#define __MCONV_SQWMOD_COMPOSITE_H__
+
+#include <vector>
+#include <string>
+#include <memory>
+
+#include "../../res/defs.h"
+#include "../sqwbase.h"
+
+
+/**
+ * sum of several S(Q, E) models which are evaluated on the same neutrons,
+ * the variables of each component are prefixed with its name, e.g. "phonon.T",
+ * and each component has an additional amplitude variable, e.g. "phonon.scale"
+ */
+class SqwComposite : public SqwBase
+{
+public:
+	using t_real = t_real_reso;
+
+	struct Component
+	{
+		std::string strName;
+		std::string strModel;
+		std::shared_ptr<SqwBase> pSqw;
+		t_real dScale = 1.;
+	};
+
+protected:
+	std::vector<Component> m_vecComps;
+
+protected:
+	SqwComposite() = default;
+
+	std::size_t GetComponentIdx(const std::string& strVar, std::string* pstrSubVar = nullptr) const;
+
+public:
+	SqwComposite(const char* pcFile);
+	virtual ~SqwComposite() = default;
+
+	virtual t_real operator()(t_real dh, t_real dk, t_real dl, t_real dE) const override;
+	virtual t_real GetBackground(t_real dh, t_real dk, t_real dl, t_real dE) const override;
+
+	// unscaled intensities of the individual components
+	void GetPartials(t_real dh, t_real dk, t_real dl, t_real dE, std::vector<t_real>& vecPartials) const;
+	void GetPartialBackgrounds(t_real dh, t_real dk, t_real dl, t_real dE, std::vector<t_real>& vecPartials) const;
+
+	std::size_t GetComponentCount() const { return m_vecComps.size(); }
+	const std::string& GetComponentName(std::size_t iComp) const { return m_vecComps[iComp].strName; }
+	t_real GetComponentScale(std::size_t iComp) const { return m_vecComps[iComp].dScale; }
+
+	// all variables except the component amplitudes
+	std::string GetShapeKey() const;
+
+	virtual std::vector<SqwBase::t_var> GetVars() const override;
+	virtual void SetVars(const std::vector<SqwBase::t_var>&) override;
+	virtual bool SetVarIfAvail(const std::string& strKey, const std::string& strNewVal) override;
+
+	virtual SqwBase* shallow_copy() const override;
+};
+
+
+#endif
@@ -38,6 +38,7 @@
 #include <atomic>
 #include <memory>
 #include <string>
+#include <cstdlib>
 
 #include "monteconvo_cli.h"
 #include "monteconvo_common.h"
@@ -46,6 +47,8 @@
 #include "tools/res/defs.h"
 #include "tools/convofit/scan.h"
 #include "TASReso.h"
+#include "convo_net.h"
+#include "neutron_pool.h"
 
 #include "libs/globals.h"
 #include "tlibs/file/file.h"
@@ -83,13 +86,19 @@ struct ConvoConfig
 
 	t_real tolerance{};
 	t_real S_scale{1}, S_slope{0}, S_offs{0};
+	t_real max_disp_curv{0.5};       // limit for the analytic convolution
+	t_real pool_factor{8};           // initial neutrons per point in the shared pool: neutron_count / pool_factor
+	t_real pool_ess{1};              // target effective sample size relative to neutron_count
 
 	unsigned int neutron_count{500};
 	unsigned int sample_step_count{1};
 	unsigned int step_count{256};
+	unsigned int pool_rounds{4};     // maximum number of top-up rounds for the shared pool
 
 	bool scan_2d{false};
+	bool analytic_convo{false};      // analytic convolution for dispersion models
 	bool recycle_neutrons{true};
+	bool neutron_pool{false};        // share the neutrons of all points, see NeutronPool
 	bool normalise{true};
 	bool flip_coords{false};
 	bool allow_scan_merging{false};
@@ -136,6 +145,9 @@ static ConvoConfig load_config(const tl::Prop<std::string>& xml)
 	odVal = xml.QueryOpt<t_real>(g_strXmlRoot+"monteconvo/S_scale"); if(odVal) cfg.S_scale = *odVal;
 	odVal = xml.QueryOpt<t_real>(g_strXmlRoot+"monteconvo/S_slope"); if(odVal) cfg.S_slope = *odVal;
 	odVal = xml.QueryOpt<t_real>(g_strXmlRoot+"monteconvo/S_offs"); if(odVal) cfg.S_offs = *odVal;
+	odVal = xml.QueryOpt<t_real>(g_strXmlRoot+"monteconvo/analytic_max_curvature"); if(odVal) cfg.max_disp_curv = *odVal;
+	odVal = xml.QueryOpt<t_real>(g_strXmlRoot+"monteconvo/pool_factor"); if(odVal) cfg.pool_factor = *odVal;
+	odVal = xml.QueryOpt<t_real>(g_strXmlRoot+"monteconvo/pool_ess"); if(odVal) cfg.pool_ess = *odVal;
 
 	// real value epsilons
 	odVal = xml.QueryOpt<t_real>(g_strXmlRoot+"monteconvo/eps_rlu");
@@ -157,12 +169,15 @@ static ConvoConfig load_config(const tl::Prop<std::string>& xml)
 	oiVal = xml.QueryOpt<unsigned int>(g_strXmlRoot+"monteconvo/neutron_count"); if(oiVal) cfg.neutron_count = *oiVal;
 	oiVal = xml.QueryOpt<unsigned int>(g_strXmlRoot+"monteconvo/sample_step_count"); if(oiVal) cfg.sample_step_count = *oiVal;
 	oiVal = xml.QueryOpt<unsigned int>(g_strXmlRoot+"monteconvo/step_count"); if(oiVal) cfg.step_count = *oiVal;
+	oiVal = xml.QueryOpt<unsigned int>(g_strXmlRoot+"monteconvo/pool_rounds"); if(oiVal) cfg.pool_rounds = *oiVal;
 	//oiVal = xml.QueryOpt<unsigned int>(g_strXmlRoot+"convofit/strategy"); if(oiVal) cfg.strategy = *oiVal;
 	//oiVal = xml.QueryOpt<unsigned int>(g_strXmlRoot+"convofit/max_calls"); if(oiVal) cfg.max_calls = *oiVal;
 
 	// bool values
 	boost::optional<int> obVal;
 	obVal = xml.QueryOpt<int>(g_strXmlRoot+"monteconvo/scan_2d"); if(obVal) cfg.scan_2d = (*obVal != 0);
+	obVal = xml.QueryOpt<int>(g_strXmlRoot+"monteconvo/analytic_convo"); if(obVal) cfg.analytic_convo = (*obVal != 0);
+	obVal = xml.QueryOpt<int>(g_strXmlRoot+"monteconvo/neutron_pool"); if(obVal) cfg.neutron_pool = (*obVal != 0);
 	obVal = xml.QueryOpt<int>(g_strXmlRoot+"convofit/recycle_neutrons"); if(obVal) cfg.recycle_neutrons = (*obVal != 0);
 	obVal = xml.QueryOpt<int>(g_strXmlRoot+"convofit/normalise"); if(obVal) cfg.normalise = (*obVal != 0);
 	obVal = xml.QueryOpt<int>(g_strXmlRoot+"convofit/flip_coords"); if(obVal) cfg.flip_coords = (*obVal != 0);
@@ -259,18 +274,18 @@ static std::shared_ptr<SqwBase> create_sqw_model(const std::string& strSqwIdent,
 
 
 /**
- * create 1d convolution
+ * create the S(Q, E) model and apply the parameter overrides
  */
-static bool start_convo_1d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, const std::string& sqw_params)
+static std::shared_ptr<SqwBase> setup_sqw(ConvoConfig& cfg, const tl::Prop<std::string>& xml, const std::string& sqw_params)
 {
-	// load S(Q. E) model
+	// load S(Q, E) model
 	std::shared_ptr<SqwBase> pSqw = create_sqw_model(cfg.sqw, cfg.sqw_conf);
 	if(!pSqw)
-		return false;
+		return nullptr;
 
 	// load default model parameters from configuration
 	if(!load_sqw_params(pSqw.get(), xml, g_strXmlRoot + "monteconvo/"))
-		return false;
+		return nullptr;
 
 
 	// override model parameters
@@ -289,96 +304,78 @@ static bool start_convo_1d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, c
 	if(iter_offs != all_params.end())
 		cfg.S_offs = tl::str_to_var<t_real>(iter_offs->second);
 
+	return pSqw;
+}
+
+
 
+/**
+ * load the scan file(s) and optionally take over their scan path
+ */
+static bool load_scan(ConvoConfig& cfg, const tl::Prop<std::string>& xml, Scan& scan)
+{
 	Filter filter;
 	if(cfg.filter_col != "")
 		filter.colEquals = std::make_pair(cfg.filter_col, cfg.filter_val);
 
-	Scan scan;
-	if(cfg.has_scanfile)
+	// optional counter and monitor overrides
+	boost::optional<std::string> optCtr = xml.QueryOpt<std::string>(g_strXmlRoot + "convofit/counter");
+	boost::optional<std::string> optMon = xml.QueryOpt<std::string>(g_strXmlRoot + "convofit/monitor");
+	if(optCtr)
+		scan.strCntCol = *optCtr;
+	if(optMon)
+		scan.strMonCol = *optMon;
+
+	if(!load_scan_file(cfg.scanfile, scan,
+		cfg.flip_coords, cfg.allow_scan_merging, filter))
 	{
-		// optional counter and monitor overrides
-		boost::optional<std::string> optCtr = xml.QueryOpt<std::string>(g_strXmlRoot + "convofit/counter");
-		boost::optional<std::string> optMon = xml.QueryOpt<std::string>(g_strXmlRoot + "convofit/monitor");
-		if(optCtr)
-			scan.strCntCol = *optCtr;
-		if(optMon)
-			scan.strMonCol = *optMon;
-
-		if(!load_scan_file(cfg.scanfile, scan,
-			cfg.flip_coords, cfg.allow_scan_merging, filter))
-		{
-			tl::log_err("Cannot load scan(s) \"", cfg.scanfile, "\".");
-			return false;
-		}
+		tl::log_err("Cannot load scan(s) \"", cfg.scanfile, "\".");
+		return false;
+	}
 
-		if(!scan.vecPoints.size())
-		{
-			tl::log_err("No points in scan(s) \"", cfg.scanfile, "\".");
-			return false;
-		}
+	if(!scan.vecPoints.size())
+	{
+		tl::log_err("No points in scan(s) \"", cfg.scanfile, "\".");
+		return false;
+	}
 
-		if(cfg.override_positions)
-		{
-			// use scan start and end positions from scan file
-			cfg.h_from = scan.vecScanOrigin[0];
-			cfg.k_from = scan.vecScanOrigin[1];
-			cfg.l_from = scan.vecScanOrigin[2];
-			cfg.E_from = scan.vecScanOrigin[3];
+	if(cfg.override_positions)
+	{
+		// use scan start and end positions from scan file
+		cfg.h_from = scan.vecScanOrigin[0];
+		cfg.k_from = scan.vecScanOrigin[1];
+		cfg.l_from = scan.vecScanOrigin[2];
+		cfg.E_from = scan.vecScanOrigin[3];
 
-			cfg.h_to = scan.vecScanOrigin[0] + scan.vecScanDir[0];
-			cfg.k_to = scan.vecScanOrigin[1] + scan.vecScanDir[1];
-			cfg.l_to = scan.vecScanOrigin[2] + scan.vecScanDir[2];
-			cfg.E_to = scan.vecScanOrigin[3] + scan.vecScanDir[3];
+		cfg.h_to = scan.vecScanOrigin[0] + scan.vecScanDir[0];
+		cfg.k_to = scan.vecScanOrigin[1] + scan.vecScanDir[1];
+		cfg.l_to = scan.vecScanOrigin[2] + scan.vecScanDir[2];
+		cfg.E_to = scan.vecScanOrigin[3] + scan.vecScanDir[3];
 
-			cfg.kfix = scan.dKFix;
-			cfg.fixedk = scan.bKiFixed ? 0 : 1;
+		cfg.kfix = scan.dKFix;
+		cfg.fixedk = scan.bKiFixed ? 0 : 1;
 
-			tl::log_info("Overriding scan path with values from scan file: (",
-				cfg.h_from, ", ", cfg.k_from, ", ", cfg.l_from, ") rlu, ", cfg.E_from, " meV -> (",
-				cfg.h_to, ", ", cfg.k_to, ", ", cfg.l_to, ") rlu, ", cfg.E_to, " meV.");
+		tl::log_info("Overriding scan path with values from scan file: (",
+			cfg.h_from, ", ", cfg.k_from, ", ", cfg.l_from, ") rlu, ", cfg.E_from, " meV -> (",
+			cfg.h_to, ", ", cfg.k_to, ", ", cfg.l_to, ") rlu, ", cfg.E_to, " meV.");
 
-			tl::log_info("Overriding fixed ", (cfg.fixedk == 0 ? "ki = " : "kf = "), cfg.kfix, " / A.");
-		}
+		tl::log_info("Overriding fixed ", (cfg.fixedk == 0 ? "ki = " : "kf = "), cfg.kfix, " / A.");
 	}
 
-
-	std::string strAutosave = cfg.autosave;
-	if(strAutosave == "")
-	{
-		strAutosave = "out.dat";
-		tl::log_warn("Output file not set, using \"", strAutosave, "\".");
-	}
+	return true;
+}
 
 
-	tl::Stopwatch<t_real> watch;
-	watch.start();
-
-	bool bScanAxisFound = false;
-	int iScanAxisIdx = 0;
-	std::string strScanVar = "";
-	std::vector<std::vector<t_real>> vecAxes;
-	std::tie(bScanAxisFound, iScanAxisIdx, strScanVar, vecAxes) = get_scan_axis<t_real>(
-		true, cfg.scanaxis, cfg.step_count, g_dEpsRlu,
-		cfg.h_from, cfg.h_to, cfg.k_from, cfg.k_to, cfg.l_from, cfg.l_to, cfg.E_from, cfg.E_to);
-	if(!bScanAxisFound)
-	{
-		tl::log_err("No scan variable found.");
-		return false;
-	}
-
-	const std::vector<t_real> *pVecScanX = &vecAxes[iScanAxisIdx];
-	const std::vector<t_real>& vecH = vecAxes[0];
-	const std::vector<t_real>& vecK = vecAxes[1];
-	const std::vector<t_real>& vecL = vecAxes[2];
-	const std::vector<t_real>& vecE = vecAxes[3];
 
+/**
+ * load the instrument and the crystal, the latter from the scan file if given
+ */
+static bool setup_reso(const ConvoConfig& cfg, const Scan* pScan, TASReso& reso)
+{
+	reso.SetPlaneDistTolerance(g_dEpsPlane);
 
 	// -------------------------------------------------------------------------
 	// Load reso file
-	TASReso reso;
-	reso.SetPlaneDistTolerance(g_dEpsPlane);
-
 	std::string _strResoFile = cfg.instr;
 	tl::trim(_strResoFile);
 	const std::string strResoFile = find_file_in_global_paths(_strResoFile);
@@ -392,8 +389,10 @@ static bool start_convo_1d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, c
 	// -------------------------------------------------------------------------
 
 
-	if(cfg.has_scanfile)	// get crystal definition from scan file
+	if(pScan)	// get crystal definition from scan file
 	{
+		const Scan& scan = *pScan;
+
 		ublas::vector<t_real> vec1 =
 			tl::make_vec({scan.plane.vec1[0], scan.plane.vec1[1], scan.plane.vec1[2]});
 		ublas::vector<t_real> vec2 =
@@ -423,6 +422,263 @@ static bool start_convo_1d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, c
 	reso.SetKFix(cfg.kfix);
 	reso.SetOptimalFocus(get_reso_focus(cfg.mono_foc, cfg.ana_foc));
 
+	return true;
+}
+
+
+
+/**
+ * convolution of a single (Q, E) point
+ */
+static std::pair<bool, t_real> convolve_point(const TASReso& reso, const SqwBase& sqw,
+	const ConvoConfig& cfg, t_real dCurH, t_real dCurK, t_real dCurL, t_real dCurE,
+	std::atomic<unsigned int>* pNumMCFallbacks = nullptr)
+{
+	t_real dS = 0.;
+	t_real dhklE_mean[4] = {0., 0., 0., 0.};
+
+	if(cfg.neutron_count == 0)
+	{	// if no neutrons are given, just plot the unconvoluted S(Q, E)
+		// TODO: add an option to let the user choose if S(Q,E) is
+		// really the dynamical structure factor, or its absolute square
+		dS += sqw(dCurH, dCurK, dCurL, dCurE);
+	}
+	else
+	{	// convolution
+		TASReso localreso = reso;
+		localreso.SetRandomSamplePos(cfg.sample_step_count);
+		std::vector<ublas::vector<t_real>> vecNeutrons;
+
+		try
+		{
+			if(!localreso.SetHKLE(dCurH, dCurK, dCurL, dCurE))
+			{
+				std::ostringstream ostrErr;
+				ostrErr << "Invalid crystal position: (" <<
+					dCurH << " " << dCurK << " " << dCurL << ") rlu, "
+					<< dCurE << " meV.";
+				throw tl::Err(ostrErr.str().c_str());
+			}
+		}
+		catch(const std::exception& ex)
+		{
+			tl::log_err(ex.what());
+			return std::pair<bool, t_real>(false, 0.);
+		}
+
+		// analytic convolution along the dispersion if possible
+		if(cfg.analytic_convo)
+		{
+			if(localreso.ConvolveDisp(sqw, dS, cfg.max_disp_curv))
+			{
+				dS *= localreso.GetResoResults().dR0 * localreso.GetR0Scale();
+				return std::pair<bool, t_real>(true, dS);
+			}
+
+			if(pNumMCFallbacks)
+				++*pNumMCFallbacks;
+		}
+
+		Ellipsoid4d<t_real> elli =
+			localreso.GenerateMC_deferred(cfg.neutron_count, vecNeutrons);
+
+		for(const ublas::vector<t_real>& vecHKLE : vecNeutrons)
+		{
+			// TODO: add an option to let the user choose if S(Q,E) is
+			// really the dynamical structure factor, or its absolute square
+			dS += sqw(vecHKLE[0], vecHKLE[1], vecHKLE[2], vecHKLE[3]);
+
+			for(int i=0; i<4; ++i)
+				dhklE_mean[i] += vecHKLE[i];
+		}
+
+		dS /= t_real(cfg.neutron_count*cfg.sample_step_count);
+		for(int i=0; i<4; ++i)
+			dhklE_mean[i] /= t_real(cfg.neutron_count*cfg.sample_step_count);
+
+		dS *= localreso.GetResoResults().dR0 * localreso.GetR0Scale();
+		//if(localreso.GetResoParams().flags & CALC_RESVOL)
+		//	dS /= localreso.GetResoResults().dResVol * tl::get_pi<t_real>() * t_real(3.);
+	}
+
+	return std::pair<bool, t_real>(true, dS);
+}
+
+
+
+/**
+ * calculates all points on the remote workers, points which
+ * could not be calculated remotely are convoluted locally
+ */
+static std::vector<ConvoNetCoordinator::t_result> convolve_remote(const ConvoNetCoordinator& net,
+	const TASReso& reso, const SqwBase& sqw, const ConvoConfig& cfg,
+	const std::vector<t_real>& vecH, const std::vector<t_real>& vecK,
+	const std::vector<t_real>& vecL, const std::vector<t_real>& vecE,
+	std::atomic<unsigned int>* pNumMCFallbacks)
+{
+	std::vector<ConvoNetCoordinator::t_point> vecPts;
+	vecPts.reserve(vecH.size());
+	for(std::size_t iPt=0; iPt<vecH.size(); ++iPt)
+		vecPts.push_back({ vecH[iPt], vecK[iPt], vecL[iPt], vecE[iPt] });
+
+	tl::log_info("Distributing ", vecPts.size(), " points over ", net.GetNumWorkers(), " worker(s).");
+
+	tl::init_rand();
+	return net.Calc(vecPts, [&reso, &sqw, &cfg, pNumMCFallbacks](const ConvoNetCoordinator::t_point& pt)
+	{
+		return convolve_point(reso, sqw, cfg, pt[0], pt[1], pt[2], pt[3], pNumMCFallbacks);
+	});
+}
+
+
+
+/**
+ * convolution of all points using a shared pool of neutrons,
+ * points which can be convoluted analytically are not included in the pool
+ */
+static std::vector<std::pair<bool, t_real>> convolve_pooled(
+	const TASReso& reso, const SqwBase& sqw, const ConvoConfig& cfg,
+	const std::vector<t_real>& vecH, const std::vector<t_real>& vecK,
+	const std::vector<t_real>& vecL, const std::vector<t_real>& vecE,
+	std::atomic<unsigned int>* pNumMCFallbacks)
+{
+	const std::size_t iNumPts = vecH.size();
+	std::vector<std::pair<bool, t_real>> vecResults(iNumPts, std::make_pair(false, t_real(0)));
+
+	NeutronPool pool;
+	std::vector<std::size_t> vecPooledPts;   // point indices of the pool points
+	std::vector<t_real> vecR0;               // their R0 factors
+
+	tl::init_rand();
+	for(std::size_t iPt=0; iPt<iNumPts; ++iPt)
+	{
+		TASReso localreso = reso;
+		localreso.SetRandomSamplePos(cfg.sample_step_count);
+
+		try
+		{
+			if(!localreso.SetHKLE(vecH[iPt], vecK[iPt], vecL[iPt], vecE[iPt]))
+			{
+				std::ostringstream ostrErr;
+				ostrErr << "Invalid crystal position: (" <<
+					vecH[iPt] << " " << vecK[iPt] << " " << vecL[iPt] << ") rlu, "
+					<< vecE[iPt] << " meV.";
+				throw tl::Err(ostrErr.str().c_str());
+			}
+		}
+		catch(const std::exception& ex)
+		{
+			// the remaining points stay invalid
+			tl::log_err(ex.what());
+			break;
+		}
+
+		const t_real dR0 = localreso.GetResoResults().dR0 * localreso.GetR0Scale();
+
+		if(cfg.analytic_convo)
+		{
+			t_real dS = 0.;
+			if(localreso.ConvolveDisp(sqw, dS, cfg.max_disp_curv))
+			{
+				vecResults[iPt] = std::make_pair(true, dS * dR0);
+				continue;
+			}
+
+			if(pNumMCFallbacks)
+				++*pNumMCFallbacks;
+		}
+
+		if(!pool.AddPoint(localreso))
+		{
+			// use an independent convolution for degenerate ellipsoids
+			vecResults[iPt] = convolve_point(reso, sqw, cfg, vecH[iPt], vecK[iPt], vecL[iPt], vecE[iPt]);
+			continue;
+		}
+
+		vecPooledPts.push_back(iPt);
+		vecR0.push_back(dR0);
+	}
+
+	if(!pool.GetPointCount())
+		return vecResults;
+
+	pool.Build(cfg.neutron_count, cfg.pool_factor, cfg.pool_ess, cfg.pool_rounds);
+	pool.LogStats();
+
+	std::vector<std::vector<t_real>> vecS = pool.Evaluate(
+		[&sqw](const NeutronPool::t_vec& vecHKLE, std::vector<t_real>& vecVals)
+	{
+		vecVals[0] = sqw(vecHKLE[0], vecHKLE[1], vecHKLE[2], vecHKLE[3]);
+	});
+
+	for(std::size_t iPooled=0; iPooled<vecPooledPts.size(); ++iPooled)
+	{
+		const std::size_t iPt = vecPooledPts[iPooled];
+		if(vecS[iPooled].empty())
+		{
+			// no pool neutron reached this point, convolute independently
+			vecResults[iPt] = convolve_point(reso, sqw, cfg, vecH[iPt], vecK[iPt], vecL[iPt], vecE[iPt]);
+			continue;
+		}
+
+		vecResults[iPt] = std::make_pair(true, vecS[iPooled][0] * vecR0[iPooled]);
+	}
+
+	return vecResults;
+}
+
+
+
+/**
+ * create 1d convolution
+ */
+static bool start_convo_1d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, const std::string& sqw_params,
+	const ConvoNetCoordinator* pNet = nullptr)
+{
+	std::shared_ptr<SqwBase> pSqw = setup_sqw(cfg, xml, sqw_params);
+	if(!pSqw)
+		return false;
+
+	Scan scan;
+	if(cfg.has_scanfile && !load_scan(cfg, xml, scan))
+		return false;
+
+
+	std::string strAutosave = cfg.autosave;
+	if(strAutosave == "")
+	{
+		strAutosave = "out.dat";
+		tl::log_warn("Output file not set, using \"", strAutosave, "\".");
+	}
+
+
+	tl::Stopwatch<t_real> watch;
+	watch.start();
+
+	bool bScanAxisFound = false;
+	int iScanAxisIdx = 0;
+	std::string strScanVar = "";
+	std::vector<std::vector<t_real>> vecAxes;
+	std::tie(bScanAxisFound, iScanAxisIdx, strScanVar, vecAxes) = get_scan_axis<t_real>(
+		true, cfg.scanaxis, cfg.step_count, g_dEpsRlu,
+		cfg.h_from, cfg.h_to, cfg.k_from, cfg.k_to, cfg.l_from, cfg.l_to, cfg.E_from, cfg.E_to);
+	if(!bScanAxisFound)
+	{
+		tl::log_err("No scan variable found.");
+		return false;
+	}
+
+	const std::vector<t_real> *pVecScanX = &vecAxes[iScanAxisIdx];
+	const std::vector<t_real>& vecH = vecAxes[0];
+	const std::vector<t_real>& vecK = vecAxes[1];
+	const std::vector<t_real>& vecL = vecAxes[2];
+	const std::vector<t_real>& vecE = vecAxes[3];
+
+
+	TASReso reso;
+	if(!setup_reso(cfg, cfg.has_scanfile ? &scan : nullptr, reso))
+		return false;
+
 
 	// meta data
 	std::ostringstream ostrOut;
@@ -431,6 +687,10 @@ static bool start_convo_1d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, c
 	write_takin_metadata(ostrOut);
 	ostrOut << "# MC neutrons: " << cfg.neutron_count << "\n";
 	ostrOut << "# MC sample steps: " << cfg.sample_step_count << "\n";
+	if(cfg.analytic_convo)
+		ostrOut << "# Analytic dispersion convolution: max. curvature " << cfg.max_disp_curv << "\n";
+	if(cfg.neutron_pool)
+		ostrOut << "# Neutron pool: factor " << cfg.pool_factor << ", target ESS " << cfg.pool_ess << "\n";
 	ostrOut << "# Scale: " << cfg.S_scale << "\n";
 	ostrOut << "# Slope: " << cfg.S_slope << "\n";
 	ostrOut << "# Offset: " << cfg.S_offs << "\n";
@@ -460,6 +720,19 @@ static bool start_convo_1d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, c
 	tl::ThreadPool<std::pair<bool, t_real>()> tp(iNumThreads, pThStartFunc);
 	auto& lstFuts = tp.GetResults();
 
+	// number of points where the analytic convolution was not applicable
+	std::atomic<unsigned int> iNumMCFallbacks{0};
+
+	// calculate the points on the remote workers
+	std::vector<ConvoNetCoordinator::t_result> vecNetResults;
+	if(pNet)
+		vecNetResults = convolve_remote(*pNet, reso, *pSqw, cfg, vecH, vecK, vecL, vecE, &iNumMCFallbacks);
+
+	// calculate all points using a shared neutron pool
+	std::vector<std::pair<bool, t_real>> vecPoolResults;
+	if(!pNet && cfg.neutron_pool && cfg.neutron_count)
+		vecPoolResults = convolve_pooled(reso, *pSqw, cfg, vecH, vecK, vecL, vecE, &iNumMCFallbacks);
+
 	for(unsigned int iStep=0; iStep<cfg.step_count; ++iStep)
 	{
 		t_real dCurH = vecH[iStep];
@@ -467,63 +740,15 @@ static bool start_convo_1d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, c
 		t_real dCurL = vecL[iStep];
 		t_real dCurE = vecE[iStep];
 
-		tp.AddTask([&reso, dCurH, dCurK, dCurL, dCurE, pSqw, &cfg]()
-			-> std::pair<bool, t_real>
+		tp.AddTask([&reso, dCurH, dCurK, dCurL, dCurE, pSqw, &cfg, &iNumMCFallbacks,
+			&vecNetResults, &vecPoolResults, iStep]() -> std::pair<bool, t_real>
 		{
-			t_real dS = 0.;
-			t_real dhklE_mean[4] = {0., 0., 0., 0.};
-
-			if(cfg.neutron_count == 0)
-			{	// if no neutrons are given, just plot the unconvoluted S(Q, E)
-				// TODO: add an option to let the user choose if S(Q,E) is
-				// really the dynamical structure factor, or its absolute square
-				dS += (*pSqw)(dCurH, dCurK, dCurL, dCurE);
-			}
-			else
-			{	// convolution
-				TASReso localreso = reso;
-				localreso.SetRandomSamplePos(cfg.sample_step_count);
-				std::vector<ublas::vector<t_real>> vecNeutrons;
-
-				try
-				{
-					if(!localreso.SetHKLE(dCurH, dCurK, dCurL, dCurE))
-					{
-						std::ostringstream ostrErr;
-						ostrErr << "Invalid crystal position: (" <<
-							dCurH << " " << dCurK << " " << dCurL << ") rlu, "
-							<< dCurE << " meV.";
-						throw tl::Err(ostrErr.str().c_str());
-					}
-				}
-				catch(const std::exception& ex)
-				{
-					tl::log_err(ex.what());
-					return std::pair<bool, t_real>(false, 0.);
-				}
-
-				Ellipsoid4d<t_real> elli =
-					localreso.GenerateMC_deferred(cfg.neutron_count, vecNeutrons);
-
-				for(const ublas::vector<t_real>& vecHKLE : vecNeutrons)
-				{
-					// TODO: add an option to let the user choose if S(Q,E) is
-					// really the dynamical structure factor, or its absolute square
-					dS += (*pSqw)(vecHKLE[0], vecHKLE[1], vecHKLE[2], vecHKLE[3]);
-
-					for(int i=0; i<4; ++i)
-						dhklE_mean[i] += vecHKLE[i];
-				}
-
-				dS /= t_real(cfg.neutron_count*cfg.sample_step_count);
-				for(int i=0; i<4; ++i)
-					dhklE_mean[i] /= t_real(cfg.neutron_count*cfg.sample_step_count);
+			if(vecNetResults.size())
+				return vecNetResults[iStep];
+			if(vecPoolResults.size())
+				return vecPoolResults[iStep];
 
-				dS *= localreso.GetResoResults().dR0 * localreso.GetR0Scale();
-				//if(localreso.GetResoParams().flags & CALC_RESVOL)
-				//	dS /= localreso.GetResoResults().dResVol * tl::get_pi<t_real>() * t_real(3.);
-			}
-			return std::pair<bool, t_real>(true, dS);
+			return convolve_point(reso, *pSqw, cfg, dCurH, dCurK, dCurL, dCurE, &iNumMCFallbacks);
 		});
 	}
 
@@ -540,7 +765,12 @@ static bool start_convo_1d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, c
 		}
 
 		std::pair<bool, t_real> pairS = fut.get();
-		if(!pairS.first) break;
+		if(!pairS.first)
+		{
+			// don't start the remaining tasks
+			tp.Cancel();
+			break;
+		}
 		t_real dS = pairS.second;
 		if(tl::is_nan_or_inf(dS))
 		{
@@ -589,6 +819,12 @@ static bool start_convo_1d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, c
 	}
 	tl::log_info("Convolution simulation finished.");
 
+	if(iNumMCFallbacks > 0)
+	{
+		tl::log_warn("Analytic convolution was not applicable for ", iNumMCFallbacks.load(),
+			" point(s), Monte-Carlo integration was used instead.");
+	}
+
 
 	// approximate chi^2
 	if(cfg.has_scanfile && pSqw)
@@ -650,34 +886,13 @@ static bool start_convo_1d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, c
 /**
  * create 2d convolution
  */
-static bool start_convo_2d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, const std::string& sqw_params)
+static bool start_convo_2d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, const std::string& sqw_params,
+	const ConvoNetCoordinator* pNet = nullptr)
 {
-	// load S(Q, E) model
-	std::shared_ptr<SqwBase> pSqw = create_sqw_model(cfg.sqw, cfg.sqw_conf);
+	std::shared_ptr<SqwBase> pSqw = setup_sqw(cfg, xml, sqw_params);
 	if(!pSqw)
 		return false;
 
-	// load default model parameters from configuration
-	if(!load_sqw_params(pSqw.get(), xml, g_strXmlRoot+"monteconvo/"))
-		return false;
-
-
-	// override model parameters
-	std::unordered_set<std::string> ignored_params{{ "scale", "slope", "offs" }};
-	std::unordered_map<std::string, std::string> all_params;
-	pSqw->SetVars(sqw_params, true, &ignored_params, &all_params);
-
-	// override non-S(Q,E) parameters
-	auto iter_scale = all_params.find("scale");
-	auto iter_slope = all_params.find("slope");
-	auto iter_offs = all_params.find("offs");
-	if(iter_scale != all_params.end())
-		cfg.S_scale = tl::str_to_var<t_real>(iter_scale->second);
-	if(iter_slope != all_params.end())
-		cfg.S_slope = tl::str_to_var<t_real>(iter_slope->second);
-	if(iter_offs != all_params.end())
-		cfg.S_offs = tl::str_to_var<t_real>(iter_offs->second);
-
 
 	std::string strAutosave = cfg.autosave;
 	if(strAutosave == "")
@@ -767,43 +982,9 @@ static bool start_convo_2d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, c
 
 
 
-	// -------------------------------------------------------------------------
-	// Load reso file
 	TASReso reso;
-	reso.SetPlaneDistTolerance(g_dEpsPlane);
-
-	std::string _strResoFile = cfg.instr;
-	tl::trim(_strResoFile);
-	const std::string strResoFile = find_file_in_global_paths(_strResoFile);
-
-	tl::log_info("Loading resolution from \"", strResoFile, "\".");
-	if(strResoFile == "" || !reso.LoadRes(strResoFile.c_str()))
-	{
-		tl::log_err("Could not load resolution file \"", strResoFile, "\".");
-		return false;
-	}
-	// -------------------------------------------------------------------------
-
-
-	// -------------------------------------------------------------------------
-	// Load lattice
-	std::string _strLatticeFile = cfg.crys;
-	tl::trim(_strLatticeFile);
-	const std::string strLatticeFile = find_file_in_global_paths(_strLatticeFile);
-
-	tl::log_info("Loading crystal from \"", strLatticeFile, "\".");
-	if(strLatticeFile == "" || !reso.LoadLattice(strLatticeFile.c_str(), cfg.flip_coords))
-	{
-		tl::log_err("Could not load crystal file \"", strLatticeFile, "\".");
+	if(!setup_reso(cfg, nullptr, reso))
 		return false;
-	}
-	// -------------------------------------------------------------------------
-
-
-	reso.SetAlgo(cfg.algo);
-	reso.SetKiFix(cfg.fixedk == 0);
-	reso.SetKFix(cfg.kfix);
-	reso.SetOptimalFocus(get_reso_focus(cfg.mono_foc, cfg.ana_foc));
 
 
 	std::ostringstream ostrOut;
@@ -812,6 +993,10 @@ static bool start_convo_2d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, c
 	write_takin_metadata(ostrOut);
 	ostrOut << "# MC neutrons: " << cfg.neutron_count << "\n";
 	ostrOut << "# MC sample steps: " << cfg.sample_step_count << "\n";
+	if(cfg.analytic_convo)
+		ostrOut << "# Analytic dispersion convolution: max. curvature " << cfg.max_disp_curv << "\n";
+	if(cfg.neutron_pool)
+		ostrOut << "# Neutron pool: factor " << cfg.pool_factor << ", target ESS " << cfg.pool_ess << "\n";
 	ostrOut << "# Scale: " << cfg.S_scale << "\n";
 	ostrOut << "# Slope: " << cfg.S_slope << "\n";
 	ostrOut << "# Offset: " << cfg.S_offs << "\n";
@@ -848,6 +1033,19 @@ static bool start_convo_2d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, c
 	tl::ThreadPool<std::pair<bool, t_real>()> tp(iNumThreads, pThStartFunc);
 	auto& lstFuts = tp.GetResults();
 
+	// number of points where the analytic convolution was not applicable
+	std::atomic<unsigned int> iNumMCFallbacks{0};
+
+	// calculate the points on the remote workers
+	std::vector<ConvoNetCoordinator::t_result> vecNetResults;
+	if(pNet)
+		vecNetResults = convolve_remote(*pNet, reso, *pSqw, cfg, vecH, vecK, vecL, vecE, &iNumMCFallbacks);
+
+	// calculate all points using a shared neutron pool
+	std::vector<std::pair<bool, t_real>> vecPoolResults;
+	if(!pNet && cfg.neutron_pool && cfg.neutron_count)
+		vecPoolResults = convolve_pooled(reso, *pSqw, cfg, vecH, vecK, vecL, vecE, &iNumMCFallbacks);
+
 	for(unsigned int iStep=0; iStep<cfg.step_count*cfg.step_count; ++iStep)
 	{
 		t_real dCurH = vecH[iStep];
@@ -855,65 +1053,15 @@ static bool start_convo_2d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, c
 		t_real dCurL = vecL[iStep];
 		t_real dCurE = vecE[iStep];
 
-		tp.AddTask(
-		[&reso, dCurH, dCurK, dCurL, dCurE, pSqw, &cfg]()
-			-> std::pair<bool, t_real>
+		tp.AddTask([&reso, dCurH, dCurK, dCurL, dCurE, pSqw, &cfg, &iNumMCFallbacks,
+			&vecNetResults, &vecPoolResults, iStep]() -> std::pair<bool, t_real>
 		{
-			t_real dS = 0.;
-			t_real dhklE_mean[4] = {0., 0., 0., 0.};
-
-			if(cfg.neutron_count == 0)
-			{	// if no neutrons are given, just plot the unconvoluted S(Q, E)
-				// TODO: add an option to let the user choose if S(Q,E) is
-				// really the dynamical structure factor, or its absolute square
-				dS += (*pSqw)(dCurH, dCurK, dCurL, dCurE);
-			}
-			else
-			{	// convolution
-				TASReso localreso = reso;
-				localreso.SetRandomSamplePos(cfg.sample_step_count);
-				std::vector<ublas::vector<t_real>> vecNeutrons;
-
-				try
-				{
-					if(!localreso.SetHKLE(dCurH, dCurK, dCurL, dCurE))
-					{
-						std::ostringstream ostrErr;
-						ostrErr << "Invalid crystal position: (" <<
-							dCurH << " " << dCurK << " " << dCurL << ") rlu, "
-							<< dCurE << " meV.";
-						throw tl::Err(ostrErr.str().c_str());
-					}
-				}
-				catch(const std::exception& ex)
-				{
-					//QMessageBox::critical(this, "Error", ex.what());
-					tl::log_err(ex.what());
-					return std::pair<bool, t_real>(false, 0.);
-				}
-
-				Ellipsoid4d<t_real> elli =
-					localreso.GenerateMC_deferred(cfg.neutron_count, vecNeutrons);
+			if(vecNetResults.size())
+				return vecNetResults[iStep];
+			if(vecPoolResults.size())
+				return vecPoolResults[iStep];
 
-				for(const ublas::vector<t_real>& vecHKLE : vecNeutrons)
-				{
-					// TODO: add an option to let the user choose if S(Q,E) is
-					// really the dynamical structure factor, or its absolute square
-					dS += (*pSqw)(vecHKLE[0], vecHKLE[1], vecHKLE[2], vecHKLE[3]);
-
-					for(int i=0; i<4; ++i)
-						dhklE_mean[i] += vecHKLE[i];
-				}
-
-				dS /= t_real(cfg.neutron_count*cfg.sample_step_count);
-				for(int i=0; i<4; ++i)
-					dhklE_mean[i] /= t_real(cfg.neutron_count*cfg.sample_step_count);
-
-				dS *= localreso.GetResoResults().dR0 * localreso.GetR0Scale();
-				//if(localreso.GetResoParams().flags & CALC_RESVOL)
-				//	dS /= localreso.GetResoResults().dResVol * tl::get_pi<t_real>() * t_real(3.);
-			}
-			return std::pair<bool, t_real>(true, dS);
+			return convolve_point(reso, *pSqw, cfg, dCurH, dCurK, dCurL, dCurE, &iNumMCFallbacks);
 		});
 	}
 
@@ -930,7 +1078,12 @@ static bool start_convo_2d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, c
 		}
 
 		std::pair<bool, t_real> pairS = fut.get();
-		if(!pairS.first) break;
+		if(!pairS.first)
+		{
+			// don't start the remaining tasks
+			tp.Cancel();
+			break;
+		}
 		t_real dS = pairS.second;
 		if(tl::is_nan_or_inf(dS))
 		{
@@ -975,6 +1128,12 @@ static bool start_convo_2d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, c
 	}
 	tl::log_info("Convolution simulation finished.");
 
+	if(iNumMCFallbacks > 0)
+	{
+		tl::log_warn("Analytic convolution was not applicable for ", iNumMCFallbacks.load(),
+			" point(s), Monte-Carlo integration was used instead.");
+	}
+
 	// output elapsed time
 	watch.stop();
 
@@ -989,6 +1148,161 @@ static bool start_convo_2d(ConvoConfig& cfg, const tl::Prop<std::string>& xml, c
 
 
 
+// ----------------------------------------------------------------------------
+// remote worker
+
+/**
+ * convolution on a worker with the job and files sent by the coordinator
+ */
+class MonteconvoBackend : public ConvoNetBackend
+{
+protected:
+	ConvoConfig m_cfg;
+	std::shared_ptr<SqwBase> m_pSqw;
+	TASReso m_reso;
+
+public:
+	virtual bool Setup(const t_map& files, const t_map& opts) override
+	{
+		// local file for a file name in the job
+		auto local_file = [&files](const std::string& _strName) -> std::string
+		{
+			std::string strName = _strName;
+			tl::trim(strName);
+
+			auto iter = files.find(strName);
+			if(iter == files.end())
+				return strName;
+			return iter->second;
+		};
+
+		auto get_opt = [&opts](const std::string& strKey) -> boost::optional<std::string>
+		{
+			auto iter = opts.find(strKey);
+			if(iter == opts.end())
+				return boost::none;
+			return iter->second;
+		};
+
+
+		boost::optional<std::string> optJob = get_opt("job");
+		if(!optJob)
+		{
+			tl::log_err("No convolution config file received.");
+			return false;
+		}
+
+		tl::Prop<std::string> xml;
+		if(!xml.Load(local_file(*optJob), tl::PropType::XML))
+		{
+			tl::log_err("Convolution config file \"", *optJob, "\" could not be loaded.");
+			return false;
+		}
+
+		m_cfg = load_config(xml);
+
+		// overrides from the coordinator
+		if(boost::optional<std::string> opt = get_opt("neutron_count"))
+			m_cfg.neutron_count = tl::str_to_var<unsigned int>(*opt);
+		if(boost::optional<std::string> opt = get_opt("analytic"))
+			m_cfg.analytic_convo = (tl::str_to_var<int>(*opt) != 0);
+		if(boost::optional<std::string> opt = get_opt("scanfile"))
+			m_cfg.scanfile = *opt;
+
+		m_cfg.instr = local_file(m_cfg.instr);
+		m_cfg.crys = local_file(m_cfg.crys);
+		m_cfg.sqw_conf = local_file(m_cfg.sqw_conf);
+
+		std::vector<std::string> vecScanFiles;
+		tl::get_tokens<std::string, std::string>(m_cfg.scanfile, ";", vecScanFiles);
+		m_cfg.scanfile = "";
+		for(const std::string& strScanFile : vecScanFiles)
+		{
+			if(m_cfg.scanfile != "")
+				m_cfg.scanfile += ";";
+			m_cfg.scanfile += local_file(strScanFile);
+		}
+
+
+		boost::optional<std::string> optParams = get_opt("sqw_params");
+		m_pSqw = setup_sqw(m_cfg, xml, optParams ? *optParams : "");
+		if(!m_pSqw)
+			return false;
+
+		// the lattice is only taken from the scan file for 1d convolutions
+		Scan scan;
+		const bool bUseScan = m_cfg.has_scanfile && !m_cfg.scan_2d;
+		if(bUseScan && !load_scan(m_cfg, xml, scan))
+			return false;
+
+		return setup_reso(m_cfg, bUseScan ? &scan : nullptr, m_reso);
+	}
+
+
+	virtual std::pair<bool, t_real> Calc(t_real h, t_real k, t_real l, t_real E) const override
+	{
+		return convolve_point(m_reso, *m_pSqw, m_cfg, h, k, l, E);
+	}
+};
+
+
+
+/**
+ * prepares the coordinator, which sends the job and all files it references to the workers
+ */
+static bool setup_coordinator(ConvoNetCoordinator& net, const std::string& strWorkers,
+	const std::string& strJobFile, const ConvoConfig& cfg, const std::string& sqw_params)
+{
+	if(!net.AddWorkers(strWorkers))
+		return false;
+
+	// sends a file under its name in the job file
+	auto add_file = [&net](const std::string& _strName, bool bAlsoTryFileOnly) -> bool
+	{
+		std::string strName = _strName;
+		tl::trim(strName);
+		if(strName == "")
+			return true;
+
+		const std::string strFile = find_file_in_global_paths(strName, bAlsoTryFileOnly);
+		if(strFile == "")
+		{
+			tl::log_err("File \"", strName, "\" not found.");
+			return false;
+		}
+
+		return net.AddFile(strName, strFile);
+	};
+
+	if(!add_file(strJobFile, true) || !add_file(cfg.instr, true) || !add_file(cfg.sqw_conf, true))
+		return false;
+	if((!cfg.has_scanfile || cfg.scan_2d) && !add_file(cfg.crys, true))
+		return false;
+
+	if(cfg.has_scanfile)
+	{
+		std::vector<std::string> vecScanFiles;
+		tl::get_tokens<std::string, std::string>(cfg.scanfile, ";", vecScanFiles);
+		for(const std::string& strScanFile : vecScanFiles)
+		{
+			if(!add_file(strScanFile, false))
+				return false;
+		}
+	}
+
+	net.SetOpt("job", tl::trimmed(strJobFile));
+	net.SetOpt("scanfile", cfg.scanfile);
+	net.SetOpt("neutron_count", tl::var_to_str(cfg.neutron_count));
+	net.SetOpt("analytic", cfg.analytic_convo ? "1" : "0");
+	if(sqw_params != "")
+		net.SetOpt("sqw_params", sqw_params);
+
+	return true;
+}
+// ----------------------------------------------------------------------------
+
+
+
 // ----------------------------------------------------------------------------
 // main program
 
@@ -1015,10 +1329,20 @@ int monteconvo_main(int argc, char** argv)
 		// overrides for quickly changing input and output files
 		std::string scanfile_override, autosave_override;
 		unsigned int neutron_count_override = 0;
+		bool analytic_convo = false;
 
 		// parameter overrides for sqw model
 		std::string sqw_params;
 
+		// distributed convolution
+		std::string workers;
+		unsigned short worker_port = 0;
+		std::string worker_bind = "127.0.0.1";
+		std::string net_secret;
+		unsigned int net_timeout = 600;
+		if(const char* secret_env = std::getenv("TAKIN_CONVO_SECRET"))
+			net_secret = secret_env;
+
 		// normal args
 		opts::options_description args("monteconvo options (overriding config file settings)");
 		args.add(boost::shared_ptr<opts::option_description>(
@@ -1033,6 +1357,10 @@ int monteconvo_main(int argc, char** argv)
 			new opts::option_description("neutron-count",
 			opts::value<decltype(neutron_count_override)>(&neutron_count_override),
 			"simulated neutron count")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("analytic",
+			opts::bool_switch(&analytic_convo),
+			"analytic convolution for dispersion models")));
 		args.add(boost::shared_ptr<opts::option_description>(
 			new opts::option_description("scanfile-override",
 			opts::value<decltype(scanfile_override)>(&scanfile_override),
@@ -1045,6 +1373,26 @@ int monteconvo_main(int argc, char** argv)
 			new opts::option_description("sqw-param-override",
 			opts::value<decltype(sqw_params)>(&sqw_params),
 			"override parameters for S(Q, E) model")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("workers",
+			opts::value<decltype(workers)>(&workers),
+			"distribute the convolution over remote workers, \"host1:port1,host2:port2,...\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("worker-port",
+			opts::value<decltype(worker_port)>(&worker_port),
+			"run as a remote worker listening on the given port")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("bind",
+			opts::value<decltype(worker_bind)>(&worker_bind),
+			"address the remote worker listens on, default: 127.0.0.1")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("secret",
+			opts::value<decltype(net_secret)>(&net_secret),
+			"shared secret between coordinator and workers, default: $TAKIN_CONVO_SECRET")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("worker-timeout",
+			opts::value<decltype(net_timeout)>(&net_timeout),
+			"seconds to wait for an answer from a remote worker, 0: no timeout")));
 
 		// dummy arg if launched from takin executable
 		bool bStartedFromTakin = false;
@@ -1086,6 +1434,22 @@ int monteconvo_main(int argc, char** argv)
 			return -1;
 		}
 
+		if(opts_map.count("worker-port"))
+		{
+			// worker mode, the job is sent by the coordinator
+			ConvoNetWorker worker(worker_port, std::max<unsigned int>(1, get_max_threads()),
+				[]() -> std::shared_ptr<ConvoNetBackend>
+				{
+					return std::make_shared<MonteconvoBackend>();
+				});
+			worker.SetBindAddress(worker_bind);
+			worker.SetSecret(net_secret);
+
+			if(!worker.Listen())
+				return -1;
+			return worker.Run() ? 0 : -1;
+		}
+
 		if(vecJobs.size() == 0)
 		{
 			tl::log_err("No config files given.");
@@ -1134,6 +1498,21 @@ int monteconvo_main(int argc, char** argv)
 
 		if(neutron_count_override > 0)
 			cfg.neutron_count = neutron_count_override;
+		if(analytic_convo)
+			cfg.analytic_convo = true;
+
+		std::unique_ptr<ConvoNetCoordinator> pNet;
+		if(workers != "")
+		{
+			pNet.reset(new ConvoNetCoordinator());
+			pNet->SetSecret(net_secret);
+			pNet->SetTimeout(net_timeout);
+			if(!setup_coordinator(*pNet, workers, strJobFile, cfg, sqw_params))
+			{
+				tl::log_err("Could not set up the distributed convolution.");
+				return -1;
+			}
+		}
 		// --------------------------------------------------------------------
 
 
@@ -1145,12 +1524,12 @@ int monteconvo_main(int argc, char** argv)
 		if(cfg.scan_2d)
 		{
 			tl::log_info("Performing a 2d convolution simulation.");
-			ok = start_convo_2d(cfg, xml, sqw_params);
+			ok = start_convo_2d(cfg, xml, sqw_params, pNet.get());
 		}
 		else
 		{
 			tl::log_info("Performing a 1d convolution simulation.");
-			ok = start_convo_1d(cfg, xml, sqw_params);
+			ok = start_convo_1d(cfg, xml, sqw_params, pNet.get());
 		}
 
 		if(!ok)
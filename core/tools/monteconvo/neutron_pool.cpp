@@ -0,0 +1,449 @@
+/**
+ * shared pool of monte-carlo neutrons for all points of a scan
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "neutron_pool.h"
+#include "libs/globals.h"
+
+#include "tlibs/math/rand.h"
+#include "tlibs/log/log.h"
+#include "tlibs/helper/thread.h"
+
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cmath>
+
+
+using t_real = NeutronPool::t_real;
+using t_vec = NeutronPool::t_vec;
+
+
+
+/**
+ * runs func(iBegin, iEnd) on blocks of [0, iNum) in parallel
+ */
+static void run_blocks(std::size_t iNum, const std::function<void(std::size_t, std::size_t)>& func)
+{
+	if(!iNum)
+		return;
+
+	const std::size_t iNumThreads = std::max<std::size_t>(get_max_threads(), 1);
+	const std::size_t iNumBlocks = std::min(iNum, iNumThreads*4);
+	const std::size_t iBlockSize = (iNum + iNumBlocks - 1) / iNumBlocks;
+
+	void (*pThStartFunc)() = []{ tl::init_rand(); };
+	tl::ThreadPool<void()> tp(iNumThreads, pThStartFunc);
+
+	for(std::size_t iBegin=0; iBegin<iNum; iBegin+=iBlockSize)
+	{
+		const std::size_t iEnd = std::min(iBegin + iBlockSize, iNum);
+		tp.AddTask([&func, iBegin, iEnd]() { func(iBegin, iEnd); });
+	}
+
+	tp.Start();
+	for(auto& fut : tp.GetResults())
+		fut.get();
+}
+
+
+
+// ----------------------------------------------------------------------------
+// pool construction
+
+void NeutronPool::Clear()
+{
+	m_vecPoints.clear();
+	m_vecNeutrons.clear();
+	m_vecDens.clear();
+	m_vecUsed.clear();
+}
+
+
+/**
+ * adds a point given by a resolution which has already been set to its (Q, E) position
+ */
+bool NeutronPool::AddPoint(const TASReso& reso)
+{
+	Point pt;
+	pt.reso = reso;
+	if(!reso.GetMCDensities(pt.vecGauss) || pt.vecGauss.empty())
+		return false;
+
+	// bounding box of all sample positions
+	pt.vecMin = t_vec(4);
+	pt.vecMax = t_vec(4);
+	for(std::size_t i=0; i<4; ++i)
+	{
+		pt.vecMin[i] = std::numeric_limits<t_real>::max();
+		pt.vecMax[i] = std::numeric_limits<t_real>::lowest();
+	}
+
+	for(const t_gauss& gauss : pt.vecGauss)
+	{
+		for(std::size_t i=0; i<4; ++i)
+		{
+			pt.vecMin[i] = std::min(pt.vecMin[i], gauss.vecMean[i] - m_dMaxSigma*gauss.vecSigmas[i]);
+			pt.vecMax[i] = std::max(pt.vecMax[i], gauss.vecMean[i] + m_dMaxSigma*gauss.vecSigmas[i]);
+		}
+	}
+
+	m_vecPoints.emplace_back(std::move(pt));
+	return true;
+}
+
+
+/**
+ * neutron density of a point, averaged over its random sample positions
+ */
+t_real NeutronPool::Density(const Point& pt, const t_vec& vec) const
+{
+	for(std::size_t i=0; i<4; ++i)
+	{
+		if(vec[i] < pt.vecMin[i] || vec[i] > pt.vecMax[i])
+			return t_real(0);
+	}
+
+	t_real dDens = 0;
+	for(const t_gauss& gauss : pt.vecGauss)
+		dDens += gauss(vec);
+	return dDens / t_real(pt.vecGauss.size());
+}
+
+
+/**
+ * draws neutrons from the given points' densities,
+ * vecDraws holds the point indices and the number of neutrons per sample position.
+ * the neutrons are drawn in the calling thread to keep the pool reproducible for a given seed.
+ */
+void NeutronPool::Draw(const std::vector<std::pair<std::size_t, std::size_t>>& vecDraws)
+{
+	std::vector<t_vec> vecNew;
+
+	for(const auto& draw : vecDraws)
+	{
+		Point& pt = m_vecPoints[draw.first];
+		pt.reso.GenerateMC_deferred(draw.second, vecNew);
+		pt.iNumDrawn += vecNew.size();
+
+		for(t_vec& vec : vecNew)
+			m_vecNeutrons.emplace_back(std::move(vec));
+	}
+}
+
+
+/**
+ * calculates the weights of all pool neutrons for all points and their effective sample sizes
+ */
+void NeutronPool::CalcWeights()
+{
+	const std::size_t iNumPts = m_vecPoints.size();
+	const std::size_t iNumNeutrons = m_vecNeutrons.size();
+
+	// sort the points along the axis on which they are spread out the most
+	// compared to their extent to quickly find the candidates for a neutron
+	std::size_t iAxis = 0;
+	t_real dBestSpread = -1.;
+	for(std::size_t i=0; i<4; ++i)
+	{
+		t_real dMin = std::numeric_limits<t_real>::max();
+		t_real dMax = std::numeric_limits<t_real>::lowest();
+		t_real dMaxWidth = 0.;
+		for(const Point& pt : m_vecPoints)
+		{
+			const t_real dCentre = (pt.vecMin[i] + pt.vecMax[i]) * t_real(0.5);
+			dMin = std::min(dMin, dCentre);
+			dMax = std::max(dMax, dCentre);
+			dMaxWidth = std::max(dMaxWidth, pt.vecMax[i] - pt.vecMin[i]);
+		}
+
+		const t_real dSpread = dMaxWidth > t_real(0) ? (dMax - dMin) / dMaxWidth : t_real(0);
+		if(dSpread > dBestSpread)
+		{
+			dBestSpread = dSpread;
+			iAxis = i;
+		}
+	}
+
+	std::vector<std::size_t> vecOrder(iNumPts);
+	std::iota(vecOrder.begin(), vecOrder.end(), 0);
+	std::stable_sort(vecOrder.begin(), vecOrder.end(), [this, iAxis](std::size_t i1, std::size_t i2) -> bool
+	{
+		return m_vecPoints[i1].vecMin[iAxis] < m_vecPoints[i2].vecMin[iAxis];
+	});
+
+	std::vector<t_real> vecSortedMin;
+	vecSortedMin.reserve(iNumPts);
+	t_real dMaxWidth = 0.;
+	for(std::size_t iPt : vecOrder)
+	{
+		vecSortedMin.push_back(m_vecPoints[iPt].vecMin[iAxis]);
+		dMaxWidth = std::max(dMaxWidth, m_vecPoints[iPt].vecMax[iAxis] - m_vecPoints[iPt].vecMin[iAxis]);
+	}
+
+
+	// densities of the points at the new neutrons, the ones of the older neutrons don't change
+	const std::size_t iNumOld = m_vecDens.size();
+	m_vecDens.resize(iNumNeutrons);
+
+	run_blocks(iNumNeutrons - iNumOld, [&](std::size_t iBegin, std::size_t iEnd)
+	{
+		for(std::size_t iNeutr=iNumOld+iBegin; iNeutr<iNumOld+iEnd; ++iNeutr)
+		{
+			const t_vec& vec = m_vecNeutrons[iNeutr];
+
+			auto iterBegin = std::lower_bound(vecSortedMin.begin(), vecSortedMin.end(), vec[iAxis] - dMaxWidth);
+			auto iterEnd = std::upper_bound(vecSortedMin.begin(), vecSortedMin.end(), vec[iAxis]);
+
+			for(auto iter=iterBegin; iter!=iterEnd; ++iter)
+			{
+				const std::size_t iPt = vecOrder[iter - vecSortedMin.begin()];
+				const t_real dDens = Density(m_vecPoints[iPt], vec);
+				if(dDens > t_real(0) && std::isfinite(dDens))
+					m_vecDens[iNeutr].emplace_back(iPt, dDens);
+			}
+		}
+	});
+
+
+	// balance heuristic weights
+	for(Point& pt : m_vecPoints)
+		pt.vecWeights.clear();
+	m_vecUsed.assign(iNumNeutrons, false);
+
+	for(std::size_t iNeutr=0; iNeutr<iNumNeutrons; ++iNeutr)
+	{
+		t_real dMixture = 0.;
+		for(const auto& pair : m_vecDens[iNeutr])
+			dMixture += t_real(m_vecPoints[pair.first].iNumDrawn) * pair.second;
+		if(dMixture <= t_real(0))
+			continue;
+
+		for(const auto& pair : m_vecDens[iNeutr])
+			m_vecPoints[pair.first].vecWeights.emplace_back(iNeutr, pair.second / dMixture);
+		m_vecUsed[iNeutr] = true;
+	}
+
+	// the effective sample size only depends on the weights, not on S(Q, E)
+	for(Point& pt : m_vecPoints)
+	{
+		t_real dSum = 0., dSum2 = 0.;
+		for(const auto& pair : pt.vecWeights)
+		{
+			dSum += pair.second;
+			dSum2 += pair.second * pair.second;
+		}
+
+		pt.dESS = dSum2 > t_real(0) ? dSum*dSum / dSum2 : t_real(0);
+	}
+}
+
+
+/**
+ * builds the pool, iNumNeutrons is the number of neutrons per sample position
+ * that would be used for the independent convolution of each point.
+ * every point initially contributes iNumNeutrons/dPoolFactor neutrons,
+ * points with an effective sample size below dESSFrac*iNumNeutrons are topped up
+ * in at most iMaxRounds rounds, but never get more than iNumNeutrons own neutrons.
+ */
+void NeutronPool::Build(std::size_t iNumNeutrons, t_real dPoolFactor, t_real dESSFrac, unsigned int iMaxRounds)
+{
+	m_vecNeutrons.clear();
+	m_vecDens.clear();
+	m_vecUsed.clear();
+	m_iNumNeutrons = iNumNeutrons;
+	m_dESSFrac = dESSFrac;
+
+	for(Point& pt : m_vecPoints)
+	{
+		pt.iNumDrawn = 0;
+		pt.dESS = 0.;
+		pt.bToppedUp = false;
+		pt.vecWeights.clear();
+	}
+
+	if(m_vecPoints.empty() || !iNumNeutrons)
+		return;
+
+	const std::size_t iInitial = std::max<std::size_t>(1,
+		std::size_t(std::ceil(t_real(iNumNeutrons) / std::max(dPoolFactor, t_real(1)))));
+
+	std::vector<std::pair<std::size_t, std::size_t>> vecDraws;
+	vecDraws.reserve(m_vecPoints.size());
+	for(std::size_t iPt=0; iPt<m_vecPoints.size(); ++iPt)
+		vecDraws.emplace_back(iPt, iInitial);
+	Draw(vecDraws);
+
+	for(unsigned int iRound=0; ; ++iRound)
+	{
+		CalcWeights();
+		if(iRound >= iMaxRounds)
+			break;
+
+		// top up the points with insufficient coverage
+		vecDraws.clear();
+		for(std::size_t iPt=0; iPt<m_vecPoints.size(); ++iPt)
+		{
+			Point& pt = m_vecPoints[iPt];
+			const std::size_t iSteps = pt.vecGauss.size();
+			const std::size_t iFull = iNumNeutrons * iSteps;
+			const t_real dTarget = dESSFrac * t_real(iFull);
+
+			if(pt.dESS >= dTarget || pt.iNumDrawn >= iFull)
+				continue;
+
+			// the effective sample size grows about linearly with the point's own neutrons
+			t_real dMore = t_real(pt.iNumDrawn) * (dTarget / std::max(pt.dESS, t_real(1)) - t_real(1));
+			std::size_t iMore = std::size_t(std::ceil(dMore / t_real(iSteps)));
+			iMore = std::max(iMore, iInitial);
+			iMore = std::min(iMore, (iFull - pt.iNumDrawn) / iSteps);
+			if(!iMore)
+				continue;
+
+			pt.bToppedUp = true;
+			vecDraws.emplace_back(iPt, iMore);
+		}
+
+		if(vecDraws.empty())
+			break;
+		Draw(vecDraws);
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// evaluation
+
+/**
+ * evaluates func once per pool neutron and returns the reweighted means of its iNumVals
+ * values for all points, the result is empty for points without contributing neutrons
+ */
+std::vector<std::vector<t_real>> NeutronPool::Evaluate(const t_func& func, std::size_t iNumVals) const
+{
+	const std::size_t iNumNeutrons = m_vecNeutrons.size();
+	std::vector<t_real> vecVals(iNumNeutrons * iNumVals, t_real(0));
+
+	run_blocks(iNumNeutrons, [this, &func, &vecVals, iNumVals](std::size_t iBegin, std::size_t iEnd)
+	{
+		std::vector<t_real> vals(iNumVals);
+		for(std::size_t iNeutr=iBegin; iNeutr<iEnd; ++iNeutr)
+		{
+			if(!m_vecUsed[iNeutr])
+				continue;
+
+			std::fill(vals.begin(), vals.end(), t_real(0));
+			func(m_vecNeutrons[iNeutr], vals);
+			std::copy(vals.begin(), vals.end(), vecVals.begin() + iNeutr*iNumVals);
+		}
+	});
+
+	std::vector<std::vector<t_real>> vecResults(m_vecPoints.size());
+	for(std::size_t iPt=0; iPt<m_vecPoints.size(); ++iPt)
+	{
+		const Point& pt = m_vecPoints[iPt];
+
+		std::vector<t_real> vecSum(iNumVals, t_real(0));
+		t_real dWeightSum = 0.;
+		for(const auto& pair : pt.vecWeights)
+		{
+			for(std::size_t iVal=0; iVal<iNumVals; ++iVal)
+				vecSum[iVal] += pair.second * vecVals[pair.first*iNumVals + iVal];
+			dWeightSum += pair.second;
+		}
+
+		if(dWeightSum <= t_real(0))
+			continue;
+
+		// self-normalised to compensate for the truncation of the densities
+		for(t_real& dVal : vecSum)
+			dVal /= dWeightSum;
+		vecResults[iPt] = std::move(vecSum);
+	}
+
+	return vecResults;
+}
+
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// diagnostics
+
+t_real NeutronPool::GetMinESS() const
+{
+	t_real dMin = std::numeric_limits<t_real>::max();
+	for(const Point& pt : m_vecPoints)
+		dMin = std::min(dMin, pt.dESS);
+	return m_vecPoints.size() ? dMin : t_real(0);
+}
+
+
+t_real NeutronPool::GetMeanESS() const
+{
+	t_real dSum = 0.;
+	for(const Point& pt : m_vecPoints)
+		dSum += pt.dESS;
+	return m_vecPoints.size() ? dSum / t_real(m_vecPoints.size()) : t_real(0);
+}
+
+
+std::size_t NeutronPool::GetToppedUpCount() const
+{
+	return std::count_if(m_vecPoints.begin(), m_vecPoints.end(),
+		[](const Point& pt) -> bool { return pt.bToppedUp; });
+}
+
+
+void NeutronPool::LogStats() const
+{
+	std::size_t iIndependent = 0, iUsed = 0, iLowESS = 0;
+	for(const Point& pt : m_vecPoints)
+	{
+		const std::size_t iFull = m_iNumNeutrons * pt.vecGauss.size();
+		iIndependent += iFull;
+		if(pt.dESS < m_dESSFrac * t_real(iFull))
+			++iLowESS;
+	}
+	iUsed = std::count(m_vecUsed.begin(), m_vecUsed.end(), true);
+
+	tl::log_info("Neutron pool: ", m_vecNeutrons.size(), " neutrons for ", m_vecPoints.size(),
+		" points, S(Q, E) evaluations: ", iUsed, " (independent sampling: ", iIndependent, ").");
+	tl::log_info("Neutron pool: effective sample size min. ", GetMinESS(), ", mean ", GetMeanESS(),
+		", topped-up points: ", GetToppedUpCount(), ".");
+
+	if(iLowESS)
+	{
+		tl::log_warn("Neutron pool: ", iLowESS, " point(s) have an effective sample size below the target of ",
+			m_dESSFrac*t_real(m_iNumNeutrons), " per sample position.");
+	}
+}
+
+// ----------------------------------------------------------------------------
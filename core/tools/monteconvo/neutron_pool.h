@@ -0,0 +1,117 @@
+/**
+ * shared pool of monte-carlo neutrons for all points of a scan
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __TAKIN_NEUTRON_POOL_H__
+#define __TAKIN_NEUTRON_POOL_H__
+
+#include "TASReso.h"
+
+#include <vector>
+#include <utility>
+#include <functional>
+
+
+/**
+ * instead of drawing independent neutrons for every point of a scan or map,
+ * the neutrons of all points' resolution ellipsoids are pooled. S(Q, E) is then
+ * evaluated once per pooled neutron and each point's intensity is obtained by
+ * reweighting all pooled neutrons with that point's resolution density.
+ *
+ * the weights use the balance heuristic of multiple importance sampling:
+ *   w_p(q) = rho_p(q) / sum_k n_k rho_k(q),
+ * with rho_k the density and n_k the number of neutrons drawn for point k.
+ * points whose effective sample size stays below the target are topped up
+ * by drawing additional neutrons from their own resolution density.
+ */
+class NeutronPool
+{
+public:
+	using t_real = t_real_reso;
+	using t_vec = ublas::vector<t_real>;
+	using t_mat = ublas::matrix<t_real>;
+	using t_gauss = McGaussian<t_vec, t_mat>;
+
+	// values at a neutron position, e.g. S(Q, E) or the partial intensities of a composite model
+	using t_func = std::function<void(const t_vec& vecHKLE, std::vector<t_real>& vecVals)>;
+
+protected:
+	struct Point
+	{
+		TASReso reso;                     // positioned resolution, used to draw the neutrons
+		std::vector<t_gauss> vecGauss;    // densities, one per random sample position
+		t_vec vecMin, vecMax;             // bounding box of the densities
+
+		std::size_t iNumDrawn = 0;        // neutrons drawn from this point's density
+		t_real dESS = 0;                  // effective sample size
+		bool bToppedUp = false;
+
+		// indices and weights of the contributing pool neutrons
+		std::vector<std::pair<std::size_t, t_real>> vecWeights;
+	};
+
+	std::vector<Point> m_vecPoints;
+	std::vector<t_vec> m_vecNeutrons;
+	std::vector<bool> m_vecUsed;          // neutron contributes to at least one point
+
+	// indices and densities of the points at each pool neutron
+	std::vector<std::vector<std::pair<std::size_t, t_real>>> m_vecDens;
+
+	t_real m_dMaxSigma = 5.;              // extent of the bounding boxes in standard deviations
+
+	// settings of the last build
+	std::size_t m_iNumNeutrons = 0;       // neutrons per sample position for independent sampling
+	t_real m_dESSFrac = 1.;               // target effective sample size relative to independent sampling
+
+protected:
+	t_real Density(const Point& pt, const t_vec& vec) const;
+	void Draw(const std::vector<std::pair<std::size_t, std::size_t>>& vecDraws);
+	void CalcWeights();
+
+public:
+	NeutronPool() = default;
+	~NeutronPool() = default;
+
+	bool AddPoint(const TASReso& reso);
+	void Build(std::size_t iNumNeutrons, t_real dPoolFactor = 8., t_real dESSFrac = 1., unsigned int iMaxRounds = 4);
+	std::vector<std::vector<t_real>> Evaluate(const t_func& func, std::size_t iNumVals = 1) const;
+
+	void Clear();
+	void LogStats() const;
+
+	std::size_t GetPointCount() const { return m_vecPoints.size(); }
+	std::size_t GetNeutronCount() const { return m_vecNeutrons.size(); }
+	t_real GetESS(std::size_t iPt) const { return m_vecPoints[iPt].dESS; }
+	t_real GetMinESS() const;
+	t_real GetMeanESS() const;
+	std::size_t GetToppedUpCount() const;
+
+	void SetMaxSigma(t_real dSig) { m_dMaxSigma = dSig; }
+};
+
+
+#endif
@@ -34,6 +34,7 @@
 #include "modules/table1d.h"
 #include "modules/elast.h"
 #include "modules/uniform_grid.h"
+#include "modules/composite.h"
 
 #include "sqw_proc.h"
 #include "sqw_proc_impl.h"
@@ -144,6 +145,17 @@ static t_mapSqw g_mapSqw =
 			"This model creates a collection of Bragg peaks."
 		}
 	},
+	{ "composite", t_mapSqw::mapped_type
+		{
+			[](const std::string& strCfgFile) -> std::shared_ptr<SqwBase>
+			{ return std::make_shared<SqwComposite>(strCfgFile.c_str()); },
+			"Composite Model",
+			"This model sums up several other S(Q, E) models which are evaluated on the same neutrons. "
+			"\n\nEach line of the configuration file defines a component: name, model identifier, "
+			"model configuration file and an optional scale. "
+			"The component variables are prefixed by the component name, e.g. \"phonon.T\"."
+		}
+	},
 };
 
 
@@ -27,6 +27,8 @@
  */
 
 #include "res.h"
+#include "trace.h"
+#include "../monteconvo/TASReso.h"
 #include "tlibs/log/log.h"
 #include "tlibs/string/string.h"
 #include "dialogs/EllipseDlg.h"
@@ -34,6 +36,7 @@
 
 #include <clocale>
 #include <fstream>
+#include <iomanip>
 #include <vector>
 #include <unordered_map>
 #include <string>
@@ -259,6 +262,76 @@ static bool load_mc_list(const char* pcFile, Resolution& res,
 }
 
 
+/**
+ * traces neutrons through the instrument described by a resolution file
+ */
+static bool trace_instr(const std::string& strResFile, const std::string& strLatticeFile,
+	const std::vector<t_real>& vecHKLE, const TasTracerOpts& opts, const std::string& strEventFile,
+	Resolution& res, const ublas::vector<t_real> *qPara = nullptr,
+	const ublas::vector<t_real> *qPerp = nullptr)
+{
+	TASReso reso;
+	if(!reso.LoadRes(strResFile.c_str()))
+	{
+		tl::log_err("Cannot load resolution file \"", strResFile, "\".");
+		return 0;
+	}
+
+	if(strLatticeFile != "")
+	{
+		if(!reso.LoadLattice(strLatticeFile.c_str()))
+		{
+			tl::log_err("Cannot load lattice file \"", strLatticeFile, "\".");
+			return 0;
+		}
+
+		if(vecHKLE.size() >= 4 && !reso.SetHKLE(vecHKLE[0], vecHKLE[1], vecHKLE[2], vecHKLE[3]))
+		{
+			tl::log_err("Invalid scattering position.");
+			return 0;
+		}
+	}
+
+	TasTracer tracer(reso.GetResoParams(), opts);
+	if(!tracer.IsOk())
+		return 0;
+	TasTracerResult result = tracer.Trace();
+
+	if(strEventFile != "")
+	{
+		std::ofstream ofstrEvents(strEventFile);
+		if(!ofstrEvents)
+		{
+			tl::log_err("Cannot write event file \"", strEventFile, "\".");
+		}
+		else
+		{
+			ofstrEvents.precision(8);
+			ofstrEvents << "# variables: Qx Qy Qz E p\n";
+			for(std::size_t iEvent=0; iEvent<result.vecQ.size(); ++iEvent)
+			{
+				const ublas::vector<t_real>& vecQ = result.vecQ[iEvent];
+				ofstrEvents << std::setw(16) << vecQ[0] << " " << std::setw(16) << vecQ[1] << " "
+					<< std::setw(16) << vecQ[2] << " " << std::setw(16) << vecQ[3] << " "
+					<< std::setw(16) << result.vecP[iEvent] << "\n";
+			}
+			tl::log_info("Wrote ", result.vecQ.size(), " events to \"", strEventFile, "\".");
+		}
+	}
+
+	normalise_P(&result.vecP);
+	res = calc_res(result.vecQ, &result.vecP, qPara, qPerp);
+
+	if(!res.bHasRes)
+	{
+		tl::log_err("Cannot calculate resolution matrix.");
+		return 0;
+	}
+
+	return 1;
+}
+
+
 static EllipseDlg* show_ellipses(const Resolution& res)
 {
 	EllipseDlg* pdlg = new EllipseDlg(0, 0, Qt::Window);
@@ -291,6 +364,12 @@ int main(int argc, char **argv)
 	bool bReso = 0;
 	bool bCovar = 0;
 
+	// ray tracing
+	TasTracerOpts traceopts;
+	std::string strTraceFile, strLatticeFile, strHKLE, strEventFile;
+	std::string strMonoTiles, strAnaTiles;
+	bool bNoPlot = 0;
+
 	opts::options_description args("program options");
 	args.add(boost::shared_ptr<opts::option_description>(
 		new opts::option_description("in-file",
@@ -309,6 +388,42 @@ int main(int argc, char **argv)
 	args.add(boost::shared_ptr<opts::option_description>(
 		new opts::option_description("orient2",
 		opts::value<decltype(strOrient2)>(&strOrient2), "second orientation vector")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("trace",
+		opts::value<decltype(strTraceFile)>(&strTraceFile),
+		"ray-trace the instrument in the given resolution file")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("lattice",
+		opts::value<decltype(strLatticeFile)>(&strLatticeFile), "lattice file for tracing")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("hklE",
+		opts::value<decltype(strHKLE)>(&strHKLE), "scattering position (h, k, l, E) for tracing")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("neutrons",
+		opts::value<decltype(traceopts.num_neutrons)>(&traceopts.num_neutrons),
+		"number of neutrons to trace")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("threads",
+		opts::value<decltype(traceopts.num_threads)>(&traceopts.num_threads),
+		"number of threads for tracing, 0: all")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("seed",
+		opts::value<decltype(traceopts.seed)>(&traceopts.seed), "random seed for tracing, 0: random")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("mono-tiles",
+		opts::value<decltype(strMonoTiles)>(&strMonoTiles),
+		"horizontal and vertical number of monochromator tiles")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("ana-tiles",
+		opts::value<decltype(strAnaTiles)>(&strAnaTiles),
+		"horizontal and vertical number of analyser tiles")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("save-events",
+		opts::value<decltype(strEventFile)>(&strEventFile), "write the traced events to a file")));
+	args.add(boost::shared_ptr<opts::option_description>(
+		new opts::option_description("no-plot",
+		opts::bool_switch(&bNoPlot),
+		"only print the resolution, do not show the ellipses")));
 
 	opts::positional_options_description args_pos;
 	args_pos.add("in-file", -1);
@@ -351,7 +466,25 @@ int main(int argc, char **argv)
 
 	Resolution res;
 
-	if(ft==FileType::RESOLUTION_MATRIX || ft==FileType::COVARIANCE_MATRIX)
+	if(strTraceFile != "")
+	{
+		std::vector<t_real> vecHKLE;
+		std::vector<unsigned int> vecMonoTiles, vecAnaTiles;
+		tl::get_tokens<t_real>(strHKLE, std::string(" ,;"), vecHKLE);
+		tl::get_tokens<unsigned int>(strMonoTiles, std::string(" ,;"), vecMonoTiles);
+		tl::get_tokens<unsigned int>(strAnaTiles, std::string(" ,;"), vecAnaTiles);
+
+		if(vecMonoTiles.size() >= 1) traceopts.mono_tiles_h = vecMonoTiles[0];
+		if(vecMonoTiles.size() >= 2) traceopts.mono_tiles_v = vecMonoTiles[1];
+		if(vecAnaTiles.size() >= 1) traceopts.ana_tiles_h = vecAnaTiles[0];
+		if(vecAnaTiles.size() >= 2) traceopts.ana_tiles_v = vecAnaTiles[1];
+
+		tl::log_info("Tracing instrument from \"", strTraceFile, "\".");
+		if(!trace_instr(strTraceFile, strLatticeFile, vecHKLE, traceopts, strEventFile, res,
+			_vecOrient1.size() ? &vecQPara : 0, _vecOrient2.size() ? &vecQPerp : 0))
+			return -1;
+	}
+	else if(ft==FileType::RESOLUTION_MATRIX || ft==FileType::COVARIANCE_MATRIX)
 	{
 		tl::log_info("Loading covariance/resolution matrix from \"", strFile, "\".");
 		if(!load_mat(strFile.c_str(), res, ft))
@@ -366,6 +499,9 @@ int main(int argc, char **argv)
 	}
 
 
+	if(bNoPlot)
+		return 0;
+
 	QLocale::setDefault(QLocale::English);
 	QApplication app(argc, argv);
 	app.setQuitOnLastWindowClosed(1);
@@ -0,0 +1,803 @@
+/**
+ * Monte-Carlo ray tracing of a triple-axis spectrometer
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "trace.h"
+#include "tlibs/phys/neutrons.h"
+#include "tlibs/math/math.h"
+#include "tlibs/helper/thread.h"
+#include "tlibs/log/log.h"
+#include "libs/globals.h"
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+using t_real = TasTracer::t_real;
+using t_vec3 = TasTracer::t_vec3;
+using t_rnd = std::mt19937;
+
+
+// ----------------------------------------------------------------------------
+// vector helpers
+
+static inline t_vec3 operator+(const t_vec3& a, const t_vec3& b)
+{
+	return t_vec3{{ a[0]+b[0], a[1]+b[1], a[2]+b[2] }};
+}
+
+static inline t_vec3 operator-(const t_vec3& a, const t_vec3& b)
+{
+	return t_vec3{{ a[0]-b[0], a[1]-b[1], a[2]-b[2] }};
+}
+
+static inline t_vec3 operator*(t_real s, const t_vec3& a)
+{
+	return t_vec3{{ s*a[0], s*a[1], s*a[2] }};
+}
+
+static inline t_real dot(const t_vec3& a, const t_vec3& b)
+{
+	return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+static inline t_vec3 cross(const t_vec3& a, const t_vec3& b)
+{
+	return t_vec3{{ a[1]*b[2] - a[2]*b[1], a[2]*b[0] - a[0]*b[2], a[0]*b[1] - a[1]*b[0] }};
+}
+
+static inline t_real len(const t_vec3& a)
+{
+	return std::sqrt(dot(a, a));
+}
+
+static inline t_vec3 normalise(const t_vec3& a)
+{
+	return (t_real(1) / len(a)) * a;
+}
+
+/**
+ * rotates a vector around the vertical axis
+ */
+static inline t_vec3 rot_z(const t_vec3& a, t_real angle)
+{
+	const t_real c = std::cos(angle), s = std::sin(angle);
+	return t_vec3{{ c*a[0] - s*a[1], s*a[0] + c*a[1], a[2] }};
+}
+
+static const t_vec3 g_up{{ 0, 0, 1 }};
+
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// sampling and transmission helpers
+
+static inline t_real rand_uni(t_rnd& rnd, t_real dMin, t_real dMax)
+{
+	return std::uniform_real_distribution<t_real>(dMin, dMax)(rnd);
+}
+
+
+/**
+ * uniform point on a rectangle or an ellipse with full widths w and h
+ */
+static inline void rand_area(t_rnd& rnd, bool bRect, t_real w, t_real h, t_real& x, t_real& y)
+{
+	while(1)
+	{
+		x = rand_uni(rnd, -0.5, 0.5);
+		y = rand_uni(rnd, -0.5, 0.5);
+
+		if(bRect || x*x + y*y <= t_real(0.25))
+			break;
+	}
+
+	x *= w;
+	y *= h;
+}
+
+
+/**
+ * position of the centre of the tile containing the given coordinate
+ */
+static inline t_real tile_centre(t_real x, t_real w, unsigned int iTiles)
+{
+	if(iTiles <= 1)
+		return x;
+
+	const t_real wTile = w / t_real(iTiles);
+	const int iTile = tl::clamp(int(std::floor((x + t_real(0.5)*w) / wTile)), 0, int(iTiles)-1);
+	return -t_real(0.5)*w + (t_real(iTile) + t_real(0.5))*wTile;
+}
+
+
+/**
+ * horizontal and vertical angles of a direction relative to an axis in the scattering plane
+ */
+static inline void dir_angles(const t_vec3& dir, const t_vec3& axis, t_real& angle_h, t_real& angle_v)
+{
+	const t_vec3 side = normalise(cross(g_up, axis));
+
+	angle_h = std::atan2(dot(dir, side), dot(dir, axis));
+	angle_v = std::asin(tl::clamp<t_real>(dot(dir, g_up), -1, 1));
+}
+
+
+/**
+ * transmission of a soller collimator with the given fwhm
+ */
+static inline t_real soller(t_real angle, t_real fwhm)
+{
+	if(fwhm <= t_real(0))
+		return 1;
+	return std::max<t_real>(0, t_real(1) - std::abs(angle)/fwhm);
+}
+
+
+/**
+ * transmission of a neutron guide, which passes all divergences up to its critical angle
+ */
+static inline t_real guide(t_real angle, t_real fwhm)
+{
+	if(fwhm <= t_real(0))
+		return 1;
+	return std::abs(angle) <= t_real(0.5)*fwhm ? 1 : 0;
+}
+
+
+/**
+ * random coordinate along one of the crystal dimensions, either uniformly distributed or,
+ * with equal probability, around the coordinate of the specular reflection point
+ * @param spec_width width for sampling around the specular point, 0: only sample uniformly
+ * @return weight relative to uniform sampling
+ */
+static inline t_real rand_crystal_coord(t_rnd& rnd, std::normal_distribution<t_real>& distNorm,
+	t_real w, t_real spec, t_real spec_width, t_real& x)
+{
+	if(spec_width <= t_real(0))
+	{
+		x = rand_uni(rnd, -t_real(0.5)*w, t_real(0.5)*w);
+		return 1;
+	}
+
+	if(rand_uni(rnd, 0, 1) < t_real(0.5))
+		x = rand_uni(rnd, -t_real(0.5)*w, t_real(0.5)*w);
+	else
+		x = spec + spec_width*distNorm(rnd);
+
+	if(std::abs(x) > t_real(0.5)*w)
+		return 0;
+
+	const t_real arg = (x - spec) / spec_width;
+	const t_real gauss = std::exp(-t_real(0.5)*arg*arg) / (std::sqrt(t_real(2)*tl::get_pi<t_real>())*spec_width);
+	return (t_real(1)/w) / (t_real(0.5)/w + t_real(0.5)*gauss);
+}
+
+
+/**
+ * coordinates of the point on the nominal crystal surface which mirrors a ray between two points
+ */
+static inline void specular_point(const TasTracer::Crystal& cryst,
+	const t_vec3& from, const t_vec3& to, t_real& u, t_real& v)
+{
+	const t_vec3 mirrored = from - (t_real(2)*dot(from - cryst.pos, cryst.normal))*cryst.normal;
+	const t_vec3 path = to - mirrored;
+
+	const t_real denom = dot(path, cryst.normal);
+	if(std::abs(denom) <= std::numeric_limits<t_real>::epsilon())
+	{
+		u = v = 0;
+		return;
+	}
+
+	const t_vec3 pt = mirrored + (dot(cryst.pos - mirrored, cryst.normal)/denom)*path - cryst.pos;
+	u = dot(pt, cryst.lateral);
+	v = pt[2];
+}
+
+
+/**
+ * point in a (possibly curved and segmented) crystal and the local crystal normal there
+ */
+static inline t_vec3 crystal_point(const TasTracer::Crystal& cryst,
+	t_real u, t_real v, t_real depth, t_vec3& normal)
+{
+	// the tiles are tangential to the curvature at their centres
+	const t_real uc = tile_centre(u, cryst.w, cryst.tiles_h);
+	const t_real vc = tile_centre(v, cryst.h, cryst.tiles_v);
+	const t_real sagitta =
+		cryst.curv_h * (t_real(0.5)*uc*uc + (u-uc)*uc) +
+		cryst.curv_v * (t_real(0.5)*vc*vc + (v-vc)*vc);
+
+	normal = normalise(cryst.normal - (cryst.curv_h*uc)*cryst.lateral - (cryst.curv_v*vc)*g_up);
+	return cryst.pos + u*cryst.lateral + v*g_up + (sagitta - depth)*cryst.normal;
+}
+
+
+/**
+ * random point in a crystal, preferably near the specular reflection point between two points
+ * @param from, to points before and after the crystal, nullptr for uniform sampling
+ */
+static inline t_vec3 rand_crystal(t_rnd& rnd, std::normal_distribution<t_real>& distNorm,
+	const TasTracer::Crystal& cryst, const t_vec3* from, const t_vec3* to,
+	t_vec3& normal, t_real& weight)
+{
+	t_real u_spec = 0, v_spec = 0;
+	t_real spec_h = 0, spec_v = 0;
+	if(from && to)
+	{
+		specular_point(cryst, *from, *to, u_spec, v_spec);
+		spec_h = cryst.spec_width_h;
+		spec_v = cryst.spec_width_v;
+	}
+
+	t_real u = 0, v = 0;
+	weight *= rand_crystal_coord(rnd, distNorm, cryst.w, u_spec, spec_h, u);
+	weight *= rand_crystal_coord(rnd, distNorm, cryst.h, v_spec, spec_v, v);
+	const t_real depth = cryst.thick > t_real(0) ? rand_uni(rnd, 0, cryst.thick) : t_real(0);
+
+	return crystal_point(cryst, u, v, depth, normal);
+}
+
+
+/**
+ * weights a reflection between fixed directions by the probability of finding a suitable mosaic block
+ * @return wavenumber fulfilling the bragg condition
+ */
+static inline t_real reflect(const TasTracer::Crystal& cryst, const t_vec3& normal,
+	const t_vec3& dir_in, const t_vec3& dir_out, t_real& weight)
+{
+	const t_vec3 G = dir_out - dir_in;
+	const t_real lenG = len(G);
+	if(lenG <= std::numeric_limits<t_real>::epsilon())
+	{
+		weight = 0;
+		return 0;
+	}
+
+	// deviation of the needed block orientation from the local crystal normal
+	const t_vec3 block = (t_real(1)/lenG) * G;
+	const t_vec3 side = normalise(cross(g_up, normal));
+	const t_real eta_h = std::atan2(dot(block, side), dot(block, normal));
+	const t_real eta_v = std::asin(tl::clamp<t_real>(dot(block, cross(normal, side)), -1, 1));
+
+	const t_real arg_h = eta_h / cryst.sig_mosaic_h;
+	const t_real arg_v = eta_v / cryst.sig_mosaic_v;
+	weight *= std::exp(-t_real(0.5) * (arg_h*arg_h + arg_v*arg_v));
+
+	// bragg condition: 2 sin(theta) = |dir_out - dir_in|
+	return t_real(2)*tl::get_pi<t_real>() / (cryst.d * lenG);
+}
+
+
+/**
+ * reflects a neutron at a mosaic block whose orientation is drawn from the mosaic distribution
+ * @param dir known direction, the incoming one for bIncoming, otherwise the outgoing one
+ * @param dir_refl the other direction
+ * @return wavenumber fulfilling the bragg condition, 0 if the block cannot reflect the neutron
+ */
+static inline t_real rand_reflect(t_rnd& rnd, std::normal_distribution<t_real>& distNorm,
+	const TasTracer::Crystal& cryst, const t_vec3& normal,
+	const t_vec3& dir, bool bIncoming, t_vec3& dir_refl, t_real& weight)
+{
+	const t_real eta_h = cryst.sig_mosaic_h * distNorm(rnd);
+	const t_real eta_v = cryst.sig_mosaic_v * distNorm(rnd);
+
+	const t_vec3 side = normalise(cross(g_up, normal));
+	const t_vec3 up = cross(normal, side);
+	const t_vec3 block = std::cos(eta_v)*(std::cos(eta_h)*normal + std::sin(eta_h)*side)
+		+ std::sin(eta_v)*up;
+
+	// the neutron has to come from and leave to the reflecting side
+	const t_real sin_th = bIncoming ? -dot(dir, block) : dot(dir, block);
+	if(sin_th <= std::numeric_limits<t_real>::epsilon())
+	{
+		weight = 0;
+		return 0;
+	}
+
+	dir_refl = dir - (t_real(2)*dot(dir, block))*block;
+
+	// the solid angle of the reflected beam is 4 sin(theta) times the one of the block normals
+	weight *= t_real(4)*sin_th;
+
+	// bragg condition
+	return tl::get_pi<t_real>() / (cryst.d * sin_th);
+}
+
+
+/**
+ * does a ray hit a rectangular or elliptic area perpendicular to the given axis?
+ */
+static inline bool hit_area(const t_vec3& pos, const t_vec3& dir,
+	const t_vec3& centre, const t_vec3& axis, bool bRect, t_real w, t_real h)
+{
+	const t_real denom = dot(dir, axis);
+	if(std::abs(denom) <= std::numeric_limits<t_real>::epsilon())
+		return false;
+
+	const t_real t = dot(centre - pos, axis) / denom;
+	if(t <= t_real(0))
+		return false;
+
+	const t_vec3 hit = pos + t*dir - centre;
+	const t_real x = t_real(2) * dot(hit, normalise(cross(g_up, axis))) / w;
+	const t_real y = t_real(2) * hit[2] / h;
+
+	if(bRect)
+		return std::abs(x) <= t_real(1) && std::abs(y) <= t_real(1);
+	return x*x + y*y <= t_real(1);
+}
+
+/**
+ * effective number of events of a weighted sample
+ */
+static t_real get_eff_size(const std::vector<t_real>& vecP)
+{
+	t_real dSumP = 0, dSumP2 = 0;
+	for(t_real p : vecP)
+	{
+		dSumP += p;
+		dSumP2 += p*p;
+	}
+
+	return dSumP2 > t_real(0) ? dSumP*dSumP/dSumP2 : t_real(0);
+}
+
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// tracer
+
+TasTracer::TasTracer(const EckParams& params, const TasTracerOpts& opts)
+	: m_params(params), m_opts(opts)
+{
+	static const auto angs = tl::get_one_angstrom<t_real>();
+	static const auto rads = tl::get_one_radian<t_real>();
+	static const auto cm = tl::get_one_centimeter<t_real>();
+	const t_real pi = tl::get_pi<t_real>();
+	const t_real fwhm2sig = tl::get_FWHM2SIGMA<t_real>();
+
+	if(params.bKfVertical)
+		tl::log_warn("Vertical scattering in kf is not supported by the tracer, using a horizontal analyser.");
+
+	const t_real ki = params.ki * angs;
+	const t_real kf = params.kf * angs;
+	const t_real Q = params.Q * angs;
+	m_mono.d = params.mono_d / angs;
+	m_ana.d = params.ana_d / angs;
+
+	// scattering angles
+	const t_real sin_th_m = pi / (m_mono.d * ki);
+	const t_real sin_th_a = pi / (m_ana.d * kf);
+	const t_real cos_tt_s = (ki*ki + kf*kf - Q*Q) / (t_real(2)*ki*kf);
+	if(std::abs(sin_th_m) > t_real(1) || std::abs(sin_th_a) > t_real(1) || std::abs(cos_tt_s) > t_real(1))
+	{
+		tl::log_err("Scattering triangle cannot be closed.");
+		return;
+	}
+
+	const t_real tt_m = t_real(2) * std::asin(sin_th_m);
+	const t_real tt_a = t_real(2) * std::asin(sin_th_a);
+	const t_real tt_s = std::acos(cos_tt_s);
+
+	// nominal beam axes and component positions
+	m_dist[0] = params.dist_src_mono / cm;
+	m_dist[1] = params.dist_mono_sample / cm;
+	m_dist[2] = params.dist_sample_ana / cm;
+	m_dist[3] = params.dist_ana_det / cm;
+
+	m_axes[0] = t_vec3{{ 1, 0, 0 }};
+	m_axes[1] = rot_z(m_axes[0], params.dmono_sense * tt_m);
+	m_axes[2] = rot_z(m_axes[1], params.dsample_sense * tt_s);
+	m_axes[3] = rot_z(m_axes[2], params.dana_sense * tt_a);
+
+	m_posSrc = -m_dist[0] * m_axes[0];
+	m_mono.pos = t_vec3{{ 0, 0, 0 }};
+	m_posSample = m_mono.pos + m_dist[1]*m_axes[1];
+	m_ana.pos = m_posSample + m_dist[2]*m_axes[2];
+	m_posDet = m_ana.pos + m_dist[3]*m_axes[3];
+
+	m_dirQ = normalise(ki*m_axes[1] - kf*m_axes[2]);
+
+	// crystals
+	auto inv_curv = [](t_real R) -> t_real
+	{
+		return tl::float_equal<t_real>(R, 0) ? t_real(0) : t_real(1)/std::abs(R);
+	};
+
+	m_mono.normal = normalise(m_axes[1] - m_axes[0]);
+	m_mono.lateral = normalise(cross(g_up, m_mono.normal));
+	m_mono.w = params.mono_w / cm;
+	m_mono.h = params.mono_h / cm;
+	m_mono.thick = params.mono_thick / cm;
+	m_mono.tiles_h = opts.mono_tiles_h;
+	m_mono.tiles_v = opts.mono_tiles_v;
+	if(params.bMonoIsCurvedH)
+		m_mono.curv_h = inv_curv((params.bMonoIsOptimallyCurvedH
+			? tl::foc_curv(params.dist_src_mono, params.dist_mono_sample, tt_m*rads, false)
+			: params.mono_curvh) / cm);
+	if(params.bMonoIsCurvedV)
+		m_mono.curv_v = inv_curv((params.bMonoIsOptimallyCurvedV
+			? tl::foc_curv(params.dist_src_mono, params.dist_mono_sample, tt_m*rads, true)
+			: params.mono_curvv) / cm);
+	m_mono.sig_mosaic_h = params.mono_mosaic / rads * fwhm2sig;
+	m_mono.sig_mosaic_v = params.mono_mosaic_v / rads * fwhm2sig;
+	if(m_mono.sig_mosaic_v <= t_real(0))
+		m_mono.sig_mosaic_v = m_mono.sig_mosaic_h;
+
+	m_ana.normal = normalise(m_axes[3] - m_axes[2]);
+	m_ana.lateral = normalise(cross(g_up, m_ana.normal));
+	m_ana.w = params.ana_w / cm;
+	m_ana.h = params.ana_h / cm;
+	m_ana.thick = params.ana_thick / cm;
+	m_ana.tiles_h = opts.ana_tiles_h;
+	m_ana.tiles_v = opts.ana_tiles_v;
+	if(params.bAnaIsCurvedH)
+		m_ana.curv_h = inv_curv((params.bAnaIsOptimallyCurvedH
+			? tl::foc_curv(params.dist_sample_ana, params.dist_ana_det, tt_a*rads, false)
+			: params.ana_curvh) / cm);
+	if(params.bAnaIsCurvedV)
+		m_ana.curv_v = inv_curv((params.bAnaIsOptimallyCurvedV
+			? tl::foc_curv(params.dist_sample_ana, params.dist_ana_det, tt_a*rads, true)
+			: params.ana_curvv) / cm);
+	m_ana.sig_mosaic_h = params.ana_mosaic / rads * fwhm2sig;
+	m_ana.sig_mosaic_v = params.ana_mosaic_v / rads * fwhm2sig;
+	if(m_ana.sig_mosaic_v <= t_real(0))
+		m_ana.sig_mosaic_v = m_ana.sig_mosaic_h;
+
+	if(m_mono.sig_mosaic_h <= t_real(0) || m_ana.sig_mosaic_h <= t_real(0))
+	{
+		tl::log_err("Monochromator and analyser mosaics have to be positive.");
+		return;
+	}
+
+	// for flat crystals, only a narrow region around the specular point reflects between
+	// two given points, the widths follow from the mosaic and the change in the needed
+	// block orientation when moving along the crystal
+	auto set_spec_widths = [](Crystal& cryst, t_real sin_th, t_real dist_in, t_real dist_out)
+	{
+		const t_real dInvDist = t_real(1)/dist_in + t_real(1)/dist_out;
+
+		if(tl::float_equal<t_real>(cryst.curv_h, 0))
+			cryst.spec_width_h = t_real(2)*cryst.sig_mosaic_h / (sin_th*dInvDist);
+		if(tl::float_equal<t_real>(cryst.curv_v, 0))
+			cryst.spec_width_v = t_real(2)*cryst.sig_mosaic_v*sin_th / dInvDist;
+
+		if(cryst.spec_width_h >= cryst.w)
+			cryst.spec_width_h = 0;
+		if(cryst.spec_width_v >= cryst.h)
+			cryst.spec_width_v = 0;
+	};
+
+	set_spec_widths(m_mono, sin_th_m, m_dist[0], m_dist[1]);
+	set_spec_widths(m_ana, sin_th_a, m_dist[2], m_dist[3]);
+
+	m_sig_sample_h = params.sample_mosaic / rads * fwhm2sig;
+	m_sig_sample_v = params.sample_mosaic_v / rads * fwhm2sig;
+	if(m_sig_sample_v <= t_real(0))
+		m_sig_sample_v = m_sig_sample_h;
+
+	// source, sample and detector
+	m_src_w = params.src_w / cm;
+	m_src_h = params.src_h / cm;
+	m_sample_wq = params.sample_w_q / cm;
+	m_sample_wperpq = params.sample_w_perpq / cm;
+	m_sample_h = params.sample_h / cm;
+	m_det_w = params.det_w / cm;
+	m_det_h = params.det_h / cm;
+
+	// collimators
+	m_coll_h[0] = params.coll_h_pre_mono / rads;
+	m_coll_h[1] = params.coll_h_pre_sample / rads;
+	m_coll_h[2] = params.coll_h_post_sample / rads;
+	m_coll_h[3] = params.coll_h_post_ana / rads;
+	m_coll_v[0] = params.coll_v_pre_mono / rads;
+	m_coll_v[1] = params.coll_v_pre_sample / rads;
+	m_coll_v[2] = params.coll_v_post_sample / rads;
+	m_coll_v[3] = params.coll_v_post_ana / rads;
+
+	if(params.bGuide)
+	{
+		m_guide_div_h = params.guide_div_h / rads;
+		m_guide_div_v = params.guide_div_v / rads;
+	}
+
+	m_bOk = true;
+}
+
+
+/**
+ * traces a number of neutrons through random points in the crystals and the sample,
+ * the directions towards the source and the detector either follow from random points
+ * on them or from randomly oriented mosaic blocks
+ * @return number of events with non-zero weight
+ */
+std::size_t TasTracer::TraceBlock(t_rnd& rnd, std::size_t iNum,
+	bool bMonoMosaic, bool bAnaMosaic, TasTracerResult& res) const
+{
+	static const t_real KSQ2E = tl::get_KSQ2E<t_real>();
+	const t_real pi = tl::get_pi<t_real>();
+
+	const t_vec3 srcSide = normalise(cross(g_up, m_axes[0]));
+	const t_vec3 detSide = normalise(cross(g_up, m_axes[3]));
+	const t_vec3 perpQ = normalise(cross(g_up, m_dirQ));
+
+	// normalise the distances to keep the weights in a sensible range
+	t_real dDistNorm = m_dist[1]*m_dist[1] * m_dist[2]*m_dist[2];
+	if(!bMonoMosaic)
+		dDistNorm *= m_dist[0]*m_dist[0];
+	if(!bAnaMosaic)
+		dDistNorm *= m_dist[3]*m_dist[3];
+
+	std::normal_distribution<t_real> distNorm(0, 1);
+
+	res.vecQ.reserve(res.vecQ.size() + iNum);
+	res.vecP.reserve(res.vecP.size() + iNum);
+	std::size_t iAccepted = 0;
+
+	for(std::size_t iNeutr=0; iNeutr<iNum; ++iNeutr)
+	{
+		t_real dWeight = dDistNorm;
+		t_vec3 dir[4];
+
+		// sample
+		t_vec3 posSample;
+		if(m_params.bSampleCub)
+		{
+			posSample = m_posSample
+				+ rand_uni(rnd, -t_real(0.5)*m_sample_wq, t_real(0.5)*m_sample_wq)*m_dirQ
+				+ rand_uni(rnd, -t_real(0.5)*m_sample_wperpq, t_real(0.5)*m_sample_wperpq)*perpQ;
+		}
+		else
+		{
+			t_real x = 0, y = 0;
+			rand_area(rnd, false, m_sample_wq, m_sample_wperpq, x, y);
+			posSample = m_posSample + x*m_dirQ + y*perpQ;
+		}
+		posSample = posSample + rand_uni(rnd, -t_real(0.5)*m_sample_h, t_real(0.5)*m_sample_h)*g_up;
+
+		// monochromator
+		t_vec3 posSrc, normalMono, posMono;
+		if(bMonoMosaic)
+		{
+			posMono = rand_crystal(rnd, distNorm, m_mono, nullptr, nullptr, normalMono, dWeight);
+		}
+		else
+		{
+			t_real x = 0, y = 0;
+			rand_area(rnd, m_params.bSrcRect, m_src_w, m_src_h, x, y);
+			posSrc = m_posSrc + x*srcSide + y*g_up;
+			posMono = rand_crystal(rnd, distNorm, m_mono, &posSrc, &posSample, normalMono, dWeight);
+		}
+
+		// analyser
+		t_vec3 posDet, normalAna, posAna;
+		if(bAnaMosaic)
+		{
+			posAna = rand_crystal(rnd, distNorm, m_ana, nullptr, nullptr, normalAna, dWeight);
+		}
+		else
+		{
+			t_real x = 0, y = 0;
+			rand_area(rnd, m_params.bDetRect, m_det_w, m_det_h, x, y);
+			posDet = m_posDet + x*detSide + y*g_up;
+			posAna = rand_crystal(rnd, distNorm, m_ana, &posSample, &posDet, normalAna, dWeight);
+		}
+
+		if(dWeight <= t_real(0))
+			continue;
+
+		// flight paths between the crystals and the sample
+		for(int iPath=1; iPath<=2; ++iPath)
+		{
+			const t_vec3 path = iPath==1 ? posSample - posMono : posAna - posSample;
+			const t_real dLenSq = dot(path, path);
+			dir[iPath] = (t_real(1)/std::sqrt(dLenSq)) * path;
+			dWeight /= dLenSq;
+		}
+
+		// monochromator reflection
+		t_real ki = 0;
+		if(bMonoMosaic)
+		{
+			// the incoming beam has to come from the source
+			ki = rand_reflect(rnd, distNorm, m_mono, normalMono, dir[1], false, dir[0], dWeight);
+			if(dWeight <= t_real(0) || !hit_area(posMono, -t_real(1)*dir[0], m_posSrc, m_axes[0],
+				m_params.bSrcRect, m_src_w, m_src_h))
+				continue;
+		}
+		else
+		{
+			const t_vec3 path = posMono - posSrc;
+			const t_real dLenSq = dot(path, path);
+			dir[0] = (t_real(1)/std::sqrt(dLenSq)) * path;
+
+			// emission from the source surface
+			dWeight *= std::max<t_real>(0, dot(dir[0], m_axes[0])) / dLenSq;
+			ki = reflect(m_mono, normalMono, dir[0], dir[1], dWeight);
+		}
+
+		// analyser reflection
+		t_real kf = 0;
+		if(bAnaMosaic)
+		{
+			// the outgoing beam has to hit the detector
+			kf = rand_reflect(rnd, distNorm, m_ana, normalAna, dir[2], true, dir[3], dWeight);
+			if(dWeight <= t_real(0) || !hit_area(posAna, dir[3], m_posDet, m_axes[3],
+				m_params.bDetRect, m_det_w, m_det_h))
+				continue;
+		}
+		else
+		{
+			const t_vec3 path = posDet - posAna;
+			const t_real dLenSq = dot(path, path);
+			dir[3] = (t_real(1)/std::sqrt(dLenSq)) * path;
+
+			// projected detector area
+			dWeight *= std::max<t_real>(0, dot(dir[3], m_axes[3])) / dLenSq;
+			kf = reflect(m_ana, normalAna, dir[2], dir[3], dWeight);
+		}
+
+		if(dWeight <= t_real(0))
+			continue;
+
+		// collimators, the guide replaces the pre-monochromator collimator
+		for(int iPath=0; iPath<4 && dWeight > t_real(0); ++iPath)
+		{
+			t_real angle_h = 0, angle_v = 0;
+			dir_angles(dir[iPath], m_axes[iPath], angle_h, angle_v);
+
+			if(iPath == 0 && m_params.bGuide)
+			{
+				const t_real lam = t_real(2)*pi / ki;
+				dWeight *= guide(angle_h, lam*m_guide_div_h) * guide(angle_v, lam*m_guide_div_v);
+			}
+			else
+			{
+				dWeight *= soller(angle_h, m_coll_h[iPath]) * soller(angle_v, m_coll_v[iPath]);
+			}
+		}
+
+		if(dWeight <= t_real(0))
+			continue;
+
+		if(m_params.mono_refl_curve)
+			dWeight *= (*m_params.mono_refl_curve)(ki);
+		if(m_params.ana_effic_curve)
+			dWeight *= (*m_params.ana_effic_curve)(kf);
+
+		// scattering vector and energy transfer
+		t_vec3 Q = ki*dir[1] - kf*dir[2];
+		const t_real E = KSQ2E * (ki*ki - kf*kf);
+
+		if(m_opts.sample_mosaic && m_sig_sample_h > t_real(0))
+		{
+			// in-plane and out-of-plane tilt of the mosaic block
+			Q = rot_z(Q, m_sig_sample_h * distNorm(rnd));
+
+			const t_real tilt = m_sig_sample_v * distNorm(rnd);
+			const t_vec3 axis = normalise(cross(g_up, Q));
+			Q = std::cos(tilt)*Q + std::sin(tilt)*cross(axis, Q);
+		}
+
+		res.vecQ.emplace_back(tl::make_vec<ublas::vector<t_real>>({ Q[0], Q[1], Q[2], E }));
+		res.vecP.push_back(dWeight);
+		++iAccepted;
+	}
+
+	return iAccepted;
+}
+
+
+/**
+ * traces the neutrons in parallel blocks, each block has its own random
+ * engine, so the events only depend on the seed and not on the number of threads
+ */
+TasTracerResult TasTracer::Trace() const
+{
+	TasTracerResult res;
+	if(!m_bOk)
+		return res;
+
+	const std::size_t iBlockSize = 1 << 14;
+	const std::size_t iNumBlocks = (m_opts.num_neutrons + iBlockSize - 1) / iBlockSize;
+	const unsigned int iSeed = m_opts.seed ? m_opts.seed : std::random_device{}();
+
+	const unsigned int iNumThreads = std::max<unsigned int>(1,
+		m_opts.num_threads ? m_opts.num_threads : get_max_threads());
+	tl::log_info("Tracing ", m_opts.num_neutrons, " neutrons using ", iNumThreads,
+		(iNumThreads == 1 ? " thread" : " threads"), " and random seed ", iSeed, ".");
+
+	// pilot runs to choose the sampling strategies with the largest effective sample size
+	bool bMonoMosaic = true, bAnaMosaic = true;
+	t_real dBestEff = -1;
+	for(int iStrategy=0; iStrategy<4; ++iStrategy)
+	{
+		const bool bMono = (iStrategy & 1) != 0, bAna = (iStrategy & 2) != 0;
+
+		std::seed_seq seed{ iSeed, ~0u, static_cast<unsigned int>(iStrategy) };
+		t_rnd rnd(seed);
+
+		TasTracerResult resPilot;
+		TraceBlock(rnd, iBlockSize/2, bMono, bAna, resPilot);
+
+		const t_real dEff = get_eff_size(resPilot.vecP);
+		if(dEff > dBestEff)
+		{
+			dBestEff = dEff;
+			bMonoMosaic = bMono;
+			bAnaMosaic = bAna;
+		}
+	}
+
+	tl::log_debug("Sampling monochromator ", (bMonoMosaic ? "mosaic" : "source"),
+		" and analyser ", (bAnaMosaic ? "mosaic" : "detector"), ".");
+
+	tl::ThreadPool<TasTracerResult()> tp(iNumThreads);
+	for(std::size_t iBlock=0; iBlock<iNumBlocks; ++iBlock)
+	{
+		const std::size_t iNum = std::min(iBlockSize, m_opts.num_neutrons - iBlock*iBlockSize);
+
+		tp.AddTask([this, iSeed, iBlock, iNum, bMonoMosaic, bAnaMosaic]() -> TasTracerResult
+		{
+			std::seed_seq seed{ iSeed, static_cast<unsigned int>(iBlock) };
+			t_rnd rnd(seed);
+
+			TasTracerResult resBlock;
+			resBlock.iNumTraced = iNum;
+			TraceBlock(rnd, iNum, bMonoMosaic, bAnaMosaic, resBlock);
+			return resBlock;
+		});
+	}
+
+	tp.Start();
+
+	// collect the blocks in order
+	auto& lstResults = tp.GetResults();
+	for(auto& fut : lstResults)
+	{
+		TasTracerResult resBlock = fut.get();
+
+		res.iNumTraced += resBlock.iNumTraced;
+		res.vecQ.insert(res.vecQ.end(),
+			std::make_move_iterator(resBlock.vecQ.begin()),
+			std::make_move_iterator(resBlock.vecQ.end()));
+		res.vecP.insert(res.vecP.end(), resBlock.vecP.begin(), resBlock.vecP.end());
+	}
+
+	tl::log_info("Events with non-zero weight: ", res.vecQ.size(), " of ", res.iNumTraced,
+		", effective sample size: ", get_eff_size(res.vecP), ".");
+
+	return res;
+}
+
+// ----------------------------------------------------------------------------
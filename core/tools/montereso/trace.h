@@ -0,0 +1,137 @@
+/**
+ * Monte-Carlo ray tracing of a triple-axis spectrometer
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __MONTERES_TRACE_H__
+#define __MONTERES_TRACE_H__
+
+#include <vector>
+#include <array>
+#include <random>
+
+#include "../res/eck.h"
+#include "tlibs/math/linalg.h"
+namespace ublas = boost::numeric::ublas;
+
+
+struct TasTracerOpts
+{
+	std::size_t num_neutrons = 1000000;
+	unsigned int num_threads = 0;            // 0: use all available threads
+	unsigned int seed = 0;
+
+	// number of flat crystal tiles, <= 1: continuously bent crystal
+	unsigned int mono_tiles_h = 0, mono_tiles_v = 0;
+	unsigned int ana_tiles_h = 0, ana_tiles_v = 0;
+
+	bool sample_mosaic = true;               // smear Q by the sample mosaic
+};
+
+
+struct TasTracerResult
+{
+	// (Qx, Qy, Qz, E) events in the laboratory system, in 1/A and meV
+	std::vector<ublas::vector<t_real_reso>> vecQ;
+	std::vector<t_real_reso> vecP;           // event weights
+
+	std::size_t iNumTraced = 0;
+};
+
+
+/**
+ * point-to-point Monte-Carlo tracer through source, collimators, monochromator,
+ * sample, analyser and detector, using the instrument parameters of the
+ * analytical resolution calculations.
+ *
+ * for each crystal, the tracer either samples the source or detector point and
+ * weights by the mosaic, or samples the mosaic block and checks if the reflected
+ * beam hits the source or detector; a short pilot run picks the more efficient way.
+ *
+ * the laboratory system has x along the beam from the source to the
+ * monochromator and z pointing upwards, the monochromator is at the origin.
+ */
+class TasTracer
+{
+public:
+	using t_real = t_real_reso;
+	using t_vec3 = std::array<t_real, 3>;
+
+	// a mosaic crystal, lengths in cm
+	struct Crystal
+	{
+		t_vec3 pos, normal, lateral;
+		t_real d = 0;                        // in A
+		t_real w = 0, h = 0, thick = 0;
+		t_real curv_h = 0, curv_v = 0;       // inverse curvature radii
+		unsigned int tiles_h = 0, tiles_v = 0;
+		t_real sig_mosaic_h = 0, sig_mosaic_v = 0;
+
+		// widths for sampling around the specular reflection point, 0: uniform sampling
+		t_real spec_width_h = 0, spec_width_v = 0;
+	};
+
+protected:
+	EckParams m_params;
+	TasTracerOpts m_opts;
+	bool m_bOk = false;
+
+	// nominal beam directions: source->mono, mono->sample, sample->ana, ana->det
+	t_vec3 m_axes[4];
+
+	// positions in cm
+	t_vec3 m_posSrc, m_posSample, m_posDet;
+	Crystal m_mono, m_ana;
+
+	// nominal direction of Q at the sample
+	t_vec3 m_dirQ;
+
+	// source, sample and detector dimensions in cm
+	t_real m_src_w = 0, m_src_h = 0;
+	t_real m_sample_wq = 0, m_sample_wperpq = 0, m_sample_h = 0;
+	t_real m_det_w = 0, m_det_h = 0;
+
+	// nominal distances in cm
+	t_real m_dist[4];
+
+	// collimations (fwhm) in rad, <= 0: open
+	t_real m_coll_h[4], m_coll_v[4];
+	t_real m_guide_div_h = 0, m_guide_div_v = 0;      // in rad/A
+	t_real m_sig_sample_h = 0, m_sig_sample_v = 0;
+
+protected:
+	std::size_t TraceBlock(std::mt19937& rnd, std::size_t iNum,
+		bool bMonoMosaic, bool bAnaMosaic, TasTracerResult& res) const;
+
+public:
+	TasTracer(const EckParams& params, const TasTracerOpts& opts = TasTracerOpts{});
+
+	bool IsOk() const { return m_bOk; }
+	TasTracerResult Trace() const;
+};
+
+
+#endif
@@ -0,0 +1,635 @@
+/**
+ * instrument configuration planner for lists of target (Q, E) points
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "planner.h"
+
+#include "tlibs/file/prop.h"
+#include "tlibs/phys/lattice.h"
+#include "tlibs/phys/neutrons.h"
+#include "tlibs/math/math.h"
+#include "tlibs/helper/thread.h"
+#include "tlibs/string/string.h"
+#include "tlibs/log/log.h"
+#include "libs/globals.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+using t_real = InstrPlanner::t_real;
+using t_vec = ublas::vector<t_real>;
+
+static const auto angs = tl::get_one_angstrom<t_real>();
+static const auto rads = tl::get_one_radian<t_real>();
+
+
+
+// ----------------------------------------------------------------------------
+// setup
+
+const char* InstrPlanner::GetStatusName(PlannerStatus status)
+{
+	switch(status)
+	{
+		case PlannerStatus::OK: return "ok";
+		case PlannerStatus::KINEMATICS: return "kinematics";
+		case PlannerStatus::ANGLE_LIMIT: return "angle_limit";
+		case PlannerStatus::DARK_ANGLE: return "dark_angle";
+		case PlannerStatus::RESOLUTION: return "resolution";
+		case PlannerStatus::SPURION: return "spurion";
+	}
+
+	return "unknown";
+}
+
+
+/**
+ * short description, e.g. "kf=1.4,m1,a1,s-"
+ */
+std::string InstrPlanner::GetConfigName(const PlannerConfig& cfg)
+{
+	std::ostringstream ostr;
+	ostr.precision(g_iPrec);
+	ostr << (cfg.kifix ? "ki=" : "kf=") << cfg.kfix
+		<< ",m" << cfg.order_mono << ",a" << cfg.order_ana
+		<< ",s" << (cfg.sense_sample < t_real(0) ? "-" : "+");
+	return ostr.str();
+}
+
+
+/**
+ * loads the dark angles from a Takin file, as saved by the dark angles dialog
+ */
+bool InstrPlanner::LoadDarkAngles(const std::string& strFile)
+{
+	const std::string strXmlRoot("taz/");
+
+	tl::Prop<std::string> xml;
+	if(!xml.Load(strFile, tl::PropType::XML))
+	{
+		tl::log_err("Cannot load dark angles from \"", strFile, "\".");
+		return false;
+	}
+
+	const unsigned int iNum = xml.Query<unsigned int>(strXmlRoot + "darkangles/num", 0);
+	for(unsigned int iAngle=0; iAngle<iNum; ++iAngle)
+	{
+		const std::string strNr = strXmlRoot + "darkangles/" + tl::var_to_str(iAngle);
+
+		PlannerDarkAngle angle;
+		angle.start = xml.Query<t_real>(strNr + "/start", 0.);
+		angle.end = xml.Query<t_real>(strNr + "/end", 0.);
+		angle.offs = xml.Query<t_real>(strNr + "/offs", 0.);
+		angle.centre_on = xml.Query<int>(strNr + "/centreon", 1);
+		angle.relative_to = xml.Query<int>(strNr + "/relativeto", 0);
+		m_vecDarkAngles.push_back(angle);
+	}
+
+	tl::log_info("Loaded ", iNum, " dark angle range(s).");
+	return true;
+}
+
+
+/**
+ * adds the combinations of the given fixed wavenumbers, crystal orders and sample senses,
+ * the monochromator and analyser senses are taken from the instrument file
+ */
+void InstrPlanner::AddConfigs(const std::vector<t_real>& vecK, bool bKi, bool bKf,
+	const std::vector<unsigned int>& vecMonoOrders, const std::vector<unsigned int>& vecAnaOrders,
+	bool bBothSampleSenses)
+{
+	const EckParams& params = m_screener.GetReso().GetResoParams();
+
+	std::vector<bool> vecKiFix;
+	if(bKi) vecKiFix.push_back(true);
+	if(bKf) vecKiFix.push_back(false);
+
+	std::vector<t_real> vecSenses{ params.dsample_sense };
+	if(bBothSampleSenses)
+		vecSenses.push_back(-params.dsample_sense);
+
+	for(bool bKiFix : vecKiFix)
+	for(t_real dK : vecK)
+	for(unsigned int iMono : vecMonoOrders)
+	for(unsigned int iAna : vecAnaOrders)
+	for(t_real dSense : vecSenses)
+	{
+		PlannerConfig cfg;
+		cfg.kifix = bKiFix;
+		cfg.kfix = dK;
+		cfg.order_mono = iMono ? iMono : 1;
+		cfg.order_ana = iAna ? iAna : 1;
+		cfg.sense_mono = params.dmono_sense;
+		cfg.sense_sample = dSense;
+		cfg.sense_ana = params.dana_sense;
+		m_vecConfigs.emplace_back(std::move(cfg));
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// evaluation
+
+/**
+ * tests if a beam passes through a dark angle range, see TasLayout::paint
+ *
+ * the beam is deflected by the signed scattering angles (in deg) at the
+ * monochromator, sample and analyser, with all angles counted counter-clockwise
+ */
+bool InstrPlanner::IsDark(const t_real* pAngles, t_real dSampleTheta) const
+{
+	// directions of the source-mono, mono-sample, sample-ana and ana-detector beams
+	t_real dDirs[4] = { 0, 0, 0, 0 };
+	for(int i=0; i<3; ++i)
+		dDirs[i+1] = dDirs[i] + pAngles[i];
+
+	const t_real dCrystalThetas[3] = { pAngles[0]/t_real(2), dSampleTheta, pAngles[2]/t_real(2) };
+
+	for(const PlannerDarkAngle& angle : m_vecDarkAngles)
+	{
+		if(angle.centre_on < 0 || angle.centre_on > 2)
+			continue;
+
+		const t_real dIn = dDirs[angle.centre_on];
+		const t_real dOut = dDirs[angle.centre_on + 1];
+
+		t_real dAbsOffs = dIn + dCrystalThetas[angle.centre_on];
+		if(angle.relative_to == 1)
+			dAbsOffs = dIn;
+		else if(angle.relative_to == 2)
+			dAbsOffs = dOut;
+
+		const t_real dStart = angle.start + angle.offs + dAbsOffs;
+		const t_real dRange = angle.end - angle.start;
+
+		// incoming beam, seen from the axis, and outgoing beam
+		for(t_real dBeam : { dIn + t_real(180), dOut })
+		{
+			if(tl::is_in_angular_range<t_real>(tl::d2r(std::fmod(dStart, t_real(360))),
+				tl::d2r(dRange), tl::d2r(std::fmod(dBeam, t_real(360)))))
+				return true;
+		}
+	}
+
+	return false;
+}
+
+
+/**
+ * evaluates the configuration set in reso at a target point
+ */
+void InstrPlanner::EvalPoint(const SpurionScan& scan, std::size_t iScan, std::size_t iPt,
+	TASReso& reso, const std::vector<SpurionPowderLine>& vecLines, PlannerEval& eval) const
+{
+	const std::array<t_real, 4>& pt = scan.points[iPt];
+	const EckParams& params = reso.GetResoParams();
+
+	// kinematics
+	const t_real dK2 = scan.kfix*scan.kfix + (scan.kifix ? -pt[3] : pt[3]) / tl::get_KSQ2E<t_real>();
+	if(dK2 <= t_real(0))
+	{
+		eval.status = PlannerStatus::KINEMATICS;
+		return;
+	}
+
+	const t_real dKi = scan.kifix ? scan.kfix : std::sqrt(dK2);
+	const t_real dKf = scan.kifix ? std::sqrt(dK2) : scan.kfix;
+	t_real dSampleTheta = 0;
+
+	try
+	{
+		const tl::Lattice<t_real> latt(scan.lattice[0], scan.lattice[1], scan.lattice[2],
+			tl::d2r(scan.lattice[3]), tl::d2r(scan.lattice[4]), tl::d2r(scan.lattice[5]));
+
+		eval.angles[0] = tl::r2d(t_real(tl::get_mono_twotheta(dKi/angs, params.mono_d,
+			params.dmono_sense >= t_real(0)) / rads));
+		eval.angles[2] = tl::r2d(t_real(tl::get_mono_twotheta(dKf/angs, params.ana_d,
+			params.dana_sense >= t_real(0)) / rads));
+
+		t_real dSample2Theta = 0;
+		tl::get_tas_angles(latt,
+			tl::make_vec<t_vec>({scan.plane1[0], scan.plane1[1], scan.plane1[2]}),
+			tl::make_vec<t_vec>({scan.plane2[0], scan.plane2[1], scan.plane2[2]}),
+			dKi, dKf, pt[0], pt[1], pt[2],
+			params.dsample_sense >= t_real(0),
+			&dSampleTheta, &dSample2Theta);
+		eval.angles[1] = tl::r2d(dSample2Theta);
+		dSampleTheta = tl::r2d(dSampleTheta);
+	}
+	catch(const std::exception&)
+	{
+		eval.status = PlannerStatus::KINEMATICS;
+		return;
+	}
+
+	for(t_real dAngle : eval.angles)
+	{
+		if(tl::is_nan_or_inf<t_real>(dAngle))
+		{
+			eval.status = PlannerStatus::KINEMATICS;
+			return;
+		}
+	}
+
+	// angle limits
+	const std::array<t_real, 2>* pLimits[3] = { &m_limits.mono2th, &m_limits.sample2th, &m_limits.ana2th };
+	for(int i=0; i<3; ++i)
+	{
+		const t_real dAngle = std::abs(eval.angles[i]);
+		if(dAngle < (*pLimits[i])[0] || dAngle > (*pLimits[i])[1])
+		{
+			eval.status = PlannerStatus::ANGLE_LIMIT;
+			return;
+		}
+	}
+
+	if(IsDark(eval.angles, dSampleTheta))
+	{
+		eval.status = PlannerStatus::DARK_ANGLE;
+		return;
+	}
+
+	// resolution and spurions
+	if(m_bAvoidSpurions)
+	{
+		std::vector<SpurionHit> vecHits;
+		m_screener.ScreenPoint(scan, iScan, iPt, reso, vecLines, vecHits);
+
+		// the nominal Bragg peak does not depend on the configuration
+		eval.spurions = std::count_if(vecHits.begin(), vecHits.end(),
+			[](const SpurionHit& hit) -> bool { return hit.type != SpurionType::BRAGG; });
+	}
+	else
+	{
+		reso.SetHKLE(pt[0], pt[1], pt[2], pt[3]);
+	}
+
+	const ResoResults& res = reso.GetResoResults();
+	eval.R0 = res.dR0 * reso.GetR0Scale();
+	eval.vol = res.dResVol;
+	std::copy(res.dBraggFWHMs, res.dBraggFWHMs + 4, eval.fwhm);
+
+	if(!res.bOk || eval.R0 <= t_real(0) || tl::is_nan_or_inf<t_real>(eval.R0))
+	{
+		eval.status = PlannerStatus::RESOLUTION;
+		return;
+	}
+
+	if((m_dMaxFwhmE >= t_real(0) && eval.fwhm[3] > m_dMaxFwhmE) ||
+		(m_dMaxFwhmQ >= t_real(0) && eval.fwhm[0] > m_dMaxFwhmQ))
+	{
+		eval.status = PlannerStatus::RESOLUTION;
+		return;
+	}
+
+	eval.status = eval.spurions ? PlannerStatus::SPURION : PlannerStatus::OK;
+}
+
+
+/**
+ * evaluates all configurations at all target points in parallel
+ */
+InstrPlanner::t_evals InstrPlanner::Evaluate() const
+{
+	const std::vector<SpurionScan>& vecScans = m_screener.GetScans();
+
+	const unsigned int iNumThreads = std::max<unsigned int>(1,
+		m_screener.GetMaxThreads() ? m_screener.GetMaxThreads() : get_max_threads());
+	tl::log_debug("Evaluating ", m_vecConfigs.size(), " configuration(s) at ",
+		m_screener.GetNumPoints(), " point(s) using ", iNumThreads,
+		(iNumThreads == 1 ? " thread." : " threads."));
+
+	// one task per configuration and scan
+	using t_task = std::vector<PlannerEval>;
+	tl::ThreadPool<t_task()> tp(iNumThreads);
+
+	for(std::size_t iCfg=0; iCfg<m_vecConfigs.size(); ++iCfg)
+	for(std::size_t iScan=0; iScan<vecScans.size(); ++iScan)
+	{
+		tp.AddTask([this, &vecScans, iCfg, iScan]() -> t_task
+		{
+			const PlannerConfig& cfg = m_vecConfigs[iCfg];
+
+			SpurionScan scan = vecScans[iScan];
+			scan.kifix = cfg.kifix;
+			scan.kfix = cfg.kfix;
+
+			TASReso reso = m_screener.GetReso();
+			EckParams& params = reso.GetResoParams();
+			params.mono_d /= t_real(cfg.order_mono);
+			params.ana_d /= t_real(cfg.order_ana);
+			params.dmono_sense = cfg.sense_mono;
+			params.dsample_sense = cfg.sense_sample;
+			params.dana_sense = cfg.sense_ana;
+
+			reso.SetKiFix(scan.kifix);
+			reso.SetKFix(scan.kfix);
+			reso.SetLattice(scan.lattice[0], scan.lattice[1], scan.lattice[2],
+				tl::d2r(scan.lattice[3]), tl::d2r(scan.lattice[4]), tl::d2r(scan.lattice[5]),
+				tl::make_vec<t_vec>({scan.plane1[0], scan.plane1[1], scan.plane1[2]}),
+				tl::make_vec<t_vec>({scan.plane2[0], scan.plane2[1], scan.plane2[2]}));
+
+			std::vector<SpurionPowderLine> vecLines;
+			if(m_bAvoidSpurions)
+				vecLines = m_screener.GetScanPowderLines(scan);
+
+			t_task vecEvals(scan.points.size());
+			for(std::size_t iPt=0; iPt<scan.points.size(); ++iPt)
+			{
+				try
+				{
+					EvalPoint(scan, iScan, iPt, reso, vecLines, vecEvals[iPt]);
+				}
+				catch(const std::exception& ex)
+				{
+					vecEvals[iPt].status = PlannerStatus::RESOLUTION;
+					tl::log_err("Cannot evaluate point ", iPt+1, " of scan \"", scan.name,
+						"\" with configuration ", GetConfigName(cfg), ": ", ex.what());
+				}
+			}
+
+			return vecEvals;
+		});
+	}
+
+	tp.Start();
+
+	t_evals evals(m_vecConfigs.size());
+	auto& lstResults = tp.GetResults();
+	auto iterResult = lstResults.begin();
+	for(std::size_t iCfg=0; iCfg<m_vecConfigs.size(); ++iCfg)
+	{
+		evals[iCfg].reserve(vecScans.size());
+		for(std::size_t iScan=0; iScan<vecScans.size(); ++iScan, ++iterResult)
+			evals[iCfg].emplace_back(iterResult->get());
+	}
+
+	// monitor counts relative to the best configuration at each point, the monitor counts
+	// for a given statistical accuracy are inversely proportional to the monitor-normalised R0
+	for(std::size_t iScan=0; iScan<vecScans.size(); ++iScan)
+	{
+		for(std::size_t iPt=0; iPt<vecScans[iScan].points.size(); ++iPt)
+		{
+			t_real dBestR0 = 0;
+			for(std::size_t iCfg=0; iCfg<m_vecConfigs.size(); ++iCfg)
+			{
+				const PlannerEval& eval = evals[iCfg][iScan][iPt];
+				if(eval.status == PlannerStatus::OK)
+					dBestR0 = std::max(dBestR0, eval.R0);
+			}
+
+			for(std::size_t iCfg=0; iCfg<m_vecConfigs.size(); ++iCfg)
+			{
+				PlannerEval& eval = evals[iCfg][iScan][iPt];
+				if(eval.R0 > t_real(0) && dBestR0 > t_real(0))
+					eval.mon = dBestR0 / eval.R0;
+			}
+		}
+	}
+
+	return evals;
+}
+
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// ranking
+
+/**
+ * ranks the configurations for a whole scan: configurations which can measure
+ * all points come first, ordered by their total monitor counts
+ */
+std::vector<PlannerScanRank> InstrPlanner::RankScan(const t_evals& evals, std::size_t iScan) const
+{
+	std::vector<PlannerScanRank> vecRanks;
+	vecRanks.reserve(m_vecConfigs.size());
+
+	for(std::size_t iCfg=0; iCfg<m_vecConfigs.size(); ++iCfg)
+	{
+		PlannerScanRank rank;
+		rank.config = iCfg;
+
+		for(const PlannerEval& eval : evals[iCfg][iScan])
+		{
+			if(eval.status != PlannerStatus::OK)
+				continue;
+
+			++rank.valid;
+			rank.mon += t_real(1) / eval.R0;
+			rank.fwhmE = std::max(rank.fwhmE, eval.fwhm[3]);
+			rank.fwhmQ = std::max(rank.fwhmQ, eval.fwhm[0]);
+		}
+
+		if(rank.valid)
+			vecRanks.emplace_back(std::move(rank));
+	}
+
+	std::stable_sort(vecRanks.begin(), vecRanks.end(),
+		[](const PlannerScanRank& rank1, const PlannerScanRank& rank2) -> bool
+	{
+		if(rank1.valid != rank2.valid)
+			return rank1.valid > rank2.valid;
+		return rank1.mon < rank2.mon;
+	});
+
+	// relative to the best configuration
+	if(vecRanks.size())
+	{
+		const t_real dBest = vecRanks[0].mon;
+		for(PlannerScanRank& rank : vecRanks)
+			rank.mon /= dBest;
+	}
+
+	return vecRanks;
+}
+
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// output
+
+/**
+ * writes the best configurations for each target point
+ */
+bool InstrPlanner::SavePointRanking(const std::string& strFile, const t_evals& evals, std::size_t iTop) const
+{
+	std::ofstream ofstr(strFile);
+	if(!ofstr)
+	{
+		tl::log_err("Cannot open output file \"", strFile, "\".");
+		return false;
+	}
+
+	const std::vector<SpurionScan>& vecScans = m_screener.GetScans();
+	const std::size_t iNumStatus = std::size_t(PlannerStatus::SPURION) + 1;
+
+	ofstr.precision(g_iPrec);
+	ofstr << "#\n# Best configurations per point, widths are FWHMs in 1/A and meV, angles in deg.\n"
+		<< "# mon: monitor counts for the same accuracy relative to the best configuration,\n"
+		<< "# this is a figure of merit per monitor count, not a counting time,"
+		<< " as the source flux at ki is not included.\n#\n";
+	ofstr << "# " << std::left
+		<< std::setw(24) << "scan" << " " << std::setw(6) << "point" << " "
+		<< std::setw(10) << "h" << " " << std::setw(10) << "k" << " "
+		<< std::setw(10) << "l" << " " << std::setw(10) << "E" << " "
+		<< std::setw(5) << "rank" << " " << std::setw(20) << "config" << " "
+		<< std::setw(12) << "mon" << " " << std::setw(12) << "R0" << " "
+		<< std::setw(12) << "dQ_para" << " " << std::setw(12) << "dE" << " "
+		<< std::setw(10) << "2th_M" << " " << std::setw(10) << "2th_S" << " "
+		<< "2th_A\n";
+
+	for(std::size_t iScan=0; iScan<vecScans.size(); ++iScan)
+	{
+		const SpurionScan& scan = vecScans[iScan];
+		for(std::size_t iPt=0; iPt<scan.points.size(); ++iPt)
+		{
+			const std::array<t_real, 4>& pt = scan.points[iPt];
+
+			std::vector<std::size_t> vecCfgs;
+			std::vector<std::size_t> vecStatusCount(iNumStatus, 0);
+			for(std::size_t iCfg=0; iCfg<m_vecConfigs.size(); ++iCfg)
+			{
+				const PlannerEval& eval = evals[iCfg][iScan][iPt];
+				++vecStatusCount[std::size_t(eval.status)];
+				if(eval.status == PlannerStatus::OK)
+					vecCfgs.push_back(iCfg);
+			}
+
+			std::stable_sort(vecCfgs.begin(), vecCfgs.end(),
+				[&evals, iScan, iPt](std::size_t iCfg1, std::size_t iCfg2) -> bool
+			{
+				return evals[iCfg1][iScan][iPt].mon < evals[iCfg2][iScan][iPt].mon;
+			});
+			if(iTop && vecCfgs.size() > iTop)
+				vecCfgs.resize(iTop);
+
+			auto write_point = [&]()
+			{
+				ofstr << "  " << std::left
+					<< std::setw(24) << scan.name << " " << std::setw(6) << (iPt+1) << " "
+					<< std::setw(10) << pt[0] << " " << std::setw(10) << pt[1] << " "
+					<< std::setw(10) << pt[2] << " " << std::setw(10) << pt[3] << " ";
+			};
+
+			// no usable configuration: give the most frequent reason
+			if(!vecCfgs.size())
+			{
+				const std::size_t iReason = std::max_element(vecStatusCount.begin(),
+					vecStatusCount.end()) - vecStatusCount.begin();
+
+				write_point();
+				ofstr << std::setw(5) << 0 << " " << "none (mostly "
+					<< GetStatusName(PlannerStatus(iReason)) << ")\n";
+				continue;
+			}
+
+			for(std::size_t iRank=0; iRank<vecCfgs.size(); ++iRank)
+			{
+				const PlannerEval& eval = evals[vecCfgs[iRank]][iScan][iPt];
+
+				write_point();
+				ofstr << std::setw(5) << (iRank+1) << " "
+					<< std::setw(20) << GetConfigName(m_vecConfigs[vecCfgs[iRank]]) << " "
+					<< std::setw(12) << eval.mon << " " << std::setw(12) << eval.R0 << " "
+					<< std::setw(12) << eval.fwhm[0] << " " << std::setw(12) << eval.fwhm[3] << " "
+					<< std::setw(10) << eval.angles[0] << " " << std::setw(10) << eval.angles[1] << " "
+					<< eval.angles[2] << "\n";
+			}
+		}
+	}
+
+	return true;
+}
+
+
+/**
+ * writes the best configurations for each scan
+ */
+bool InstrPlanner::SaveScanRanking(const std::string& strFile, const t_evals& evals, std::size_t iTop) const
+{
+	std::ofstream ofstr(strFile);
+	if(!ofstr)
+	{
+		tl::log_err("Cannot open output file \"", strFile, "\".");
+		return false;
+	}
+
+	const std::vector<SpurionScan>& vecScans = m_screener.GetScans();
+
+	ofstr.precision(g_iPrec);
+	ofstr << "#\n# Best configurations per scan, widths are the largest FWHMs of the scan in 1/A and meV.\n"
+		<< "# mon: total monitor counts for the same accuracy relative to the best configuration,\n"
+		<< "# this is a figure of merit per monitor count, not a counting time,"
+		<< " as the source flux at ki is not included.\n#\n";
+	ofstr << "# " << std::left
+		<< std::setw(24) << "scan" << " " << std::setw(5) << "rank" << " "
+		<< std::setw(20) << "config" << " " << std::setw(12) << "points" << " "
+		<< std::setw(12) << "mon" << " " << std::setw(12) << "dQ_para" << " "
+		<< "dE\n";
+
+	for(std::size_t iScan=0; iScan<vecScans.size(); ++iScan)
+	{
+		std::vector<PlannerScanRank> vecRanks = RankScan(evals, iScan);
+		if(iTop && vecRanks.size() > iTop)
+			vecRanks.resize(iTop);
+
+		if(!vecRanks.size())
+		{
+			ofstr << "  " << std::left << std::setw(24) << vecScans[iScan].name << " "
+				<< std::setw(5) << 0 << " " << "none\n";
+			continue;
+		}
+
+		for(std::size_t iRank=0; iRank<vecRanks.size(); ++iRank)
+		{
+			const PlannerScanRank& rank = vecRanks[iRank];
+			const std::string strPoints = tl::var_to_str(rank.valid) + "/" +
+				tl::var_to_str(vecScans[iScan].points.size());
+
+			ofstr << "  " << std::left
+				<< std::setw(24) << vecScans[iScan].name << " " << std::setw(5) << (iRank+1) << " "
+				<< std::setw(20) << GetConfigName(m_vecConfigs[rank.config]) << " "
+				<< std::setw(12) << strPoints << " " << std::setw(12) << rank.mon << " "
+				<< std::setw(12) << rank.fwhmQ << " " << rank.fwhmE << "\n";
+		}
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
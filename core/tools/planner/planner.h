@@ -0,0 +1,170 @@
+/**
+ * instrument configuration planner for lists of target (Q, E) points
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __TAKIN_PLANNER_H__
+#define __TAKIN_PLANNER_H__
+
+#include <string>
+#include <vector>
+#include <array>
+
+#include "../spurions/spurions.h"
+#include "../res/defs.h"
+
+
+/**
+ * a candidate instrument configuration
+ */
+struct PlannerConfig
+{
+	bool kifix = false;
+	t_real_reso kfix = 1.4;                  // in 1/A
+
+	// reflection orders of the monochromator and analyser crystals, e.g. 2 for PG(004)
+	unsigned int order_mono = 1, order_ana = 1;
+
+	// scattering senses, +1: counter-clockwise
+	t_real_reso sense_mono = 1, sense_sample = -1, sense_ana = 1;
+};
+
+
+/**
+ * a dark angle range around one of the axes, see DarkAngle in DarkAnglesDlg.h
+ */
+struct PlannerDarkAngle
+{
+	t_real_reso start = 0, end = 0, offs = 0;   // in deg
+	int centre_on = 1;                          // 0: mono, 1: sample, 2: ana
+	int relative_to = 0;                        // 0: crystal angle, 1: in axis, 2: out axis
+};
+
+
+/**
+ * allowed ranges of the absolute scattering angles, in deg
+ */
+struct PlannerLimits
+{
+	std::array<t_real_reso, 2> mono2th{{ 0, 180 }};
+	std::array<t_real_reso, 2> sample2th{{ 0, 180 }};
+	std::array<t_real_reso, 2> ana2th{{ 0, 180 }};
+};
+
+
+enum class PlannerStatus : unsigned int
+{
+	OK = 0,
+	KINEMATICS,         // scattering triangle cannot be closed
+	ANGLE_LIMIT,        // a scattering angle is outside its allowed range
+	DARK_ANGLE,         // a beam passes through a dark angle range
+	RESOLUTION,         // resolution calculation failed or requirements not met
+	SPURION,            // possible spurion at the point
+};
+
+
+/**
+ * a configuration evaluated at a target point
+ */
+struct PlannerEval
+{
+	PlannerStatus status = PlannerStatus::KINEMATICS;
+
+	t_real_reso angles[3] = { 0, 0, 0 };    // mono, sample and ana scattering angles, in deg
+	t_real_reso R0 = 0;                      // resolution prefactor
+	t_real_reso vol = 0;                     // resolution volume in 1/A^3 * meV
+	t_real_reso fwhm[4] = { 0, 0, 0, 0 };    // Bragg widths along Q_para, Q_perp, Q_up and E
+	unsigned int spurions = 0;               // number of spurion hits
+
+	// monitor counts for a given accuracy relative to the best configuration at the point,
+	// this is not a counting time, as R0 is normalised to the monitor (by default in the
+	// instrument files) and the flux of the source at ki is not modelled
+	t_real_reso mon = 0;
+};
+
+
+/**
+ * a configuration ranked for a whole scan
+ */
+struct PlannerScanRank
+{
+	std::size_t config = 0;
+	std::size_t valid = 0;                   // number of points the configuration can measure
+	t_real_reso mon = 0;                     // total monitor counts relative to the best configuration
+	t_real_reso fwhmE = 0, fwhmQ = 0;        // largest energy and longitudinal widths of the scan
+};
+
+
+class InstrPlanner
+{
+public:
+	using t_real = t_real_reso;
+
+	// evaluations per configuration, scan and point
+	using t_evals = std::vector<std::vector<std::vector<PlannerEval>>>;
+
+protected:
+	SpurionScreener m_screener;              // instrument, target points and spurion settings
+	std::vector<PlannerConfig> m_vecConfigs;
+	std::vector<PlannerDarkAngle> m_vecDarkAngles;
+	PlannerLimits m_limits;
+
+	t_real m_dMaxFwhmE = -1;                 // required energy resolution, < 0: any
+	t_real m_dMaxFwhmQ = -1;                 // required longitudinal Q resolution, < 0: any
+	bool m_bAvoidSpurions = true;
+
+protected:
+	bool IsDark(const t_real* pAngles, t_real dSampleTheta) const;
+	void EvalPoint(const SpurionScan& scan, std::size_t iScan, std::size_t iPt,
+		TASReso& reso, const std::vector<SpurionPowderLine>& vecLines, PlannerEval& eval) const;
+
+public:
+	static const char* GetStatusName(PlannerStatus status);
+	static std::string GetConfigName(const PlannerConfig& cfg);
+
+	SpurionScreener& GetScreener() { return m_screener; }
+	const SpurionScreener& GetScreener() const { return m_screener; }
+
+	bool LoadDarkAngles(const std::string& strFile);
+	void SetLimits(const PlannerLimits& limits) { m_limits = limits; }
+	void SetResolution(t_real dMaxFwhmE, t_real dMaxFwhmQ) { m_dMaxFwhmE = dMaxFwhmE; m_dMaxFwhmQ = dMaxFwhmQ; }
+	void SetAvoidSpurions(bool b) { m_bAvoidSpurions = b; }
+
+	void AddConfig(const PlannerConfig& cfg) { m_vecConfigs.push_back(cfg); }
+	void AddConfigs(const std::vector<t_real>& vecK, bool bKi, bool bKf,
+		const std::vector<unsigned int>& vecMonoOrders, const std::vector<unsigned int>& vecAnaOrders,
+		bool bBothSampleSenses);
+	const std::vector<PlannerConfig>& GetConfigs() const { return m_vecConfigs; }
+
+	t_evals Evaluate() const;
+	std::vector<PlannerScanRank> RankScan(const t_evals& evals, std::size_t iScan) const;
+
+	bool SavePointRanking(const std::string& strFile, const t_evals& evals, std::size_t iTop) const;
+	bool SaveScanRanking(const std::string& strFile, const t_evals& evals, std::size_t iTop) const;
+};
+
+
+#endif
@@ -0,0 +1,357 @@
+/**
+ * instrument configuration planner for lists of target (Q, E) points -- CLI program
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+// e.g. takin_planner --instr=instr.taz --crys=crys.taz --targets=beamtime.txt
+//      --k=1.4:2.662:8 --fix=both --ana-orders=1,2 --both-senses --dark=darkangles.taz
+//      --sample-2th=5:110 --max-dE=0.5 --env=Al --out=points.dat --out-scans=scans.dat
+
+#include <boost/program_options.hpp>
+
+#include <vector>
+#include <array>
+#include <string>
+
+#include "planner.h"
+#include "libs/globals.h"
+
+#include "tlibs/string/string.h"
+#include "tlibs/math/math.h"
+#include "tlibs/log/log.h"
+#include "tlibs/time/stopwatch.h"
+
+namespace opts = boost::program_options;
+
+using t_real = InstrPlanner::t_real;
+
+
+/**
+ * parses a list of values "v1,v2,..." or a range "min:max:num"
+ */
+template<class T>
+static bool parse_values(const std::string& strVals, std::vector<T>& vecVals)
+{
+	vecVals.clear();
+
+	if(strVals.find(':') != std::string::npos)
+	{
+		std::vector<t_real> vecToks;
+		tl::get_tokens<t_real, std::string>(strVals, ":", vecToks);
+		if(vecToks.size() != 3 || vecToks[2] < t_real(1))
+		{
+			tl::log_err("Invalid range \"", strVals, "\", expected \"min:max:num\".");
+			return false;
+		}
+
+		const std::size_t iNum = std::size_t(vecToks[2]);
+		for(std::size_t i=0; i<iNum; ++i)
+		{
+			const t_real dFrac = iNum > 1 ? t_real(i) / t_real(iNum-1) : t_real(0);
+			vecVals.push_back(T(tl::lerp(vecToks[0], vecToks[1], dFrac)));
+		}
+	}
+	else
+	{
+		tl::get_tokens<T, std::string>(strVals, ",; ", vecVals);
+	}
+
+	if(!vecVals.size())
+	{
+		tl::log_err("No values given in \"", strVals, "\".");
+		return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * parses an angular range "min:max" in deg
+ */
+static bool parse_limits(const std::string& strLimits, std::array<t_real, 2>& arrLimits)
+{
+	if(strLimits == "")
+		return true;
+
+	std::vector<t_real> vecToks;
+	tl::get_tokens<t_real, std::string>(strLimits, ":,", vecToks);
+	if(vecToks.size() != 2 || vecToks[1] < vecToks[0])
+	{
+		tl::log_err("Invalid angular range \"", strLimits, "\", expected \"min:max\".");
+		return false;
+	}
+
+	arrLimits[0] = vecToks[0];
+	arrLimits[1] = vecToks[1];
+	return true;
+}
+
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		tl::log_info("--------------------------------------------------------------------------------");
+		tl::log_info("This is the Takin instrument configuration planner.");
+		tl::log_info("Written by Tobias Weber <tweber@ill.fr>, 2026.");
+		tl::log_info("--------------------------------------------------------------------------------");
+
+		std::vector<std::string> vecInputs, vecTargets, vecEnv;
+		std::string strInstr, strCrys, strDark;
+		std::string strK, strFix = "both", strMonoOrders = "1", strAnaOrders = "1";
+		std::string strMono2th, strSample2th, strAna2th;
+		std::string strOut = "planner.dat", strOutScans;
+		t_real dMaxFwhmE = -1, dMaxFwhmQ = -1;
+		t_real dSigma = 2;
+		unsigned int iMaxOrder = 3;
+		std::size_t iTop = 5;
+		bool bBothSenses = false, bAllowSpurions = false;
+
+		opts::options_description args("planner options");
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("scan-files",
+			opts::value<decltype(vecInputs)>(&vecInputs),
+			"measured scan files whose points are used as targets")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("targets",
+			opts::value<decltype(vecTargets)>(&vecTargets),
+			"target scan list, one scan per line: \"h1 k1 l1 E1  h2 k2 l2 E2  steps  [name]\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("instr",
+			opts::value<decltype(strInstr)>(&strInstr),
+			"instrument file")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("crys",
+			opts::value<decltype(strCrys)>(&strCrys),
+			"crystal file for the target scans")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("dark",
+			opts::value<decltype(strDark)>(&strDark),
+			"Takin file with the dark angles")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("k",
+			opts::value<decltype(strK)>(&strK),
+			"fixed wavenumbers in 1/A, \"k1,k2,...\" or \"min:max:num\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("fix",
+			opts::value<decltype(strFix)>(&strFix),
+			"fixed wavenumber: \"ki\", \"kf\" or \"both\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("mono-orders",
+			opts::value<decltype(strMonoOrders)>(&strMonoOrders),
+			"monochromator reflection orders, e.g. \"1,2\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("ana-orders",
+			opts::value<decltype(strAnaOrders)>(&strAnaOrders),
+			"analyser reflection orders, e.g. \"1,2\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("both-senses",
+			opts::bool_switch(&bBothSenses),
+			"also try the opposite sample scattering sense")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("mono-2th",
+			opts::value<decltype(strMono2th)>(&strMono2th),
+			"allowed monochromator scattering angles in deg, \"min:max\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("sample-2th",
+			opts::value<decltype(strSample2th)>(&strSample2th),
+			"allowed sample scattering angles in deg, \"min:max\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("ana-2th",
+			opts::value<decltype(strAna2th)>(&strAna2th),
+			"allowed analyser scattering angles in deg, \"min:max\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("max-dE",
+			opts::value<decltype(dMaxFwhmE)>(&dMaxFwhmE),
+			"required energy resolution (FWHM) in meV")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("max-dQ",
+			opts::value<decltype(dMaxFwhmQ)>(&dMaxFwhmQ),
+			"required longitudinal Q resolution (FWHM) in 1/A")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("allow-spurions",
+			opts::bool_switch(&bAllowSpurions),
+			"do not reject configurations with possible spurions")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("env",
+			opts::value<decltype(vecEnv)>(&vecEnv),
+			"sample environment material for the spurion check, e.g. \"Al\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("max-order",
+			opts::value<decltype(iMaxOrder)>(&iMaxOrder),
+			"highest monochromator and analyser harmonic for the spurion check")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("sigma",
+			opts::value<decltype(dSigma)>(&dSigma),
+			"spurion overlap cutoff in units of the resolution sigma")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("top",
+			opts::value<decltype(iTop)>(&iTop),
+			"number of configurations to list per point and scan, 0: all")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("out",
+			opts::value<decltype(strOut)>(&strOut),
+			"output file for the ranking per point")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("out-scans",
+			opts::value<decltype(strOutScans)>(&strOutScans),
+			"output file for the ranking per scan")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("max-threads",
+			opts::value<decltype(g_iMaxThreads)>(&g_iMaxThreads),
+			"maximum number of threads")));
+
+		opts::positional_options_description args_pos;
+		args_pos.add("scan-files", -1);
+
+		opts::basic_command_line_parser<char> clparser(argc, argv);
+		clparser.options(args);
+		clparser.positional(args_pos);
+		opts::basic_parsed_options<char> parsedopts = clparser.run();
+
+		opts::variables_map opts_map;
+		opts::store(parsedopts, opts_map);
+		opts::notify(opts_map);
+
+		if(argc <= 1)
+		{
+			std::ostringstream ostrHelp;
+			ostrHelp << "Usage: " << argv[0] << " [options] <scan files>\n";
+			ostrHelp << args;
+			tl::log_info(ostrHelp.str());
+			return -1;
+		}
+
+
+		// --------------------------------------------------------------------
+		// instrument, targets and spurion settings
+		InstrPlanner planner;
+		SpurionScreener& screener = planner.GetScreener();
+		screener.SetMaxOrder(iMaxOrder);
+		screener.SetSigma(dSigma);
+		planner.SetAvoidSpurions(!bAllowSpurions);
+		planner.SetResolution(dMaxFwhmE, dMaxFwhmQ);
+
+		const std::string strInstrFile = find_file_in_global_paths(strInstr);
+		if(strInstrFile == "" || !screener.LoadInstrument(strInstrFile))
+		{
+			tl::log_err("Could not load instrument file \"", strInstr, "\".");
+			return -1;
+		}
+
+		for(const std::string& strEnv : vecEnv)
+		{
+			if(!screener.AddEnvironment(strEnv))
+				return -1;
+		}
+
+		for(const std::string& strFile : vecInputs)
+			screener.AddScanFile(strFile);
+
+		for(const std::string& strFile : vecTargets)
+		{
+			if(!screener.AddPlannedScans(strFile, find_file_in_global_paths(strCrys)))
+				return -1;
+		}
+
+		if(screener.GetNumPoints() == 0)
+		{
+			tl::log_err("No target points given.");
+			return -1;
+		}
+
+		if(strDark != "")
+		{
+			const std::string strDarkFile = find_file_in_global_paths(strDark);
+			if(strDarkFile == "" || !planner.LoadDarkAngles(strDarkFile))
+				return -1;
+		}
+
+		PlannerLimits limits;
+		if(!parse_limits(strMono2th, limits.mono2th) ||
+			!parse_limits(strSample2th, limits.sample2th) ||
+			!parse_limits(strAna2th, limits.ana2th))
+			return -1;
+		planner.SetLimits(limits);
+		// --------------------------------------------------------------------
+
+
+		// --------------------------------------------------------------------
+		// candidate configurations
+		std::vector<t_real> vecK;
+		if(strK == "")
+			vecK.push_back(screener.GetReso().GetResoParams().kf * tl::get_one_angstrom<t_real>());
+		else if(!parse_values(strK, vecK))
+			return -1;
+
+		std::vector<unsigned int> vecMonoOrders, vecAnaOrders;
+		if(!parse_values(strMonoOrders, vecMonoOrders) || !parse_values(strAnaOrders, vecAnaOrders))
+			return -1;
+
+		const bool bKi = (strFix == "ki" || strFix == "both");
+		const bool bKf = (strFix == "kf" || strFix == "both");
+		if(!bKi && !bKf)
+		{
+			tl::log_err("Invalid fixed wavenumber \"", strFix, "\".");
+			return -1;
+		}
+
+		planner.AddConfigs(vecK, bKi, bKf, vecMonoOrders, vecAnaOrders, bBothSenses);
+		// --------------------------------------------------------------------
+
+
+		// --------------------------------------------------------------------
+		// evaluate and rank
+		tl::Stopwatch<t_real> watch;
+		watch.start();
+
+		InstrPlanner::t_evals evals = planner.Evaluate();
+
+		watch.stop();
+		tl::log_info("Evaluated ", planner.GetConfigs().size(), " configuration(s) at ",
+			screener.GetNumPoints(), " point(s) in ", tl::get_duration_str_secs<t_real>(watch.GetDur()), ".");
+
+		if(!planner.SavePointRanking(strOut, evals, iTop))
+			return -1;
+		tl::log_info("Wrote ranking per point to \"", strOut, "\".");
+
+		if(strOutScans != "")
+		{
+			if(!planner.SaveScanRanking(strOutScans, evals, iTop))
+				return -1;
+			tl::log_info("Wrote ranking per scan to \"", strOutScans, "\".");
+		}
+		// --------------------------------------------------------------------
+	}
+	catch(const std::exception& ex)
+	{
+		tl::log_crit(ex.what());
+		return -1;
+	}
+
+	return 0;
+}
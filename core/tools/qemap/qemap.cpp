@@ -0,0 +1,679 @@
+/**
+ * assembles (h,k,l,E) or (|Q|,E) intensity maps from scan files
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "qemap.h"
+
+#include "tlibs/file/loadinstr.h"
+#include "tlibs/phys/lattice.h"
+#include "tlibs/phys/neutrons.h"
+#include "tlibs/helper/thread.h"
+#include "tlibs/log/log.h"
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <tuple>
+#include <algorithm>
+#include <cmath>
+
+namespace fs = boost::filesystem;
+namespace sys = boost::system;
+
+using t_real = QEMap::t_real;
+
+
+// magic string at the beginning of map files
+static const std::string g_strMagic = "takin_qemap_ver1";
+
+
+
+// ----------------------------------------------------------------------------
+// bins
+
+QEMapBin& QEMapBin::operator+=(const QEMapBin& bin)
+{
+	cts += bin.cts;
+	mon += bin.mon;
+	var += bin.var;
+	pts += bin.pts;
+	return *this;
+}
+
+
+QEMapBin& QEMapBin::operator-=(const QEMapBin& bin)
+{
+	cts -= bin.cts;
+	mon -= bin.mon;
+	var -= bin.var;
+	pts -= std::min(pts, bin.pts);
+	return *this;
+}
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// histogram
+
+QEMap::QEMap(QEMapMode mode, const std::vector<QEMapAxis>& vecAxes)
+	: m_mode{mode}, m_vecAxes{vecAxes}
+{
+	if(m_vecAxes.size() != GetNumAxes(m_mode))
+	{
+		tl::log_err("Expected ", GetNumAxes(m_mode), " axes for the map, but got ", m_vecAxes.size(), ".");
+		m_vecAxes.resize(GetNumAxes(m_mode));
+	}
+}
+
+
+/**
+ * linear index of the bin containing the given coordinates, the last axis is the fastest
+ */
+bool QEMap::GetBinIndex(const std::vector<t_real>& vecCoords, std::size_t& iIdx) const
+{
+	iIdx = 0;
+
+	for(std::size_t iAxis=0; iAxis<m_vecAxes.size(); ++iAxis)
+	{
+		const QEMapAxis& axis = m_vecAxes[iAxis];
+		const t_real dCoord = vecCoords[iAxis];
+
+		if(!(dCoord >= axis.min && dCoord < axis.max))
+			return false;
+
+		std::size_t iBin = std::size_t((dCoord - axis.min) / axis.GetStep());
+		if(iBin >= axis.bins)
+			iBin = axis.bins - 1;
+
+		iIdx = iIdx*axis.bins + iBin;
+	}
+
+	return true;
+}
+
+
+std::vector<t_real> QEMap::GetBinCentre(std::size_t iIdx) const
+{
+	std::vector<t_real> vecCoords(m_vecAxes.size());
+
+	for(std::size_t _iAxis=m_vecAxes.size(); _iAxis>0; --_iAxis)
+	{
+		const QEMapAxis& axis = m_vecAxes[_iAxis-1];
+		vecCoords[_iAxis-1] = axis.GetCentre(iIdx % axis.bins);
+		iIdx /= axis.bins;
+	}
+
+	return vecCoords;
+}
+
+
+/**
+ * monitor-normalised intensity and its error
+ */
+std::pair<t_real, t_real> QEMap::GetIntensity(const QEMapBin& bin) const
+{
+	if(bin.mon <= t_real(0))
+		return std::make_pair(t_real(0), t_real(0));
+
+	const t_real dI = bin.cts / bin.mon * m_dMonScale;
+	const t_real dErr = std::sqrt(std::abs(bin.var)) / bin.mon * m_dMonScale;
+	return std::make_pair(dI, dErr);
+}
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// scan files
+
+/**
+ * loads a scan file and bins its points
+ */
+bool QEMap::LoadScan(const std::string& strFile, FileEntry& entry, std::size_t& iNumOutside) const
+{
+	std::unique_ptr<tl::FileInstrBase<t_real>> pInstr(
+		tl::FileInstrBase<t_real>::LoadInstr(strFile.c_str()));
+	if(!pInstr)
+	{
+		tl::log_err("Cannot load scan file \"", strFile, "\".");
+		return false;
+	}
+
+	const std::string strCtr = m_strCtrCol != "" ? m_strCtrCol : pInstr->GetCountVar();
+	const std::string strMon = m_strMonCol != "" ? m_strMonCol : pInstr->GetMonVar();
+
+	const tl::FileInstrBase<t_real>::t_vecVals& vecCts = pInstr->GetCol(strCtr);
+	const tl::FileInstrBase<t_real>::t_vecVals& vecMon = pInstr->GetCol(strMon);
+	const std::size_t iNumPts = pInstr->GetScanCount();
+
+	if(vecCts.size() < iNumPts || vecMon.size() < iNumPts)
+	{
+		tl::log_err("Counter column \"", strCtr, "\" or monitor column \"", strMon,
+			"\" not found in scan file \"", strFile, "\".");
+		return false;
+	}
+
+
+	// reciprocal lattice of the scan for the |Q| values
+	const std::array<t_real, 3> latt = pInstr->GetSampleLattice();
+	const std::array<t_real, 3> ang = pInstr->GetSampleAngles();
+	const tl::Lattice<t_real> lattRecip = tl::Lattice<t_real>(
+		latt[0], latt[1], latt[2], ang[0], ang[1], ang[2]).GetRecip();
+
+	std::vector<t_real> vecCoords(m_vecAxes.size());
+	std::unordered_map<std::size_t, QEMapBin> bins;
+
+	for(std::size_t iPt=0; iPt<iNumPts; ++iPt)
+	{
+		if(vecMon[iPt] <= t_real(0))
+			continue;
+
+		// h, k, l, ki, kf
+		const std::array<t_real, 5> sc = pInstr->GetScanHKLKiKf(iPt);
+		const t_real dE = tl::get_KSQ2E<t_real>() * (sc[3]*sc[3] - sc[4]*sc[4]);
+
+		if(m_mode == QEMapMode::QE)
+		{
+			vecCoords[0] = boost::numeric::ublas::norm_2(lattRecip.GetPos(sc[0], sc[1], sc[2]));
+			vecCoords[1] = dE;
+		}
+		else
+		{
+			vecCoords[0] = sc[0];
+			vecCoords[1] = sc[1];
+			vecCoords[2] = sc[2];
+			vecCoords[3] = dE;
+		}
+
+		std::size_t iIdx = 0;
+		if(!GetBinIndex(vecCoords, iIdx))
+		{
+			++iNumOutside;
+			continue;
+		}
+
+		QEMapBin& bin = bins[iIdx];
+		bin.cts += vecCts[iPt];
+		bin.mon += vecMon[iPt];
+		// same counting error convention as for the fits
+		bin.var += tl::float_equal<t_real>(vecCts[iPt], 0.) ? t_real(1) : std::abs(vecCts[iPt]);
+		++bin.pts;
+	}
+
+	entry.contribs.assign(bins.begin(), bins.end());
+	std::sort(entry.contribs.begin(), entry.contribs.end(),
+		[](const std::pair<std::size_t, QEMapBin>& bin1, const std::pair<std::size_t, QEMapBin>& bin2) -> bool
+		{ return bin1.first < bin2.first; });
+
+	return true;
+}
+
+
+/**
+ * loads the new or modified scan files in parallel and adds them to the map
+ * @return number of (re-)loaded files
+ */
+std::size_t QEMap::AddFiles(const std::vector<std::string>& vecFiles)
+{
+	// only load files which are new or have changed since they were added
+	std::vector<std::pair<std::string, std::time_t>> vecToLoad;
+	for(const std::string& _strFile : vecFiles)
+	{
+		sys::error_code err;
+		const std::string strFile = fs::absolute(_strFile).string();
+		const std::time_t mtime = fs::last_write_time(strFile, err);
+		if(err)
+		{
+			tl::log_err("Cannot access scan file \"", strFile, "\".");
+			continue;
+		}
+
+		auto iter = m_files.find(strFile);
+		if(iter != m_files.end() && iter->second.mtime == mtime)
+			continue;
+
+		vecToLoad.emplace_back(std::make_pair(strFile, mtime));
+	}
+
+	if(!vecToLoad.size())
+		return 0;
+
+
+	using t_task = std::tuple<bool, FileEntry, std::size_t>;
+	const unsigned int iNumThreads = std::max<unsigned int>(1,
+		m_iMaxThreads ? m_iMaxThreads : get_max_threads());
+	tl::log_debug("Loading ", vecToLoad.size(), " scan file(s) using ", iNumThreads,
+		(iNumThreads == 1 ? " thread." : " threads."));
+
+	tl::ThreadPool<t_task()> tp(iNumThreads);
+	for(const auto& pairFile : vecToLoad)
+	{
+		tp.AddTask([this, pairFile]() -> t_task
+		{
+			FileEntry entry;
+			entry.mtime = pairFile.second;
+			std::size_t iNumOutside = 0;
+			bool bOk = LoadScan(pairFile.first, entry, iNumOutside);
+			return std::make_tuple(bOk, std::move(entry), iNumOutside);
+		});
+	}
+	tp.Start();
+
+
+	// accumulate the binned scans in the order they were given
+	std::size_t iNumLoaded = 0, iNumOutside = 0;
+	auto iterFile = vecToLoad.begin();
+	for(auto& fut : tp.GetResults())
+	{
+		const std::string& strFile = (iterFile++)->first;
+
+		t_task result = fut.get();
+		if(!std::get<0>(result))
+			continue;
+
+		// replace a previous version of the file
+		RemoveFile(strFile);
+
+		FileEntry& entry = std::get<1>(result);
+		for(const auto& pairBin : entry.contribs)
+			m_bins[pairBin.first] += pairBin.second;
+		m_files[strFile] = std::move(entry);
+
+		iNumOutside += std::get<2>(result);
+		++iNumLoaded;
+	}
+
+	if(iNumOutside)
+		tl::log_warn(iNumOutside, " scan point(s) are outside the map range.");
+
+	return iNumLoaded;
+}
+
+
+/**
+ * removes the contributions of a scan file
+ */
+bool QEMap::RemoveFile(const std::string& strFile)
+{
+	auto iterFile = m_files.find(strFile);
+	if(iterFile == m_files.end())
+		return false;
+
+	for(const auto& pairBin : iterFile->second.contribs)
+	{
+		auto iterBin = m_bins.find(pairBin.first);
+		if(iterBin == m_bins.end())
+			continue;
+
+		iterBin->second -= pairBin.second;
+		if(iterBin->second.pts == 0)
+			m_bins.erase(iterBin);
+	}
+
+	m_files.erase(iterFile);
+	return true;
+}
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// binary map files
+
+template<class T>
+static void write_val(std::ostream& ostr, const T& val)
+{
+	ostr.write(reinterpret_cast<const char*>(&val), sizeof(T));
+}
+
+
+template<class T>
+static T read_val(std::istream& istr)
+{
+	T val{};
+	istr.read(reinterpret_cast<char*>(&val), sizeof(T));
+	return val;
+}
+
+
+static void write_str(std::ostream& ostr, const std::string& str)
+{
+	write_val<std::uint64_t>(ostr, str.size());
+	ostr.write(str.data(), str.size());
+}
+
+
+static std::string read_str(std::istream& istr)
+{
+	std::string str(read_val<std::uint64_t>(istr), 0);
+	istr.read(&str[0], str.size());
+	return str;
+}
+
+
+static void write_bin(std::ostream& ostr, std::size_t iIdx, const QEMapBin& bin)
+{
+	write_val<std::uint64_t>(ostr, iIdx);
+	write_val<t_real>(ostr, bin.cts);
+	write_val<t_real>(ostr, bin.mon);
+	write_val<t_real>(ostr, bin.var);
+	write_val<std::uint64_t>(ostr, bin.pts);
+}
+
+
+static std::pair<std::size_t, QEMapBin> read_bin(std::istream& istr)
+{
+	std::pair<std::size_t, QEMapBin> pairBin;
+	pairBin.first = read_val<std::uint64_t>(istr);
+	pairBin.second.cts = read_val<t_real>(istr);
+	pairBin.second.mon = read_val<t_real>(istr);
+	pairBin.second.var = read_val<t_real>(istr);
+	pairBin.second.pts = read_val<std::uint64_t>(istr);
+	return pairBin;
+}
+
+
+/**
+ * file layout:
+ *   magic string, mode, axes, column names, monitor scale,
+ *   bins: [index, counts, monitor, variance, points, intensity, error],
+ *   files: [name, modification time, contributing bins]
+ */
+bool QEMap::Save(const std::string& strFile) const
+{
+	std::ofstream ofstr(strFile, std::ios_base::binary);
+	if(!ofstr)
+	{
+		tl::log_err("Cannot open map file \"", strFile, "\" for writing.");
+		return false;
+	}
+
+	ofstr.write(g_strMagic.data(), g_strMagic.size());
+	write_val<std::uint32_t>(ofstr, static_cast<std::uint32_t>(m_mode));
+	write_val<std::uint32_t>(ofstr, m_vecAxes.size());
+	for(const QEMapAxis& axis : m_vecAxes)
+	{
+		write_val<t_real>(ofstr, axis.min);
+		write_val<t_real>(ofstr, axis.max);
+		write_val<std::uint64_t>(ofstr, axis.bins);
+	}
+
+	write_str(ofstr, m_strCtrCol);
+	write_str(ofstr, m_strMonCol);
+	write_val<t_real>(ofstr, m_dMonScale);
+
+	// bins, sorted for reproducible files
+	std::vector<std::size_t> vecIndices;
+	vecIndices.reserve(m_bins.size());
+	for(const auto& pairBin : m_bins)
+		vecIndices.push_back(pairBin.first);
+	std::sort(vecIndices.begin(), vecIndices.end());
+
+	write_val<std::uint64_t>(ofstr, vecIndices.size());
+	for(std::size_t iIdx : vecIndices)
+	{
+		const QEMapBin& bin = m_bins.at(iIdx);
+		write_bin(ofstr, iIdx, bin);
+
+		const std::pair<t_real, t_real> pairI = GetIntensity(bin);
+		write_val<t_real>(ofstr, pairI.first);
+		write_val<t_real>(ofstr, pairI.second);
+	}
+
+	// files
+	write_val<std::uint64_t>(ofstr, m_files.size());
+	for(const auto& pairFile : m_files)
+	{
+		write_str(ofstr, pairFile.first);
+		write_val<std::int64_t>(ofstr, pairFile.second.mtime);
+		write_val<std::uint64_t>(ofstr, pairFile.second.contribs.size());
+		for(const auto& pairBin : pairFile.second.contribs)
+			write_bin(ofstr, pairBin.first, pairBin.second);
+	}
+
+	return bool(ofstr);
+}
+
+
+bool QEMap::Load(const std::string& strFile)
+{
+	std::ifstream ifstr(strFile, std::ios_base::binary);
+	if(!ifstr)
+	{
+		tl::log_err("Cannot open map file \"", strFile, "\".");
+		return false;
+	}
+
+	std::string strMagic(g_strMagic.size(), 0);
+	ifstr.read(&strMagic[0], strMagic.size());
+	if(strMagic != g_strMagic)
+	{
+		tl::log_err("\"", strFile, "\" is not a map file.");
+		return false;
+	}
+
+	m_mode = static_cast<QEMapMode>(read_val<std::uint32_t>(ifstr));
+	m_vecAxes.resize(read_val<std::uint32_t>(ifstr));
+	for(QEMapAxis& axis : m_vecAxes)
+	{
+		axis.min = read_val<t_real>(ifstr);
+		axis.max = read_val<t_real>(ifstr);
+		axis.bins = read_val<std::uint64_t>(ifstr);
+	}
+
+	if(m_vecAxes.size() != GetNumAxes(m_mode))
+	{
+		tl::log_err("Invalid axes in map file \"", strFile, "\".");
+		return false;
+	}
+
+	m_strCtrCol = read_str(ifstr);
+	m_strMonCol = read_str(ifstr);
+	m_dMonScale = read_val<t_real>(ifstr);
+
+	m_bins.clear();
+	const std::size_t iNumBins = read_val<std::uint64_t>(ifstr);
+	for(std::size_t iBin=0; iBin<iNumBins && ifstr; ++iBin)
+	{
+		m_bins.insert(read_bin(ifstr));
+
+		// skip the intensity and its error
+		read_val<t_real>(ifstr);
+		read_val<t_real>(ifstr);
+	}
+
+	m_files.clear();
+	const std::size_t iNumFiles = read_val<std::uint64_t>(ifstr);
+	for(std::size_t iFile=0; iFile<iNumFiles && ifstr; ++iFile)
+	{
+		const std::string strName = read_str(ifstr);
+
+		FileEntry entry;
+		entry.mtime = read_val<std::int64_t>(ifstr);
+		entry.contribs.resize(read_val<std::uint64_t>(ifstr));
+		for(auto& pairBin : entry.contribs)
+			pairBin = read_bin(ifstr);
+
+		m_files.emplace(std::make_pair(strName, std::move(entry)));
+	}
+
+	if(!ifstr)
+	{
+		tl::log_err("Map file \"", strFile, "\" is truncated.");
+		return false;
+	}
+
+	return true;
+}
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// export
+
+/**
+ * writes the non-empty bins as text columns, e.g. for plotting
+ */
+bool QEMap::SaveText(const std::string& strFile) const
+{
+	std::ofstream ofstr(strFile);
+	if(!ofstr)
+	{
+		tl::log_err("Cannot open file \"", strFile, "\" for writing.");
+		return false;
+	}
+
+	std::vector<std::size_t> vecIndices;
+	vecIndices.reserve(m_bins.size());
+	for(const auto& pairBin : m_bins)
+		vecIndices.push_back(pairBin.first);
+	std::sort(vecIndices.begin(), vecIndices.end());
+
+	const int iPrec = g_iPrec;
+	ofstr.precision(iPrec);
+
+	ofstr << "#\n";
+	ofstr << "# Scan files: " << m_files.size() << "\n";
+	ofstr << "# Non-empty bins: " << vecIndices.size() << "\n";
+	ofstr << "# Intensities per monitor: " << m_dMonScale << "\n";
+	ofstr << "#\n";
+
+	const std::vector<std::string> vecCols = m_mode == QEMapMode::QE
+		? std::vector<std::string>{ "# |Q|", "E" }
+		: std::vector<std::string>{ "# h", "k", "l", "E" };
+	for(const std::string& strCol : vecCols)
+		ofstr << std::left << std::setw(iPrec*2) << strCol << " ";
+	ofstr << std::left << std::setw(iPrec*2) << "I" << " "
+		<< std::left << std::setw(iPrec*2) << "dI" << " "
+		<< std::left << std::setw(iPrec*2) << "points" << "\n";
+
+	for(std::size_t iIdx : vecIndices)
+	{
+		const QEMapBin& bin = m_bins.at(iIdx);
+		const std::pair<t_real, t_real> pairI = GetIntensity(bin);
+
+		for(t_real dCoord : GetBinCentre(iIdx))
+			ofstr << std::left << std::setw(iPrec*2) << dCoord << " ";
+		ofstr << std::left << std::setw(iPrec*2) << pairI.first << " "
+			<< std::left << std::setw(iPrec*2) << pairI.second << " "
+			<< std::left << std::setw(iPrec*2) << bin.pts << "\n";
+	}
+
+	return bool(ofstr);
+}
+
+
+/**
+ * writes an (h,k,l,E) map in the version 2 grid format of the SqwUniformGrid module,
+ * each non-empty energy bin becomes a branch with the bin's intensity as weight
+ */
+bool QEMap::SaveGrid(const std::string& strFile) const
+{
+	using t_idx = std::size_t;
+	using t_branchidx = unsigned int;
+
+	if(m_mode != QEMapMode::HKLE)
+	{
+		tl::log_err("Grid files can only be written for (h, k, l, E) maps.");
+		return false;
+	}
+
+	std::ofstream ofstr(strFile, std::ios_base::binary);
+	if(!ofstr)
+	{
+		tl::log_err("Cannot open grid file \"", strFile, "\" for writing.");
+		return false;
+	}
+
+	const QEMapAxis& axisE = m_vecAxes[3];
+
+	// (E, w) branches per (h, k, l) cell
+	std::unordered_map<std::size_t, std::vector<std::pair<t_real, t_real>>> mapCells;
+	for(const auto& pairBin : m_bins)
+	{
+		const t_real dI = GetIntensity(pairBin.second).first;
+		if(dI <= t_real(0))
+			continue;
+
+		mapCells[pairBin.first / axisE.bins].emplace_back(
+			std::make_pair(axisE.GetCentre(pairBin.first % axisE.bins), dI));
+	}
+
+
+	// header, the grid points are the bin centres
+	t_idx idx_offs = 0;
+	write_val<t_idx>(ofstr, idx_offs);
+	for(std::size_t iAxis=0; iAxis<3; ++iAxis)
+	{
+		const QEMapAxis& axis = m_vecAxes[iAxis];
+		const t_real dMin = axis.GetCentre(0);
+		write_val<t_real>(ofstr, dMin);
+		write_val<t_real>(ofstr, dMin + t_real(axis.bins)*axis.GetStep());
+		write_val<t_real>(ofstr, axis.GetStep());
+	}
+	ofstr << "takin_grid_data_ver2";
+
+	// data block
+	const std::size_t iNumCells = m_vecAxes[0].bins * m_vecAxes[1].bins * m_vecAxes[2].bins;
+	std::vector<t_idx> vecIndices;
+	vecIndices.reserve(iNumCells);
+
+	for(std::size_t iCell=0; iCell<iNumCells; ++iCell)
+	{
+		vecIndices.push_back(ofstr.tellp());
+
+		auto iterCell = mapCells.find(iCell);
+		if(iterCell == mapCells.end())
+		{
+			write_val<t_branchidx>(ofstr, 0);
+			continue;
+		}
+
+		std::vector<std::pair<t_real, t_real>>& vecBranches = iterCell->second;
+		std::sort(vecBranches.begin(), vecBranches.end());
+
+		write_val<t_branchidx>(ofstr, vecBranches.size());
+		for(const auto& pairBranch : vecBranches)
+		{
+			write_val<t_real>(ofstr, pairBranch.first);
+			write_val<t_real>(ofstr, pairBranch.second);
+		}
+	}
+
+	// index block
+	idx_offs = ofstr.tellp();
+	ofstr.write(reinterpret_cast<const char*>(vecIndices.data()), sizeof(t_idx)*vecIndices.size());
+	ofstr.seekp(0, std::ios_base::beg);
+	write_val<t_idx>(ofstr, idx_offs);
+
+	return bool(ofstr);
+}
+// ----------------------------------------------------------------------------
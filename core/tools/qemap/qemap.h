@@ -0,0 +1,139 @@
+/**
+ * assembles (h,k,l,E) or (|Q|,E) intensity maps from scan files
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __TAKIN_QEMAP_H__
+#define __TAKIN_QEMAP_H__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <ctime>
+
+#include "libs/globals.h"
+
+
+enum class QEMapMode : unsigned int
+{
+	HKLE = 0,	// 4d histogram: (h, k, l, E)
+	QE = 1,		// 2d histogram: (|Q|, E)
+};
+
+
+/**
+ * regular histogram axis
+ */
+struct QEMapAxis
+{
+	t_real_glob min = 0, max = 1;
+	std::size_t bins = 1;
+
+	t_real_glob GetStep() const { return (max - min) / t_real_glob(bins); }
+	t_real_glob GetCentre(std::size_t iBin) const { return min + (t_real_glob(iBin) + 0.5)*GetStep(); }
+};
+
+
+/**
+ * accumulated counts in one histogram bin
+ */
+struct QEMapBin
+{
+	t_real_glob cts = 0;    // sum of counts
+	t_real_glob mon = 0;    // sum of monitor counts
+	t_real_glob var = 0;    // sum of count variances
+	std::size_t pts = 0;    // number of scan points
+
+	QEMapBin& operator+=(const QEMapBin& bin);
+	QEMapBin& operator-=(const QEMapBin& bin);
+};
+
+
+/**
+ * sparse intensity map, the bins are only stored when they contain scan points
+ */
+class QEMap
+{
+public:
+	using t_real = t_real_glob;
+	using t_bins = std::unordered_map<std::size_t, QEMapBin>;
+
+	// contributions of a single scan file, kept to be able to replace the file
+	struct FileEntry
+	{
+		std::time_t mtime = 0;
+		std::vector<std::pair<std::size_t, QEMapBin>> contribs;
+	};
+
+protected:
+	QEMapMode m_mode = QEMapMode::HKLE;
+	std::vector<QEMapAxis> m_vecAxes;
+
+	std::string m_strCtrCol, m_strMonCol;  // overrides for the counter and monitor columns
+	t_real m_dMonScale = 1;                // intensities are given per this monitor count
+
+	t_bins m_bins;
+	std::map<std::string, FileEntry> m_files;
+
+	unsigned int m_iMaxThreads = 0;
+
+protected:
+	bool LoadScan(const std::string& strFile, FileEntry& entry, std::size_t& iNumOutside) const;
+
+public:
+	QEMap() = default;
+	QEMap(QEMapMode mode, const std::vector<QEMapAxis>& vecAxes);
+	~QEMap() = default;
+
+	static std::size_t GetNumAxes(QEMapMode mode) { return mode == QEMapMode::QE ? 2 : 4; }
+
+	QEMapMode GetMode() const { return m_mode; }
+	const std::vector<QEMapAxis>& GetAxes() const { return m_vecAxes; }
+	const t_bins& GetBins() const { return m_bins; }
+	const std::map<std::string, FileEntry>& GetFiles() const { return m_files; }
+
+	void SetCounterCol(const std::string& str) { m_strCtrCol = str; }
+	void SetMonitorCol(const std::string& str) { m_strMonCol = str; }
+	void SetMonitorScale(t_real d) { m_dMonScale = d; }
+	void SetMaxThreads(unsigned int iNum) { m_iMaxThreads = iNum; }
+
+	bool GetBinIndex(const std::vector<t_real>& vecCoords, std::size_t& iIdx) const;
+	std::vector<t_real> GetBinCentre(std::size_t iIdx) const;
+	std::pair<t_real, t_real> GetIntensity(const QEMapBin& bin) const;
+
+	std::size_t AddFiles(const std::vector<std::string>& vecFiles);
+	bool RemoveFile(const std::string& strFile);
+
+	bool Save(const std::string& strFile) const;
+	bool Load(const std::string& strFile);
+
+	bool SaveText(const std::string& strFile) const;
+	bool SaveGrid(const std::string& strFile) const;
+};
+
+
+#endif
@@ -0,0 +1,332 @@
+/**
+ * assembles (h,k,l,E) or (|Q|,E) intensity maps from scan files -- CLI program
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+// e.g. takin_qemap --mode=qe --Q=0:4:200 --E=-1:10:110 --out=map.qem --text=map.dat data/
+//      takin_qemap --update --out=map.qem --watch=30 data/
+
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+#include "qemap.h"
+
+#include "tlibs/string/string.h"
+#include "tlibs/log/log.h"
+#include "tlibs/time/stopwatch.h"
+
+namespace opts = boost::program_options;
+namespace fs = boost::filesystem;
+namespace sys = boost::system;
+
+using t_real = QEMap::t_real;
+
+
+/**
+ * parses an axis given as "min:max:bins"
+ */
+static bool parse_axis(const std::string& strAxis, QEMapAxis& axis)
+{
+	std::vector<std::string> vecToks;
+	tl::get_tokens<std::string, std::string>(strAxis, ":,", vecToks);
+	if(vecToks.size() != 3)
+	{
+		tl::log_err("Invalid axis \"", strAxis, "\", expected \"min:max:bins\".");
+		return false;
+	}
+
+	axis.min = tl::str_to_var<t_real>(vecToks[0]);
+	axis.max = tl::str_to_var<t_real>(vecToks[1]);
+	axis.bins = tl::str_to_var<std::size_t>(vecToks[2]);
+
+	if(axis.bins == 0 || axis.max <= axis.min)
+	{
+		tl::log_err("Invalid axis \"", strAxis, "\".");
+		return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * gets the scan files, directories are searched (non-recursively)
+ */
+static std::vector<std::string> get_scan_files(const std::vector<std::string>& vecInputs)
+{
+	std::vector<std::string> vecFiles;
+
+	for(const std::string& strInput : vecInputs)
+	{
+		sys::error_code err;
+		if(fs::is_directory(strInput, err))
+		{
+			std::vector<std::string> vecDirFiles;
+			for(fs::directory_iterator iter(strInput, err); iter!=fs::directory_iterator(); iter.increment(err))
+			{
+				if(err)
+					break;
+				if(fs::is_regular_file(iter->path()))
+					vecDirFiles.push_back(iter->path().string());
+			}
+
+			std::sort(vecDirFiles.begin(), vecDirFiles.end());
+			vecFiles.insert(vecFiles.end(), vecDirFiles.begin(), vecDirFiles.end());
+		}
+		else
+		{
+			vecFiles.push_back(strInput);
+		}
+	}
+
+	return vecFiles;
+}
+
+
+static bool save_map(const QEMap& map, const std::string& strOut,
+	const std::string& strText, const std::string& strGrid)
+{
+	bool bOk = true;
+
+	if(strOut != "")
+	{
+		bOk = map.Save(strOut) && bOk;
+		tl::log_info("Wrote map to \"", strOut, "\".");
+	}
+	if(strText != "")
+	{
+		bOk = map.SaveText(strText) && bOk;
+		tl::log_info("Wrote map text columns to \"", strText, "\".");
+	}
+	if(strGrid != "")
+	{
+		bOk = map.SaveGrid(strGrid) && bOk;
+		tl::log_info("Wrote grid to \"", strGrid, "\".");
+	}
+
+	return bOk;
+}
+
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		tl::log_info("--------------------------------------------------------------------------------");
+		tl::log_info("This is the Takin scan map assembler.");
+		tl::log_info("Written by Tobias Weber <tweber@ill.fr>, 2026.");
+		tl::log_info("--------------------------------------------------------------------------------");
+
+		std::vector<std::string> vecInputs;
+		std::string strMode = "hkle";
+		std::string strH, strK, strL, strQ, strE;
+		std::string strCtr, strMon;
+		std::string strOut, strText, strGrid;
+		t_real dMonScale = 1;
+		unsigned int iWatch = 0;
+		bool bUpdate = false;
+
+		opts::options_description args("map assembler options");
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("scan-files",
+			opts::value<decltype(vecInputs)>(&vecInputs),
+			"scan files or directories")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("mode",
+			opts::value<decltype(strMode)>(&strMode),
+			"map type, \"hkle\" or \"qe\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("h",
+			opts::value<decltype(strH)>(&strH),
+			"h axis, \"min:max:bins\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("k",
+			opts::value<decltype(strK)>(&strK),
+			"k axis, \"min:max:bins\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("l",
+			opts::value<decltype(strL)>(&strL),
+			"l axis, \"min:max:bins\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("Q",
+			opts::value<decltype(strQ)>(&strQ),
+			"|Q| axis in 1/A, \"min:max:bins\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("E",
+			opts::value<decltype(strE)>(&strE),
+			"E axis in meV, \"min:max:bins\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("counter",
+			opts::value<decltype(strCtr)>(&strCtr),
+			"counter column override")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("monitor",
+			opts::value<decltype(strMon)>(&strMon),
+			"monitor column override")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("monitor-scale",
+			opts::value<decltype(dMonScale)>(&dMonScale),
+			"give intensities per this monitor count")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("out",
+			opts::value<decltype(strOut)>(&strOut),
+			"binary map output file")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("text",
+			opts::value<decltype(strText)>(&strText),
+			"text output file")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("grid",
+			opts::value<decltype(strGrid)>(&strGrid),
+			"grid output file for the uniform_grid S(Q, E) module")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("update",
+			opts::bool_switch(&bUpdate),
+			"add new and modified scans to an existing binary map file")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("watch",
+			opts::value<decltype(iWatch)>(&iWatch),
+			"check for new scans every given number of seconds")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("max-threads",
+			opts::value<decltype(g_iMaxThreads)>(&g_iMaxThreads),
+			"maximum number of threads")));
+
+		opts::positional_options_description args_pos;
+		args_pos.add("scan-files", -1);
+
+		opts::basic_command_line_parser<char> clparser(argc, argv);
+		clparser.options(args);
+		clparser.positional(args_pos);
+		opts::basic_parsed_options<char> parsedopts = clparser.run();
+
+		opts::variables_map opts_map;
+		opts::store(parsedopts, opts_map);
+		opts::notify(opts_map);
+
+		if(argc <= 1)
+		{
+			std::ostringstream ostrHelp;
+			ostrHelp << "Usage: " << argv[0] << " [options] <scan files or directories>\n";
+			ostrHelp << args;
+			tl::log_info(ostrHelp.str());
+			return -1;
+		}
+
+
+		// --------------------------------------------------------------------
+		// set up the map
+		QEMap map;
+
+		if(bUpdate && strOut != "" && fs::exists(strOut))
+		{
+			if(!map.Load(strOut))
+				return -1;
+			tl::log_info("Loaded map \"", strOut, "\" with ", map.GetFiles().size(), " scan file(s).");
+		}
+		else
+		{
+			QEMapMode mode = QEMapMode::HKLE;
+			std::vector<std::string> vecAxes;
+
+			if(strMode == "hkle")
+			{
+				mode = QEMapMode::HKLE;
+				vecAxes = { strH, strK, strL, strE };
+			}
+			else if(strMode == "qe")
+			{
+				mode = QEMapMode::QE;
+				vecAxes = { strQ, strE };
+			}
+			else
+			{
+				tl::log_err("Unknown map mode \"", strMode, "\".");
+				return -1;
+			}
+
+			std::vector<QEMapAxis> axes(vecAxes.size());
+			for(std::size_t iAxis=0; iAxis<vecAxes.size(); ++iAxis)
+			{
+				if(!parse_axis(vecAxes[iAxis], axes[iAxis]))
+					return -1;
+			}
+
+			map = QEMap(mode, axes);
+			map.SetCounterCol(strCtr);
+			map.SetMonitorCol(strMon);
+			map.SetMonitorScale(dMonScale);
+		}
+		// --------------------------------------------------------------------
+
+
+		// --------------------------------------------------------------------
+		// bin the scans
+		tl::Stopwatch<t_real> watch;
+		watch.start();
+
+		std::vector<std::string> vecFiles = get_scan_files(vecInputs);
+		std::size_t iNumLoaded = map.AddFiles(vecFiles);
+
+		watch.stop();
+		tl::log_info("Binned ", iNumLoaded, " new or modified scan file(s) in ",
+			tl::get_duration_str_secs<t_real>(watch.GetDur()), ", ",
+			map.GetBins().size(), " non-empty bin(s).");
+
+		if(!save_map(map, strOut, strText, strGrid))
+			return -1;
+
+
+		// check for new files periodically
+		while(iWatch)
+		{
+			std::this_thread::sleep_for(std::chrono::seconds(iWatch));
+
+			vecFiles = get_scan_files(vecInputs);
+			iNumLoaded = map.AddFiles(vecFiles);
+			if(!iNumLoaded)
+				continue;
+
+			tl::log_info("Binned ", iNumLoaded, " new or modified scan file(s), ",
+				map.GetBins().size(), " non-empty bin(s).");
+			save_map(map, strOut, strText, strGrid);
+		}
+		// --------------------------------------------------------------------
+	}
+	catch(const std::exception& ex)
+	{
+		tl::log_crit(ex.what());
+		return -1;
+	}
+
+	return 0;
+}
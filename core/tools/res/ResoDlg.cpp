@@ -326,6 +326,9 @@ void ResoDlg::Calc()
 		if(m_bDontCalc)
 			return;
 
+		// neutrons still being generated for the old parameters are obsolete
+		m_mcjobs.Cancel(0);
+
 		EckParams &cn = m_tasparams;
 		VioParams &tof = m_tofparams;
 		SimpleResoParams &simple = m_simpleparams;
@@ -766,30 +769,58 @@ void ResoDlg::Calc()
 
 				opts.dAngleQVec0 = m_dAngleQVec0;
 
-				if(m_bHasUB)
+				// generate the neutrons off the gui thread, a newer calculation cancels this one;
+				// the results are emitted together with the neutrons
+				m_mcjobs.RunAsync(0, [this, opts, iNumMC, ell4d = m_ell4d, bHasUB = m_bHasUB]
+					(const std::atomic<bool>& bCancel) mutable -> UpdateScheduler::t_func
 				{
-					// rlu system
-					opts.coords = McNeutronCoords::RLU;
-					if(m_vecMC_HKL.size() != iNumMC)
-						m_vecMC_HKL.resize(iNumMC);
-					mc_neutrons<t_vec>(m_ell4d, iNumMC, opts, m_vecMC_HKL.begin());
-				}
-				else
-					m_vecMC_HKL.clear();
-
-				// Qpara, Qperp system
-				opts.coords = McNeutronCoords::DIRECT;
-				if(m_vecMC_direct.size() != iNumMC)
-					m_vecMC_direct.resize(iNumMC);
-				mc_neutrons<t_vec>(m_ell4d, iNumMC, opts, m_vecMC_direct.begin());
+					const std::size_t iChunk = 1024;
+
+					std::vector<t_vec> vecMC_HKL, vecMC_direct;
+					std::vector<std::vector<t_vec>*> vecResults;
+					std::vector<McNeutronCoords> vecCoords;
+
+					if(bHasUB)
+					{
+						// rlu system
+						vecResults.push_back(&vecMC_HKL);
+						vecCoords.push_back(McNeutronCoords::RLU);
+					}
+
+					// Qpara, Qperp system
+					vecResults.push_back(&vecMC_direct);
+					vecCoords.push_back(McNeutronCoords::DIRECT);
+
+					for(std::size_t iResult = 0; iResult < vecResults.size(); ++iResult)
+					{
+						opts.coords = vecCoords[iResult];
+						vecResults[iResult]->resize(iNumMC);
+
+						for(std::size_t iStart = 0; iStart < iNumMC; iStart += iChunk)
+						{
+							if(bCancel)
+								return nullptr;
+
+							mc_neutrons<t_vec>(ell4d, std::min(iChunk, iNumMC - iStart),
+								opts, vecResults[iResult]->begin() + iStart);
+						}
+					}
+
+					return [this, vecMC_HKL = std::move(vecMC_HKL),
+						vecMC_direct = std::move(vecMC_direct)]() mutable
+					{
+						m_vecMC_HKL = std::move(vecMC_HKL);
+						m_vecMC_direct = std::move(vecMC_direct);
+						EmitResults();
+					};
+				});
 			}
 			else
 			{
 				m_vecMC_direct.clear();
 				m_vecMC_HKL.clear();
+				EmitResults();
 			}
-
-			EmitResults();
 		}
 		else
 		{
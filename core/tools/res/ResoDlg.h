@@ -51,6 +51,7 @@
 #ifndef NO_3D
 	#include "libs/plotgl.h"
 #endif
+#include "libs/qt/update_sched.h"
 #include "dialogs/RecipParamDlg.h"
 #include "dialogs/RealParamDlg.h"
 #include "dialogs/EllipseDlg.h"
@@ -134,6 +135,9 @@ protected:
 	std::vector<ublas::vector<t_real_reso>> m_vecMC_direct;
 	std::vector<ublas::vector<t_real_reso>> m_vecMC_HKL;
 
+	// live neutrons are generated in a worker thread
+	UpdateScheduler m_mcjobs;
+
 
 	bool m_bDontCalc;
 	bool m_bEll4dCurrent = 0;
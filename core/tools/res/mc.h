@@ -40,6 +40,7 @@
 namespace ublas = boost::numeric::ublas;
 
 #include "tlibs/math/math.h"
+#include "tlibs/math/linalg.h"
 #include "tlibs/math/rand.h"
 
 
@@ -117,4 +118,85 @@ void mc_neutrons(const Ellipsoid4d<typename t_vec::value_type>& ell4d,
 	}
 }
 
+
+/**
+ * density of the neutrons generated by mc_neutrons() in the given coordinates:
+ * v = A*z + mean, with z a standard normal 4-vector
+ */
+template<class t_vec = ublas::vector<double>, class t_mat = ublas::matrix<double>>
+struct McGaussian
+{
+	using t_real = typename t_vec::value_type;
+
+	t_vec vecMean;
+	t_mat matInvA;        // whitening transformation, A^(-1)
+	t_vec vecSigmas;      // standard deviations along the coordinate axes
+	t_real dLogNorm = 0;  // log of the normalisation, log((2pi)^2 * |det A|)
+
+	/**
+	 * squared mahalanobis distance from the mean
+	 */
+	t_real dist2(const t_vec& vec) const
+	{
+		t_vec vecZ = ublas::prod(matInvA, vec - vecMean);
+		return ublas::inner_prod(vecZ, vecZ);
+	}
+
+	t_real operator()(const t_vec& vec) const
+	{
+		return std::exp(-t_real(0.5)*dist2(vec) - dLogNorm);
+	}
+};
+
+
+/**
+ * get the density that mc_neutrons() samples for a given ellipsoid
+ */
+template<class t_vec = ublas::vector<double>, class t_mat = ublas::matrix<double>>
+bool mc_gaussian(const Ellipsoid4d<typename t_vec::value_type>& ell4d,
+	const McNeutronOpts<t_mat>& opts, McGaussian<t_vec, t_mat>& gauss)
+{
+	using t_real = typename t_vec::value_type;
+
+	t_mat matQVec0 = tl::rotation_matrix_2d(-opts.dAngleQVec0);
+	tl::resize_unity(matQVec0, 4);
+
+	t_mat matTrafo = tl::unit_m<t_mat>(4);
+	if(opts.coords == McNeutronCoords::ANGS)
+		matTrafo = matQVec0;
+	else if(opts.coords == McNeutronCoords::RLU)
+		matTrafo = ublas::prod(opts.matUBinv, matQVec0);
+
+	t_mat matSigmas = tl::diag_matrix<t_mat>({
+		ell4d.x_hwhm*tl::get_HWHM2SIGMA<t_real>(),
+		ell4d.y_hwhm*tl::get_HWHM2SIGMA<t_real>(),
+		ell4d.z_hwhm*tl::get_HWHM2SIGMA<t_real>(),
+		ell4d.w_hwhm*tl::get_HWHM2SIGMA<t_real>() });
+
+	t_mat matRotSigmas = ublas::prod(ell4d.rot, matSigmas);
+	t_mat matA = ublas::prod(matTrafo, matRotSigmas);
+	if(!tl::inverse(matA, gauss.matInvA))
+		return false;
+
+	gauss.vecMean = tl::make_vec<t_vec>({ 0., 0., 0., 0. });
+	if(!opts.bCenter)
+	{
+		t_vec vecTrans = tl::make_vec<t_vec>({
+			ell4d.x_offs, ell4d.y_offs, ell4d.z_offs, ell4d.w_offs });
+		gauss.vecMean = ublas::prod(matTrafo, vecTrans);
+	}
+
+	// the covariance is A*A^T
+	gauss.vecSigmas = t_vec(4);
+	for(std::size_t i=0; i<4; ++i)
+		gauss.vecSigmas[i] = ublas::norm_2(ublas::row(matA, i));
+
+	const t_real dDet = std::abs(tl::determinant(matA));
+	if(dDet <= t_real(0) || !std::isfinite(dDet))
+		return false;
+	gauss.dLogNorm = t_real(2)*std::log(t_real(2)*tl::get_pi<t_real>()) + std::log(dDet);
+
+	return true;
+}
+
 #endif
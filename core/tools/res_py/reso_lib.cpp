@@ -0,0 +1,464 @@
+/**
+ * batched resolution calculation for the python module
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "reso_lib.h"
+#include "tools/res/ellipse.h"
+#include "tools/monteconvo/TASReso.h"
+#include "tlibs/log/log.h"
+#include "tlibs/helper/thread.h"
+
+#include <unordered_map>
+#include <functional>
+#include <atomic>
+#include <limits>
+#include <algorithm>
+
+
+using t_real = ResoLib::t_real;
+using t_vec = ublas::vector<t_real>;
+using t_mat = ublas::matrix<t_real>;
+
+static const auto angs = tl::get_one_angstrom<t_real>();
+static const auto rads = tl::get_one_radian<t_real>();
+static const auto meV = tl::get_one_meV<t_real>();
+
+// number of positions per task
+static constexpr std::size_t CHUNK_SIZE = 256;
+
+
+
+ResoLib::ResoLib()
+{
+	// defaults from the python test script, test.py
+	const t_real min = tl::m2r(t_real(1));
+	const t_real cm = t_real(1e8);   // in A
+
+	m_reso.mono_d = 3.355 * angs;
+	m_reso.ana_d = 3.355 * angs;
+	m_reso.dmono_sense = -1.;
+	m_reso.dana_sense = -1.;
+	m_reso.dsample_sense = 1.;
+
+	m_reso.mono_mosaic = m_reso.mono_mosaic_v = 45.*min * rads;
+	m_reso.sample_mosaic = m_reso.sample_mosaic_v = 30.*min * rads;
+	m_reso.ana_mosaic = m_reso.ana_mosaic_v = 45.*min * rads;
+
+	m_reso.coll_h_pre_mono = m_reso.coll_h_pre_sample = 30.*min * rads;
+	m_reso.coll_h_post_sample = m_reso.coll_h_post_ana = 30.*min * rads;
+	m_reso.coll_v_pre_mono = m_reso.coll_v_pre_sample = 30.*min * rads;
+	m_reso.coll_v_post_sample = m_reso.coll_v_post_ana = 30.*min * rads;
+
+	m_reso.dmono_refl = m_reso.dana_effic = 1.;
+
+	m_reso.dist_src_mono = 10.*cm * angs;
+	m_reso.dist_mono_sample = 200.*cm * angs;
+	m_reso.dist_sample_ana = 115.*cm * angs;
+	m_reso.dist_ana_det = 85.*cm * angs;
+
+	m_reso.bSrcRect = true;
+	m_reso.src_w = 6.*cm * angs;
+	m_reso.src_h = 12.*cm * angs;
+
+	m_reso.mono_thick = 0.15*cm * angs;
+	m_reso.mono_w = 12.*cm * angs;
+	m_reso.mono_h = 8.*cm * angs;
+	m_reso.mono_curvh = m_reso.mono_curvv = 0. * angs;
+	m_reso.mono_numtiles_h = m_reso.mono_numtiles_v = 1;
+
+	m_reso.bSampleCub = false;
+	m_reso.sample_w_q = m_reso.sample_w_perpq = m_reso.sample_h = 1.*cm * angs;
+
+	m_reso.ana_thick = 0.3*cm * angs;
+	m_reso.ana_w = 12.*cm * angs;
+	m_reso.ana_h = 8.*cm * angs;
+	m_reso.ana_curvh = m_reso.ana_curvv = 0. * angs;
+	m_reso.ana_numtiles_h = m_reso.ana_numtiles_v = 1;
+
+	m_reso.bDetRect = true;
+	m_reso.det_w = 1.5*cm * angs;
+	m_reso.det_h = 5.*cm * angs;
+
+	m_reso.bGuide = false;
+	m_reso.guide_div_h = m_reso.guide_div_v = 15.*min * rads;
+
+	m_reso.monitor_w = m_reso.monitor_h = 0. * angs;
+	m_reso.dist_mono_monitor = 0. * angs;
+
+	m_reso.pos_x = m_reso.pos_y = m_reso.pos_z = 0. * angs;
+	m_reso.bKfVertical = false;
+
+	for(int i=0; i<3; ++i)
+	{
+		m_reso.sample_lattice[i] = 5. * angs;
+		m_reso.sample_angles[i] = tl::d2r(t_real(90)) * rads;
+	}
+}
+
+
+/**
+ * take the instrument parameters, algorithm and fixed k from a takin file
+ */
+bool ResoLib::LoadInstr(const std::string& strFile)
+{
+	TASReso reso;
+	if(!reso.LoadRes(strFile.c_str()))
+		return false;
+
+	if(reso.GetAlgo() == ResoAlgo::VIO)
+	{
+		tl::log_err("The TOF resolution is not supported by the batch calculation.");
+		return false;
+	}
+
+	m_reso = reso.GetResoParams();
+	m_algo = reso.GetAlgo();
+	m_R0_scale = reso.GetR0Scale();
+	m_bKiFix = reso.GetKiFix();
+	m_dKFix = reso.GetKFix();
+
+	return true;
+}
+
+
+bool ResoLib::SetAlgo(const std::string& strAlgo)
+{
+	if(strAlgo == "cn")
+		m_algo = ResoAlgo::CN;
+	else if(strAlgo == "pop_cn")
+		m_algo = ResoAlgo::POP_CN;
+	else if(strAlgo == "pop")
+		m_algo = ResoAlgo::POP;
+	else if(strAlgo == "eck")
+		m_algo = ResoAlgo::ECK;
+	else
+	{
+		tl::log_err("Unknown resolution algorithm \"", strAlgo, "\".");
+		return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * set a parameter using the names and units (A, rad) of the python implementation
+ */
+bool ResoLib::SetParam(const std::string& strName, t_real dVal)
+{
+	using t_setter = std::function<void(EckParams&, t_real)>;
+
+	static const std::unordered_map<std::string, t_setter> mapSetters =
+	{
+		// d spacings
+		{ "mono_xtal_d", [](EckParams& p, t_real v) { p.mono_d = v*angs; } },
+		{ "ana_xtal_d", [](EckParams& p, t_real v) { p.ana_d = v*angs; } },
+
+		// scattering senses
+		{ "mono_sense", [](EckParams& p, t_real v) { p.dmono_sense = v; } },
+		{ "sample_sense", [](EckParams& p, t_real v) { p.dsample_sense = v; } },
+		{ "ana_sense", [](EckParams& p, t_real v) { p.dana_sense = v; } },
+
+		// distances
+		{ "dist_src_mono", [](EckParams& p, t_real v) { p.dist_src_mono = v*angs; } },
+		{ "dist_mono_sample", [](EckParams& p, t_real v) { p.dist_mono_sample = v*angs; } },
+		{ "dist_sample_ana", [](EckParams& p, t_real v) { p.dist_sample_ana = v*angs; } },
+		{ "dist_ana_det", [](EckParams& p, t_real v) { p.dist_ana_det = v*angs; } },
+		{ "dist_mono_monitor", [](EckParams& p, t_real v) { p.dist_mono_monitor = v*angs; } },
+
+		// component sizes
+		{ "src_w", [](EckParams& p, t_real v) { p.src_w = v*angs; } },
+		{ "src_h", [](EckParams& p, t_real v) { p.src_h = v*angs; } },
+		{ "mono_d", [](EckParams& p, t_real v) { p.mono_thick = v*angs; } },
+		{ "mono_w", [](EckParams& p, t_real v) { p.mono_w = v*angs; } },
+		{ "mono_h", [](EckParams& p, t_real v) { p.mono_h = v*angs; } },
+		{ "sample_d", [](EckParams& p, t_real v) { p.sample_w_q = v*angs; } },
+		{ "sample_w", [](EckParams& p, t_real v) { p.sample_w_perpq = v*angs; } },
+		{ "sample_h", [](EckParams& p, t_real v) { p.sample_h = v*angs; } },
+		{ "ana_d", [](EckParams& p, t_real v) { p.ana_thick = v*angs; } },
+		{ "ana_w", [](EckParams& p, t_real v) { p.ana_w = v*angs; } },
+		{ "ana_h", [](EckParams& p, t_real v) { p.ana_h = v*angs; } },
+		{ "det_w", [](EckParams& p, t_real v) { p.det_w = v*angs; } },
+		{ "det_h", [](EckParams& p, t_real v) { p.det_h = v*angs; } },
+		{ "monitor_w", [](EckParams& p, t_real v) { p.monitor_w = v*angs; } },
+		{ "monitor_h", [](EckParams& p, t_real v) { p.monitor_h = v*angs; } },
+
+		// collimation
+		{ "coll_h_pre_mono", [](EckParams& p, t_real v) { p.coll_h_pre_mono = v*rads; } },
+		{ "coll_h_pre_sample", [](EckParams& p, t_real v) { p.coll_h_pre_sample = v*rads; } },
+		{ "coll_h_post_sample", [](EckParams& p, t_real v) { p.coll_h_post_sample = v*rads; } },
+		{ "coll_h_post_ana", [](EckParams& p, t_real v) { p.coll_h_post_ana = v*rads; } },
+		{ "coll_v_pre_mono", [](EckParams& p, t_real v) { p.coll_v_pre_mono = v*rads; } },
+		{ "coll_v_pre_sample", [](EckParams& p, t_real v) { p.coll_v_pre_sample = v*rads; } },
+		{ "coll_v_post_sample", [](EckParams& p, t_real v) { p.coll_v_post_sample = v*rads; } },
+		{ "coll_v_post_ana", [](EckParams& p, t_real v) { p.coll_v_post_ana = v*rads; } },
+
+		// focusing
+		{ "mono_curvh", [](EckParams& p, t_real v) { p.mono_curvh = v*angs; } },
+		{ "mono_curvv", [](EckParams& p, t_real v) { p.mono_curvv = v*angs; } },
+		{ "ana_curvh", [](EckParams& p, t_real v) { p.ana_curvh = v*angs; } },
+		{ "ana_curvv", [](EckParams& p, t_real v) { p.ana_curvv = v*angs; } },
+		{ "mono_is_curved_h", [](EckParams& p, t_real v) { p.bMonoIsCurvedH = (v != 0.); } },
+		{ "mono_is_curved_v", [](EckParams& p, t_real v) { p.bMonoIsCurvedV = (v != 0.); } },
+		{ "ana_is_curved_h", [](EckParams& p, t_real v) { p.bAnaIsCurvedH = (v != 0.); } },
+		{ "ana_is_curved_v", [](EckParams& p, t_real v) { p.bAnaIsCurvedV = (v != 0.); } },
+		{ "mono_is_optimally_curved_h", [](EckParams& p, t_real v) { p.bMonoIsOptimallyCurvedH = (v != 0.); } },
+		{ "mono_is_optimally_curved_v", [](EckParams& p, t_real v) { p.bMonoIsOptimallyCurvedV = (v != 0.); } },
+		{ "ana_is_optimally_curved_h", [](EckParams& p, t_real v) { p.bAnaIsOptimallyCurvedH = (v != 0.); } },
+		{ "ana_is_optimally_curved_v", [](EckParams& p, t_real v) { p.bAnaIsOptimallyCurvedV = (v != 0.); } },
+
+		// guide
+		{ "use_guide", [](EckParams& p, t_real v) { p.bGuide = (v != 0.); } },
+		{ "guide_div_h", [](EckParams& p, t_real v) { p.guide_div_h = v*rads; } },
+		{ "guide_div_v", [](EckParams& p, t_real v) { p.guide_div_v = v*rads; } },
+
+		// mosaics
+		{ "mono_mosaic", [](EckParams& p, t_real v) { p.mono_mosaic = v*rads; } },
+		{ "sample_mosaic", [](EckParams& p, t_real v) { p.sample_mosaic = v*rads; } },
+		{ "ana_mosaic", [](EckParams& p, t_real v) { p.ana_mosaic = v*rads; } },
+		{ "mono_mosaic_v", [](EckParams& p, t_real v) { p.mono_mosaic_v = v*rads; } },
+		{ "sample_mosaic_v", [](EckParams& p, t_real v) { p.sample_mosaic_v = v*rads; } },
+		{ "ana_mosaic_v", [](EckParams& p, t_real v) { p.ana_mosaic_v = v*rads; } },
+
+		// reflectivities
+		{ "dmono_refl", [](EckParams& p, t_real v) { p.dmono_refl = v; } },
+		{ "dana_effic", [](EckParams& p, t_real v) { p.dana_effic = v; } },
+
+		// off-centre scattering
+		{ "pos_x", [](EckParams& p, t_real v) { p.pos_x = v*angs; } },
+		{ "pos_y", [](EckParams& p, t_real v) { p.pos_y = v*angs; } },
+		{ "pos_z", [](EckParams& p, t_real v) { p.pos_z = v*angs; } },
+		{ "kf_vert", [](EckParams& p, t_real v) { p.bKfVertical = (v != 0.); } },
+	};
+
+	// R0 normalisation flags, same names as in the takin files
+	static const std::unordered_map<std::string, std::size_t> mapFlags =
+	{
+		{ "use_ki3", CALC_KI3 }, { "use_kf3", CALC_KF3 },
+		{ "use_kfki", CALC_KFKI }, { "use_monki", CALC_MONKI },
+		{ "use_mon", CALC_MON }, { "use_general_R0", CALC_GENERAL_R0 },
+	};
+
+	auto iterSetter = mapSetters.find(strName);
+	if(iterSetter != mapSetters.end())
+	{
+		iterSetter->second(m_reso, dVal);
+		return true;
+	}
+
+	auto iterFlag = mapFlags.find(strName);
+	if(iterFlag != mapFlags.end())
+	{
+		if(dVal != 0.)
+			m_reso.flags |= iterFlag->second;
+		else
+			m_reso.flags &= ~iterFlag->second;
+		return true;
+	}
+
+	if(strName == "r0_scale")
+	{
+		m_R0_scale = dVal;
+		return true;
+	}
+
+	return false;
+}
+
+
+bool ResoLib::SetParam(const std::string& strName, const std::string& strVal)
+{
+	if(strName == "src_shape")
+		m_reso.bSrcRect = (strVal == "rectangular");
+	else if(strName == "det_shape")
+		m_reso.bDetRect = (strVal == "rectangular");
+	else if(strName == "sample_shape")
+		m_reso.bSampleCub = (strVal == "cuboid");
+	else if(strName == "algo")
+		return SetAlgo(strVal);
+	else
+		return false;
+
+	return true;
+}
+
+
+
+// ----------------------------------------------------------------------------
+// calculation
+
+/**
+ * set up the scattering triangle and calculate the resolution at one position,
+ * see TASReso::SetHKLE
+ */
+bool ResoLib::CalcPoint(EckParams& reso, t_real dQ, t_real dE, t_real dKFix, ResoResults& res) const
+{
+	reso.Q = dQ / angs;
+	reso.E = dE * meV;
+
+	const tl::t_wavenumber_si<t_real> kother = tl::get_other_k(reso.E, dKFix/angs, m_bKiFix);
+	reso.ki = m_bKiFix ? dKFix/angs : kother;
+	reso.kf = m_bKiFix ? kother : dKFix/angs;
+
+	reso.thetam = units::abs(tl::get_mono_twotheta(reso.ki, reso.mono_d, true) * t_real(0.5));
+	reso.thetaa = units::abs(tl::get_mono_twotheta(reso.kf, reso.ana_d, true) * t_real(0.5));
+	reso.twotheta = units::abs(tl::get_sample_twotheta(reso.ki, reso.kf, reso.Q, true));
+	reso.angle_ki_Q = tl::get_angle_ki_Q(reso.ki, reso.kf, reso.Q, true, false);
+	reso.angle_kf_Q = tl::get_angle_kf_Q(reso.ki, reso.kf, reso.Q, true, true);
+
+	switch(m_algo)
+	{
+		case ResoAlgo::CN: res = calc_cn(reso); break;
+		case ResoAlgo::POP_CN: res = calc_pop_cn(reso); break;
+		case ResoAlgo::POP: res = calc_pop(reso); break;
+		case ResoAlgo::ECK: res = calc_eck(reso); break;
+		default: res.bOk = false; res.strErr = "Unknown algorithm."; break;
+	}
+
+	return res.bOk && res.reso.size1() == 4 && res.reso.size2() == 4;
+}
+
+
+std::size_t ResoLib::Calc(const t_real *pQ, const t_real *pE, const t_real *pKFix, std::size_t iNum,
+	t_real *pReso, t_real *pResoV, t_real *pResoS, t_real *pR0, t_real *pVol,
+	t_real *pQavg, t_real *pBragg, t_real *pEll) const
+{
+	if(!pQ || !pE || !iNum)
+		return 0;
+
+	// x, y, project 1, project 2, remove 1, remove 2, see res_cli.cpp
+	static const int iEllParams[NUM_ELLI][6] =
+	{
+		{ 0, 3, 1, -1, 2, -1 },
+		{ 1, 3, 0, -1, 2, -1 },
+		{ 2, 3, 0, -1, 1, -1 },
+		{ 0, 1, 3, -1, 2, -1 },
+	};
+
+	const t_real dNaN = std::numeric_limits<t_real>::quiet_NaN();
+	std::atomic<std::size_t> iNumValid{0};
+
+	auto calc_chunk = [&, this](std::size_t iStart, std::size_t iEnd)
+	{
+		// every task works on its own copy of the parameters
+		EckParams reso = m_reso;
+		ResoResults res;
+
+		for(std::size_t iPt = iStart; iPt < iEnd; ++iPt)
+		{
+			const t_real dKFix = pKFix ? pKFix[iPt] : m_dKFix;
+			bool bOk = false;
+			try
+			{
+				bOk = CalcPoint(reso, pQ[iPt], pE[iPt], dKFix, res);
+			}
+			catch(const std::exception& ex)
+			{
+				tl::log_err("Resolution calculation failed at Q = ", pQ[iPt],
+					" / A, E = ", pE[iPt], " meV: ", ex.what());
+			}
+
+			if(bOk)
+				++iNumValid;
+
+			for(std::size_t i = 0; i < 4; ++i)
+			{
+				for(std::size_t j = 0; j < 4; ++j)
+				{
+					if(pReso)
+						pReso[iPt*NUM_RESO + i*4 + j] = bOk ? res.reso(i, j) : dNaN;
+				}
+
+				if(pResoV)
+					pResoV[iPt*NUM_VEC + i] = bOk && res.reso_v.size() == 4 ? res.reso_v[i] : dNaN;
+				if(pQavg)
+					pQavg[iPt*NUM_VEC + i] = bOk && res.Q_avg.size() == 4 ? res.Q_avg[i] : dNaN;
+				if(pBragg)
+					pBragg[iPt*NUM_VEC + i] = bOk ? res.dBraggFWHMs[i] : dNaN;
+			}
+
+			if(pResoS)
+				pResoS[iPt] = bOk ? res.reso_s : dNaN;
+			if(pR0)
+				pR0[iPt] = bOk ? res.dR0 * m_R0_scale : dNaN;
+			if(pVol)
+				pVol[iPt] = bOk ? res.dResVol : dNaN;
+
+			if(pEll)
+			{
+				t_real *pCurEll = pEll + iPt*NUM_ELLI*NUM_ELLI_VALS;
+				for(std::size_t iEll = 0; iEll < NUM_ELLI; ++iEll)
+				{
+					if(!bOk)
+					{
+						std::fill(pCurEll, pCurEll + NUM_ELLI_VALS, dNaN);
+						pCurEll += NUM_ELLI_VALS;
+						continue;
+					}
+
+					const int *iP = iEllParams[iEll];
+					Ellipse2d<t_real> ell = ::calc_res_ellipse<t_real>(
+						res.reso, res.reso_v, res.reso_s, res.Q_avg,
+						iP[0], iP[1], iP[2], iP[3], iP[4], iP[5]);
+
+					*pCurEll++ = ell.phi;
+					*pCurEll++ = ell.x_hwhm;
+					*pCurEll++ = ell.y_hwhm;
+					*pCurEll++ = ell.x_offs;
+					*pCurEll++ = ell.y_offs;
+				}
+			}
+		}
+	};
+
+	const std::size_t iNumChunks = (iNum + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	unsigned int iNumThreads = m_iMaxThreads ? m_iMaxThreads : get_max_threads();
+	iNumThreads = unsigned(std::min<std::size_t>(std::max(iNumThreads, 1u), iNumChunks));
+
+	if(iNumThreads <= 1)
+	{
+		calc_chunk(0, iNum);
+	}
+	else
+	{
+		tl::ThreadPool<void()> tp(iNumThreads);
+		for(std::size_t iChunk = 0; iChunk < iNumChunks; ++iChunk)
+		{
+			const std::size_t iStart = iChunk * CHUNK_SIZE;
+			const std::size_t iEnd = std::min(iStart + CHUNK_SIZE, iNum);
+			tp.AddTask([&calc_chunk, iStart, iEnd]() { calc_chunk(iStart, iEnd); });
+		}
+
+		tp.Start();
+		for(auto& fut : tp.GetResults())
+			fut.get();
+	}
+
+	return iNumValid.load();
+}
+
+// ----------------------------------------------------------------------------
@@ -0,0 +1,105 @@
+/**
+ * batched resolution calculation for the python module
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __TAKIN_RESO_LIB_H__
+#define __TAKIN_RESO_LIB_H__
+
+#include <string>
+#include <cstddef>
+
+#include "tools/res/eck.h"
+
+
+/**
+ * resolution calculation for many (Q, E) positions using the C++ backends,
+ * the parameters have the same names and units (A, rad) as the dictionaries
+ * of the python implementation in pop.py and eck.py.
+ *
+ * results per position, in the (Q_para, Q_perp, Q_z, E) system:
+ *   reso:    4x4 resolution matrix
+ *   reso_v:  4 linear quadric components
+ *   reso_s:  constant quadric component
+ *   r0, vol: R0 prefactor and resolution volume
+ *   q_avg:   4 mean (Q, E) components
+ *   bragg:   4 Bragg widths (fwhm)
+ *   ell:     4 projected ellipses (Q_para-E, Q_perp-E, Q_z-E, Q_para-Q_perp),
+ *            each given by angle, two hwhms and two offsets
+ * the results of invalid positions are set to NaN.
+ */
+class ResoLib
+{
+public:
+	using t_real = t_real_reso;
+
+	static constexpr std::size_t NUM_RESO = 16;
+	static constexpr std::size_t NUM_VEC = 4;
+	static constexpr std::size_t NUM_ELLI = 4;
+	static constexpr std::size_t NUM_ELLI_VALS = 5;
+
+protected:
+	EckParams m_reso;
+	ResoAlgo m_algo = ResoAlgo::POP;
+	t_real m_R0_scale = 1.;
+
+	bool m_bKiFix = false;
+	t_real m_dKFix = 1.4;
+
+	unsigned int m_iMaxThreads = 0;        // 0: use the global setting
+
+protected:
+	bool CalcPoint(EckParams& reso, t_real dQ, t_real dE, t_real dKFix, ResoResults& res) const;
+
+public:
+	ResoLib();
+	~ResoLib() = default;
+
+	bool LoadInstr(const std::string& strFile);
+
+	bool SetAlgo(const std::string& strAlgo);
+	bool SetParam(const std::string& strName, t_real dVal);
+	bool SetParam(const std::string& strName, const std::string& strVal);
+
+	void SetKiFix(bool bKiFix) { m_bKiFix = bKiFix; }
+	void SetKFix(t_real dKFix) { m_dKFix = dKFix; }
+	bool GetKiFix() const { return m_bKiFix; }
+	t_real GetKFix() const { return m_dKFix; }
+
+	void SetMaxThreads(unsigned int iThreads) { m_iMaxThreads = iThreads; }
+
+	/**
+	 * calculate the resolution at iNum positions, pKFix may be null to use the fixed k from SetKFix,
+	 * output arrays which are not needed may also be null.
+	 * returns the number of valid positions.
+	 */
+	std::size_t Calc(const t_real *pQ, const t_real *pE, const t_real *pKFix, std::size_t iNum,
+		t_real *pReso, t_real *pResoV, t_real *pResoS, t_real *pR0, t_real *pVol,
+		t_real *pQavg, t_real *pBragg, t_real *pEll) const;
+};
+
+
+#endif
@@ -0,0 +1,169 @@
+/**
+ * swig interface for the batched resolution calculation
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+// the gil is released during the calls
+%module(threads="1") resolib
+%{
+	#include "tools/res_py/reso_lib.h"
+
+	#include <cstring>
+
+
+	/**
+	 * contiguous float64 buffer of a python object, e.g. a numpy array
+	 */
+	struct ResoLibBuffer
+	{
+		Py_buffer view;
+		bool bValid = false;
+
+		bool Get(PyObject *pObj, bool bWritable)
+		{
+			int iFlags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT;
+			if(bWritable)
+				iFlags |= PyBUF_WRITABLE;
+
+			if(PyObject_GetBuffer(pObj, &view, iFlags) < 0)
+				return false;
+			bValid = true;
+
+			if(view.itemsize != sizeof(double) || !view.format || std::strcmp(view.format, "d") != 0)
+			{
+				PyErr_SetString(PyExc_TypeError, "Expected a contiguous float64 array.");
+				return false;
+			}
+
+			return true;
+		}
+
+		~ResoLibBuffer()
+		{
+			if(bValid)
+				PyBuffer_Release(&view);
+		}
+	};
+%}
+
+
+%include "std_string.i"
+
+
+// input and output arrays, None is passed as a null pointer
+%typemap(in) const double *INARR (ResoLibBuffer buf)
+{
+	$1 = nullptr;
+	if($input != Py_None)
+	{
+		if(!buf.Get($input, false))
+			SWIG_fail;
+		$1 = static_cast<const double*>(buf.view.buf);
+	}
+}
+
+%typemap(in) double *OUTARR (ResoLibBuffer buf)
+{
+	$1 = nullptr;
+	if($input != Py_None)
+	{
+		if(!buf.Get($input, true))
+			SWIG_fail;
+		$1 = static_cast<double*>(buf.view.buf);
+	}
+}
+
+// types which are defined in headers that swig doesn't parse
+typedef double t_real_glob;
+typedef double t_real_reso;
+
+%apply const double *INARR { const t_real_reso *pQ, const t_real_reso *pE, const t_real_reso *pKFix };
+%apply double *OUTARR { t_real_reso *pReso, t_real_reso *pResoV, t_real_reso *pResoS,
+	t_real_reso *pR0, t_real_reso *pVol, t_real_reso *pQavg, t_real_reso *pBragg, t_real_reso *pEll };
+
+
+// the raw calculation is wrapped by calc() below, which allocates the output arrays
+%rename(_calc) ResoLib::Calc;
+%ignore ResoLib::CalcPoint;
+
+%include "tools/res_py/reso_lib.h"
+
+
+%extend ResoLib
+{
+%pythoncode
+%{
+    # entries of the python parameter dictionaries that are given per position
+    _per_pos_params = { "verbose", "calc_R0", "mirror_Qperp", "ki", "kf", "E", "Q" }
+
+    def set_params(self, params):
+        """
+        set the instrument parameters from a dictionary as used by pop.py and eck.py
+        """
+        for (key, val) in params.items():
+            if key in self._per_pos_params:
+                continue
+            if isinstance(val, str):
+                ok = self.SetParam(key, val)
+            else:
+                ok = self.SetParam(key, float(val))
+            if not ok:
+                raise KeyError("Unknown resolution parameter \"%s\"." % key)
+
+    def calc(self, Q, E, kfix = None, ellipses = True):
+        """
+        calculate the resolution for arrays of Q (in 1/A) and E (in meV) positions,
+        kfix optionally gives the fixed ki or kf (in 1/A) per position,
+        returns a dictionary of contiguous numpy arrays, invalid positions are NaN
+        """
+        import numpy as np
+
+        Q = np.ascontiguousarray(Q, dtype = np.float64).ravel()
+        E = np.ascontiguousarray(np.broadcast_to(E, Q.shape), dtype = np.float64)
+        if kfix is not None:
+            kfix = np.ascontiguousarray(np.broadcast_to(kfix, Q.shape), dtype = np.float64)
+
+        num = Q.shape[0]
+        res = {
+            "reso" : np.empty((num, 4, 4)),
+            "reso_v" : np.empty((num, 4)),
+            "reso_s" : np.empty(num),
+            "r0" : np.empty(num),
+            "res_vol" : np.empty(num),
+            "Q_avg" : np.empty((num, 4)),
+            "bragg" : np.empty((num, 4)),
+        }
+        if ellipses:
+            # angle, hwhm_x, hwhm_y, offs_x, offs_y for the Q_para-E, Q_perp-E, Q_z-E and Q_para-Q_perp planes
+            res["ellipses"] = np.empty((num, 4, 5))
+
+        res["num_ok"] = self._calc(Q, E, kfix, num,
+            res["reso"], res["reso_v"], res["reso_s"], res["r0"], res["res_vol"],
+            res["Q_avg"], res["bragg"], res.get("ellipses"))
+        res["ok"] = np.isfinite(res["r0"])
+        return res
+%}
+}
@@ -158,28 +158,29 @@ params = {
 }
 
 
-# calculate resolution ellipsoid using the given backend
-if reso_method == "eck":
-    res = eck.calc(params)
-elif reso_method == "pop":
-    res = pop.calc(params, False)
-elif reso_method == "cn":
-    res = pop.calc(params, True)
-else:
-    raise "ResPy: Invalid resolution calculation method selected."
-
-
-if not res["ok"]:
-    print("RESOLUTION CALCULATION FAILED!")
-    exit(-1)
-
-if verbose:
-    print("R0 = %g, Vol = %g" % (res["r0"], res["res_vol"]))
-    print("Resolution matrix:\n%s" % res["reso"])
-    print("Resolution vector: %s" % res["reso_v"])
-    print("Resolution scalar: %g" % res["reso_s"])
-
-
-# describe and plot ellipses
-ellipses = reso.calc_ellipses(res["reso"], verbose)
-reso.plot_ellipses(ellipses, verbose)
+if __name__ == "__main__":
+    # calculate resolution ellipsoid using the given backend
+    if reso_method == "eck":
+        res = eck.calc(params)
+    elif reso_method == "pop":
+        res = pop.calc(params, False)
+    elif reso_method == "cn":
+        res = pop.calc(params, True)
+    else:
+        raise "ResPy: Invalid resolution calculation method selected."
+
+
+    if not res["ok"]:
+        print("RESOLUTION CALCULATION FAILED!")
+        exit(-1)
+
+    if verbose:
+        print("R0 = %g, Vol = %g" % (res["r0"], res["res_vol"]))
+        print("Resolution matrix:\n%s" % res["reso"])
+        print("Resolution vector: %s" % res["reso_v"])
+        print("Resolution scalar: %g" % res["reso_s"])
+
+
+    # describe and plot ellipses
+    ellipses = reso.calc_ellipses(res["reso"], verbose)
+    reso.plot_ellipses(ellipses, verbose)
@@ -0,0 +1,73 @@
+#
+# compares the native resolution module with the python implementation
+#
+# @author Tobias Weber <tweber@ill.fr>
+# @date oct-2026
+# @license GPLv2
+#
+# ----------------------------------------------------------------------------
+# Takin (inelastic neutron scattering software package)
+# Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+#                          Grenoble, France).
+# Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+#                          (TUM), Garching, Germany).
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; version 2 of the License.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+# ----------------------------------------------------------------------------
+#
+
+# the module is built as _resolib.so together with resolib.py
+import time
+import numpy as np
+import helpers
+import pop
+import resolib
+
+# parameters of the test script
+import test
+
+
+kf = 1.4
+Qs = np.linspace(1., 2.5, 10000)
+Es = np.linspace(-1., 2., 10000)
+
+
+lib = resolib.ResoLib()
+lib.set_params(test.params)
+lib.SetAlgo("pop")
+lib.SetKiFix(False)
+lib.SetKFix(kf)
+
+t_start = time.time()
+res_lib = lib.calc(Qs, Es)
+t_lib = time.time() - t_start
+print("Native: %d of %d positions in %.3f s." % (res_lib["num_ok"], len(Qs), t_lib))
+
+
+# compare a few positions with the python implementation
+params = dict(test.params)
+params["verbose"] = False
+for idx in range(0, len(Qs), len(Qs)//10):
+    params["kf"] = kf
+    params["ki"] = np.sqrt(kf**2. + Es[idx] / helpers.ksq2E)
+    params["E"] = Es[idx]
+    params["Q"] = Qs[idx]
+
+    res_py = pop.calc(params, False)
+    if not res_py["ok"] or not res_lib["ok"][idx]:
+        print("Q = %.3f, E = %.3f: invalid position." % (Qs[idx], Es[idx]))
+        continue
+
+    dev = np.max(np.abs(res_py["reso"] - res_lib["reso"][idx])) / np.max(np.abs(res_py["reso"]))
+    print("Q = %.3f, E = %.3f: relative deviation of the resolution matrix: %g." % (Qs[idx], Es[idx], dev))
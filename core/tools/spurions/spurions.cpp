@@ -0,0 +1,812 @@
+/**
+ * batch spurion screening of measured and planned scans
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * @desc for the spurion types, see: (Shirane 2002), ch. 6
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "spurions.h"
+
+#include "tlibs/file/loadinstr.h"
+#include "tlibs/file/prop.h"
+#include "tlibs/phys/lattice.h"
+#include "tlibs/phys/neutrons.h"
+#include "tlibs/math/linalg.h"
+#include "tlibs/helper/thread.h"
+#include "tlibs/string/string.h"
+#include "tlibs/log/log.h"
+#include "libs/globals.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+
+using t_real = SpurionScreener::t_real;
+using t_vec = ublas::vector<t_real>;
+using t_mat = ublas::matrix<t_real>;
+
+static const auto angs = tl::get_one_angstrom<t_real>();
+static const auto rads = tl::get_one_radian<t_real>();
+static const auto meV = tl::get_one_meV<t_real>();
+
+// points per thread pool task
+static constexpr std::size_t g_iBlockSize = 64;
+
+
+
+// ----------------------------------------------------------------------------
+// powder lines
+
+/**
+ * gets the distinct powder lines of a lattice up to the given |Q|
+ * @param cCentring 'P', 'I' or 'F'
+ */
+std::vector<SpurionPowderLine> SpurionScreener::GetPowderLines(const std::string& strName,
+	const std::array<t_real, 6>& lattice, char cCentring, t_real dMaxQ)
+{
+	const tl::Lattice<t_real> latt(lattice[0], lattice[1], lattice[2],
+		tl::d2r(lattice[3]), tl::d2r(lattice[4]), tl::d2r(lattice[5]));
+	const t_mat matB = tl::get_B(latt, 1);
+
+	// maximum index along each axis
+	std::array<int, 3> iMax;
+	for(int i=0; i<3; ++i)
+	{
+		iMax[i] = int(std::ceil(dMaxQ * lattice[i] / (t_real(2)*tl::get_pi<t_real>())));
+		iMax[i] = std::max(iMax[i], 1) + 1;
+	}
+
+	std::vector<t_real> vecQs;
+	for(int h=-iMax[0]; h<=iMax[0]; ++h)
+	for(int k=-iMax[1]; k<=iMax[1]; ++k)
+	for(int l=-iMax[2]; l<=iMax[2]; ++l)
+	{
+		if(h==0 && k==0 && l==0)
+			continue;
+		if(cCentring == 'I' && (h+k+l) % 2 != 0)
+			continue;
+		if(cCentring == 'F' && !((h%2==0 && k%2==0 && l%2==0) || (h%2!=0 && k%2!=0 && l%2!=0)))
+			continue;
+
+		const t_real dQ = ublas::norm_2(ublas::prod(matB, tl::make_vec<t_vec>({t_real(h), t_real(k), t_real(l)})));
+		if(dQ <= dMaxQ)
+			vecQs.push_back(dQ);
+	}
+
+	std::sort(vecQs.begin(), vecQs.end());
+
+	std::vector<SpurionPowderLine> vecLines;
+	for(t_real dQ : vecQs)
+	{
+		if(vecLines.size() && tl::float_equal<t_real>(vecLines.rbegin()->Q, dQ, g_dEps))
+			continue;
+
+		SpurionPowderLine line;
+		line.name = strName;
+		line.Q = dQ;
+		vecLines.emplace_back(std::move(line));
+	}
+
+	return vecLines;
+}
+
+
+/**
+ * common sample environment materials
+ */
+bool SpurionScreener::GetEnvironmentMaterial(const std::string& strName, SpurionMaterial& mat)
+{
+	static const std::vector<SpurionMaterial> vecMaterials =
+	{
+		SpurionMaterial{"Al", 4.0495, 'F'},
+		SpurionMaterial{"Cu", 3.6149, 'F'},
+		SpurionMaterial{"V", 3.0240, 'I'},
+		SpurionMaterial{"Nb", 3.3004, 'I'},
+		SpurionMaterial{"Fe", 2.8665, 'I'},
+	};
+
+	for(const SpurionMaterial& matCur : vecMaterials)
+	{
+		if(matCur.name == strName)
+		{
+			mat = matCur;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/**
+ * adds a sample environment material whose powder lines are checked,
+ * given either by name or as "name:a:centring", e.g. "Al:4.0495:F"
+ */
+bool SpurionScreener::AddEnvironment(const std::string& strMaterial)
+{
+	std::vector<std::string> vecToks;
+	tl::get_tokens<std::string, std::string>(strMaterial, ":", vecToks);
+	if(vecToks.size() == 0)
+		return false;
+
+	SpurionMaterial mat;
+	if(vecToks.size() == 1)
+	{
+		if(!GetEnvironmentMaterial(vecToks[0], mat))
+		{
+			tl::log_err("Unknown sample environment material \"", vecToks[0], "\".");
+			return false;
+		}
+	}
+	else
+	{
+		mat.name = vecToks[0];
+		mat.a = tl::str_to_var_parse<t_real>(vecToks[1]);
+		mat.centring = 'P';
+		if(vecToks.size() >= 3 && vecToks[2].length())
+			mat.centring = char(std::toupper(vecToks[2][0]));
+	}
+
+	m_vecEnv.emplace_back(std::move(mat));
+	return true;
+}
+
+
+/**
+ * powder lines of the environment and, optionally, the sample
+ * up to the highest |Q| reachable by the harmonics of the scan
+ */
+std::vector<SpurionPowderLine> SpurionScreener::GetScanPowderLines(const SpurionScan& scan) const
+{
+	std::vector<SpurionPowderLine> vecLines;
+	if(!m_vecEnv.size() && !m_bSamplePowder)
+		return vecLines;
+
+	t_real dMaxK = scan.kfix;
+	for(const std::array<t_real, 4>& pt : scan.points)
+	{
+		const t_real dK2 = scan.kfix*scan.kfix + (scan.kifix ? -pt[3] : pt[3]) / tl::get_KSQ2E<t_real>();
+		if(dK2 > t_real(0))
+			dMaxK = std::max(dMaxK, std::sqrt(dK2));
+	}
+	const t_real dMaxQ = t_real(2*m_iMaxOrder) * dMaxK;
+
+	for(const SpurionMaterial& mat : m_vecEnv)
+	{
+		std::vector<SpurionPowderLine> vecMatLines = GetPowderLines(mat.name,
+			{{ mat.a, mat.a, mat.a, 90, 90, 90 }}, mat.centring, dMaxQ);
+		vecLines.insert(vecLines.end(), vecMatLines.begin(), vecMatLines.end());
+	}
+
+	if(m_bSamplePowder)
+	{
+		std::vector<SpurionPowderLine> vecSampleLines = GetPowderLines("sample", scan.lattice, 'P', dMaxQ);
+		vecLines.insert(vecLines.end(), vecSampleLines.begin(), vecSampleLines.end());
+	}
+
+	std::sort(vecLines.begin(), vecLines.end(),
+		[](const SpurionPowderLine& line1, const SpurionPowderLine& line2) -> bool
+		{ return line1.Q < line2.Q; });
+
+	return vecLines;
+}
+
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// scans
+
+bool SpurionScreener::LoadInstrument(const std::string& strFile)
+{
+	if(!m_reso.LoadRes(strFile.c_str()))
+		return false;
+
+	// the spurion types are only defined for triple-axis instruments
+	if(m_reso.GetResoParams().ki*angs <= t_real(0))
+		tl::log_warn("Instrument file \"", strFile, "\" has no valid ki.");
+	return true;
+}
+
+
+/**
+ * adds the points of a measured scan file
+ */
+bool SpurionScreener::AddScanFile(const std::string& strFile)
+{
+	std::unique_ptr<tl::FileInstrBase<t_real>> pInstr(
+		tl::FileInstrBase<t_real>::LoadInstr(strFile.c_str()));
+	if(!pInstr)
+	{
+		tl::log_err("Cannot load scan file \"", strFile, "\".");
+		return false;
+	}
+
+	SpurionScan scan;
+	scan.name = tl::get_file_nodir(strFile);
+
+	const std::array<t_real, 3> latt = pInstr->GetSampleLattice();
+	const std::array<t_real, 3> ang = pInstr->GetSampleAngles();
+	scan.lattice = {{ latt[0], latt[1], latt[2], tl::r2d(ang[0]), tl::r2d(ang[1]), tl::r2d(ang[2]) }};
+	scan.plane1 = pInstr->GetScatterPlane0();
+	scan.plane2 = pInstr->GetScatterPlane1();
+	scan.kifix = pInstr->IsKiFixed();
+	scan.kfix = pInstr->GetKFix();
+
+	for(std::size_t iPt=0; iPt<pInstr->GetScanCount(); ++iPt)
+	{
+		// h, k, l, ki, kf
+		const std::array<t_real, 5> sc = pInstr->GetScanHKLKiKf(iPt);
+		const t_real dE = tl::get_KSQ2E<t_real>() * (sc[3]*sc[3] - sc[4]*sc[4]);
+		scan.points.push_back({{ sc[0], sc[1], sc[2], dE }});
+	}
+
+	m_vecScans.emplace_back(std::move(scan));
+	return true;
+}
+
+
+/**
+ * adds planned scans, one per line: "h1 k1 l1 E1  h2 k2 l2 E2  steps  [name]",
+ * the lines "ki <k>" and "kf <k>" set the fixed wavenumber for the following scans
+ */
+bool SpurionScreener::AddPlannedScans(const std::string& strFile, const std::string& strCrysFile)
+{
+	SpurionScan scanTemplate;
+	scanTemplate.kifix = false;
+	scanTemplate.kfix = m_reso.GetResoParams().kf * angs;
+
+	// sample lattice and scattering plane
+	if(strCrysFile != "")
+	{
+		const std::string strXmlRoot("taz/");
+
+		tl::Prop<std::string> xml;
+		if(!xml.Load(strCrysFile, tl::PropType::XML))
+		{
+			tl::log_err("Cannot load crystal file \"", strCrysFile, "\".");
+			return false;
+		}
+
+		const char* pcLatt[] = { "sample/a", "sample/b", "sample/c",
+			"sample/alpha", "sample/beta", "sample/gamma" };
+		const char* pcPlane[] = { "plane/x0", "plane/x1", "plane/x2",
+			"plane/y0", "plane/y1", "plane/y2" };
+
+		for(int i=0; i<6; ++i)
+			scanTemplate.lattice[i] = xml.Query<t_real>(strXmlRoot + pcLatt[i], scanTemplate.lattice[i]);
+		for(int i=0; i<3; ++i)
+		{
+			scanTemplate.plane1[i] = xml.Query<t_real>(strXmlRoot + pcPlane[i], scanTemplate.plane1[i]);
+			scanTemplate.plane2[i] = xml.Query<t_real>(strXmlRoot + pcPlane[i+3], scanTemplate.plane2[i]);
+		}
+	}
+
+	std::ifstream ifstr(strFile);
+	if(!ifstr)
+	{
+		tl::log_err("Cannot open planned scan file \"", strFile, "\".");
+		return false;
+	}
+
+	std::size_t iLine = 0;
+	std::string strLine;
+	while(std::getline(ifstr, strLine))
+	{
+		++iLine;
+		tl::trim(strLine);
+		if(strLine.length()==0 || strLine[0]=='#')
+			continue;
+
+		std::istringstream istr(strLine);
+
+		// fixed wavenumber
+		if(strLine[0]=='k')
+		{
+			std::string strKey;
+			istr >> strKey >> scanTemplate.kfix;
+			scanTemplate.kifix = (strKey == "ki");
+			continue;
+		}
+
+		std::array<t_real, 4> vecStart, vecEnd;
+		std::size_t iSteps = 0;
+		for(t_real& d : vecStart) istr >> d;
+		for(t_real& d : vecEnd) istr >> d;
+		istr >> iSteps;
+
+		if(!istr || iSteps == 0)
+		{
+			tl::log_err("Invalid scan definition in line ", iLine, " of \"", strFile, "\".");
+			return false;
+		}
+
+		SpurionScan scan = scanTemplate;
+		istr >> scan.name;
+		if(scan.name == "")
+			scan.name = tl::get_file_nodir(strFile) + ":" + tl::var_to_str(iLine);
+
+		for(std::size_t iStep=0; iStep<iSteps; ++iStep)
+		{
+			const t_real dFrac = iSteps > 1 ? t_real(iStep) / t_real(iSteps-1) : t_real(0);
+
+			std::array<t_real, 4> vecPt;
+			for(int i=0; i<4; ++i)
+				vecPt[i] = tl::lerp(vecStart[i], vecEnd[i], dFrac);
+			scan.points.push_back(vecPt);
+		}
+
+		m_vecScans.emplace_back(std::move(scan));
+	}
+
+	return true;
+}
+
+
+std::size_t SpurionScreener::GetNumPoints() const
+{
+	std::size_t iNum = 0;
+	for(const SpurionScan& scan : m_vecScans)
+		iNum += scan.points.size();
+	return iNum;
+}
+
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// screening
+
+const char* SpurionScreener::GetTypeName(SpurionType ty)
+{
+	switch(ty)
+	{
+		case SpurionType::BRAGG: return "bragg";
+		case SpurionType::HIGHER_ORDER: return "higher_order";
+		case SpurionType::INCOHERENT: return "incoherent";
+		case SpurionType::POWDER: return "powder";
+		case SpurionType::BRAGG_TAIL: return "bragg_tail";
+		case SpurionType::CURRAT_AXE_A: return "currat_axe_a";
+		case SpurionType::CURRAT_AXE_M: return "currat_axe_m";
+	}
+
+	return "unknown";
+}
+
+
+/**
+ * tests a scan point for all spurion types
+ *
+ * all vectors are given in the orientation system in 1/A, with Q = ki - kf and E = Ei - Ef,
+ * the overlap with a spurious position is decided using the resolution matrix of the
+ * nominal point; for higher-order wavelengths the Q and E widths are scaled by the order
+ * and its square, respectively; the lattice and the fixed k of the scan have to be set in reso
+ */
+void SpurionScreener::ScreenPoint(const SpurionScan& scan, std::size_t iScan, std::size_t iPt, TASReso& reso,
+	const std::vector<SpurionPowderLine>& vecLines, std::vector<SpurionHit>& vecHits) const
+{
+	const std::array<t_real, 4>& pt = scan.points[iPt];
+
+	if(!reso.SetHKLE(pt[0], pt[1], pt[2], pt[3]))
+		return;
+
+	const EckParams& params = reso.GetResoParams();
+	const t_mat& matReso = reso.GetResoResults().reso;
+
+	t_mat matUB = reso.GetMCOpts().matUB, matUBinv = reso.GetMCOpts().matUBinv;
+	matUB.resize(3, 3, true);
+	matUBinv.resize(3, 3, true);
+
+	const t_real dKi = params.ki * angs;
+	const t_real dKf = params.kf * angs;
+	const t_real dSigma2 = m_dSigma * m_dSigma;
+
+	// basis of the resolution matrix: Q_para, Q_perp, Q_up
+	const t_vec vecQ = ublas::prod(matUB, tl::make_vec<t_vec>({pt[0], pt[1], pt[2]}));
+	const t_real dQ = ublas::norm_2(vecQ);
+	if(tl::float_equal<t_real>(dQ, 0., g_dEps))
+		return;
+
+	const t_vec vecUp = tl::make_vec<t_vec>({0, 0, 1});
+	const t_vec vecQPara = vecQ / dQ;
+	const t_vec vecQPerp = tl::cross_3(vecUp, vecQPara);
+
+	const t_real dAngleKiQ = params.angle_ki_Q/rads * params.dsample_sense;
+	const t_vec vecKi = dKi * (std::cos(dAngleKiQ)*vecQPara + std::sin(dAngleKiQ)*vecQPerp);
+	const t_vec vecKf = vecKi - vecQ;
+	const t_vec vecKiDir = vecKi / dKi;
+	const t_vec vecKfDir = vecKf / dKf;
+
+
+	// squared mahalanobis distance of a (Q, E) offset, with widths scaled by the given factors
+	auto dist2 = [&](const t_vec& vecDQ, t_real dDE, t_real dScaleQ = 1, t_real dScaleE = 1) -> t_real
+	{
+		const t_vec vecD = tl::make_vec<t_vec>({
+			ublas::inner_prod(vecDQ, vecQPara) / dScaleQ,
+			ublas::inner_prod(vecDQ, vecQPerp) / dScaleQ,
+			ublas::inner_prod(vecDQ, vecUp) / dScaleQ,
+			dDE / dScaleE });
+		return ublas::inner_prod(vecD, ublas::prod(matReso, vecD));
+	};
+
+	// squared mahalanobis distance of a Q offset, the energy is integrated out
+	const t_real dMEE = matReso(3, 3);
+	auto dist2_Q = [&](const t_vec& vecDQ) -> t_real
+	{
+		const t_vec vecD = tl::make_vec<t_vec>({
+			ublas::inner_prod(vecDQ, vecQPara),
+			ublas::inner_prod(vecDQ, vecQPerp),
+			ublas::inner_prod(vecDQ, vecUp) });
+
+		t_real dDist2 = 0, dMixed = 0;
+		for(int i=0; i<3; ++i)
+		{
+			dMixed += matReso(3, i) * vecD[i];
+			for(int j=0; j<3; ++j)
+				dDist2 += vecD[i] * matReso(i, j) * vecD[j];
+		}
+		if(dMEE > t_real(0))
+			dDist2 -= dMixed*dMixed / dMEE;
+		return dDist2;
+	};
+
+	// widths, the other components are integrated out
+	t_mat matCov;
+	const bool bHasCov = tl::inverse(matReso, matCov);
+	const t_real dSigE = bHasCov ? std::sqrt(std::abs(matCov(3, 3))) : t_real(0);
+	const t_real dSigQ = bHasCov ? std::sqrt(std::abs(matCov(0, 0) + matCov(1, 1) + matCov(2, 2))) : dQ;
+
+	// visits the Bragg peaks around a point in 1/A
+	auto for_bragg = [&](const t_vec& vecPos, const std::function<void(const t_vec&, const t_vec&)>& func)
+	{
+		const t_vec vecHKL = ublas::prod(matUBinv, vecPos);
+		for(int h=int(std::round(vecHKL[0]))-1; h<=int(std::round(vecHKL[0]))+1; ++h)
+		for(int k=int(std::round(vecHKL[1]))-1; k<=int(std::round(vecHKL[1]))+1; ++k)
+		for(int l=int(std::round(vecHKL[2]))-1; l<=int(std::round(vecHKL[2]))+1; ++l)
+		{
+			if(h==0 && k==0 && l==0)
+				continue;
+			const t_vec vecG_rlu = tl::make_vec<t_vec>({t_real(h), t_real(k), t_real(l)});
+			func(vecG_rlu, ublas::prod(matUB, vecG_rlu));
+		}
+	};
+
+	auto bragg_name = [](const t_vec& vecG_rlu) -> std::string
+	{
+		std::ostringstream ostr;
+		ostr << "(" << int(vecG_rlu[0]) << " " << int(vecG_rlu[1]) << " " << int(vecG_rlu[2]) << ")";
+		return ostr.str();
+	};
+
+	// keeps the closest spurion per type and order
+	auto add_hit = [&](SpurionType ty, unsigned int iMono, unsigned int iAna,
+		const std::string& strFeature, t_real dDist2)
+	{
+		if(dDist2 > dSigma2)
+			return;
+
+		const t_real dDist = std::sqrt(std::max(dDist2, t_real(0)));
+		for(auto iter=vecHits.rbegin(); iter!=vecHits.rend(); ++iter)
+		{
+			if(iter->scan != iScan || iter->point != iPt)
+				break;
+			if(iter->type == ty && iter->order_mono == iMono && iter->order_ana == iAna)
+			{
+				if(dDist < iter->dist)
+				{
+					iter->dist = dDist;
+					iter->feature = strFeature;
+				}
+				return;
+			}
+		}
+
+		SpurionHit hit;
+		hit.scan = iScan;
+		hit.point = iPt;
+		hit.type = ty;
+		hit.order_mono = iMono;
+		hit.order_ana = iAna;
+		hit.feature = strFeature;
+		hit.dist = dDist;
+		vecHits.emplace_back(std::move(hit));
+	};
+
+
+	// higher-order wavelengths passing mono and analyser at the same angles
+	for(unsigned int iMono=1; iMono<=m_iMaxOrder; ++iMono)
+	for(unsigned int iAna=1; iAna<=m_iMaxOrder; ++iAna)
+	{
+		const bool bNominal = (iMono==1 && iAna==1);
+		const t_real dScaleQ = t_real(std::max(iMono, iAna));
+		const t_real dScaleE = dScaleQ*dScaleQ;
+
+		const t_vec vecQOrd = t_real(iMono)*vecKi - t_real(iAna)*vecKf;
+		const t_real dQOrd = ublas::norm_2(vecQOrd);
+		const t_real dEOrd = tl::get_KSQ2E<t_real>() *
+			(t_real(iMono*iMono)*dKi*dKi - t_real(iAna*iAna)*dKf*dKf);
+
+		// Bragg scattering of the sample, for the nominal wavelengths: elastic leakage
+		for_bragg(vecQOrd, [&](const t_vec& vecG_rlu, const t_vec& vecG)
+		{
+			add_hit(bNominal ? SpurionType::BRAGG : SpurionType::HIGHER_ORDER, iMono, iAna,
+				bragg_name(vecG_rlu), dist2(vecQOrd - vecG, dEOrd, dScaleQ, dScaleE));
+		});
+
+		// incoherent elastic scattering, equal orders only reach it at the nominal elastic line
+		if(iMono != iAna && dSigE > t_real(0))
+		{
+			const t_real dDistE = dEOrd / (dScaleE * dSigE);
+			add_hit(SpurionType::INCOHERENT, iMono, iAna, "incoherent", dDistE*dDistE);
+		}
+
+		// powder lines, using the closest point on the powder sphere
+		if(vecLines.size() && dQOrd > t_real(0))
+		{
+			const t_vec vecQOrdDir = vecQOrd / dQOrd;
+			const t_real dWindow = m_dSigma * dScaleQ * dSigQ;
+
+			auto iterBegin = std::lower_bound(vecLines.begin(), vecLines.end(), dQOrd - dWindow,
+				[](const SpurionPowderLine& line, t_real dVal) -> bool { return line.Q < dVal; });
+			for(auto iter=iterBegin; iter!=vecLines.end() && iter->Q <= dQOrd + dWindow; ++iter)
+			{
+				add_hit(SpurionType::POWDER, iMono, iAna,
+					iter->name + "@" + tl::var_to_str(iter->Q, g_iPrec),
+					dist2((dQOrd - iter->Q)*vecQOrdDir, dEOrd, dScaleQ, dScaleE));
+			}
+		}
+	}
+
+
+	// Bragg tails along the ki and kf directions
+	const t_real dKFix = scan.kifix ? dKi : dKf;
+	for_bragg(vecQ, [&](const t_vec& vecG_rlu, const t_vec& vecG)
+	{
+		const t_vec vecq = vecQ - vecG;
+		for(const t_vec* pDir : { &vecKiDir, &vecKfDir })
+		{
+			const t_real dqPara = ublas::inner_prod(vecq, *pDir);
+			// close to G the tail merges with the Bragg peak itself
+			if(std::abs(dqPara) > m_dMaxTailQ || std::abs(dqPara) < dSigQ)
+				continue;
+
+			const t_real dETail = tl::get_bragg_tail(dKFix/angs, dqPara/angs, scan.kifix) / meV;
+			add_hit(SpurionType::BRAGG_TAIL, 1, 1, bragg_name(vecG_rlu),
+				dist2(vecq - dqPara*(*pDir), pt[3] - dETail));
+		}
+	});
+
+
+	// accidental Bragg scattering, see (Shirane 2002), fig. 6.2:
+	// A type: the sample reflects ki into the analyser direction, Q - G = (ki - kf) kf_dir
+	// M type: the sample reflects kf, coming from the monochromator, Q - G = (ki - kf) ki_dir
+	// close to the elastic line the shift is not resolved and the hit is ordinary Bragg scattering
+	if(std::abs(dKi - dKf) > m_dSigma * dSigQ)
+	{
+		const t_vec vecShiftA = (dKi - dKf) * vecKfDir;
+		const t_vec vecShiftM = (dKi - dKf) * vecKiDir;
+
+		for_bragg(vecQ - vecShiftA, [&](const t_vec& vecG_rlu, const t_vec& vecG)
+		{
+			add_hit(SpurionType::CURRAT_AXE_A, 1, 1, bragg_name(vecG_rlu),
+				dist2_Q(vecQ - vecG - vecShiftA));
+		});
+
+		for_bragg(vecQ - vecShiftM, [&](const t_vec& vecG_rlu, const t_vec& vecG)
+		{
+			add_hit(SpurionType::CURRAT_AXE_M, 1, 1, bragg_name(vecG_rlu),
+				dist2_Q(vecQ - vecG - vecShiftM));
+		});
+	}
+}
+
+
+/**
+ * screens all scan points in parallel
+ */
+std::vector<SpurionHit> SpurionScreener::Screen() const
+{
+	// (point, scan) index pairs
+	std::vector<std::pair<std::size_t, std::size_t>> vecPts;
+	vecPts.reserve(GetNumPoints());
+	for(std::size_t iScan=0; iScan<m_vecScans.size(); ++iScan)
+		for(std::size_t iPt=0; iPt<m_vecScans[iScan].points.size(); ++iPt)
+			vecPts.emplace_back(std::make_pair(iScan, iPt));
+
+	const unsigned int iNumThreads = std::max<unsigned int>(1,
+		m_iMaxThreads ? m_iMaxThreads : get_max_threads());
+	tl::log_debug("Screening ", vecPts.size(), " point(s) using ", iNumThreads,
+		(iNumThreads == 1 ? " thread." : " threads."));
+
+	std::vector<std::vector<SpurionPowderLine>> vecScanLines;
+	vecScanLines.reserve(m_vecScans.size());
+	for(const SpurionScan& scan : m_vecScans)
+		vecScanLines.emplace_back(GetScanPowderLines(scan));
+
+	using t_task = std::vector<SpurionHit>;
+	tl::ThreadPool<t_task()> tp(iNumThreads);
+
+	for(std::size_t iBlock=0; iBlock<vecPts.size(); iBlock+=g_iBlockSize)
+	{
+		const std::size_t iEnd = std::min(iBlock + g_iBlockSize, vecPts.size());
+
+		tp.AddTask([this, &vecPts, &vecScanLines, iBlock, iEnd]() -> t_task
+		{
+			TASReso reso = m_reso;
+			std::size_t iCurScan = m_vecScans.size();
+			t_task vecHits;
+
+			for(std::size_t iIdx=iBlock; iIdx<iEnd; ++iIdx)
+			{
+				const std::size_t iScan = vecPts[iIdx].first;
+				const std::size_t iPt = vecPts[iIdx].second;
+
+				// set up the scan's crystal
+				if(iScan != iCurScan)
+				{
+					const SpurionScan& scan = m_vecScans[iScan];
+					iCurScan = iScan;
+
+					reso.SetLattice(scan.lattice[0], scan.lattice[1], scan.lattice[2],
+						tl::d2r(scan.lattice[3]), tl::d2r(scan.lattice[4]), tl::d2r(scan.lattice[5]),
+						tl::make_vec<t_vec>({scan.plane1[0], scan.plane1[1], scan.plane1[2]}),
+						tl::make_vec<t_vec>({scan.plane2[0], scan.plane2[1], scan.plane2[2]}));
+					reso.SetKiFix(scan.kifix);
+					reso.SetKFix(scan.kfix);
+				}
+
+				try
+				{
+					ScreenPoint(m_vecScans[iScan], iScan, iPt, reso, vecScanLines[iScan], vecHits);
+				}
+				catch(const std::exception& ex)
+				{
+					tl::log_err("Cannot screen point ", iPt+1, " of scan \"",
+						m_vecScans[iScan].name, "\": ", ex.what());
+				}
+			}
+
+			return vecHits;
+		});
+	}
+
+	tp.Start();
+
+	std::vector<SpurionHit> vecHits;
+	for(auto& fut : tp.GetResults())
+	{
+		t_task vecBlockHits = fut.get();
+		vecHits.insert(vecHits.end(), vecBlockHits.begin(), vecBlockHits.end());
+	}
+
+	return vecHits;
+}
+
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// output
+
+/**
+ * writes a table of the flagged points
+ */
+bool SpurionScreener::SaveTable(const std::string& strFile, const std::vector<SpurionHit>& vecHits) const
+{
+	std::ofstream ofstr(strFile);
+	if(!ofstr)
+	{
+		tl::log_err("Cannot open output file \"", strFile, "\".");
+		return false;
+	}
+
+	ofstr.precision(g_iPrec);
+	ofstr << "#\n# Flagged scan points, distances are given in units of the resolution sigma.\n#\n";
+	ofstr << "# " << std::left
+		<< std::setw(24) << "scan" << " " << std::setw(6) << "point" << " "
+		<< std::setw(10) << "h" << " " << std::setw(10) << "k" << " "
+		<< std::setw(10) << "l" << " " << std::setw(10) << "E" << " "
+		<< std::setw(14) << "type" << " " << std::setw(4) << "n" << " " << std::setw(4) << "m" << " "
+		<< std::setw(20) << "feature" << " " << "dist\n";
+
+	for(const SpurionHit& hit : vecHits)
+	{
+		const SpurionScan& scan = m_vecScans[hit.scan];
+		const std::array<t_real, 4>& pt = scan.points[hit.point];
+
+		ofstr << "  " << std::left
+			<< std::setw(24) << scan.name << " " << std::setw(6) << (hit.point+1) << " "
+			<< std::setw(10) << pt[0] << " " << std::setw(10) << pt[1] << " "
+			<< std::setw(10) << pt[2] << " " << std::setw(10) << pt[3] << " "
+			<< std::setw(14) << GetTypeName(hit.type) << " "
+			<< std::setw(4) << hit.order_mono << " " << std::setw(4) << hit.order_ana << " "
+			<< std::setw(20) << hit.feature << " " << hit.dist << "\n";
+	}
+
+	return true;
+}
+
+
+/**
+ * writes the number of flagged points per scan and spurion type
+ */
+bool SpurionScreener::SaveSummary(const std::string& strFile, const std::vector<SpurionHit>& vecHits) const
+{
+	std::ofstream ofstr(strFile);
+	if(!ofstr)
+	{
+		tl::log_err("Cannot open output file \"", strFile, "\".");
+		return false;
+	}
+
+	const std::size_t iNumTypes = std::size_t(SpurionType::CURRAT_AXE_M) + 1;
+
+	// flagged points per scan and type
+	std::vector<std::vector<std::vector<bool>>> vecFlags(m_vecScans.size());
+	for(std::size_t iScan=0; iScan<m_vecScans.size(); ++iScan)
+	{
+		vecFlags[iScan].resize(iNumTypes + 1);
+		for(std::vector<bool>& vec : vecFlags[iScan])
+			vec.resize(m_vecScans[iScan].points.size(), false);
+	}
+
+	for(const SpurionHit& hit : vecHits)
+	{
+		vecFlags[hit.scan][std::size_t(hit.type)][hit.point] = true;
+		vecFlags[hit.scan][iNumTypes][hit.point] = true;
+	}
+
+	ofstr << "#\n# Number of flagged points per scan.\n#\n";
+	ofstr << "# " << std::left << std::setw(24) << "scan" << " "
+		<< std::setw(8) << "points" << " " << std::setw(8) << "flagged";
+	for(std::size_t iType=0; iType<iNumTypes; ++iType)
+		ofstr << " " << std::setw(14) << GetTypeName(SpurionType(iType));
+	ofstr << "\n";
+
+	for(std::size_t iScan=0; iScan<m_vecScans.size(); ++iScan)
+	{
+		auto count = [](const std::vector<bool>& vec) -> std::size_t
+		{ return std::count(vec.begin(), vec.end(), true); };
+
+		ofstr << "  " << std::left << std::setw(24) << m_vecScans[iScan].name << " "
+			<< std::setw(8) << m_vecScans[iScan].points.size() << " "
+			<< std::setw(8) << count(vecFlags[iScan][iNumTypes]);
+		for(std::size_t iType=0; iType<iNumTypes; ++iType)
+			ofstr << " " << std::setw(14) << count(vecFlags[iScan][iType]);
+		ofstr << "\n";
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
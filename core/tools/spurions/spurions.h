@@ -0,0 +1,157 @@
+/**
+ * batch spurion screening of measured and planned scans
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * @desc for the spurion types, see: (Shirane 2002), ch. 6
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __TAKIN_SPURIONS_H__
+#define __TAKIN_SPURIONS_H__
+
+#include <string>
+#include <vector>
+#include <array>
+
+#include "../monteconvo/TASReso.h"
+#include "../res/defs.h"
+
+
+enum class SpurionType : unsigned int
+{
+	BRAGG = 0,          // elastic Bragg intensity inside the resolution ellipsoid
+	HIGHER_ORDER,       // Bragg scattering of higher-order mono/ana wavelengths
+	INCOHERENT,         // incoherent elastic scattering of higher-order wavelengths
+	POWDER,             // powder line of the sample or its environment
+	BRAGG_TAIL,         // Bragg tail along ki or kf
+	CURRAT_AXE_A,       // accidental Bragg scattering, incoherent analyser scattering
+	CURRAT_AXE_M,       // accidental Bragg scattering, incoherent monochromator scattering
+};
+
+
+/**
+ * a powder line at the given |Q|
+ */
+struct SpurionPowderLine
+{
+	std::string name;
+	t_real_reso Q = 0;                  // in 1/A
+};
+
+
+/**
+ * a cubic sample environment material
+ */
+struct SpurionMaterial
+{
+	std::string name;
+	t_real_reso a = 4.0495;             // in A
+	char centring = 'F';                // 'P', 'I' or 'F'
+};
+
+
+/**
+ * a planned or measured scan
+ */
+struct SpurionScan
+{
+	std::string name;
+
+	std::array<t_real_reso, 6> lattice{{ 5, 5, 5, 90, 90, 90 }};   // in A and deg
+	std::array<t_real_reso, 3> plane1{{ 1, 0, 0 }};
+	std::array<t_real_reso, 3> plane2{{ 0, 1, 0 }};
+	bool kifix = false;
+	t_real_reso kfix = 1.4;              // in 1/A
+
+	// points: h, k, l (rlu), E (meV)
+	std::vector<std::array<t_real_reso, 4>> points;
+};
+
+
+/**
+ * a scan point which may be affected by a spurion
+ */
+struct SpurionHit
+{
+	std::size_t scan = 0, point = 0;
+	SpurionType type = SpurionType::BRAGG;
+	unsigned int order_mono = 1, order_ana = 1;
+
+	std::string feature;                // Bragg peak or powder line causing the spurion
+	t_real_reso dist = 0;               // distance to the resolution ellipsoid centre in units of sigma
+};
+
+
+class SpurionScreener
+{
+public:
+	using t_real = t_real_reso;
+
+protected:
+	TASReso m_reso;                     // instrument resolution parameters
+	std::vector<SpurionScan> m_vecScans;
+	std::vector<SpurionMaterial> m_vecEnv;
+
+	unsigned int m_iMaxOrder = 3;       // highest mono and ana harmonic
+	t_real m_dSigma = 2;                // overlap cutoff in units of sigma
+	t_real m_dMaxTailQ = 0.25;          // maximum distance to a Bragg peak for tails, in 1/A
+	bool m_bSamplePowder = false;       // also check the sample's powder lines
+	unsigned int m_iMaxThreads = 0;
+
+public:
+	std::vector<SpurionPowderLine> GetScanPowderLines(const SpurionScan& scan) const;
+	void ScreenPoint(const SpurionScan& scan, std::size_t iScan, std::size_t iPt, TASReso& reso,
+		const std::vector<SpurionPowderLine>& vecLines, std::vector<SpurionHit>& vecHits) const;
+
+	static std::vector<SpurionPowderLine> GetPowderLines(const std::string& strName,
+		const std::array<t_real, 6>& lattice, char cCentring, t_real dMaxQ);
+	static bool GetEnvironmentMaterial(const std::string& strName, SpurionMaterial& mat);
+	static const char* GetTypeName(SpurionType ty);
+
+	bool LoadInstrument(const std::string& strFile);
+	bool AddScanFile(const std::string& strFile);
+	bool AddPlannedScans(const std::string& strFile, const std::string& strCrysFile);
+	void AddScan(const SpurionScan& scan) { m_vecScans.push_back(scan); }
+	bool AddEnvironment(const std::string& strMaterial);
+
+	void SetMaxOrder(unsigned int iOrder) { m_iMaxOrder = iOrder ? iOrder : 1; }
+	void SetSigma(t_real dSigma) { m_dSigma = dSigma; }
+	void SetMaxTailQ(t_real dQ) { m_dMaxTailQ = dQ; }
+	void SetSamplePowder(bool b) { m_bSamplePowder = b; }
+	void SetMaxThreads(unsigned int iNum) { m_iMaxThreads = iNum; }
+
+	const TASReso& GetReso() const { return m_reso; }
+	const std::vector<SpurionScan>& GetScans() const { return m_vecScans; }
+	unsigned int GetMaxThreads() const { return m_iMaxThreads; }
+	std::size_t GetNumPoints() const;
+
+	std::vector<SpurionHit> Screen() const;
+
+	bool SaveTable(const std::string& strFile, const std::vector<SpurionHit>& vecHits) const;
+	bool SaveSummary(const std::string& strFile, const std::vector<SpurionHit>& vecHits) const;
+};
+
+
+#endif
@@ -0,0 +1,243 @@
+/**
+ * batch spurion screening of measured and planned scans -- CLI program
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+// e.g. takin_spurions --instr=instr.taz --env=Al --out=flagged.dat --summary=summary.dat data/
+//      takin_spurions --instr=instr.taz --crys=crys.taz --planned=beamtime.txt --env=Al --env=Cu
+
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "spurions.h"
+#include "libs/globals.h"
+
+#include "tlibs/log/log.h"
+#include "tlibs/time/stopwatch.h"
+
+namespace opts = boost::program_options;
+namespace fs = boost::filesystem;
+namespace sys = boost::system;
+
+using t_real = SpurionScreener::t_real;
+
+
+/**
+ * gets the scan files, directories are searched (non-recursively)
+ */
+static std::vector<std::string> get_scan_files(const std::vector<std::string>& vecInputs)
+{
+	std::vector<std::string> vecFiles;
+
+	for(const std::string& strInput : vecInputs)
+	{
+		sys::error_code err;
+		if(fs::is_directory(strInput, err))
+		{
+			std::vector<std::string> vecDirFiles;
+			for(fs::directory_iterator iter(strInput, err); iter!=fs::directory_iterator(); iter.increment(err))
+			{
+				if(err)
+					break;
+				if(fs::is_regular_file(iter->path()))
+					vecDirFiles.push_back(iter->path().string());
+			}
+
+			std::sort(vecDirFiles.begin(), vecDirFiles.end());
+			vecFiles.insert(vecFiles.end(), vecDirFiles.begin(), vecDirFiles.end());
+		}
+		else
+		{
+			vecFiles.push_back(strInput);
+		}
+	}
+
+	return vecFiles;
+}
+
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		tl::log_info("--------------------------------------------------------------------------------");
+		tl::log_info("This is the Takin spurion screener.");
+		tl::log_info("Written by Tobias Weber <tweber@ill.fr>, 2026.");
+		tl::log_info("--------------------------------------------------------------------------------");
+
+		std::vector<std::string> vecInputs, vecPlanned, vecEnv;
+		std::string strInstr, strCrys;
+		std::string strOut = "spurions.dat", strSummary;
+		unsigned int iMaxOrder = 3;
+		t_real dSigma = 2, dMaxTailQ = 0.25;
+		bool bSamplePowder = false;
+
+		opts::options_description args("spurion screener options");
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("scan-files",
+			opts::value<decltype(vecInputs)>(&vecInputs),
+			"measured scan files or directories")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("planned",
+			opts::value<decltype(vecPlanned)>(&vecPlanned),
+			"planned scan list, one scan per line: \"h1 k1 l1 E1  h2 k2 l2 E2  steps  [name]\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("instr",
+			opts::value<decltype(strInstr)>(&strInstr),
+			"instrument file")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("crys",
+			opts::value<decltype(strCrys)>(&strCrys),
+			"crystal file for the planned scans")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("env",
+			opts::value<decltype(vecEnv)>(&vecEnv),
+			"sample environment material, e.g. \"Al\" or \"name:a:centring\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("sample-powder",
+			opts::bool_switch(&bSamplePowder),
+			"also check the powder lines of the sample")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("max-order",
+			opts::value<decltype(iMaxOrder)>(&iMaxOrder),
+			"highest monochromator and analyser harmonic")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("sigma",
+			opts::value<decltype(dSigma)>(&dSigma),
+			"overlap cutoff in units of the resolution sigma")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("max-tail-q",
+			opts::value<decltype(dMaxTailQ)>(&dMaxTailQ),
+			"maximum distance to a Bragg peak for Bragg tails in 1/A")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("out",
+			opts::value<decltype(strOut)>(&strOut),
+			"output file for the flagged points")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("summary",
+			opts::value<decltype(strSummary)>(&strSummary),
+			"output file for the per-scan summary")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("max-threads",
+			opts::value<decltype(g_iMaxThreads)>(&g_iMaxThreads),
+			"maximum number of threads")));
+
+		opts::positional_options_description args_pos;
+		args_pos.add("scan-files", -1);
+
+		opts::basic_command_line_parser<char> clparser(argc, argv);
+		clparser.options(args);
+		clparser.positional(args_pos);
+		opts::basic_parsed_options<char> parsedopts = clparser.run();
+
+		opts::variables_map opts_map;
+		opts::store(parsedopts, opts_map);
+		opts::notify(opts_map);
+
+		if(argc <= 1)
+		{
+			std::ostringstream ostrHelp;
+			ostrHelp << "Usage: " << argv[0] << " [options] <scan files or directories>\n";
+			ostrHelp << args;
+			tl::log_info(ostrHelp.str());
+			return -1;
+		}
+
+
+		// --------------------------------------------------------------------
+		// set up the screener
+		SpurionScreener screener;
+		screener.SetMaxOrder(iMaxOrder);
+		screener.SetSigma(dSigma);
+		screener.SetMaxTailQ(dMaxTailQ);
+		screener.SetSamplePowder(bSamplePowder);
+
+		const std::string strInstrFile = find_file_in_global_paths(strInstr);
+		if(strInstrFile == "" || !screener.LoadInstrument(strInstrFile))
+		{
+			tl::log_err("Could not load instrument file \"", strInstr, "\".");
+			return -1;
+		}
+
+		for(const std::string& strEnv : vecEnv)
+		{
+			if(!screener.AddEnvironment(strEnv))
+				return -1;
+		}
+
+		for(const std::string& strFile : get_scan_files(vecInputs))
+			screener.AddScanFile(strFile);
+
+		for(const std::string& strFile : vecPlanned)
+		{
+			if(!screener.AddPlannedScans(strFile, find_file_in_global_paths(strCrys)))
+				return -1;
+		}
+
+		if(screener.GetNumPoints() == 0)
+		{
+			tl::log_err("No scan points given.");
+			return -1;
+		}
+		// --------------------------------------------------------------------
+
+
+		// --------------------------------------------------------------------
+		// screen the points
+		tl::Stopwatch<t_real> watch;
+		watch.start();
+
+		std::vector<SpurionHit> vecHits = screener.Screen();
+
+		watch.stop();
+		tl::log_info("Screened ", screener.GetNumPoints(), " point(s) in ",
+			screener.GetScans().size(), " scan(s), found ", vecHits.size(),
+			" possible spurion(s) in ", tl::get_duration_str_secs<t_real>(watch.GetDur()), ".");
+
+		if(!screener.SaveTable(strOut, vecHits))
+			return -1;
+		tl::log_info("Wrote flagged points to \"", strOut, "\".");
+
+		if(strSummary != "")
+		{
+			if(!screener.SaveSummary(strSummary, vecHits))
+				return -1;
+			tl::log_info("Wrote summary to \"", strSummary, "\".");
+		}
+		// --------------------------------------------------------------------
+	}
+	catch(const std::exception& ex)
+	{
+		tl::log_crit(ex.what());
+		return -1;
+	}
+
+	return 0;
+}
@@ -238,9 +238,14 @@ TazDlg::TazDlg(QWidget* pParent, const std::string& strLogFile)
 	if(m_pviewTof)
 		QObject::connect(m_pviewTof, &TofLayoutView::scaleChanged, &m_sceneTof, &TofLayoutScene::scaleChanged);
 
+	// own recalculations come first, the dialogs depend on them
+	m_chanCalcPeaksRecip = m_sched.AddChannel();
+	m_chanCalcPeaks = m_sched.AddChannel();
+	m_chanGoto = m_sched.AddChannel(m_pGotoDlg);
+
 	// parameter dialogs
-	QObject::connect(&m_sceneRecip, &ScatteringTriangleScene::paramsChanged, &m_dlgRecipParam, &RecipParamDlg::paramsChanged);
-	QObject::connect(&m_sceneReal, &TasLayoutScene::paramsChanged, &m_dlgRealParam, &RealParamDlg::paramsChanged);
+	m_sched.Connect(&m_sceneRecip, &ScatteringTriangleScene::paramsChanged, &m_dlgRecipParam, &RecipParamDlg::paramsChanged);
+	m_sched.Connect(&m_sceneReal, &TasLayoutScene::paramsChanged, &m_dlgRealParam, &RealParamDlg::paramsChanged);
 
 	// cursor position
 	QObject::connect(&m_sceneRecip, &ScatteringTriangleScene::coordsChanged, this, &TazDlg::RecipCoordsChanged);
@@ -250,7 +255,7 @@ TazDlg::TazDlg(QWidget* pParent, const std::string& strLogFile)
 	QObject::connect(&m_sceneRecip, &ScatteringTriangleScene::spurionInfo, this, &TazDlg::spurionInfo);
 
 	QObject::connect(m_pGotoDlg, &GotoDlg::vars_changed, this, &TazDlg::VarsChanged);
-	QObject::connect(&m_sceneRecip, &ScatteringTriangleScene::paramsChanged, m_pGotoDlg, &GotoDlg::RecipParamsChanged);
+	m_sched.Connect(&m_sceneRecip, &ScatteringTriangleScene::paramsChanged, m_pGotoDlg, &GotoDlg::RecipParamsChanged);
 
 	QObject::connect(&m_sceneRecip, &ScatteringTriangleScene::paramsChanged, this, &TazDlg::recipParamsChanged);
 
@@ -261,16 +266,16 @@ TazDlg::TazDlg(QWidget* pParent, const std::string& strLogFile)
 	for(QLineEdit* pEdit : m_vecEdits_real)
 	{
 		QObject::connect(pEdit, &QLineEdit::textEdited, this, &TazDlg::CheckCrystalType);
-		QObject::connect(pEdit, &QLineEdit::textEdited, this, &TazDlg::CalcPeaks);
+		QObject::connect(pEdit, &QLineEdit::textEdited, this, &TazDlg::ScheduleCalcPeaks);
 	}
 
 	for(QLineEdit* pEdit : m_vecEdits_plane)
-		QObject::connect(pEdit, &QLineEdit::textEdited, this, &TazDlg::CalcPeaks);
+		QObject::connect(pEdit, &QLineEdit::textEdited, this, &TazDlg::ScheduleCalcPeaks);
 
 	for(QLineEdit* pEdit : m_vecEdits_recip)
 	{
 		QObject::connect(pEdit, &QLineEdit::textEdited, this, &TazDlg::CheckCrystalType);
-		QObject::connect(pEdit, &QLineEdit::textEdited, this, &TazDlg::CalcPeaksRecip);
+		QObject::connect(pEdit, &QLineEdit::textEdited, this, &TazDlg::ScheduleCalcPeaksRecip);
 	}
 
 	QObject::connect(checkSenseM, &QCheckBox::stateChanged, this, &TazDlg::UpdateMonoSense);
@@ -279,8 +284,8 @@ TazDlg::TazDlg(QWidget* pParent, const std::string& strLogFile)
 
 	QObject::connect(editSpaceGroupsFilter, &QLineEdit::textEdited, this, &TazDlg::RepopulateSpaceGroups);
 	QObject::connect(comboSpaceGroups, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &TazDlg::SetCrystalType);
-	QObject::connect(comboSpaceGroups, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &TazDlg::CalcPeaks);
-	QObject::connect(checkPowder, &QCheckBox::stateChanged, this, &TazDlg::CalcPeaks);
+	QObject::connect(comboSpaceGroups, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &TazDlg::ScheduleCalcPeaks);
+	QObject::connect(checkPowder, &QCheckBox::stateChanged, this, &TazDlg::ScheduleCalcPeaks);
 
 	QObject::connect(btnAtoms, &QPushButton::clicked, this, &TazDlg::ShowAtomsDlg);
 
@@ -1341,7 +1346,8 @@ void TazDlg::Show3D()
 		m_pRecip3d->SetPlaneDistTolerance(dTol);
 
 		// also track current Q position
-		QObject::connect(&m_sceneRecip, &ScatteringTriangleScene::paramsChanged,
+		m_chanRecip3d = m_sched.AddChannel(m_pRecip3d);
+		m_sched.Connect(&m_sceneRecip, &ScatteringTriangleScene::paramsChanged,
 			m_pRecip3d, &Recip3DDlg::RecipParamsChanged);
 		m_sceneRecip.emitAllParams();
 	}
@@ -1350,7 +1356,10 @@ void TazDlg::Show3D()
 		m_pRecip3d->show();
 	m_pRecip3d->activateWindow();
 
-	m_pRecip3d->CalcPeaks(m_latticecommon);
+	m_sched.Post(m_chanRecip3d, [this]()
+	{
+		m_pRecip3d->CalcPeaks(m_latticecommon);
+	});
 	//CalcPeaks();
 }
 
@@ -1358,13 +1367,19 @@ void TazDlg::Show3D()
 void TazDlg::Show3DReal()
 {
 	if(!m_pReal3d)
+	{
 		m_pReal3d = new Real3DDlg(this, &m_settings);
+		m_chanReal3d = m_sched.AddChannel(m_pReal3d);
+	}
 
 	if(!m_pReal3d->isVisible())
 		m_pReal3d->show();
 	m_pReal3d->activateWindow();
 
-	m_pReal3d->CalcPeaks(m_sceneRealLattice.GetLattice()->GetWS3D(), m_latticecommon);
+	m_sched.Post(m_chanReal3d, [this]()
+	{
+		m_pReal3d->CalcPeaks(m_sceneRealLattice.GetLattice()->GetWS3D(), m_latticecommon);
+	});
 	//CalcPeaks();
 }
 
@@ -1376,7 +1391,8 @@ void TazDlg::Show3DBZ()
 		m_pBZ3d = new BZ3DDlg(this, &m_settings);
 
 		// also track current q position
-		QObject::connect(&m_sceneRecip, &ScatteringTriangleScene::paramsChanged,
+		m_chanBZ3d = m_sched.AddChannel(m_pBZ3d);
+		m_sched.Connect(&m_sceneRecip, &ScatteringTriangleScene::paramsChanged,
 			m_pBZ3d, &BZ3DDlg::RecipParamsChanged);
 		m_sceneRecip.emitAllParams();
 	}
@@ -1385,10 +1401,13 @@ void TazDlg::Show3DBZ()
 		m_pBZ3d->show();
 	m_pBZ3d->activateWindow();
 
-	m_pBZ3d->RenderBZ(m_sceneRecip.GetTriangle()->GetBZ3D(),
-		m_latticecommon,
-		&m_sceneRecip.GetTriangle()->GetBZ3DPlaneVerts(),
-		&m_sceneRecip.GetTriangle()->GetBZ3DSymmVerts());
+	m_sched.Post(m_chanBZ3d, [this]()
+	{
+		m_pBZ3d->RenderBZ(m_sceneRecip.GetTriangle()->GetBZ3D(),
+			m_latticecommon,
+			&m_sceneRecip.GetTriangle()->GetBZ3DPlaneVerts(),
+			&m_sceneRecip.GetTriangle()->GetBZ3DSymmVerts());
+	});
 	//CalcPeaks();
 }
 
@@ -1536,7 +1555,7 @@ void TazDlg::ShowNeutronDlg()
 	if(!m_pNeutronDlg)
 	{
 		m_pNeutronDlg = new NeutronDlg(this, &m_settings);
-		QObject::connect(&m_sceneRecip, &ScatteringTriangleScene::paramsChanged,
+		m_sched.Connect(&m_sceneRecip, &ScatteringTriangleScene::paramsChanged,
 						 m_pNeutronDlg, &NeutronDlg::paramsChanged);
 		m_sceneRecip.emitAllParams();
 	}
@@ -1579,6 +1598,7 @@ void TazDlg::InitElasticDlg()
 	if(!m_pElasticDlg)
 	{
 		m_pElasticDlg = new ElasticDlg(this, &m_settings);
+		m_chanElastic = m_sched.AddChannel(m_pElasticDlg);
 		QObject::connect(m_pElasticDlg, &ElasticDlg::ChangedPosition, this, &TazDlg::VarsChanged);
 
 		m_pElasticDlg->SetD(editMonoD->text().toDouble(), editAnaD->text().toDouble());
@@ -1601,7 +1621,7 @@ void TazDlg::ShowPowderDlg()
 	if(!m_pPowderDlg)
 	{
 		m_pPowderDlg = new PowderDlg(this, &m_settings);
-		QObject::connect(&m_sceneRecip, &ScatteringTriangleScene::paramsChanged,
+		m_sched.Connect(&m_sceneRecip, &ScatteringTriangleScene::paramsChanged,
 						 m_pPowderDlg, &PowderDlg::paramsChanged);
 		m_sceneRecip.emitAllParams();
 	}
@@ -1633,7 +1653,7 @@ void TazDlg::ShowDynPlaneDlg()
 	if(!m_pDynPlaneDlg)
 	{
 		m_pDynPlaneDlg = new DynPlaneDlg(this, &m_settings);
-		QObject::connect(&m_sceneRecip, &ScatteringTriangleScene::paramsChanged,
+		m_sched.Connect(&m_sceneRecip, &ScatteringTriangleScene::paramsChanged,
 						 m_pDynPlaneDlg, &DynPlaneDlg::RecipParamsChanged);
 		m_sceneRecip.emitAllParams();
 	}
@@ -91,6 +91,7 @@
 #include "libs/spacegroups/latticehelper.h"
 #include "libs/globals.h"
 #include "libs/globals_qt.h"
+#include "libs/qt/update_sched.h"
 #include "tlibs/phys/lattice.h"
 
 
@@ -170,6 +171,16 @@ class TazDlg : public QMainWindow, Ui::TazDlg
 
 		std::vector<DarkAngle<t_real_glob>> m_vecDarkAngles;
 
+		// coalesced updates of the dependent dialogs
+		UpdateScheduler m_sched;
+		UpdateScheduler::t_chan m_chanCalcPeaksRecip = UpdateScheduler::NO_CHAN;
+		UpdateScheduler::t_chan m_chanCalcPeaks = UpdateScheduler::NO_CHAN;
+		UpdateScheduler::t_chan m_chanGoto = UpdateScheduler::NO_CHAN;
+		UpdateScheduler::t_chan m_chanElastic = UpdateScheduler::NO_CHAN;
+		UpdateScheduler::t_chan m_chanRecip3d = UpdateScheduler::NO_CHAN;
+		UpdateScheduler::t_chan m_chanReal3d = UpdateScheduler::NO_CHAN;
+		UpdateScheduler::t_chan m_chanBZ3d = UpdateScheduler::NO_CHAN;
+
 		// dialogs
 		RecipParamDlg m_dlgRecipParam;
 		RealParamDlg m_dlgRealParam;
@@ -246,6 +257,8 @@ class TazDlg : public QMainWindow, Ui::TazDlg
 	protected slots:
 		void CalcPeaks();
 		void CalcPeaksRecip();
+		void ScheduleCalcPeaks();
+		void ScheduleCalcPeaksRecip();
 		void UpdateDs();
 
 		void SetCrystalType();
@@ -150,6 +150,27 @@ void TazDlg::CalcPeaksRecip()
 }
 
 
+/**
+ * recalculate the peaks after a burst of edits
+ */
+void TazDlg::ScheduleCalcPeaks()
+{
+	m_sched.Post(m_chanCalcPeaks, [this]()
+	{
+		CalcPeaks();
+	});
+}
+
+
+void TazDlg::ScheduleCalcPeaksRecip()
+{
+	m_sched.Post(m_chanCalcPeaksRecip, [this]()
+	{
+		CalcPeaksRecip();
+	});
+}
+
+
 void TazDlg::CalcPeaks()
 {
 	if(!m_bReady || !m_sceneRecip.GetTriangle() || !m_sceneRealLattice.GetLattice())
@@ -246,18 +267,25 @@ void TazDlg::CalcPeaks()
 		//----------------------------------------------------------------------
 
 
+		// the dialogs are only updated once they are visible
 		if(m_pGotoDlg)
 		{
-			m_pGotoDlg->SetLattice(lattice);
-			m_pGotoDlg->SetScatteringPlane(tl::make_vec({dX0, dX1, dX2}), tl::make_vec({dY0, dY1, dY2}));
-			m_pGotoDlg->CalcSample();
+			m_sched.Post(m_chanGoto, [this, lattice, vecPlaneXRLU, vecPlaneYRLU]()
+			{
+				m_pGotoDlg->SetLattice(lattice);
+				m_pGotoDlg->SetScatteringPlane(vecPlaneXRLU, vecPlaneYRLU);
+				m_pGotoDlg->CalcSample();
+			});
 		}
 
 		if(m_pElasticDlg)
 		{
-			m_pElasticDlg->SetLattice(lattice);
-			m_pElasticDlg->SetScatteringPlane(tl::make_vec({dX0, dX1, dX2}), tl::make_vec({dY0, dY1, dY2}));
-			m_pElasticDlg->CalcSpuriousPositions();
+			m_sched.Post(m_chanElastic, [this, lattice, vecPlaneXRLU, vecPlaneYRLU]()
+			{
+				m_pElasticDlg->SetLattice(lattice);
+				m_pElasticDlg->SetScatteringPlane(vecPlaneXRLU, vecPlaneYRLU);
+				m_pElasticDlg->CalcSpuriousPositions();
+			});
 		}
 
 		emitSampleParams();
@@ -312,16 +340,32 @@ void TazDlg::CalcPeaks()
 			m_sceneRealLattice.GetLattice()->CalcPeaks(m_latticecommon);
 
 #ifndef NO_3D
+			// the 3d views use the then newest lattice
 			if(m_pRecip3d)
-				m_pRecip3d->CalcPeaks(m_latticecommon);
+			{
+				m_sched.Post(m_chanRecip3d, [this]()
+				{
+					m_pRecip3d->CalcPeaks(m_latticecommon);
+				});
+			}
 			if(m_pReal3d)
-				m_pReal3d->CalcPeaks(m_sceneRealLattice.GetLattice()->GetWS3D(),
-					m_latticecommon);
+			{
+				m_sched.Post(m_chanReal3d, [this]()
+				{
+					m_pReal3d->CalcPeaks(m_sceneRealLattice.GetLattice()->GetWS3D(),
+						m_latticecommon);
+				});
+			}
 			if(m_pBZ3d)
-				m_pBZ3d->RenderBZ(m_sceneRecip.GetTriangle()->GetBZ3D(),
-					m_latticecommon,
-					&m_sceneRecip.GetTriangle()->GetBZ3DPlaneVerts(),
-					&m_sceneRecip.GetTriangle()->GetBZ3DSymmVerts());
+			{
+				m_sched.Post(m_chanBZ3d, [this]()
+				{
+					m_pBZ3d->RenderBZ(m_sceneRecip.GetTriangle()->GetBZ3D(),
+						m_latticecommon,
+						&m_sceneRecip.GetTriangle()->GetBZ3DPlaneVerts(),
+						&m_sceneRecip.GetTriangle()->GetBZ3DSymmVerts());
+				});
+			}
 #endif
 		}
 		else
@@ -616,7 +660,7 @@ void TazDlg::ShowSpurionDlg()
 	if(!m_pSpuri)
 	{
 		m_pSpuri = new SpurionDlg(this, &m_settings);
-		QObject::connect(&m_sceneRecip, &ScatteringTriangleScene::paramsChanged, m_pSpuri, &SpurionDlg::paramsChanged);
+		m_sched.Connect(&m_sceneRecip, &ScatteringTriangleScene::paramsChanged, m_pSpuri, &SpurionDlg::paramsChanged);
 
 		m_sceneRecip.emitAllParams();
 	}
@@ -701,10 +745,13 @@ void TazDlg::InitReso()
 	{
 		m_pReso = new ResoDlg(this, &m_settings);
 
+		// the reso parameters only contain the changed values, they can't be coalesced
 		QObject::connect(this, &TazDlg::ResoParamsChanged, m_pReso, &ResoDlg::ResoParamsChanged);
-		QObject::connect(&m_sceneRecip, &ScatteringTriangleScene::paramsChanged, m_pReso, &ResoDlg::RecipParamsChanged);
-		QObject::connect(&m_sceneReal, &TasLayoutScene::paramsChanged, m_pReso, &ResoDlg::RealParamsChanged);
-		QObject::connect(this, &TazDlg::SampleParamsChanged, m_pReso, &ResoDlg::SampleParamsChanged);
+
+		// the UB matrix from the sample parameters is needed for the reciprocal ones
+		m_sched.Connect(this, &TazDlg::SampleParamsChanged, m_pReso, &ResoDlg::SampleParamsChanged);
+		m_sched.Connect(&m_sceneRecip, &ScatteringTriangleScene::paramsChanged, m_pReso, &ResoDlg::RecipParamsChanged);
+		m_sched.Connect(&m_sceneReal, &TasLayoutScene::paramsChanged, m_pReso, &ResoDlg::RealParamsChanged);
 
 		UpdateDs();
 		UpdateMonoSense();
@@ -732,7 +779,8 @@ void TazDlg::ShowResoEllipses()
 	if(!m_pEllipseDlg)
 	{
 		m_pEllipseDlg = new EllipseDlg(this, &m_settings);
-		QObject::connect(m_pReso, &ResoDlg::ResoResultsSig, m_pEllipseDlg, &EllipseDlg::SetParams);
+		m_sched.AddWatch(m_pReso, m_pEllipseDlg);
+		m_sched.Connect(m_pReso, &ResoDlg::ResoResultsSig, m_pEllipseDlg, &EllipseDlg::SetParams);
 
 		m_pReso->EmitResults();
 	}
@@ -763,7 +811,8 @@ void TazDlg::ShowResoEllipses3D()
 	if(!m_pEllipseDlg3D)
 	{
 		m_pEllipseDlg3D = new EllipseDlg3D(this, &m_settings);
-		QObject::connect(m_pReso, &ResoDlg::ResoResultsSig, m_pEllipseDlg3D, &EllipseDlg3D::SetParams);
+		m_sched.AddWatch(m_pReso, m_pEllipseDlg3D);
+		m_sched.Connect(m_pReso, &ResoDlg::ResoResultsSig, m_pEllipseDlg3D, &EllipseDlg3D::SetParams);
 
 		m_pReso->EmitResults();
 	}
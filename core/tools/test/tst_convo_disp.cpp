@@ -0,0 +1,139 @@
+/**
+ * compares the analytic convolution along a dispersion with the monte-carlo convolution
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+// g++ -std=c++17 -DNO_LAPACK -I../.. -o tst_convo_disp tst_convo_disp.cpp ../monteconvo/TASReso.cpp ../monteconvo/sqwbase.cpp ../res/cn.cpp ../res/pop.cpp ../res/pop_cn.cpp ../res/eck.cpp ../res/vio.cpp ../res/simple.cpp ../../libs/globals.cpp ../../tlibs/log/log.cpp ../../tlibs/math/rand.cpp ../../tlibs/string/eval.cpp -lboost_iostreams -lboost_filesystem -lboost_system -lpthread
+// ./tst_convo_disp ../../../data/instruments/thales_pg002_pg002.taz
+
+#include "tools/monteconvo/TASReso.h"
+#include "tools/monteconvo/sqwbase.h"
+#include "tlibs/math/math.h"
+#include "tlibs/math/rand.h"
+
+#include <iostream>
+#include <cmath>
+
+using t_real = t_real_reso;
+
+
+/**
+ * single linear branch E = v*(h - h0) with a gaussian energy width
+ */
+class SqwLinear : public SqwBase
+{
+protected:
+	t_real m_dh0 = 1.;
+	t_real m_dv = 20.;
+	t_real m_dSigma = 0.05;
+
+public:
+	SqwLinear() { m_bOk = true; }
+	virtual ~SqwLinear() = default;
+
+	virtual std::tuple<std::vector<t_real>, std::vector<t_real>>
+		disp(t_real dh, t_real /*dk*/, t_real /*dl*/) const override
+	{
+		return std::make_tuple(std::vector<t_real>{ m_dv*(dh - m_dh0) }, std::vector<t_real>{ 1. });
+	}
+
+	virtual t_real operator()(t_real dh, t_real dk, t_real dl, t_real dE) const override
+	{
+		const t_real dE0 = std::get<0>(disp(dh, dk, dl))[0];
+		return tl::gauss_model<t_real>(dE, dE0, m_dSigma, 1., 0.);
+	}
+
+	virtual std::vector<t_var> GetVars() const override { return {}; }
+	virtual void SetVars(const std::vector<t_var>&) override {}
+	virtual SqwBase* shallow_copy() const override { return new SqwLinear(*this); }
+};
+
+
+int main(int argc, char** argv)
+{
+	const char* pcInstr = argc > 1 ? argv[1] : "../../../data/instruments/thales_pg002_pg002.taz";
+	const std::size_t iNumNeutrons = 200000;
+
+	tl::init_rand();
+
+	TASReso reso;
+	if(!reso.LoadRes(pcInstr))
+	{
+		std::cerr << "Cannot load instrument file \"" << pcInstr << "\"." << std::endl;
+		return -1;
+	}
+
+	reso.SetLattice(4., 4., 4., tl::d2r<t_real>(90.), tl::d2r<t_real>(90.), tl::d2r<t_real>(90.),
+		tl::make_vec<ublas::vector<t_real>>({ 1., 0., 0. }),
+		tl::make_vec<ublas::vector<t_real>>({ 0., 1., 0. }));
+
+	const SqwLinear sqw;
+	const t_real dh = 1.1;
+
+	// energy scan through the branch at E = 2 meV
+	t_real dMaxS = 0., dMaxDiff = 0.;
+	for(t_real dE = 0.5; dE < 3.6; dE += 0.25)
+	{
+		if(!reso.SetHKLE(dh, 0., 0., dE))
+		{
+			std::cerr << "Invalid position at E = " << dE << " meV." << std::endl;
+			return -1;
+		}
+
+		t_real dSAna = 0.;
+		if(!reso.ConvolveDisp(sqw, dSAna))
+		{
+			std::cerr << "Analytic convolution failed at E = " << dE << " meV." << std::endl;
+			return -1;
+		}
+
+		std::vector<ublas::vector<t_real>> vecNeutrons;
+		reso.GenerateMC_deferred(iNumNeutrons, vecNeutrons);
+
+		t_real dSMC = 0.;
+		for(const ublas::vector<t_real>& vecHKLE : vecNeutrons)
+			dSMC += sqw(vecHKLE[0], vecHKLE[1], vecHKLE[2], vecHKLE[3]);
+		dSMC /= t_real(vecNeutrons.size());
+
+		std::cout << "E = " << dE << " meV: analytic S = " << dSAna
+			<< ", monte-carlo S = " << dSMC << std::endl;
+
+		dMaxS = std::max(dMaxS, dSMC);
+		dMaxDiff = std::max(dMaxDiff, std::abs(dSAna - dSMC));
+	}
+
+	// deviation relative to the peak
+	const t_real dRelDiff = dMaxDiff / dMaxS;
+	std::cout << "Maximum relative deviation: " << dRelDiff << std::endl;
+	if(dRelDiff > 0.05)
+	{
+		std::cerr << "Analytic and monte-carlo convolutions disagree." << std::endl;
+		return -1;
+	}
+
+	std::cout << "Analytic and monte-carlo convolutions agree." << std::endl;
+	return 0;
+}
@@ -0,0 +1,157 @@
+/**
+ * tests the distributed convolution with several workers on localhost
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+// g++ -std=c++17 -DNO_LAPACK -I../.. -o tst_convo_net tst_convo_net.cpp ../monteconvo/convo_net.cpp ../../libs/globals.cpp ../../tlibs/log/log.cpp ../../tlibs/math/rand.cpp -lboost_iostreams -lboost_filesystem -lboost_system -lpthread
+
+#include "tools/monteconvo/convo_net.h"
+#include "tlibs/string/string.h"
+#include "tlibs/log/log.h"
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <list>
+#include <cmath>
+
+using t_real = t_real_reso;
+
+
+/**
+ * dummy model which checks the transferred configuration
+ * and optionally fails or hangs after a number of points
+ */
+class TstBackend : public ConvoNetBackend
+{
+protected:
+	t_real m_dScale = 0;
+	int m_iFailAfter = -1;
+	bool m_bHang = false;
+	mutable std::atomic<int> m_iNumCalcs{0};
+
+public:
+	TstBackend(int iFailAfter, bool bHang) : m_iFailAfter(iFailAfter), m_bHang(bHang) {}
+
+	virtual bool Setup(const t_map& files, const t_map& opts) override
+	{
+		auto iterFile = files.find("scale.dat");
+		auto iterOpt = opts.find("offset");
+		if(iterFile == files.end() || iterOpt == opts.end())
+			return false;
+
+		std::ifstream ifstr(iterFile->second);
+		ifstr >> m_dScale;
+		m_dScale += tl::str_to_var<t_real>(iterOpt->second);
+		return true;
+	}
+
+	virtual std::pair<bool, t_real> Calc(t_real h, t_real k, t_real l, t_real E) const override
+	{
+		if(m_iFailAfter >= 0 && ++m_iNumCalcs > m_iFailAfter)
+		{
+			if(!m_bHang)
+				throw std::runtime_error("Simulated worker fault");
+
+			// longer than the coordinator's timeout
+			std::this_thread::sleep_for(std::chrono::seconds(2));
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		return std::make_pair(E >= 0., m_dScale * (h + 2.*k + 3.*l + E));
+	}
+};
+
+
+int main()
+{
+	// workers, the last ones fail or stop answering after a few points per connection
+	const std::pair<int, bool> iFailAfter[] = { {-1, false}, {-1, false}, {-1, false}, {5, false}, {5, true} };
+	std::list<std::unique_ptr<ConvoNetWorker>> lstWorkers;
+	std::list<std::thread> lstWorkerThreads;
+
+	ConvoNetCoordinator coord;
+	coord.SetMaxRetries(1);
+	coord.SetTimeout(1);
+
+	for(const auto& pairFail : iFailAfter)
+	{
+		auto factory = [pairFail]() -> std::shared_ptr<ConvoNetBackend>
+			{ return std::make_shared<TstBackend>(pairFail.first, pairFail.second); };
+		lstWorkers.emplace_back(new ConvoNetWorker(0, 2, factory));
+
+		ConvoNetWorker *pWorker = lstWorkers.back().get();
+		if(!pWorker->Listen())
+			return -1;
+		lstWorkerThreads.emplace_back([pWorker]() { pWorker->Run(); });
+
+		coord.AddWorker("localhost", tl::var_to_str(pWorker->GetPort()));
+	}
+
+	// unreachable worker
+	coord.AddWorkers("127.0.0.1:1");
+
+	coord.AddFileContents("scale.dat", "1.5\n");
+	coord.SetOpt("offset", "0.5");
+
+
+	std::vector<ConvoNetCoordinator::t_point> vecPts;
+	for(int i=0; i<500; ++i)
+		vecPts.push_back({ t_real(i)*0.01, 0.1, -0.2, t_real(i%50) - 1. });
+
+	std::vector<ConvoNetCoordinator::t_result> vecRes = coord.Calc(vecPts);
+
+	for(auto& pWorker : lstWorkers)
+		pWorker->Stop();
+	for(std::thread& th : lstWorkerThreads)
+		th.join();
+
+
+	// check results
+	std::size_t iNumErrs = 0;
+	for(std::size_t iPt=0; iPt<vecPts.size(); ++iPt)
+	{
+		const auto& pt = vecPts[iPt];
+		bool bOk = (pt[3] >= 0.);
+		t_real dS = 2. * (pt[0] + 2.*pt[1] + 3.*pt[2] + pt[3]);
+
+		if(vecRes[iPt].first != bOk || (bOk && std::abs(vecRes[iPt].second - dS) > 1e-10))
+		{
+			std::cerr << "Mismatch at point " << iPt << ": " << vecRes[iPt].second
+				<< " != " << dS << std::endl;
+			++iNumErrs;
+		}
+	}
+
+	if(iNumErrs)
+	{
+		tl::log_err(iNumErrs, " errors.");
+		return -1;
+	}
+
+	tl::log_info("All ", vecPts.size(), " points ok.");
+	return 0;
+}
@@ -0,0 +1,638 @@
+/**
+ * detector-wide convolution of S(Q, E) models for time-of-flight spectrometers
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * @desc uses the Violini resolution model, see: [vio14] N. Violini et al., NIM A 736 (2014) pp. 31-39, doi: 10.1016/j.nima.2013.10.042
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "tofconvo.h"
+#include "libs/globals.h"
+
+#include "tlibs/math/linalg.h"
+#include "tlibs/math/math.h"
+#include "tlibs/math/rand.h"
+#include "tlibs/phys/neutrons.h"
+#include "tlibs/string/string.h"
+#include "tlibs/helper/thread.h"
+#include "tlibs/log/log.h"
+
+#include <fstream>
+#include <iomanip>
+#include <atomic>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+using t_real = TofConvo::t_real;
+using t_vec = TofConvo::t_vec;
+using t_mat = TofConvo::t_mat;
+
+using angle = tl::t_angle_si<t_real>;
+using wavenumber = tl::t_wavenumber_si<t_real>;
+using velocity = tl::t_velocity_si<t_real>;
+using t_time = tl::t_time_si<t_real>;
+using energy = tl::t_energy_si<t_real>;
+using length = tl::t_length_si<t_real>;
+
+static const auto rads = tl::get_one_radian<t_real>();
+static const length angs = tl::get_one_angstrom<t_real>();
+static const energy meV = tl::get_one_meV<t_real>();
+static const t_time sec = tl::get_one_second<t_real>();
+static const length meter = tl::get_one_meter<t_real>();
+static const length cm = tl::get_one_centimeter<t_real>();
+
+
+
+// ----------------------------------------------------------------------------
+// detector
+
+/**
+ * loads the detector pixels, one pixel per line:
+ * in-plane angle 2theta (deg), optional out-of-plane angle (deg)
+ * and optional sample-detector distance (cm)
+ */
+bool TofDetector::LoadPixels(const std::string& strFile)
+{
+	std::ifstream ifstr(strFile);
+	if(!ifstr)
+	{
+		tl::log_err("Cannot open detector file \"", strFile, "\".");
+		return false;
+	}
+
+	pixels.clear();
+
+	std::string strLine;
+	while(std::getline(ifstr, strLine))
+	{
+		tl::trim(strLine);
+		if(strLine.size() == 0 || strLine[0] == '#')
+			continue;
+
+		std::vector<t_real> vecToks;
+		tl::get_tokens<t_real, std::string>(strLine, " \t,;", vecToks);
+		if(vecToks.size() == 0)
+			continue;
+
+		TofPixel pix;
+		pix.twotheta = tl::d2r(vecToks[0]);
+		if(vecToks.size() > 1)
+			pix.phi = tl::d2r(vecToks[1]);
+		if(vecToks.size() > 2)
+			pix.dist = vecToks[2] * cm / meter;
+
+		pixels.push_back(pix);
+	}
+
+	if(!pixels.size())
+	{
+		tl::log_err("No pixels defined in detector file \"", strFile, "\".");
+		return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * sets equidistant time channels, the times are given at the channel centres
+ */
+void TofDetector::SetChannels(t_real tMin, t_real tMax, std::size_t iNum)
+{
+	channels.clear();
+	channels.reserve(iNum);
+	width = iNum ? (tMax - tMin) / t_real(iNum) : t_real(0);
+
+	for(std::size_t iCh=0; iCh<iNum; ++iCh)
+		channels.push_back(tMin + (t_real(iCh) + t_real(0.5)) * (tMax - tMin) / t_real(iNum));
+}
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// kinematics and resolution
+
+/**
+ * calculates the lab Q vector (x: along ki, z: up), the energy transfer
+ * and the final wavenumber of a detector pixel and time channel,
+ * optionally also the jacobian |dE/dt| = 2 E_f / t_f in meV/s
+ */
+bool TofConvo::GetKinematics(const TofPixel& pix, t_real t,
+	t_vec& vecQ, t_real& dE, t_real& dKf, t_real *pdEdt) const
+{
+	const wavenumber ki = m_dKi / angs;
+	const length lm = m_params.len_mono_sample;
+	const length ls = pix.dist >= 0 ? pix.dist*meter : m_params.len_sample_det;
+
+	const velocity vi = tl::k2v(ki);
+	const t_time tf = t*sec - lm/vi;
+	if(tf <= t_real(0)*sec)
+		return false;
+
+	const velocity vf = ls / tf;
+	const wavenumber kf = tl::v2k(vf);
+
+	dKf = kf * angs;
+	dE = tl::get_energy_transfer(ki, kf) / meV;
+	if(pdEdt)
+		*pdEdt = t_real(2) * (tl::k2E(kf) / meV) / (tf / sec);
+
+	const t_real ctt = std::cos(pix.twotheta), stt = std::sin(pix.twotheta);
+	const t_real cph = std::cos(pix.phi), sph = std::sin(pix.phi);
+
+	// Q = ki - kf
+	vecQ = tl::make_vec<t_vec>({ m_dKi - dKf*ctt*cph, -dKf*stt*cph, -dKf*sph });
+	return true;
+}
+
+
+/**
+ * calculates the resolution matrix for a positive in-plane scattering angle,
+ * the matrix is given in the lab system rotated around the vertical axis,
+ * i.e. along the in-plane projection of Q, perpendicular to it, and vertical
+ */
+TofResoNode TofConvo::CalcReso(t_real tt, t_real ph, t_real t) const
+{
+	TofResoNode node;
+
+	TofPixel pix;
+	pix.twotheta = std::abs(tt);
+	pix.phi = ph;
+
+	t_vec vecQ;
+	t_real dE, dKf;
+	if(!GetKinematics(pix, t, vecQ, dE, dKf))
+		return node;
+
+	VioParams params = m_params;
+	params.ki = m_dKi / angs;
+	params.kf = dKf / angs;
+	params.E = dE * meV;
+	params.twotheta = pix.twotheta * rads;
+	params.angle_outplane_f = pix.phi * rads;
+
+	try
+	{
+		params.Q = tl::get_sample_Q(params.ki, params.kf, params.twotheta);
+		params.angle_kf_Q = tl::get_angle_kf_Q(params.ki, params.kf, params.Q, true, true);
+	}
+	catch(const std::exception&)
+	{
+		return node;
+	}
+
+	// angle between ki and the in-plane projection of Q, which differs
+	// from the in-plane scattering triangle if the pixel is out of plane
+	params.angle_ki_Q = std::atan2(-vecQ[1], vecQ[0]) * rads;
+
+	ResoResults res = calc_vio(params);
+	if(!res.bOk)
+		return node;
+
+	node.reso = res.reso;
+	node.bOk = true;
+	return node;
+}
+
+
+void TofConvo::SetLatticeSize(std::size_t iTT, std::size_t iPh, std::size_t iT)
+{
+	m_iLatticeSize[0] = std::max<std::size_t>(iTT, 1);
+	m_iLatticeSize[1] = std::max<std::size_t>(iPh, 1);
+	m_iLatticeSize[2] = std::max<std::size_t>(iT, 1);
+}
+
+
+std::size_t TofConvo::GetNodeIdx(std::size_t iTT, std::size_t iPh, std::size_t iT) const
+{
+	return (iTT*m_iLatticeSize[1] + iPh)*m_iLatticeSize[2] + iT;
+}
+
+
+t_real TofConvo::GetNodeCoord(int iAxis, std::size_t iNode) const
+{
+	if(m_iLatticeSize[iAxis] <= 1)
+		return m_dLatticeMin[iAxis];
+
+	return m_dLatticeMin[iAxis] + t_real(iNode) *
+		(m_dLatticeMax[iAxis] - m_dLatticeMin[iAxis]) / t_real(m_iLatticeSize[iAxis] - 1);
+}
+
+
+/**
+ * calculates the resolution matrices on a coarse (|2theta|, phi, t) lattice
+ * spanning the detector pixels and time channels
+ */
+bool TofConvo::CalcLattice(const TofDetector& det)
+{
+	m_vecNodes.clear();
+	if(!det.pixels.size() || !det.channels.size())
+	{
+		tl::log_err("No detector pixels or time channels defined.");
+		return false;
+	}
+
+	// lattice ranges
+	for(int iAxis=0; iAxis<3; ++iAxis)
+	{
+		m_dLatticeMin[iAxis] = std::numeric_limits<t_real>::max();
+		m_dLatticeMax[iAxis] = std::numeric_limits<t_real>::lowest();
+	}
+
+	for(const TofPixel& pix : det.pixels)
+	{
+		m_dLatticeMin[0] = std::min(m_dLatticeMin[0], std::abs(pix.twotheta));
+		m_dLatticeMax[0] = std::max(m_dLatticeMax[0], std::abs(pix.twotheta));
+		m_dLatticeMin[1] = std::min(m_dLatticeMin[1], pix.phi);
+		m_dLatticeMax[1] = std::max(m_dLatticeMax[1], pix.phi);
+	}
+
+	const auto minmaxT = std::minmax_element(det.channels.begin(), det.channels.end());
+	m_dLatticeMin[2] = *minmaxT.first;
+	m_dLatticeMax[2] = *minmaxT.second;
+
+	for(int iAxis=0; iAxis<3; ++iAxis)
+	{
+		if(m_dLatticeMax[iAxis] - m_dLatticeMin[iAxis] <= tl::get_epsilon<t_real>())
+			m_iLatticeSize[iAxis] = 1;
+	}
+
+
+	// calculate the nodes
+	const std::size_t iNumNodes = m_iLatticeSize[0] * m_iLatticeSize[1] * m_iLatticeSize[2];
+	m_vecNodes.resize(iNumNodes);
+
+	const unsigned int iNumThreads = std::max<unsigned int>(1,
+		m_iMaxThreads ? m_iMaxThreads : get_max_threads());
+
+	tl::ThreadPool<void()> tp(iNumThreads);
+	for(std::size_t iTT=0; iTT<m_iLatticeSize[0]; ++iTT)
+	{
+		tp.AddTask([this, iTT]()
+		{
+			const t_real tt = GetNodeCoord(0, iTT);
+			for(std::size_t iPh=0; iPh<m_iLatticeSize[1]; ++iPh)
+			{
+				const t_real ph = GetNodeCoord(1, iPh);
+				for(std::size_t iT=0; iT<m_iLatticeSize[2]; ++iT)
+					m_vecNodes[GetNodeIdx(iTT, iPh, iT)] = CalcReso(tt, ph, GetNodeCoord(2, iT));
+			}
+		});
+	}
+
+	tp.Start();
+	for(auto& fut : tp.GetResults())
+		fut.get();
+
+	std::size_t iNumValid = std::count_if(m_vecNodes.begin(), m_vecNodes.end(),
+		[](const TofResoNode& node) -> bool { return node.bOk; });
+	tl::log_info("Calculated ", iNumValid, " of ", iNumNodes, " resolution lattice nodes (",
+		m_iLatticeSize[0], " x ", m_iLatticeSize[1], " x ", m_iLatticeSize[2], ").");
+
+	return iNumValid != 0;
+}
+
+
+/**
+ * interpolates the resolution matrix from the lattice nodes,
+ * if a neighbouring node is invalid it is calculated directly
+ */
+bool TofConvo::GetReso(t_real tt, t_real ph, t_real t, t_mat& reso) const
+{
+	const t_real dCoord[] = { std::abs(tt), ph, t };
+
+	std::size_t iIdx[3];
+	t_real dFrac[3];
+
+	bool bInterpolate = (m_vecNodes.size() != 0);
+	for(int iAxis=0; iAxis<3 && bInterpolate; ++iAxis)
+	{
+		iIdx[iAxis] = 0;
+		dFrac[iAxis] = 0;
+		if(m_iLatticeSize[iAxis] <= 1)
+			continue;
+
+		const t_real dStep = (m_dLatticeMax[iAxis] - m_dLatticeMin[iAxis]) / t_real(m_iLatticeSize[iAxis] - 1);
+		const t_real dPos = (dCoord[iAxis] - m_dLatticeMin[iAxis]) / dStep;
+
+		// outside the lattice
+		if(dPos < -tl::get_epsilon<t_real>() || dPos > t_real(m_iLatticeSize[iAxis] - 1) + tl::get_epsilon<t_real>())
+		{
+			bInterpolate = false;
+			break;
+		}
+
+		iIdx[iAxis] = std::min<std::size_t>(std::size_t(std::max<t_real>(dPos, 0)), m_iLatticeSize[iAxis] - 2);
+		dFrac[iAxis] = tl::clamp<t_real>(dPos - t_real(iIdx[iAxis]), 0, 1);
+	}
+
+	if(bInterpolate)
+	{
+		reso = ublas::zero_matrix<t_real>(4, 4);
+
+		// trilinear interpolation of the matrix elements
+		for(int iCorner=0; iCorner<8 && bInterpolate; ++iCorner)
+		{
+			std::size_t iNode[3];
+			t_real dWeight = 1;
+
+			for(int iAxis=0; iAxis<3; ++iAxis)
+			{
+				const bool bUpper = (iCorner & (1<<iAxis)) != 0;
+				if(m_iLatticeSize[iAxis] <= 1)
+				{
+					iNode[iAxis] = 0;
+					if(bUpper)
+						dWeight = 0;
+					continue;
+				}
+
+				iNode[iAxis] = iIdx[iAxis] + (bUpper ? 1 : 0);
+				dWeight *= bUpper ? dFrac[iAxis] : t_real(1) - dFrac[iAxis];
+			}
+
+			if(dWeight <= tl::get_epsilon<t_real>())
+				continue;
+
+			const TofResoNode& node = m_vecNodes[GetNodeIdx(iNode[0], iNode[1], iNode[2])];
+			if(!node.bOk)
+				bInterpolate = false;
+			else
+				reso += dWeight * node.reso;
+		}
+	}
+
+	if(!bInterpolate)
+	{
+		TofResoNode node = CalcReso(tt, ph, t);
+		if(!node.bOk)
+			return false;
+		reso = node.reso;
+	}
+
+	// mirror Q_perp for negative scattering angles
+	if(tt < t_real(0))
+	{
+		for(std::size_t i=0; i<4; ++i)
+		{
+			if(i == 1)
+				continue;
+			reso(1, i) = -reso(1, i);
+			reso(i, 1) = -reso(i, 1);
+		}
+	}
+
+	return true;
+}
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// convolution
+
+/**
+ * the deviates are drawn once, so that neighbouring pixels and channels
+ * are smeared out with the same set of neutrons
+ */
+void TofConvo::SetNeutronCount(std::size_t iNum)
+{
+	m_vecDeviates.clear();
+	m_vecDeviates.reserve(iNum);
+
+	for(std::size_t iNeutr=0; iNeutr<iNum; ++iNeutr)
+	{
+		m_vecDeviates.emplace_back(tl::make_vec<t_vec>({
+			tl::rand_norm<t_real>(0, 1), tl::rand_norm<t_real>(0, 1),
+			tl::rand_norm<t_real>(0, 1), tl::rand_norm<t_real>(0, 1) }));
+	}
+}
+
+
+/**
+ * gets the (h, k, l, E) coordinates of a pixel and time channel
+ */
+bool TofConvo::GetHKLE(const TofPixel& pix, t_real t, t_vec& vecHKLE) const
+{
+	t_vec vecQ;
+	t_real dE, dKf;
+	if(!GetKinematics(pix, t, vecQ, dE, dKf))
+		return false;
+
+	const t_mat matRot = tl::rotation_matrix_3d_z<t_mat>(-m_dPsi);
+	t_vec vecQRot = ublas::prod(matRot, vecQ);
+	t_vec vecHKL = ublas::prod(m_matUBinv, vecQRot);
+
+	vecHKLE = tl::make_vec<t_vec>({ vecHKL[0], vecHKL[1], vecHKL[2], dE });
+	return true;
+}
+
+
+/**
+ * lower cholesky factor of a 4x4 covariance matrix
+ */
+static bool cholesky4(const t_mat& mat, t_mat& L)
+{
+	L = ublas::zero_matrix<t_real>(4, 4);
+
+	for(std::size_t i=0; i<4; ++i)
+	{
+		for(std::size_t j=0; j<=i; ++j)
+		{
+			t_real dSum = mat(i, j);
+			for(std::size_t k=0; k<j; ++k)
+				dSum -= L(i, k) * L(j, k);
+
+			if(i == j)
+			{
+				if(dSum <= t_real(0))
+					return false;
+				L(i, i) = std::sqrt(dSum);
+			}
+			else
+			{
+				L(i, j) = dSum / L(j, j);
+			}
+		}
+	}
+
+	return true;
+}
+
+
+/**
+ * convolves the S(Q, E) model with the resolution of every pixel and time channel,
+ * the returned data is ordered by pixel, then by channel
+ */
+std::vector<t_real> TofConvo::Convolve(const TofDetector& det, const SqwBase& sqw) const
+{
+	const std::size_t iNumPix = det.pixels.size();
+	const std::size_t iNumCh = det.channels.size();
+	std::vector<t_real> vecData(iNumPix * iNumCh, t_real(0));
+
+	if(!m_vecDeviates.size())
+	{
+		tl::log_err("No neutrons defined for the convolution.");
+		return vecData;
+	}
+
+	const t_mat matRot = tl::rotation_matrix_3d_z<t_mat>(-m_dPsi);
+	const t_mat matToHKL = ublas::prod(m_matUBinv, matRot);
+	std::atomic<std::size_t> iNumInvalid{0};
+
+	const unsigned int iNumThreads = std::max<unsigned int>(1,
+		m_iMaxThreads ? m_iMaxThreads : get_max_threads());
+
+	// a few blocks of pixels per thread
+	const std::size_t iBlockLen = std::max<std::size_t>(1, iNumPix / (4*iNumThreads));
+
+	tl::ThreadPool<void()> tp(iNumThreads);
+	for(std::size_t iBlock=0; iBlock<iNumPix; iBlock+=iBlockLen)
+	{
+		tp.AddTask([this, iBlock, iBlockLen, iNumPix, iNumCh,
+			&det, &sqw, &matToHKL, &vecData, &iNumInvalid]()
+		{
+			t_vec vecQ, vecQNeutr(3), vecHKL(3);
+			t_mat reso, cov, L;
+
+			for(std::size_t iPix=iBlock; iPix<std::min(iBlock+iBlockLen, iNumPix); ++iPix)
+			{
+				const TofPixel& pix = det.pixels[iPix];
+
+				for(std::size_t iCh=0; iCh<iNumCh; ++iCh)
+				{
+					// integrate over the time channel using the midpoint rule
+					const std::size_t iNumSteps = det.width > t_real(0) ? m_iChannelSteps : 1;
+					const t_real dStep = det.width > t_real(0) ? det.width / t_real(iNumSteps) : t_real(1);
+
+					t_real dI = 0;
+					bool bValid = true;
+					for(std::size_t iStep=0; iStep<iNumSteps; ++iStep)
+					{
+						const t_real t = det.channels[iCh] +
+							(t_real(iStep) + t_real(0.5) - t_real(0.5)*t_real(iNumSteps)) * dStep;
+
+						t_real dE, dKf, dEdt;
+						if(!GetKinematics(pix, t, vecQ, dE, dKf, &dEdt) ||
+							!GetReso(pix.twotheta, pix.phi, t, reso) ||
+							!tl::inverse(reso, cov) || !cholesky4(cov, L))
+						{
+							bValid = false;
+							break;
+						}
+
+						// (Q_para, Q_perp, Q_z) basis of the resolution matrix in the lab system,
+						// Q_para is along the in-plane projection of Q (see CalcReso)
+						t_real dQip = std::sqrt(vecQ[0]*vecQ[0] + vecQ[1]*vecQ[1]);
+						if(dQip <= tl::get_epsilon<t_real>())
+							dQip = tl::get_epsilon<t_real>();
+						const t_real dPara[] = { vecQ[0]/dQip, vecQ[1]/dQip };
+						const t_real dPerp[] = { -dPara[1], dPara[0] };
+
+						t_real dS = 0;
+						for(const t_vec& vecDev : m_vecDeviates)
+						{
+							const t_vec vecOffs = ublas::prod(L, vecDev);
+
+							vecQNeutr[0] = vecQ[0] + vecOffs[0]*dPara[0] + vecOffs[1]*dPerp[0];
+							vecQNeutr[1] = vecQ[1] + vecOffs[0]*dPara[1] + vecOffs[1]*dPerp[1];
+							vecQNeutr[2] = vecQ[2] + vecOffs[2];
+							vecHKL = ublas::prod(matToHKL, vecQNeutr);
+
+							dS += sqw(vecHKL[0], vecHKL[1], vecHKL[2], dE + vecOffs[3]);
+						}
+						dS /= t_real(m_vecDeviates.size());
+
+						// kf/ki factor of the double-differential cross-section and
+						// jacobian |dE/dt| from the energy to the time-of-flight bins
+						dI += dS * dKf/m_dKi * dEdt * dStep;
+					}
+
+					if(!bValid)
+					{
+						++iNumInvalid;
+						continue;
+					}
+
+					vecData[iPix*iNumCh + iCh] = m_dScale * dI + m_dOffs;
+				}
+			}
+		});
+	}
+
+	tp.Start();
+	for(auto& fut : tp.GetResults())
+		fut.get();
+
+	if(iNumInvalid)
+	{
+		tl::log_warn(iNumInvalid, " data point(s) are kinematically forbidden ",
+			"or have an invalid resolution matrix.");
+	}
+
+	return vecData;
+}
+
+
+/**
+ * saves the convolution, one line per pixel with one column per time channel
+ */
+bool TofConvo::Save(const std::string& strFile, const TofDetector& det,
+	const std::vector<t_real>& vecData)
+{
+	std::ofstream ofstr(strFile);
+	if(!ofstr)
+	{
+		tl::log_err("Cannot open output file \"", strFile, "\".");
+		return false;
+	}
+
+	ofstr.precision(g_iPrec);
+	ofstr << "# pixels: " << det.pixels.size() << "\n";
+	ofstr << "# channels: " << det.channels.size() << "\n";
+	ofstr << "# channel times (us):";
+	for(t_real t : det.channels)
+		ofstr << " " << t*t_real(1e6);
+	ofstr << "\n";
+	ofstr << "# channel width (us): " << det.width*t_real(1e6) << "\n";
+	ofstr << "# columns: 2theta (deg), phi (deg), intensity for each channel\n";
+
+	const std::size_t iNumCh = det.channels.size();
+	for(std::size_t iPix=0; iPix<det.pixels.size(); ++iPix)
+	{
+		const TofPixel& pix = det.pixels[iPix];
+		ofstr << std::left << std::setw(g_iPrec*2) << tl::r2d(pix.twotheta) << " ";
+		ofstr << std::left << std::setw(g_iPrec*2) << tl::r2d(pix.phi);
+
+		for(std::size_t iCh=0; iCh<iNumCh; ++iCh)
+			ofstr << " " << std::left << std::setw(g_iPrec*2) << vecData[iPix*iNumCh + iCh];
+		ofstr << "\n";
+	}
+
+	return true;
+}
+// ----------------------------------------------------------------------------
@@ -0,0 +1,148 @@
+/**
+ * detector-wide convolution of S(Q, E) models for time-of-flight spectrometers
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * @desc uses the Violini resolution model, see: [vio14] N. Violini et al., NIM A 736 (2014) pp. 31-39, doi: 10.1016/j.nima.2013.10.042
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __TAKIN_TOFCONVO_H__
+#define __TAKIN_TOFCONVO_H__
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <boost/numeric/ublas/vector.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+
+#include "tools/res/vio.h"
+#include "tools/monteconvo/sqwbase.h"
+
+namespace ublas = boost::numeric::ublas;
+
+
+/**
+ * detector pixel
+ */
+struct TofPixel
+{
+	t_real_reso twotheta = 0;    // in-plane scattering angle in rad
+	t_real_reso phi = 0;         // out-of-plane angle in rad
+	t_real_reso dist = -1;       // sample-detector distance in m, < 0: use the instrument's distance
+};
+
+
+/**
+ * detector pixels and time channels
+ */
+struct TofDetector
+{
+	std::vector<TofPixel> pixels;
+
+	// flight times from the monochromating chopper to the detector in s
+	std::vector<t_real_reso> channels;
+
+	// width of the time channels in s, <= 0: no integration over the channels
+	t_real_reso width = 0;
+
+	bool LoadPixels(const std::string& strFile);
+	void SetChannels(t_real_reso tMin, t_real_reso tMax, std::size_t iNum);
+};
+
+
+/**
+ * resolution matrix at a lattice node
+ */
+struct TofResoNode
+{
+	bool bOk = false;
+	ublas::matrix<t_real_reso> reso;     // in the (Q_para, Q_perp, Q_z, E) system
+};
+
+
+class TofConvo
+{
+public:
+	using t_real = t_real_reso;
+	using t_vec = ublas::vector<t_real>;
+	using t_mat = ublas::matrix<t_real>;
+
+protected:
+	VioParams m_params;             // instrument lengths and sigmas
+	t_real m_dKi = 1.4;             // incident wavenumber in 1/A
+
+	t_mat m_matUBinv;               // lab Q system to rlu
+	t_real m_dPsi = 0;              // sample rotation around the vertical axis in rad
+
+	// coarse (|2theta|, phi, t) lattice of resolution matrices
+	std::size_t m_iLatticeSize[3] = { 16, 4, 16 };
+	t_real m_dLatticeMin[3] = { 0, 0, 0 }, m_dLatticeMax[3] = { 0, 0, 0 };
+	std::vector<TofResoNode> m_vecNodes;
+
+	// standard normal deviates shared by all data points
+	std::vector<t_vec> m_vecDeviates;
+
+	// sampling points for the integration over a time channel
+	std::size_t m_iChannelSteps = 4;
+
+	t_real m_dScale = 1, m_dOffs = 0;
+
+	unsigned int m_iMaxThreads = 0;
+
+protected:
+	bool GetKinematics(const TofPixel& pix, t_real t,
+		t_vec& vecQ, t_real& dE, t_real& dKf, t_real *pdEdt = nullptr) const;
+	TofResoNode CalcReso(t_real tt, t_real ph, t_real t) const;
+
+	std::size_t GetNodeIdx(std::size_t iTT, std::size_t iPh, std::size_t iT) const;
+	t_real GetNodeCoord(int iAxis, std::size_t iNode) const;
+
+public:
+	TofConvo() = default;
+	~TofConvo() = default;
+
+	void SetInstrument(const VioParams& params) { m_params = params; }
+	void SetKi(t_real dKi) { m_dKi = dKi; }
+	void SetUBinv(const t_mat& matUBinv) { m_matUBinv = matUBinv; }
+	void SetSampleRotation(t_real dPsi) { m_dPsi = dPsi; }
+	void SetLatticeSize(std::size_t iTT, std::size_t iPh, std::size_t iT);
+	void SetNeutronCount(std::size_t iNum);
+	void SetChannelSteps(std::size_t iNum) { m_iChannelSteps = std::max<std::size_t>(iNum, 1); }
+	void SetScale(t_real dScale, t_real dOffs) { m_dScale = dScale; m_dOffs = dOffs; }
+	void SetMaxThreads(unsigned int iNum) { m_iMaxThreads = iNum; }
+
+	bool CalcLattice(const TofDetector& det);
+	bool GetReso(t_real tt, t_real ph, t_real t, t_mat& reso) const;
+
+	bool GetHKLE(const TofPixel& pix, t_real t, t_vec& vecHKLE) const;
+	std::vector<t_real> Convolve(const TofDetector& det, const SqwBase& sqw) const;
+
+	static bool Save(const std::string& strFile, const TofDetector& det,
+		const std::vector<t_real>& vecData);
+};
+
+
+#endif
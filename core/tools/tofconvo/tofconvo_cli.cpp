@@ -0,0 +1,308 @@
+/**
+ * detector-wide convolution of S(Q, E) models for time-of-flight spectrometers -- CLI program
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv2
+ *
+ * ----------------------------------------------------------------------------
+ * Takin (inelastic neutron scattering software package)
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2013-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ----------------------------------------------------------------------------
+ */
+
+// e.g. takin_tofconvo --instr=tof.taz --crys=crys.taz --sqw=phonon --sqw-conf=phonon.conf
+//      --det=pixels.dat --tof=3000:6000:200 --psi=30 --out=convo.dat
+
+#include <boost/program_options.hpp>
+
+#include <vector>
+#include <string>
+
+#include "tofconvo.h"
+#include "tools/monteconvo/TASReso.h"
+#include "tools/monteconvo/sqwfactory.h"
+#include "libs/globals.h"
+
+#include "tlibs/string/string.h"
+#include "tlibs/math/rand.h"
+#include "tlibs/log/log.h"
+#include "tlibs/time/stopwatch.h"
+
+namespace opts = boost::program_options;
+
+using t_real = TofConvo::t_real;
+using t_mat = TofConvo::t_mat;
+
+
+/**
+ * parses a range given as "min:max:num"
+ */
+static bool parse_range(const std::string& strRange, t_real& dMin, t_real& dMax, std::size_t& iNum)
+{
+	std::vector<std::string> vecToks;
+	tl::get_tokens<std::string, std::string>(strRange, ":,", vecToks);
+	if(vecToks.size() != 3)
+	{
+		tl::log_err("Invalid range \"", strRange, "\", expected \"min:max:num\".");
+		return false;
+	}
+
+	dMin = tl::str_to_var<t_real>(vecToks[0]);
+	dMax = tl::str_to_var<t_real>(vecToks[1]);
+	iNum = tl::str_to_var<std::size_t>(vecToks[2]);
+
+	if(iNum == 0 || dMax <= dMin)
+	{
+		tl::log_err("Invalid range \"", strRange, "\".");
+		return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * creates the S(Q, E) model and applies the parameter overrides
+ */
+static std::shared_ptr<SqwBase> setup_sqw(const std::string& strSqw,
+	const std::string& _strSqwConf, const std::string& strSqwParams)
+{
+	const std::string strSqwConf = find_file_in_global_paths(_strSqwConf);
+	if(strSqwConf == "")
+	{
+		tl::log_err("No S(Q, E) config file given.");
+		return nullptr;
+	}
+
+	std::shared_ptr<SqwBase> pSqw = construct_sqw(strSqw, strSqwConf);
+	if(!pSqw)
+	{
+		tl::log_err("Unknown S(Q, E) model selected.");
+		return nullptr;
+	}
+
+	if(!pSqw->IsOk())
+	{
+		tl::log_err("Could not create S(Q, E).");
+		return nullptr;
+	}
+
+	if(strSqwParams != "")
+		pSqw->SetVars(strSqwParams);
+
+	return pSqw;
+}
+
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		tl::log_info("--------------------------------------------------------------------------------");
+		tl::log_info("This is the Takin time-of-flight convolution simulator.");
+		tl::log_info("Written by Tobias Weber <tweber@ill.fr>, 2026.");
+		tl::log_info("--------------------------------------------------------------------------------");
+
+		std::string strInstr, strCrys;
+		std::string strSqw, strSqwConf, strSqwParams;
+		std::string strDet, strTof, strLattice = "16:4:16";
+		std::string strOut = "tofconvo.dat";
+		t_real dKi = -1, dPsi = 0;
+		t_real dScale = 1, dOffs = 0;
+		std::size_t iNumNeutrons = 500;
+		std::size_t iChannelSteps = 4;
+
+		opts::options_description args("tof convolution options");
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("instr",
+			opts::value<decltype(strInstr)>(&strInstr),
+			"instrument file with the Violini parameters")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("crys",
+			opts::value<decltype(strCrys)>(&strCrys),
+			"crystal file")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("sqw",
+			opts::value<decltype(strSqw)>(&strSqw),
+			"S(Q, E) model")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("sqw-conf",
+			opts::value<decltype(strSqwConf)>(&strSqwConf),
+			"S(Q, E) model configuration file")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("sqw-params",
+			opts::value<decltype(strSqwParams)>(&strSqwParams),
+			"S(Q, E) model parameter overrides, e.g. \"param1=val1; param2=val2\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("det",
+			opts::value<decltype(strDet)>(&strDet),
+			"detector file, one pixel per line: 2theta (deg), phi (deg), distance (cm)")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("tof",
+			opts::value<decltype(strTof)>(&strTof),
+			"time channels in us from the monochromating chopper, \"min:max:channels\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("ki",
+			opts::value<decltype(dKi)>(&dKi),
+			"incident wavenumber in 1/A, default: from the instrument file")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("psi",
+			opts::value<decltype(dPsi)>(&dPsi),
+			"sample rotation in deg, angle between ki and the first orientation vector")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("lattice",
+			opts::value<decltype(strLattice)>(&strLattice),
+			"resolution lattice nodes, \"2theta:phi:t\"")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("neutrons",
+			opts::value<decltype(iNumNeutrons)>(&iNumNeutrons),
+			"number of neutrons per data point")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("channel-steps",
+			opts::value<decltype(iChannelSteps)>(&iChannelSteps),
+			"integration steps over the width of a time channel")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("scale",
+			opts::value<decltype(dScale)>(&dScale),
+			"intensity scale")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("offs",
+			opts::value<decltype(dOffs)>(&dOffs),
+			"intensity offset")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("out",
+			opts::value<decltype(strOut)>(&strOut),
+			"output file")));
+		args.add(boost::shared_ptr<opts::option_description>(
+			new opts::option_description("max-threads",
+			opts::value<decltype(g_iMaxThreads)>(&g_iMaxThreads),
+			"maximum number of threads")));
+
+		opts::basic_command_line_parser<char> clparser(argc, argv);
+		clparser.options(args);
+		opts::basic_parsed_options<char> parsedopts = clparser.run();
+
+		opts::variables_map opts_map;
+		opts::store(parsedopts, opts_map);
+		opts::notify(opts_map);
+
+		if(argc <= 1)
+		{
+			std::ostringstream ostrHelp;
+			ostrHelp << "Usage: " << argv[0] << " [options]\n";
+			ostrHelp << args;
+			tl::log_info(ostrHelp.str());
+			return -1;
+		}
+
+		tl::init_rand();
+		load_sqw_plugins();
+
+
+		// --------------------------------------------------------------------
+		// instrument and crystal
+		TASReso reso;
+
+		const std::string strInstrFile = find_file_in_global_paths(strInstr);
+		if(strInstrFile == "" || !reso.LoadRes(strInstrFile.c_str()))
+		{
+			tl::log_err("Could not load instrument file \"", strInstr, "\".");
+			return -1;
+		}
+
+		const std::string strCrysFile = find_file_in_global_paths(strCrys);
+		if(strCrysFile == "" || !reso.LoadLattice(strCrysFile.c_str()))
+		{
+			tl::log_err("Could not load crystal file \"", strCrys, "\".");
+			return -1;
+		}
+
+		t_mat matUBinv = reso.GetMCOpts().matUBinv;
+		matUBinv.resize(3, 3, true);
+
+		if(dKi <= 0)
+			dKi = reso.GetTofResoParams().ki * tl::get_one_angstrom<t_real>();
+		// --------------------------------------------------------------------
+
+
+		// --------------------------------------------------------------------
+		// detector
+		TofDetector det;
+		if(!det.LoadPixels(strDet))
+			return -1;
+
+		t_real dTMin = 0, dTMax = 0;
+		std::size_t iNumChannels = 0;
+		if(!parse_range(strTof, dTMin, dTMax, iNumChannels))
+			return -1;
+		det.SetChannels(dTMin*t_real(1e-6), dTMax*t_real(1e-6), iNumChannels);
+
+		std::vector<std::size_t> vecLattice;
+		tl::get_tokens<std::size_t, std::string>(strLattice, ":,", vecLattice);
+		if(vecLattice.size() != 3)
+		{
+			tl::log_err("Invalid resolution lattice \"", strLattice, "\".");
+			return -1;
+		}
+		// --------------------------------------------------------------------
+
+
+		std::shared_ptr<SqwBase> pSqw = setup_sqw(strSqw, strSqwConf, strSqwParams);
+		if(!pSqw)
+			return -1;
+
+
+		// --------------------------------------------------------------------
+		// convolution
+		TofConvo convo;
+		convo.SetInstrument(reso.GetTofResoParams());
+		convo.SetKi(dKi);
+		convo.SetUBinv(matUBinv);
+		convo.SetSampleRotation(tl::d2r(dPsi));
+		convo.SetLatticeSize(vecLattice[0], vecLattice[1], vecLattice[2]);
+		convo.SetNeutronCount(iNumNeutrons);
+		convo.SetChannelSteps(iChannelSteps);
+		convo.SetScale(dScale, dOffs);
+
+		tl::log_info("Convolving ", det.pixels.size(), " pixel(s) x ", det.channels.size(),
+			" channel(s) with ", iNumNeutrons, " neutron(s) each, ki = ", dKi, " / A.");
+
+		tl::Stopwatch<t_real> watch;
+		watch.start();
+
+		if(!convo.CalcLattice(det))
+			return -1;
+		std::vector<t_real> vecData = convo.Convolve(det, *pSqw);
+
+		watch.stop();
+		tl::log_info("Convolution took ", tl::get_duration_str_secs<t_real>(watch.GetDur()), ".");
+
+		if(!TofConvo::Save(strOut, det, vecData))
+			return -1;
+		tl::log_info("Wrote \"", strOut, "\".");
+		// --------------------------------------------------------------------
+	}
+	catch(const std::exception& ex)
+	{
+		tl::log_crit(ex.what());
+		return -1;
+	}
+
+	return 0;
+}
@@ -31,6 +31,9 @@
 
 #include <vector>
 #include <optional>
+#include <thread>
+#include <algorithm>
+#include <cmath>
 
 #include "tlibs2/libs/maths.h"
 #include "libs/loadcif.h"
@@ -70,6 +73,10 @@ public:
 		m_face_polygons.clear();
 		m_face_norms.clear();
 		m_face_dists.clear();
+
+		m_fold_G.clear();
+		m_fold_G_rlu.clear();
+		m_fold_G_len2.clear();
 	}
 
 
@@ -134,6 +141,7 @@ public:
 	const std::vector<std::vector<std::size_t>>& GetFacesIndices() const { return m_face_polygons; }
 	const std::vector<t_vec>& GetFaceNormals() const { return m_face_norms; }
 	const std::vector<t_real>& GetFaceDistances() const { return m_face_dists; }
+	const std::vector<t_vec>& GetFoldPlanes(bool rlu = false) const { return rlu ? m_fold_G_rlu : m_fold_G; }
 
 	const std::vector<t_vec>& GetAllTriangles() const { return m_all_triags; }
 	const std::vector<std::size_t>& GetAllTrianglesIndices() const { return m_all_triags_idx; }
@@ -386,6 +394,146 @@ public:
 
 		return true;
 	}
+
+
+	/**
+	 * get the voronoi-relevant reciprocal lattice vectors, i.e. the ones whose
+	 * bisecting planes form the faces of the calculated brillouin zone
+	 * @returns number of folding planes
+	 */
+	std::size_t CalcFoldPlanes()
+	{
+		m_fold_G.clear();
+		m_fold_G_rlu.clear();
+		m_fold_G_len2.clear();
+
+		bool inv_ok = false;
+		std::tie(m_crystBinv, inv_ok) = tl2::inv<t_mat>(m_crystB);
+		if(!inv_ok)
+			return 0;
+
+		for(std::size_t peak_idx = 0; peak_idx < m_peaks_invA.size(); ++peak_idx)
+		{
+			if(m_idx000 && peak_idx == *m_idx000)
+				continue;
+
+			const t_vec& G = m_peaks_invA[peak_idx];
+			t_real G_len = tl2::norm<t_vec>(G);
+			if(tl2::equals_0<t_real>(G_len, m_eps))
+				continue;
+
+			// the face bisects the (000)-G connection
+			t_vec G_dir = G / G_len;
+			bool is_face = false;
+			for(std::size_t face_idx = 0; face_idx < m_face_norms.size(); ++face_idx)
+			{
+				if(tl2::equals<t_real>(m_face_dists[face_idx], G_len*t_real(0.5), m_eps)
+					&& tl2::equals<t_vec>(m_face_norms[face_idx], G_dir, m_eps))
+				{
+					is_face = true;
+					break;
+				}
+			}
+
+			if(!is_face)
+				continue;
+
+			t_vec G_rlu = m_crystBinv * G;
+			for(t_real& hkl : G_rlu)
+				hkl = std::round(hkl);
+
+			m_fold_G.push_back(G);
+			m_fold_G_rlu.emplace_back(std::move(G_rlu));
+			m_fold_G_len2.push_back(G_len * G_len);
+		}
+
+		return m_fold_G.size();
+	}
+
+
+	/**
+	 * fold a wave vector into the first brillouin zone using the
+	 * planes from CalcFoldPlanes(), such that Q = q + G
+	 * @returns the reduced q and the reciprocal lattice vector G, in rlu or in 1/A
+	 */
+	std::pair<t_vec, t_vec> FoldQ(const t_vec& Q, bool rlu = true) const
+	{
+		t_vec q = rlu ? m_crystB * Q : Q;
+		t_vec G_rlu = tl2::zero<t_vec>(3);
+
+		// walk towards the nearest lattice point: each step shortens q,
+		// and q is inside the zone when it is on the origin's side of all planes
+		for(std::size_t iter = 0; iter < s_max_fold_iter; ++iter)
+		{
+			std::size_t best_idx = s_erridx;
+			t_real best_ratio = t_real(0.5) + m_eps;
+
+			for(std::size_t plane_idx = 0; plane_idx < m_fold_G.size(); ++plane_idx)
+			{
+				t_real ratio = tl2::inner<t_vec>(q, m_fold_G[plane_idx]) / m_fold_G_len2[plane_idx];
+				if(ratio > best_ratio)
+				{
+					best_ratio = ratio;
+					best_idx = plane_idx;
+				}
+			}
+
+			if(best_idx == s_erridx)
+				break;
+
+			// jump over as many lattice vectors as fit
+			t_real num = std::round(best_ratio);
+			q -= num * m_fold_G[best_idx];
+			G_rlu += num * m_fold_G_rlu[best_idx];
+		}
+
+		if(rlu)
+			return std::make_pair(m_crystBinv * q, G_rlu);
+		return std::make_pair(q, m_crystB * G_rlu);
+	}
+
+
+	/**
+	 * fold a batch of wave vectors into the first brillouin zone
+	 * @returns the reduced q and the reciprocal lattice vectors G
+	 */
+	void FoldQs(const std::vector<t_vec>& Qs, std::vector<t_vec>& qs, std::vector<t_vec>& Gs,
+		bool rlu = true, unsigned int max_threads = 0) const
+	{
+		qs.resize(Qs.size());
+		Gs.resize(Qs.size());
+
+		FoldParallel(Qs.size(), max_threads, [&Qs, &qs, &Gs, rlu, this](std::size_t idx)
+		{
+			std::tie(qs[idx], Gs[idx]) = FoldQ(Qs[idx], rlu);
+		});
+	}
+
+
+	/**
+	 * fold a batch of wave vectors given as a flat (Qx, Qy, Qz, ...) array
+	 * @returns a flat (qx, qy, qz, Gx, Gy, Gz, ...) array
+	 */
+	std::vector<t_real> FoldQsFlat(const std::vector<t_real>& Qs,
+		bool rlu = true, unsigned int max_threads = 0) const
+	{
+		const std::size_t num_Qs = Qs.size() / 3;
+		std::vector<t_real> results(num_Qs * 6);
+
+		FoldParallel(num_Qs, max_threads, [&Qs, &results, rlu, this](std::size_t idx)
+		{
+			t_vec Q = tl2::create<t_vec>({ Qs[idx*3 + 0], Qs[idx*3 + 1], Qs[idx*3 + 2] });
+			auto [q, G] = FoldQ(Q, rlu);
+
+			for(std::size_t i = 0; i < 3; ++i)
+			{
+				results[idx*6 + i] = q[i];
+				results[idx*6 + 3 + i] = G[i];
+			}
+		});
+
+		return results;
+	}
 	// --------------------------------------------------------------------------------
 
 
@@ -589,6 +737,37 @@ public:
 	// --------------------------------------------------------------------------------
 
 
+private:
+	/**
+	 * run a function over the index range [0, num) in contiguous blocks
+	 */
+	template<class t_func>
+	static void FoldParallel(std::size_t num, unsigned int max_threads, t_func&& func)
+	{
+		if(max_threads == 0)
+			max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+		std::size_t num_threads = std::min<std::size_t>(max_threads, num / s_min_fold_block + 1);
+
+		std::vector<std::thread> threads;
+		threads.reserve(num_threads);
+
+		for(std::size_t thread_idx = 0; thread_idx < num_threads; ++thread_idx)
+		{
+			std::size_t begin = num * thread_idx / num_threads;
+			std::size_t end = num * (thread_idx + 1) / num_threads;
+
+			threads.emplace_back([begin, end, &func]()
+			{
+				for(std::size_t idx = begin; idx < end; ++idx)
+					func(idx);
+			});
+		}
+
+		for(std::thread& thread : threads)
+			thread.join();
+	}
+
+
 private:
 	t_real m_eps{ 1e-7 };                          // calculation epsilon
 
@@ -612,7 +791,14 @@ private:
 	std::vector<t_vec> m_face_norms{};
 	std::vector<t_real> m_face_dists{};
 
+	t_mat m_crystBinv{tl2::unit<t_mat>(3)};        // inverse crystal B matrix
+	std::vector<t_vec> m_fold_G{};                 // voronoi-relevant lattice vectors in 1/A
+	std::vector<t_vec> m_fold_G_rlu{};             // ... and in rlu
+	std::vector<t_real> m_fold_G_len2{};           // ... and their squared lengths
+
 	static const std::size_t s_erridx{0xffffffff}; // index for reporting errors
+	static const std::size_t s_max_fold_iter{1024}; // maximum number of folding steps per point
+	static const std::size_t s_min_fold_block{1024}; // minimum number of points per folding thread
 };
 
 
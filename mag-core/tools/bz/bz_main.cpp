@@ -39,6 +39,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 
 
 #ifndef DONT_USE_BOOTS_PROGOPTS
@@ -61,10 +62,62 @@ static inline void set_locales()
 
 
 
+/**
+ * folds the Q points (in rlu) given in a file into the first brillouin zone
+ * @returns a table of the Q points, their reduced q and their reciprocal lattice vectors G
+ */
+static std::string fold_qs(const BZCalc<t_mat, t_vec, t_real>& bzcalc, const std::string& fold_file)
+{
+	std::ifstream ifstr{fold_file};
+	if(!ifstr)
+		throw std::runtime_error("Cannot open Q file \"" + fold_file + "\".");
+
+	// read the Q points, one per line
+	std::vector<t_vec> Qs;
+	std::string line;
+	while(std::getline(ifstr, line))
+	{
+		if(line.size() == 0 || line[0] == '#')
+			continue;
+
+		std::istringstream istr{line};
+		t_real h{}, k{}, l{};
+		if(!(istr >> h >> k >> l))
+			continue;
+
+		Qs.emplace_back(tl2::create<t_vec>({ h, k, l }));
+	}
+
+	std::vector<t_vec> qs, Gs;
+	bzcalc.FoldQs(Qs, qs, Gs, true);
+
+	std::ostringstream ostr;
+	ostr.precision(g_prec);
+	ostr << "# Q_h Q_k Q_l q_h q_k q_l G_h G_k G_l\n";
+
+	for(std::size_t idx = 0; idx < Qs.size(); ++idx)
+	{
+		for(const t_vec* vec : { &Qs[idx], &qs[idx], &Gs[idx] })
+		{
+			for(t_real elem : *vec)
+			{
+				tl2::set_eps_0(elem, g_eps);
+				ostr << elem << " ";
+			}
+		}
+		ostr << "\n";
+	}
+
+	return ostr.str();
+}
+
+
+
 /**
  * starts the cli program
  */
-static int cli_main(const std::string& cfg_file, const std::string& results_file, bool use_stdin)
+static int cli_main(const std::string& cfg_file, const std::string& results_file, bool use_stdin,
+	const std::string& fold_file = "")
 {
 	try
 	{
@@ -87,8 +140,22 @@ static int cli_main(const std::string& cfg_file, const std::string& results_file
 			return -1;
 		}
 
-		// get calculated bz
-		std::string results = bzcalc.PrintJSON(g_prec);
+		// get calculated bz or the folded Q points
+		std::string results;
+		if(fold_file == "")
+		{
+			results = bzcalc.PrintJSON(g_prec);
+		}
+		else
+		{
+			if(!bzcalc.CalcFoldPlanes())
+			{
+				std::cerr << "Error calculating Brillouin zone folding planes." << std::endl;
+				return -1;
+			}
+
+			results = fold_qs(bzcalc, fold_file);
+		}
 
 		if(results_file == "")
 		{
@@ -153,7 +220,7 @@ int main(int argc, char** argv)
 	bool show_help = false;
 	bool use_stdin = false;
 	t_real eps = -1.;
-	std::string cfg_file, results_file;
+	std::string cfg_file, results_file, fold_file;
 
 	args::options_description arg_descr("Takin/BZ arguments");
 	arg_descr.add_options()
@@ -164,7 +231,8 @@ int main(int argc, char** argv)
 		("stdin,s", args::bool_switch(&use_stdin), "load configuration file from standard input")
 		("eps,e", args::value(&eps), "set epsilon value")
 		("input,i", args::value(&cfg_file), "input configuration file")
-		("output,o", args::value(&results_file), "output results file");
+		("output,o", args::value(&results_file), "output results file")
+		("fold,f", args::value(&fold_file), "fold the Q points (rlu) from this file into the first Brillouin zone");
 
 	args::positional_options_description posarg_descr;
 	posarg_descr.add("input", 1);
@@ -190,8 +258,8 @@ int main(int argc, char** argv)
 
 #ifndef DONT_USE_QT
 	// either start the cli or the gui program
-	if(use_cli)
-		return cli_main(cfg_file, results_file, use_stdin);
+	if(use_cli || fold_file != "")
+		return cli_main(cfg_file, results_file, use_stdin, fold_file);
 	return gui_main(argc, argv, cfg_file, use_stdin);
 #else
 	// only start the cli program
@@ -200,7 +268,7 @@ int main(int argc, char** argv)
 		std::cout << arg_descr << std::endl;
 		return -1;
 	}
-	return cli_main(cfg_file, results_file, use_stdin);
+	return cli_main(cfg_file, results_file, use_stdin, fold_file);
 #endif
 }
 
@@ -34,3 +34,14 @@ if calc_ok:
 	print("\nJSON Output:")
 	json = bz.PrintJSON(6)
 	print(json)
+
+if calc_ok:
+	num_planes = bz.CalcFoldPlanes()
+	print("\nUsing %d folding planes." % num_planes)
+
+	# fold Q points (rlu) into the first zone, results are (q, G) for each point
+	Qs = [ 2.6, 0.1, -3.9,   0.9, 1.2, 0.4 ]
+	qGs = bz.FoldQsFlat(bzcalc.VecD(Qs), True, 0)
+	for idx in range(len(Qs) // 3):
+		print("Q = %s  ->  q = %s, G = %s" % (Qs[idx*3 : idx*3+3],
+			list(qGs[idx*6 : idx*6+3]), list(qGs[idx*6+3 : idx*6+6])))
@@ -42,6 +42,7 @@
 #include <QtWidgets/QSpinBox>
 #include <QtWidgets/QCheckBox>
 #include <QtWidgets/QComboBox>
+#include <QtWidgets/QStyledItemDelegate>
 #include <QtWidgets/QTextEdit>
 #include <QtWidgets/QPlainTextEdit>
 #include <QtWidgets/QMenuBar>
@@ -57,6 +58,7 @@
 #include <vector>
 #include <unordered_map>
 #include <optional>
+#include <functional>
 
 #include <boost/property_tree/ptree.hpp>
 
@@ -189,22 +191,73 @@ struct ExchangeTermInfo
 
 
 /**
- * combo box showing the magnetic sites and sorting according to their index
+ * table item holding the name of a coupling's site and sorting according to the site's index
  */
-struct SitesComboBox : public QComboBox, QTableWidgetItem
+struct SiteNameTableWidgetItem : public QTableWidgetItem
 {
-	SitesComboBox() = default;
-	virtual ~SitesComboBox() = default;
+	using QTableWidgetItem::QTableWidgetItem;
+	virtual ~SiteNameTableWidgetItem() = default;
+
+
+	virtual QTableWidgetItem* clone() const override
+	{
+		return new SiteNameTableWidgetItem(*this);
+	}
 
 
 	virtual bool operator<(const QTableWidgetItem& item) const override
 	{
-		const SitesComboBox* combo = dynamic_cast<const SitesComboBox*>(&item);
-		if(!combo)
-			return true;
+		return data(Qt::UserRole).toInt() < item.data(Qt::UserRole).toInt();
+	}
+};
+
+
+
+/**
+ * delegate which only creates a combo box with the magnetic sites
+ * while a coupling's site is being edited
+ */
+class SitesDelegate : public QStyledItemDelegate
+{
+public:
+	using t_getnames = std::function<QStringList()>;
+
+
+	SitesDelegate(const t_getnames& get_names, QObject *parent = nullptr)
+		: QStyledItemDelegate(parent), m_get_names{get_names}
+	{}
+
+	virtual ~SitesDelegate() = default;
 
-		return currentIndex() < combo->currentIndex();
+
+	virtual QWidget* createEditor(QWidget *parent,
+		const QStyleOptionViewItem&, const QModelIndex&) const override
+	{
+		QComboBox *combo = new QComboBox(parent);
+		combo->addItems(m_get_names());
+		return combo;
+	}
+
+
+	virtual void setEditorData(QWidget *editor, const QModelIndex& idx) const override
+	{
+		QComboBox *combo = static_cast<QComboBox*>(editor);
+		combo->setCurrentIndex(combo->findText(idx.data(Qt::EditRole).toString()));
 	}
+
+
+	virtual void setModelData(QWidget *editor,
+		QAbstractItemModel *model, const QModelIndex& idx) const override
+	{
+		// the site index used for sorting is set in TermsTableItemChanged
+		QComboBox *combo = static_cast<QComboBox*>(editor);
+		if(combo->currentIndex() >= 0)
+			model->setData(idx, combo->currentText(), Qt::EditRole);
+	}
+
+
+private:
+	t_getnames m_get_names{};
 };
 
 
@@ -414,9 +467,12 @@ protected:
 		const std::string& gen_zx = "0", const std::string& gen_zy = "0", const std::string& gen_zz = "0",
 		const std::string& rgb = "#0x00bf00");
 
-	void SyncSiteComboBoxes();
-	void SyncSiteComboBox(SitesComboBox* combo, const std::string& selected_site);
-	SitesComboBox* CreateSitesComboBox(const std::string& selected_site);
+	void SyncSiteNames();
+	QStringList GetSiteNames() const;
+
+	// bulk insertion of table rows
+	void BeginTabBatch(QTableWidget *pTab);
+	void EndTabBatch(QTableWidget *pTab);
 
 	// add a variable to the table
 	void AddVariableTabItem(int row = -1,
@@ -464,6 +520,8 @@ protected:
 	void SyncSitesFromKernel(boost::optional<const boost::property_tree::ptree&> extra_infos = boost::none);
 	void SyncTermsFromKernel(boost::optional<const boost::property_tree::ptree&> extra_infos = boost::none);
 	void SyncToKernel();         // transfer all data to the kernel
+	bool SyncTermToKernel(const QTableWidgetItem *item);  // only transfer a changed coupling
+	bool GetTermFromTable(int row, t_magdyn::ExchangeTerm& term) const;
 	void CalcAll();              // syncs sites and terms and calculates all dynamics
 
 	void PlotDispersion();
@@ -528,6 +586,10 @@ private:
 	bool m_ignoreCalc = false;
 	bool m_ignoreSitesCalc = false;
 	bool m_stopRequested = false;
+	bool m_batchTabUpdates = false;   // rows are being inserted in bulk, see BeginTabBatch()
+
+	// kernel indices of the coupling rows at the last full sync, empty if outdated
+	std::unordered_map<const QTableWidgetItem*, t_size> m_synced_terms{};
 
 	// data for dispersion plot
 	QVector<qreal> m_qs_data{}, m_Es_data{}, m_ws_data{};
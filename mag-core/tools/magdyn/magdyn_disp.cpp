@@ -28,8 +28,6 @@
 
 // these need to be included before all other things on mingw
 #include <boost/scope_exit.hpp>
-#include <boost/asio.hpp>
-namespace asio = boost::asio;
 
 #include "magdyn.h"
 
@@ -42,6 +40,7 @@ namespace asio = boost::asio;
 
 #include "tlibs2/libs/phys.h"
 #include "tlibs2/libs/algos.h"
+#include "tlibs2/libs/thread.h"
 
 using namespace tl2_ops;
 
@@ -258,10 +257,10 @@ void MagDynDlg::CalcDispersion()
 		m_hamiltonian_comp[1]->isChecked(),
 		m_hamiltonian_comp[2]->isChecked());
 
-	// tread pool
-	unsigned int num_threads = std::max<unsigned int>(
-		1, std::thread::hardware_concurrency()/2);
-	asio::thread_pool pool{num_threads};
+	// use half of the cores of the process-wide scheduler
+	tl2::Scheduler& sched = tl2::Scheduler::Get();
+	sched.SetMaxThreads(std::max<unsigned int>(
+		1, std::thread::hardware_concurrency()/2));
 
 	// mutex to protect m_qs_data, m_Es_data, and m_ws_data
 	std::mutex mtx;
@@ -269,6 +268,10 @@ void MagDynDlg::CalcDispersion()
 	using t_task = std::packaged_task<void()>;
 	using t_taskptr = std::shared_ptr<t_task>;
 	std::vector<t_taskptr> tasks;
+
+	// declared after the data used by the tasks, so that it is joined before they are destroyed
+	tl2::TaskGroup pool;
+
 	tasks.reserve(num_pts);
 
 	// keep the scanned Q component in ascending order
@@ -344,7 +347,7 @@ void MagDynDlg::CalcDispersion()
 
 		t_taskptr taskptr = std::make_shared<t_task>(task);
 		tasks.push_back(taskptr);
-		asio::post(pool, [taskptr]() { (*taskptr)(); });
+		pool.Run([taskptr]() { (*taskptr)(); });
 	}
 
 	m_status->setText("Performing calculation.");
@@ -356,7 +359,7 @@ void MagDynDlg::CalcDispersion()
 		qApp->processEvents();  // process events to see if the stop button was clicked
 		if(m_stopRequested)
 		{
-			pool.stop();
+			pool.Cancel();
 			break;
 		}
 
@@ -364,7 +367,7 @@ void MagDynDlg::CalcDispersion()
 		m_progress->setValue(task_idx+1);
 	}
 
-	pool.join();
+	pool.Join();
 
 	if(m_stopRequested)
 		m_status->setText("Calculation stopped.");
@@ -28,8 +28,6 @@
 
 // these need to be included before all other things on mingw
 #include <boost/scope_exit.hpp>
-#include <boost/asio.hpp>
-namespace asio = boost::asio;
 
 #include <boost/property_tree/xml_parser.hpp>
 namespace pt = boost::property_tree;
@@ -49,6 +47,7 @@ namespace pt = boost::property_tree;
 #include <cstdlib>
 
 #include "tlibs2/libs/str.h"
+#include "tlibs2/libs/thread.h"
 
 #ifdef USE_HDF5
 	#include "tlibs2/libs/h5file.h"
@@ -381,9 +380,15 @@ bool MagDynDlg::Load(const QString& filename, bool calc_dynamics)
 		DelTabItem(m_coordinatestab, -1);
 
 		// variables
-		for(const auto& var : m_dyn.GetVariables())
 		{
-			AddVariableTabItem(-1, var.name, var.value);
+			BeginTabBatch(m_varstab);
+			BOOST_SCOPE_EXIT(this_)
+			{
+				this_->EndTabBatch(this_->m_varstab);
+			} BOOST_SCOPE_EXIT_END
+
+			for(const auto& var : m_dyn.GetVariables())
+				AddVariableTabItem(-1, var.name, var.value);
 		}
 
 		// sync magnetic sites and additional entries
@@ -509,6 +514,12 @@ bool MagDynDlg::ImportStructure(const QString& filename)
 		// spin structure
 		if(auto nuclei = sfact.get_child_optional("nuclei"); nuclei)
 		{
+			BeginTabBatch(m_sitestab);
+			BOOST_SCOPE_EXIT(this_)
+			{
+				this_->EndTabBatch(this_->m_sitestab);
+			} BOOST_SCOPE_EXIT_END
+
 			for(const auto &nucl : *nuclei)
 			{
 				std::string name = nucl.second.get<std::string>("name", "n/a");
@@ -935,10 +946,9 @@ bool MagDynDlg::ExportSQE(const QString& filename)
 	const t_real inc_l = dir[2] / t_real(num_pts_l);
 	const t_vec_real Qstep = tl2::create<t_vec_real>({inc_h, inc_k, inc_l});
 
-	// tread pool
-	unsigned int num_threads = std::max<unsigned int>(
-		1, std::thread::hardware_concurrency()/2);
-	asio::thread_pool pool{num_threads};
+	// use half of the cores of the process-wide scheduler
+	tl2::Scheduler::Get().SetMaxThreads(std::max<unsigned int>(
+		1, std::thread::hardware_concurrency()/2));
 
 
 	using t_taskret = std::deque<
@@ -998,6 +1008,9 @@ bool MagDynDlg::ExportSQE(const QString& filename)
 	std::deque<t_taskptr> tasks;
 	std::deque<std::future<t_taskret>> futures;
 
+	// declared after the data used by the tasks, so that it is joined before they are destroyed
+	tl2::TaskGroup pool;
+
 	m_stopRequested = false;
 	m_progress->setMinimum(0);
 	m_progress->setMaximum(num_pts_h * num_pts_k /** num_pts_l*/);
@@ -1030,7 +1043,7 @@ bool MagDynDlg::ExportSQE(const QString& filename)
 			t_taskptr taskptr = std::make_shared<t_task>(task);
 			tasks.push_back(taskptr);
 			futures.emplace_back(taskptr->get_future());
-			asio::post(pool, [taskptr, Q, h_idx, k_idx]()
+			pool.Run([taskptr, Q, h_idx, k_idx]()
 			{
 				(*taskptr)(Q[0], Q[1], Q[2], h_idx, k_idx);
 			});
@@ -1073,7 +1086,7 @@ bool MagDynDlg::ExportSQE(const QString& filename)
 		qApp->processEvents();  // process events to see if the stop button was clicked
 		if(m_stopRequested)
 		{
-			pool.stop();
+			pool.Cancel();
 			break;
 		}
 
@@ -1156,7 +1169,7 @@ bool MagDynDlg::ExportSQE(const QString& filename)
 		m_progress->setValue(future_idx+1);
 	}
 
-	pool.join();
+	pool.Join();
 	EnableInput();
 
 	if(format == EXPORT_GRID)  // Takin grid format
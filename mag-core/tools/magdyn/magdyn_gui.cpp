@@ -544,6 +544,12 @@ void MagDynDlg::CreateExchangeTermsPanel()
 	m_termstab->setSizePolicy(QSizePolicy{
 		QSizePolicy::Expanding, QSizePolicy::Expanding});
 
+	// site selection combo boxes are only created while editing
+	SitesDelegate *sites_delegate = new SitesDelegate(
+		[this]() -> QStringList { return this->GetSiteNames(); }, m_termstab);
+	m_termstab->setItemDelegateForColumn(COL_XCH_ATOM1_IDX, sites_delegate);
+	m_termstab->setItemDelegateForColumn(COL_XCH_ATOM2_IDX, sites_delegate);
+
 	QPushButton *btnAdd = new QPushButton(
 		QIcon::fromTheme("list-add"),
 		"Add", m_termspanel);
@@ -55,6 +55,16 @@ void MagDynDlg::SyncSitesFromKernel(boost::optional<const pt::ptree&> extra_info
 	// clear old sites
 	DelTabItem(m_sitestab, -1);
 
+	BeginTabBatch(m_sitestab);
+	BOOST_SCOPE_EXIT(this_)
+	{
+		this_->EndTabBatch(this_->m_sitestab);
+	} BOOST_SCOPE_EXIT_END
+
+	boost::optional<pt::ptree::const_iterator> siteiter;
+	if(extra_infos)
+		siteiter = extra_infos->begin();
+
 	for(t_size site_index = 0; site_index < m_dyn.GetMagneticSitesCount(); ++site_index)
 	{
 		const auto &site = m_dyn.GetMagneticSite(site_index);
@@ -63,13 +73,11 @@ void MagDynDlg::SyncSitesFromKernel(boost::optional<const pt::ptree&> extra_info
 		std::string rgb = "auto";
 
 		// get additional data from exchange term entry
-		if(extra_infos && site_index < extra_infos->size())
+		if(siteiter && *siteiter != extra_infos->end())
 		{
-			auto siteiter = (*extra_infos).begin();
-			std::advance(siteiter, site_index);
-
 			// read colour
-			rgb = siteiter->second.get<std::string>("colour", "auto");
+			rgb = (*siteiter)->second.get<std::string>("colour", "auto");
+			++*siteiter;
 		}
 
 		std::string spin_ortho_x = site.spin_ortho[0];
@@ -92,7 +100,6 @@ void MagDynDlg::SyncSitesFromKernel(boost::optional<const pt::ptree&> extra_info
 	}
 
 	m_ignoreSitesCalc = false;
-	SyncSiteComboBoxes();
 }
 
 
@@ -114,6 +121,16 @@ void MagDynDlg::SyncTermsFromKernel(boost::optional<const pt::ptree&> extra_info
 	// clear old terms
 	DelTabItem(m_termstab, -1);
 
+	BeginTabBatch(m_termstab);
+	BOOST_SCOPE_EXIT(this_)
+	{
+		this_->EndTabBatch(this_->m_termstab);
+	} BOOST_SCOPE_EXIT_END
+
+	boost::optional<pt::ptree::const_iterator> termiter;
+	if(extra_infos)
+		termiter = extra_infos->begin();
+
 	for(t_size term_index = 0; term_index < m_dyn.GetExchangeTermsCount(); ++term_index)
 	{
 		const auto& term = m_dyn.GetExchangeTerm(term_index);
@@ -122,13 +139,11 @@ void MagDynDlg::SyncTermsFromKernel(boost::optional<const pt::ptree&> extra_info
 		std::string rgb = "#0x00bf00";
 
 		// get additional data from exchange term entry
-		if(extra_infos && term_index < extra_infos->size())
+		if(termiter && *termiter != extra_infos->end())
 		{
-			auto termiter = (*extra_infos).begin();
-			std::advance(termiter, term_index);
-
 			// read colour
-			rgb = termiter->second.get<std::string>("colour", "#0x00bf00");
+			rgb = (*termiter)->second.get<std::string>("colour", "#0x00bf00");
+			++*termiter;
 		}
 
 		AddTermTabItem(-1,
@@ -307,108 +322,167 @@ void MagDynDlg::SyncToKernel()
 	m_dyn.CalcMagneticSites();
 
 	// get exchange terms
+	m_synced_terms.clear();
+	m_synced_terms.reserve(m_termstab->rowCount());
 	for(int row=0; row<m_termstab->rowCount(); ++row)
 	{
-		auto *name = m_termstab->item(row, COL_XCH_NAME);
-		auto *dist_x = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
-			m_termstab->item(row, COL_XCH_DIST_X));
-		auto *dist_y = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
-			m_termstab->item(row, COL_XCH_DIST_Y));
-		auto *dist_z = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
-			m_termstab->item(row, COL_XCH_DIST_Z));
-		auto *interaction = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
-			m_termstab->item(row, COL_XCH_INTERACTION));
-		auto *dmi_x = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
-			m_termstab->item(row, COL_XCH_DMI_X));
-		auto *dmi_y = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
-			m_termstab->item(row, COL_XCH_DMI_Y));
-		auto *dmi_z = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
-			m_termstab->item(row, COL_XCH_DMI_Z));
-		QComboBox *site_1 = reinterpret_cast<QComboBox*>(
-			m_termstab->cellWidget(row, COL_XCH_ATOM1_IDX));
-		QComboBox *site_2 = reinterpret_cast<QComboBox*>(
-			m_termstab->cellWidget(row, COL_XCH_ATOM2_IDX));
-
-		tl2::NumericTableWidgetItem<t_real>* gen_xx = nullptr;
-		tl2::NumericTableWidgetItem<t_real>* gen_xy = nullptr;
-		tl2::NumericTableWidgetItem<t_real>* gen_xz = nullptr;
-		tl2::NumericTableWidgetItem<t_real>* gen_yx = nullptr;
-		tl2::NumericTableWidgetItem<t_real>* gen_yy = nullptr;
-		tl2::NumericTableWidgetItem<t_real>* gen_yz = nullptr;
-		tl2::NumericTableWidgetItem<t_real>* gen_zx = nullptr;
-		tl2::NumericTableWidgetItem<t_real>* gen_zy = nullptr;
-		tl2::NumericTableWidgetItem<t_real>* gen_zz = nullptr;
-		if(m_allow_general_J)
-		{
-			gen_xx = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
-				m_termstab->item(row, COL_XCH_GEN_XX));
-			gen_xy = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
-				m_termstab->item(row, COL_XCH_GEN_XY));
-			gen_xz = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
-				m_termstab->item(row, COL_XCH_GEN_XZ));
-			gen_yx = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
-				m_termstab->item(row, COL_XCH_GEN_YX));
-			gen_yy = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
-				m_termstab->item(row, COL_XCH_GEN_YY));
-			gen_yz = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
-				m_termstab->item(row, COL_XCH_GEN_YZ));
-			gen_zx = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
-				m_termstab->item(row, COL_XCH_GEN_ZX));
-			gen_zy = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
-				m_termstab->item(row, COL_XCH_GEN_ZY));
-			gen_zz = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
-				m_termstab->item(row, COL_XCH_GEN_ZZ));
-		}
-
-		if(!name || !site_1 || !site_2 ||
-			!dist_x || !dist_y || !dist_z ||
-			!interaction || !dmi_x || !dmi_y || !dmi_z)
-		{
-			std::cerr << "Invalid entry in couplings table row "
-				<< row << "." << std::endl;
+		t_magdyn::ExchangeTerm term;
+		if(!GetTermFromTable(row, term))
 			continue;
-		}
 
-		t_magdyn::ExchangeTerm term;
-		term.name = name->text().toStdString();
+		// remember the kernel index of the row for SyncTermToKernel()
+		m_synced_terms.emplace(m_termstab->item(row, COL_XCH_NAME),
+			m_dyn.GetExchangeTermsCount());
+		m_dyn.AddExchangeTerm(std::move(term));
+	}
 
-		term.site1 = site_1->currentText().toStdString();
-		term.site2 = site_2->currentText().toStdString();
+	m_dyn.CalcExchangeTerms();
 
-		term.dist[0] = dist_x->text().toStdString();
-		term.dist[1] = dist_y->text().toStdString();
-		term.dist[2] = dist_z->text().toStdString();
+	// ground state energy
+	std::ostringstream ostrGS;
+	ostrGS.precision(g_prec_gui);
+	ostrGS << "E0 = " << m_dyn.CalcGroundStateEnergy() << " meV";
+	m_statusFixed->setText(ostrGS.str().c_str());
+}
 
-		term.J = interaction->text().toStdString();
 
-		if(m_use_dmi->isChecked())
-		{
-			term.dmi[0] = dmi_x->text().toStdString();
-			term.dmi[1] = dmi_y->text().toStdString();
-			term.dmi[2] = dmi_z->text().toStdString();
-		}
 
-		if(m_allow_general_J && m_use_genJ->isChecked())
-		{
-			term.Jgen[0][0] = gen_xx->text().toStdString();
-			term.Jgen[0][1] = gen_xy->text().toStdString();
-			term.Jgen[0][2] = gen_xz->text().toStdString();
-			term.Jgen[1][0] = gen_yx->text().toStdString();
-			term.Jgen[1][1] = gen_yy->text().toStdString();
-			term.Jgen[1][2] = gen_yz->text().toStdString();
-			term.Jgen[2][0] = gen_zx->text().toStdString();
-			term.Jgen[2][1] = gen_zy->text().toStdString();
-			term.Jgen[2][2] = gen_zz->text().toStdString();
-		}
+/**
+ * only transfer the coupling of the given table item to the dynamics calculator,
+ * this requires an unchanged couplings table since the last full synchronisation
+ * @return false if everything has to be synchronised using SyncToKernel()
+ */
+bool MagDynDlg::SyncTermToKernel(const QTableWidgetItem *item)
+{
+	if(m_ignoreCalc || !item)
+		return false;
 
-		m_dyn.AddExchangeTerm(std::move(term));
-	}
+	// were rows added, removed, or skipped?
+	if(m_synced_terms.size() != std::size_t(m_termstab->rowCount()) ||
+		m_synced_terms.size() != m_dyn.GetExchangeTermsCount())
+		return false;
 
-	m_dyn.CalcExchangeTerms();
+	const int row = m_termstab->row(item);
+	if(row < 0)
+		return false;
+
+	auto iter = m_synced_terms.find(m_termstab->item(row, COL_XCH_NAME));
+	if(iter == m_synced_terms.end())
+		return false;
+
+	t_magdyn::ExchangeTerm term;
+	if(!GetTermFromTable(row, term))
+		return false;
+
+	t_magdyn::ExchangeTerm& kernel_term = m_dyn.GetExchangeTerms()[iter->second];
+	kernel_term = std::move(term);
+	m_dyn.CalcExchangeTerm(kernel_term);
 
 	// ground state energy
 	std::ostringstream ostrGS;
 	ostrGS.precision(g_prec_gui);
 	ostrGS << "E0 = " << m_dyn.CalcGroundStateEnergy() << " meV";
 	m_statusFixed->setText(ostrGS.str().c_str());
+
+	return true;
 }
+
+
+
+/**
+ * get an exchange term from a row of the couplings table
+ */
+bool MagDynDlg::GetTermFromTable(int row, t_magdyn::ExchangeTerm& term) const
+{
+	auto *name = m_termstab->item(row, COL_XCH_NAME);
+	auto *dist_x = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
+		m_termstab->item(row, COL_XCH_DIST_X));
+	auto *dist_y = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
+		m_termstab->item(row, COL_XCH_DIST_Y));
+	auto *dist_z = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
+		m_termstab->item(row, COL_XCH_DIST_Z));
+	auto *interaction = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
+		m_termstab->item(row, COL_XCH_INTERACTION));
+	auto *dmi_x = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
+		m_termstab->item(row, COL_XCH_DMI_X));
+	auto *dmi_y = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
+		m_termstab->item(row, COL_XCH_DMI_Y));
+	auto *dmi_z = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
+		m_termstab->item(row, COL_XCH_DMI_Z));
+	auto *site_1 = m_termstab->item(row, COL_XCH_ATOM1_IDX);
+	auto *site_2 = m_termstab->item(row, COL_XCH_ATOM2_IDX);
+
+	tl2::NumericTableWidgetItem<t_real>* gen_xx = nullptr;
+	tl2::NumericTableWidgetItem<t_real>* gen_xy = nullptr;
+	tl2::NumericTableWidgetItem<t_real>* gen_xz = nullptr;
+	tl2::NumericTableWidgetItem<t_real>* gen_yx = nullptr;
+	tl2::NumericTableWidgetItem<t_real>* gen_yy = nullptr;
+	tl2::NumericTableWidgetItem<t_real>* gen_yz = nullptr;
+	tl2::NumericTableWidgetItem<t_real>* gen_zx = nullptr;
+	tl2::NumericTableWidgetItem<t_real>* gen_zy = nullptr;
+	tl2::NumericTableWidgetItem<t_real>* gen_zz = nullptr;
+	if(m_allow_general_J)
+	{
+		gen_xx = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
+			m_termstab->item(row, COL_XCH_GEN_XX));
+		gen_xy = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
+			m_termstab->item(row, COL_XCH_GEN_XY));
+		gen_xz = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
+			m_termstab->item(row, COL_XCH_GEN_XZ));
+		gen_yx = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
+			m_termstab->item(row, COL_XCH_GEN_YX));
+		gen_yy = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
+			m_termstab->item(row, COL_XCH_GEN_YY));
+		gen_yz = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
+			m_termstab->item(row, COL_XCH_GEN_YZ));
+		gen_zx = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
+			m_termstab->item(row, COL_XCH_GEN_ZX));
+		gen_zy = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
+			m_termstab->item(row, COL_XCH_GEN_ZY));
+		gen_zz = static_cast<tl2::NumericTableWidgetItem<t_real>*>(
+			m_termstab->item(row, COL_XCH_GEN_ZZ));
+	}
+
+	if(!name || !site_1 || !site_2 ||
+		!dist_x || !dist_y || !dist_z ||
+		!interaction || !dmi_x || !dmi_y || !dmi_z)
+	{
+		std::cerr << "Invalid entry in couplings table row "
+			<< row << "." << std::endl;
+		return false;
+	}
+
+	term.name = name->text().toStdString();
+
+	term.site1 = site_1->text().toStdString();
+	term.site2 = site_2->text().toStdString();
+
+	term.dist[0] = dist_x->text().toStdString();
+	term.dist[1] = dist_y->text().toStdString();
+	term.dist[2] = dist_z->text().toStdString();
+
+	term.J = interaction->text().toStdString();
+
+	if(m_use_dmi->isChecked())
+	{
+		term.dmi[0] = dmi_x->text().toStdString();
+		term.dmi[1] = dmi_y->text().toStdString();
+		term.dmi[2] = dmi_z->text().toStdString();
+	}
+
+	if(m_allow_general_J && m_use_genJ->isChecked())
+	{
+		term.Jgen[0][0] = gen_xx->text().toStdString();
+		term.Jgen[0][1] = gen_xy->text().toStdString();
+		term.Jgen[0][2] = gen_xz->text().toStdString();
+		term.Jgen[1][0] = gen_yx->text().toStdString();
+		term.Jgen[1][1] = gen_yy->text().toStdString();
+		term.Jgen[1][2] = gen_yz->text().toStdString();
+		term.Jgen[2][0] = gen_zx->text().toStdString();
+		term.Jgen[2][1] = gen_zy->text().toStdString();
+		term.Jgen[2][2] = gen_zz->text().toStdString();
+	}
+
+	return true;
+}
+
@@ -284,6 +284,12 @@ void MagDynDlg::ImportAtoms(const std::vector<TableImportAtom>& atompos_vec)
 
 	DelTabItem(m_sitestab, -1);  // remove original sites
 
+	BeginTabBatch(m_sitestab);
+	BOOST_SCOPE_EXIT(this_)
+	{
+		this_->EndTabBatch(this_->m_sitestab);
+	} BOOST_SCOPE_EXIT_END
+
 	for(const TableImportAtom& atompos : atompos_vec)
 	{
 		std::string pos_x = "0", pos_y = "0", pos_z = "0";
@@ -323,6 +329,12 @@ void MagDynDlg::ImportCouplings(const std::vector<TableImportCoupling>& coupling
 
 	DelTabItem(m_termstab, -1);  // remove original couplings
 
+	BeginTabBatch(m_termstab);
+	BOOST_SCOPE_EXIT(this_)
+	{
+		this_->EndTabBatch(this_->m_termstab);
+	} BOOST_SCOPE_EXIT_END
+
 	for(const TableImportCoupling& coupling : couplings)
 	{
 		t_size atom_1 = 0, atom_2 = 0;
@@ -80,6 +80,87 @@ static void set_unique_tab_item_name(
 
 
 
+/**
+ * set unique names for all items of a table in a single pass,
+ * this gives the same names as adding the rows one after the other
+ */
+static void set_unique_tab_item_names(
+	QTableWidget *tab, int name_col, const std::string& prefix)
+{
+	std::unordered_set<std::string> used_names;
+	used_names.reserve(tab->rowCount());
+
+	for(int row = 0; row < tab->rowCount(); ++row)
+	{
+		auto *item = tab->item(row, name_col);
+		if(!item)
+			continue;
+
+		std::string new_name_base = item->text().toStdString();
+		std::string new_name = new_name_base;
+		if(tl2::trimmed(new_name) == "")
+			new_name_base = new_name = prefix;
+
+		// possibly add a suffix to make the name unique
+		std::size_t ctr = 1;
+		while(used_names.find(new_name) != used_names.end())
+			new_name = new_name_base + "_" + tl2::var_to_str(ctr++);
+
+		if(new_name != item->text().toStdString())
+			item->setText(new_name.c_str());
+		used_names.emplace(std::move(new_name));
+	}
+}
+
+
+
+/**
+ * prepare a table for the insertion of many rows:
+ * the per-row renaming, sorting, scrolling and recalculation is skipped
+ * until EndTabBatch() is called
+ */
+void MagDynDlg::BeginTabBatch(QTableWidget *pTab)
+{
+	m_batchTabUpdates = true;
+	if(pTab == m_termstab)
+		m_synced_terms.clear();
+
+	pTab->setUpdatesEnabled(false);
+	pTab->setSortingEnabled(false);
+}
+
+
+
+/**
+ * finish the insertion of many rows
+ */
+void MagDynDlg::EndTabBatch(QTableWidget *pTab)
+{
+	m_batchTabUpdates = false;
+
+	const bool blocked = pTab->blockSignals(true);
+	BOOST_SCOPE_EXIT(pTab, blocked)
+	{
+		pTab->blockSignals(blocked);
+	} BOOST_SCOPE_EXIT_END
+
+	if(pTab == m_sitestab)
+		set_unique_tab_item_names(pTab, COL_SITE_NAME, "site");
+	else if(pTab == m_termstab)
+		set_unique_tab_item_names(pTab, COL_XCH_NAME, "coupling");
+	else if(pTab == m_varstab)
+		set_unique_tab_item_names(pTab, COL_VARS_NAME, "var");
+
+	pTab->setSortingEnabled(true);
+	UpdateVerticalHeader(pTab);
+	pTab->setUpdatesEnabled(true);
+
+	if(pTab == m_sitestab || pTab == m_termstab)
+		SyncSiteNames();
+}
+
+
+
 /**
  * add an atom site
  */
@@ -92,11 +173,12 @@ void MagDynDlg::AddSiteTabItem(
 	const std::string& rgb)
 {
 	bool bclone = false;
+	const bool batch = m_batchTabUpdates;
 	m_sitestab->blockSignals(true);
-	BOOST_SCOPE_EXIT(this_)
+	BOOST_SCOPE_EXIT(this_, batch)
 	{
 		this_->m_sitestab->blockSignals(false);
-		if(this_->m_autocalc->isChecked())
+		if(!batch && this_->m_autocalc->isChecked())
 			this_->CalcAll();
 	} BOOST_SCOPE_EXIT_END
 
@@ -153,6 +235,10 @@ void MagDynDlg::AddSiteTabItem(
 		}
 	}
 
+	// names, header and couplings are updated once in EndTabBatch()
+	if(batch)
+		return;
+
 	set_unique_tab_item_name(m_sitestab, m_sitestab->item(row, COL_SITE_NAME),
 		COL_SITE_NAME, "site");
 
@@ -161,134 +247,105 @@ void MagDynDlg::AddSiteTabItem(
 	m_sitestab->setSortingEnabled(true);
 
 	UpdateVerticalHeader(m_sitestab);
-	SyncSiteComboBoxes();
+	SyncSiteNames();
 }
 
 
 
 /**
- * update the contents of all site selection combo boxes to match the sites table
+ * get the unique site names in the order of the sites table
  */
-void MagDynDlg::SyncSiteComboBoxes()
+QStringList MagDynDlg::GetSiteNames() const
 {
-	if(m_ignoreSitesCalc)
-		return;
+	QStringList names;
+	names.reserve(m_sitestab->rowCount());
 
-	// iterate couplings and update their site selection combo boxes
-	for(int row=0; row<m_termstab->rowCount(); ++row)
+	std::unordered_set<std::string> seen_names;
+	for(int row = 0; row < m_sitestab->rowCount(); ++row)
 	{
-		SitesComboBox *site_1 = reinterpret_cast<SitesComboBox*>(
-			m_termstab->cellWidget(row, COL_XCH_ATOM1_IDX));
-		SitesComboBox *site_2 = reinterpret_cast<SitesComboBox*>(
-			m_termstab->cellWidget(row, COL_XCH_ATOM2_IDX));
+		auto *name = m_sitestab->item(row, COL_SITE_NAME);
+		if(!name || !seen_names.insert(name->text().toStdString()).second)
+			continue;
 
-		SyncSiteComboBox(site_1, site_1->currentText().toStdString());
-		SyncSiteComboBox(site_2, site_2->currentText().toStdString());
+		names.push_back(name->text());
 	}
+
+	return names;
 }
 
 
 
 /**
- * update the contents of a site selection combo box to match the sites table
+ * update the site names and indices of all couplings to match the sites table
  */
-void MagDynDlg::SyncSiteComboBox(SitesComboBox* combo, const std::string& selected_site)
+void MagDynDlg::SyncSiteNames()
 {
-	BOOST_SCOPE_EXIT(combo)
-	{
-		combo->blockSignals(false);
-	} BOOST_SCOPE_EXIT_END
-	combo->blockSignals(true);
+	if(m_ignoreSitesCalc)
+		return;
 
-	combo->clear();
+	const QStringList site_names = GetSiteNames();
 
-	int selected_idx = -1;
-	int selected_idx_alt = -1;  // alternate selection in case of renamed site
+	// hash the site indices by their current and their previous names
+	std::unordered_map<std::string, int> site_indices, old_site_indices;
+	site_indices.reserve(site_names.size());
+	for(int idx = 0; idx < int(site_names.size()); ++idx)
+		site_indices.emplace(site_names[idx].toStdString(), idx);
 
-	// iterate sites to get their names
-	std::unordered_set<std::string> seen_names;
 	for(int row = 0; row < m_sitestab->rowCount(); ++row)
 	{
 		auto *name = m_sitestab->item(row, COL_SITE_NAME);
 		if(!name)
 			continue;
 
-		std::string site_name = name->text().toStdString();
-		if(seen_names.find(site_name) != seen_names.end())
+		// alternate name in case of a renamed site
+		std::string old_name = name->data(Qt::UserRole).toString().toStdString();
+		if(old_name == "")
 			continue;
-		seen_names.insert(site_name);
 
-		// add the item
-		combo->addItem(name->text());
-
-		// check if this item has to be selected
-		if(name->text().toStdString() == selected_site)
-			selected_idx = row;
-
-		// check if the selection corresponds to the site's previous name
-		std::string old_name = name->data(Qt::UserRole).toString().toStdString();
-		if(old_name != "" && old_name == selected_site)
-			selected_idx_alt = row;
+		if(auto iter = site_indices.find(name->text().toStdString()); iter != site_indices.end())
+			old_site_indices.emplace(old_name, iter->second);
 	}
 
-	combo->addItem("<invalid>");
-
-	if(selected_idx >= 0)
-	{
-		// select the site
-		combo->setCurrentIndex(selected_idx);
-	}
-	else if(selected_idx_alt >= 0)
-	{
-		// use alternate selection in case of a renamed site
-		combo->setCurrentIndex(selected_idx_alt);
-	}
-	else
+	// changing items would otherwise re-sort the table
+	const bool sorting = m_termstab->isSortingEnabled();
+	const bool blocked = m_termstab->blockSignals(true);
+	m_termstab->setSortingEnabled(false);
+	BOOST_SCOPE_EXIT(this_, sorting, blocked)
 	{
-		// set selection to invalid
-		combo->setCurrentIndex(combo->count() - 1);
-	}
-}
-
-
+		this_->m_termstab->setSortingEnabled(sorting);
+		this_->m_termstab->blockSignals(blocked);
+	} BOOST_SCOPE_EXIT_END
 
-/**
- * create a combo box with the site names
- */
-SitesComboBox* MagDynDlg::CreateSitesComboBox(const std::string& selected_site)
-{
-	/**
-	 * filter out wheel events (used for the combo boxes in the table)
-	 */
-	struct WheelEventFilter : public QObject
+	// iterate couplings and update their sites
+	for(int row = 0; row < m_termstab->rowCount(); ++row)
 	{
-		WheelEventFilter(QObject* comp) : m_comp{comp} {}
-		WheelEventFilter(const WheelEventFilter&) = delete;
-		WheelEventFilter& operator=(const WheelEventFilter&) = delete;
-
-		bool eventFilter(QObject *comp, QEvent *evt) override
+		for(int col : { COL_XCH_ATOM1_IDX, COL_XCH_ATOM2_IDX })
 		{
-			// ignore wheel events on the given component
-			return comp == m_comp && evt->type() == QEvent::Wheel;
-		}
-
-		QObject* m_comp = nullptr;
-	};
-
+			QTableWidgetItem *site = m_termstab->item(row, col);
+			if(!site)
+				continue;
 
-	SitesComboBox* combo = new SitesComboBox();
-	combo->setParent(m_termstab);
-	combo->installEventFilter(new WheelEventFilter(combo));
-	SyncSiteComboBox(combo, selected_site);
-
-	// connections
-	connect(combo, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
-		[this]()
-		{
-			TermsTableItemChanged(nullptr);
-		});
+			int site_idx = int(site_names.size());  // invalid sites are sorted last
+			if(auto iter = site_indices.find(site->text().toStdString());
+				iter != site_indices.end())
+			{
+				site_idx = iter->second;
+			}
+			else if(auto iter_old = old_site_indices.find(site->text().toStdString());
+				iter_old != old_site_indices.end())
+			{
+				// use the new name in case of a renamed site
+				site_idx = iter_old->second;
+				site->setText(site_names[site_idx]);
+			}
+			else
+			{
+				site->setText("<invalid>");
+			}
 
-	return combo;
+			site->setData(Qt::UserRole, site_idx);
+		}
+	}
 }
 
 
@@ -308,11 +365,13 @@ void MagDynDlg::AddTermTabItem(
 	const std::string& rgb)
 {
 	bool bclone = false;
+	const bool batch = m_batchTabUpdates;
 	m_termstab->blockSignals(true);
-	BOOST_SCOPE_EXIT(this_)
+	m_synced_terms.clear();
+	BOOST_SCOPE_EXIT(this_, batch)
 	{
 		this_->m_termstab->blockSignals(false);
-		if(this_->m_autocalc->isChecked())
+		if(!batch && this_->m_autocalc->isChecked())
 			this_->CalcAll();
 	} BOOST_SCOPE_EXIT_END
 
@@ -337,17 +396,6 @@ void MagDynDlg::AddTermTabItem(
 		{
 			m_termstab->setItem(row, thecol,
 				m_termstab->item(m_terms_cursor_row, thecol)->clone());
-
-			// also clone site selection combo boxes
-			if(thecol == COL_XCH_ATOM1_IDX || thecol == COL_XCH_ATOM2_IDX)
-			{
-				SitesComboBox *combo_old = reinterpret_cast<SitesComboBox*>(
-					m_termstab->cellWidget(m_terms_cursor_row, thecol));
-				SitesComboBox *combo = CreateSitesComboBox(
-					combo_old->currentText().toStdString());
-				m_termstab->setCellWidget(row, thecol, combo);
-				m_termstab->setItem(row, thecol, combo);
-			}
 		}
 	}
 	else
@@ -355,12 +403,11 @@ void MagDynDlg::AddTermTabItem(
 		m_termstab->setItem(row, COL_XCH_NAME,
 			new QTableWidgetItem(name.c_str()));
 
-		SitesComboBox* combo1 = CreateSitesComboBox(atom_1);
-		SitesComboBox* combo2 = CreateSitesComboBox(atom_2);
-		m_termstab->setCellWidget(row, COL_XCH_ATOM1_IDX, combo1);
-		m_termstab->setCellWidget(row, COL_XCH_ATOM2_IDX, combo2);
-		m_termstab->setItem(row, COL_XCH_ATOM1_IDX, combo1);
-		m_termstab->setItem(row, COL_XCH_ATOM2_IDX, combo2);
+		// the sites are edited using a SitesDelegate
+		m_termstab->setItem(row, COL_XCH_ATOM1_IDX,
+			new SiteNameTableWidgetItem(atom_1.c_str()));
+		m_termstab->setItem(row, COL_XCH_ATOM2_IDX,
+			new SiteNameTableWidgetItem(atom_2.c_str()));
 
 		m_termstab->setItem(row, COL_XCH_DIST_X,
 			new tl2::NumericTableWidgetItem<t_real>(dist_x));
@@ -400,8 +447,13 @@ void MagDynDlg::AddTermTabItem(
 		}
 	}
 
+	// names, header and site indices are updated once in EndTabBatch()
+	if(batch)
+		return;
+
 	set_unique_tab_item_name(m_termstab, m_termstab->item(row, COL_XCH_NAME),
 		COL_XCH_NAME, "coupling");
+	SyncSiteNames();
 
 	m_termstab->scrollToItem(m_termstab->item(row, 0));
 	m_termstab->setCurrentCell(row, 0);
@@ -418,11 +470,12 @@ void MagDynDlg::AddTermTabItem(
 void MagDynDlg::AddVariableTabItem(int row, const std::string& name, const t_cplx& value)
 {
 	bool bclone = false;
+	const bool batch = m_batchTabUpdates;
 	m_varstab->blockSignals(true);
-	BOOST_SCOPE_EXIT(this_)
+	BOOST_SCOPE_EXIT(this_, batch)
 	{
 		this_->m_varstab->blockSignals(false);
-		if(this_->m_autocalc->isChecked())
+		if(!batch && this_->m_autocalc->isChecked())
 			this_->CalcAll();
 	} BOOST_SCOPE_EXIT_END
 
@@ -459,6 +512,10 @@ void MagDynDlg::AddVariableTabItem(int row, const std::string& name, const t_cpl
 			new tl2::NumericTableWidgetItem<t_real>(value.imag()));
 	}
 
+	// names and header are updated once in EndTabBatch()
+	if(batch)
+		return;
+
 	set_unique_tab_item_name(m_varstab, m_varstab->item(row, COL_VARS_NAME),
 		COL_VARS_NAME, "var");
 
@@ -594,6 +651,8 @@ void MagDynDlg::DelTabItem(QTableWidget *pTab, int begin, int end)
 
 	if(needs_recalc)
 		pTab->blockSignals(true);
+	if(pTab == m_termstab)
+		m_synced_terms.clear();
 	BOOST_SCOPE_EXIT(this_, pTab, needs_recalc)
 	{
 		if(needs_recalc)
@@ -627,7 +686,7 @@ void MagDynDlg::DelTabItem(QTableWidget *pTab, int begin, int end)
 
 	UpdateVerticalHeader(pTab);
 	if(pTab == m_sitestab)
-		SyncSiteComboBoxes();
+		SyncSiteNames();
 }
 
 
@@ -640,6 +699,8 @@ void MagDynDlg::MoveTabItemUp(QTableWidget *pTab)
 
 	if(needs_recalc)
 		pTab->blockSignals(true);
+	if(pTab == m_termstab)
+		m_synced_terms.clear();
 	pTab->setSortingEnabled(false);
 	BOOST_SCOPE_EXIT(this_, pTab, needs_recalc)
 	{
@@ -665,17 +726,6 @@ void MagDynDlg::MoveTabItemUp(QTableWidget *pTab)
 		for(int col=0; col<pTab->columnCount(); ++col)
 		{
 			pTab->setItem(row-1, col, pTab->item(row+1, col)->clone());
-
-			// also clone site selection combo boxes
-			if(pTab == m_termstab && (col == COL_XCH_ATOM1_IDX || col == COL_XCH_ATOM2_IDX))
-			{
-				SitesComboBox *combo_old = reinterpret_cast<SitesComboBox*>(
-					pTab->cellWidget(row+1, col));
-				SitesComboBox *combo = CreateSitesComboBox(
-					combo_old->currentText().toStdString());
-				pTab->setCellWidget(row-1, col, combo);
-				pTab->setItem(row-1, col, combo);
-			}
 		}
 		pTab->removeRow(row+1);
 	}
@@ -703,6 +753,8 @@ void MagDynDlg::MoveTabItemDown(QTableWidget *pTab)
 
 	if(needs_recalc)
 		pTab->blockSignals(true);
+	if(pTab == m_termstab)
+		m_synced_terms.clear();
 	pTab->setSortingEnabled(false);
 	BOOST_SCOPE_EXIT(this_, pTab, needs_recalc)
 	{
@@ -728,17 +780,6 @@ void MagDynDlg::MoveTabItemDown(QTableWidget *pTab)
 		for(int col=0; col<pTab->columnCount(); ++col)
 		{
 			pTab->setItem(row+2, col, pTab->item(row, col)->clone());
-
-			// also clone site selection combo boxes
-			if(pTab == m_termstab && (col == COL_XCH_ATOM1_IDX || col == COL_XCH_ATOM2_IDX))
-			{
-				SitesComboBox *combo_old = reinterpret_cast<SitesComboBox*>(
-					pTab->cellWidget(row, col));
-				SitesComboBox *combo = CreateSitesComboBox(
-					combo_old->currentText().toStdString());
-				pTab->setCellWidget(row+2, col, combo);
-				pTab->setItem(row+2, col, combo);
-			}
 		}
 		pTab->removeRow(row);
 	}
@@ -826,7 +867,7 @@ void MagDynDlg::SitesTableItemChanged(QTableWidgetItem *item)
 		}
 	}
 
-	SyncSiteComboBoxes();
+	SyncSiteNames();
 
 	// clear alternate name
 	item->setData(Qt::UserRole, QVariant());
@@ -848,10 +889,35 @@ void MagDynDlg::TermsTableItemChanged(QTableWidgetItem *item)
 	} BOOST_SCOPE_EXIT_END
 	m_termstab->blockSignals(true);
 
+	if(!item)
+		return;
+
 	set_unique_tab_item_name(m_termstab, item, COL_XCH_NAME, "coupling");
 
-	if(m_autocalc->isChecked())
+	// set the sorting index of a newly selected site
+	if(int col = m_termstab->column(item);
+		col == COL_XCH_ATOM1_IDX || col == COL_XCH_ATOM2_IDX)
+	{
+		const QStringList site_names = GetSiteNames();
+		int site_idx = int(site_names.indexOf(item->text()));
+		item->setData(Qt::UserRole, site_idx >= 0 ? site_idx : int(site_names.size()));
+	}
+
+	if(!m_autocalc->isChecked())
+		return;
+
+	// only the changed coupling has to be transferred to the kernel
+	// if nothing else has changed since the last full synchronisation
+	if(SyncTermToKernel(item))
+	{
+		StructPlotSync();
+		CalcDispersion();
+		CalcHamiltonian();
+	}
+	else
+	{
 		CalcAll();
+	}
 }
 
 
@@ -29,6 +29,7 @@
 #include "magdyn.h"
 #include "tlibs2/libs/qt/gl.h"
 #include "tlibs2/libs/qt/helper.h"
+#include "libs/loadcif.h"
 
 #include <QtWidgets/QApplication>
 
@@ -78,11 +79,157 @@ static int gui_main(int argc, char** argv, const std::string& model_file,
 
 
 
+/**
+ * options for the sparse solver for large magnetic unit cells
+ */
+struct SparseOptions
+{
+	t_size num_modes = 0;           // number of modes with the lowest energies, 0: use dense solver
+	t_real E_min = 0., E_max = 0.;  // energy window, disabled if E_min >= E_max
+};
+
+
+
+/**
+ * options for the density of states calculation
+ */
+struct DosOptions
+{
+	bool calc_dos = false;          // calculate the density of states instead of the dispersion
+	bool use_symmetry = false;      // reduce the momentum grid using the space group symops
+	t_size num_Q_points = 32;       // momentum grid points along each reciprocal axis
+	t_size num_E_points = 256;      // number of energy bins
+	t_real E_min = 0., E_max = 0.;  // energy range, automatic if E_min >= E_max
+	t_real sigma = -1.;             // gaussian broadening, tetrahedron method if <= 0
+	std::vector<t_real> temperatures{};
+};
+
+
+struct SweepOptions
+{
+	std::vector<t_magdyn::SweepAxis> axes{};  // swept parameters, the last one varies fastest
+	t_size num_Q_points = 0;        // momenta along the path, use the model's value if 0
+	t_size num_grid_points = 0;     // use a momentum grid with this many points per axis instead of the path
+	t_real E_soft = 0.01;           // energy below which a mode is regarded as soft
+	bool keep_energies = false;     // also write the lowest energy for each momentum
+};
+
+
+
+/**
+ * calculates and saves the magnon density of states and the thermodynamics
+ */
+static void calc_dos(const t_magdyn& magdyn, const pt::ptree& magdyn_node,
+	const DosOptions& opts, std::ostream& ostr)
+{
+	// get the symmetry operations of the space group
+	std::vector<t_mat_real> symops;
+	if(opts.use_symmetry)
+	{
+		if(auto sgidx = magdyn_node.get_optional<t_size>("config.spacegroup_index"))
+		{
+			auto spacegroups = get_sgs<t_mat_real>();
+			if(*sgidx < spacegroups.size())
+				symops = std::get<2>(spacegroups[*sgidx]);
+		}
+
+		if(!symops.size())
+			std::cerr << "Warning: No space group defined, not using any symmetries." << std::endl;
+	}
+
+	std::cout << "\nCalculating density of states on a "
+		<< opts.num_Q_points << "x" << opts.num_Q_points << "x" << opts.num_Q_points
+		<< " grid..." << std::endl;
+
+	const t_magdyn::DensityOfStates dos = magdyn.CalcDensityOfStates(
+		opts.num_Q_points, opts.num_Q_points, opts.num_Q_points, symops,
+		opts.E_min, opts.E_max, opts.num_E_points, opts.sigma);
+
+	ostr.precision(g_prec);
+	ostr << "#\n# Magnon density of states, normalised to one magnetic unit cell.\n";
+	if(opts.sigma > 0.)
+		ostr << "# Gaussian broadening: sigma = " << opts.sigma << " meV.\n";
+	else
+		ostr << "# Linear tetrahedron method.\n";
+	ostr << "#\n";
+
+	ostr
+		<< std::setw(g_prec*2) << std::left << "# E (meV)" << " "
+		<< std::setw(g_prec*2) << std::left << "DOS (1/meV)" << " "
+		<< std::setw(g_prec*2) << std::left << "integrated DOS" << "\n";
+
+	for(t_size E_idx = 0; E_idx < dos.E.size(); ++E_idx)
+	{
+		ostr
+			<< std::setw(g_prec*2) << std::left << dos.E[E_idx] << " "
+			<< std::setw(g_prec*2) << std::left << dos.dos[E_idx] << " "
+			<< std::setw(g_prec*2) << std::left << dos.dos_int[E_idx] << "\n";
+	}
+
+	if(!opts.temperatures.size())
+		return;
+
+	ostr << "\n#\n# Thermodynamics of the magnon gas.\n#\n";
+	ostr
+		<< std::setw(g_prec*2) << std::left << "# T (K)" << " "
+		<< std::setw(g_prec*2) << std::left << "magnons" << " "
+		<< std::setw(g_prec*2) << std::left << "magnons/site" << " "
+		<< std::setw(g_prec*2) << std::left << "E (meV)" << " "
+		<< std::setw(g_prec*2) << std::left << "C (k_B)" << "\n";
+
+	for(t_real T : opts.temperatures)
+	{
+		const t_magdyn::Thermodynamics thermo = magdyn.CalcThermodynamics(dos, T);
+
+		ostr
+			<< std::setw(g_prec*2) << std::left << thermo.T << " "
+			<< std::setw(g_prec*2) << std::left << thermo.magnons << " "
+			<< std::setw(g_prec*2) << std::left << thermo.magnons_per_site << " "
+			<< std::setw(g_prec*2) << std::left << thermo.energy << " "
+			<< std::setw(g_prec*2) << std::left << thermo.heat_capacity << "\n";
+	}
+}
+
+
+
+/**
+ * sweeps the model parameters and saves the gap and stability maps
+ */
+static void calc_sweep(const t_magdyn& magdyn, const SweepOptions& opts,
+	const t_vec_real& Qi, const t_vec_real& Qf, t_size num_Qs, std::ostream& ostr)
+{
+	std::vector<t_vec_real> Qs;
+	if(opts.num_grid_points)
+	{
+		Qs = magdyn.CalcMomentumGrid(opts.num_grid_points,
+			opts.num_grid_points, opts.num_grid_points).Qs;
+	}
+	else
+	{
+		Qs = t_magdyn::GetMomentumPath(Qi, Qf, num_Qs);
+	}
+
+	t_size num_pts = 1;
+	for(const t_magdyn::SweepAxis& axis : opts.axes)
+		num_pts *= std::max<t_size>(axis.num_pts, 1);
+
+	std::cout << "\nSweeping " << num_pts << " parameter points at "
+		<< Qs.size() << " momenta..." << std::endl;
+
+	const auto results = magdyn.CalcSweep(opts.axes, Qs,
+		opts.E_soft, opts.keep_energies);
+	magdyn.SaveSweep(ostr, opts.axes, results, Qs);
+}
+
+
+
 /**
  * starts the cli program
  */
 static int cli_main(const std::string& model_file, const std::string& results_file,
-	const t_vec_real& Qi, const t_vec_real& Qf)
+	const t_vec_real& Qi, const t_vec_real& Qf,
+	const SparseOptions& sparse_opts, const DosOptions& dos_opts,
+	const SweepOptions& sweep_opts, bool save_branches)
 {
 	using namespace tl2_ops;
 
@@ -133,6 +280,20 @@ static int cli_main(const std::string& model_file, const std::string& results_fi
 	else
 		std::cout << "\tNot aligning spins to field." << std::endl;
 
+	// use the sparse solver
+	magdyn.SetSparseModes(sparse_opts.num_modes);
+	magdyn.SetSparseEnergyWindow(sparse_opts.E_min, sparse_opts.E_max);
+	if(sparse_opts.num_modes > 0)
+	{
+		std::cout << "\tOnly calculating the " << sparse_opts.num_modes
+			<< " lowest-energy modes." << std::endl;
+	}
+	if(sparse_opts.E_min < sparse_opts.E_max)
+	{
+		std::cout << "\tOnly calculating the modes between E = " << sparse_opts.E_min
+			<< " meV and E = " << sparse_opts.E_max << " meV." << std::endl;
+	}
+
 	// get output stream for results
 	std::ostream* postr = &std::cout;
 	std::unique_ptr<std::ofstream> ofstr;
@@ -153,6 +314,14 @@ static int cli_main(const std::string& model_file, const std::string& results_fi
 	pt::read_xml(ifstr, root_node);
 	const auto &magdyn_node = root_node.get_child("magdyn");
 
+	if(dos_opts.calc_dos)
+	{
+		calc_dos(magdyn, magdyn_node, dos_opts, *postr);
+		if(results_file != "")
+			std::cout << "Wrote results to \"" << results_file << "\"." << std::endl;
+		return 0;
+	}
+
 	t_real h_start =  magdyn_node.get<t_real>("config.h_start", 0.);
 	t_real k_start = magdyn_node.get<t_real>("config.k_start", 0.);
 	t_real l_start = magdyn_node.get<t_real>("config.l_start", 0.);
@@ -177,10 +346,24 @@ static int cli_main(const std::string& model_file, const std::string& results_fi
 	}
 
 
+	if(sweep_opts.axes.size())
+	{
+		calc_sweep(magdyn, sweep_opts,
+			tl2::create<t_vec_real>({ h_start, k_start, l_start }),
+			tl2::create<t_vec_real>({ h_end, k_end, l_end }),
+			sweep_opts.num_Q_points ? sweep_opts.num_Q_points : num_pts,
+			*postr);
+		if(results_file != "")
+			std::cout << "Wrote results to \"" << results_file << "\"." << std::endl;
+		return 0;
+	}
+
+
 	// calculate the dispersion
 	std::cout << "\nCalculating dispersion from Q_i = (" << h_start << ", " << k_start << ", " << l_start << ")"
 		<< " to Q_f = (" << h_end << ", " << k_end << ", " << l_end << ")"
 		<< " in " << num_pts << " steps..." << std::endl;
+	magdyn.SetSaveBranches(save_branches);
 	magdyn.SaveDispersion(*postr,  h_start, k_start, l_start,  h_end, k_end, l_end,  num_pts);
 	if(results_file != "")
 		std::cout << "Wrote results to \"" << results_file << "\"." << std::endl;
@@ -198,7 +381,12 @@ int main(int argc, char** argv)
 
 		bool show_help = false;
 		bool use_cli = false;
+		bool save_branches = false;
 		std::string model_file, results_file;
+		SparseOptions sparse_opts;
+		DosOptions dos_opts;
+		SweepOptions sweep_opts;
+		std::vector<std::string> sweep1, sweep2;
 
 		args::options_description arg_descr("Takin/Magdyn arguments");
 		arg_descr.add_options()
@@ -211,7 +399,25 @@ int main(int argc, char** argv)
 			("li", args::value<t_real>(), "initial l coordinate")
 			("hf", args::value<t_real>(), "final h coordinate")
 			("kf", args::value<t_real>(), "final k coordinate")
-			("lf", args::value<t_real>(), "final l coordinate");
+			("lf", args::value<t_real>(), "final l coordinate")
+			("branches", args::bool_switch(&save_branches), "also write the branch index of each mode along the path")
+			("sparse_modes", args::value(&sparse_opts.num_modes), "only calculate this number of lowest-energy modes using the sparse solver")
+			("sparse_E_min", args::value(&sparse_opts.E_min), "only calculate the modes above this energy using the sparse solver")
+			("sparse_E_max", args::value(&sparse_opts.E_max), "only calculate the modes below this energy using the sparse solver")
+			("dos", args::bool_switch(&dos_opts.calc_dos), "calculate the density of states (in cli mode)")
+			("dos_symm", args::bool_switch(&dos_opts.use_symmetry), "use the space group to reduce the momentum grid")
+			("dos_Q_points", args::value(&dos_opts.num_Q_points), "momentum grid points along each axis")
+			("dos_E_points", args::value(&dos_opts.num_E_points), "number of energy bins")
+			("dos_E_min", args::value(&dos_opts.E_min), "minimum energy")
+			("dos_E_max", args::value(&dos_opts.E_max), "maximum energy")
+			("dos_sigma", args::value(&dos_opts.sigma), "gaussian broadening, use tetrahedron method if not given")
+			("dos_T", args::value(&dos_opts.temperatures)->multitoken(), "temperatures for the thermodynamics")
+			("sweep1", args::value(&sweep1)->multitoken(), "sweep a variable or the field (B, Bx, By, Bz): name start end points (in cli mode)")
+			("sweep2", args::value(&sweep2)->multitoken(), "sweep a second parameter for a 2d map: name start end points")
+			("sweep_Q_points", args::value(&sweep_opts.num_Q_points), "momenta along the path for the sweep")
+			("sweep_grid", args::value(&sweep_opts.num_grid_points), "use a momentum grid with this many points per axis instead of the path")
+			("sweep_soft", args::value(&sweep_opts.E_soft), "energy below which a mode is regarded as soft")
+			("sweep_disp", args::bool_switch(&sweep_opts.keep_energies), "also write the lowest energy for each momentum");
 
 		args::positional_options_description posarg_descr;
 		posarg_descr.add("input", 1);
@@ -260,9 +466,31 @@ int main(int argc, char** argv)
 		}
 
 
+		// get the sweep axes
+		for(const std::vector<std::string>* sweep : { &sweep1, &sweep2 })
+		{
+			if(!sweep->size())
+				continue;
+			if(sweep->size() != 4)
+			{
+				std::cerr << "Error: A sweep needs a name, a start, an end and a number of points."
+					<< std::endl;
+				return -1;
+			}
+
+			t_magdyn::SweepAxis axis;
+			axis.name = (*sweep)[0];
+			axis.start = tl2::str_to_var<t_real>((*sweep)[1]);
+			axis.end = tl2::str_to_var<t_real>((*sweep)[2]);
+			axis.num_pts = tl2::str_to_var<t_size>((*sweep)[3]);
+			sweep_opts.axes.emplace_back(std::move(axis));
+		}
+
+
 		// either start the cli or the gui program
 		if(use_cli)
-			return cli_main(model_file, results_file, Qi, Qf);
+			return cli_main(model_file, results_file, Qi, Qf,
+				sparse_opts, dos_opts, sweep_opts, save_branches);
 		return gui_main(argc, argv, model_file, Qi, Qf);
 	}
 	catch(const std::exception& ex)
@@ -71,6 +71,8 @@ bool MagStructFactDlg::Load(const QString& filename)
 	BOOST_SCOPE_EXIT(this_)
 	{
 		this_->m_ignoreCalc = false;
+		this_->m_nuclei->setSortingEnabled(true);
+		this_->m_propvecs->setSortingEnabled(true);
 	} BOOST_SCOPE_EXIT_END
 	m_ignoreCalc = true;
 
@@ -97,10 +97,14 @@ void MagStructFactDlg::AddTabItem(int row,
 
 	Add3DItem(row);
 
-	m_nuclei->scrollToItem(m_nuclei->item(row, 0));
-	m_nuclei->setCurrentCell(row, 0);
+	// in bulk insertions the table is only sorted once at the end
+	if(!m_ignoreCalc)
+	{
+		m_nuclei->scrollToItem(m_nuclei->item(row, 0));
+		m_nuclei->setCurrentCell(row, 0);
 
-	m_nuclei->setSortingEnabled(/*sorting*/ true);
+		m_nuclei->setSortingEnabled(/*sorting*/ true);
+	}
 
 	m_ignoreChanges = 0;
 	Calc();
@@ -359,10 +363,14 @@ void MagStructFactDlg::AddPropItem(int row,
 
 	//Add3DItem(row);	TODO
 
-	m_propvecs->scrollToItem(m_propvecs->item(row, 0));
-	m_propvecs->setCurrentCell(row, 0);
+	// in bulk insertions the table is only sorted once at the end
+	if(!m_ignoreCalc)
+	{
+		m_propvecs->scrollToItem(m_propvecs->item(row, 0));
+		m_propvecs->setCurrentCell(row, 0);
 
-	m_propvecs->setSortingEnabled(/*sorting*/ true);
+		m_propvecs->setSortingEnabled(/*sorting*/ true);
+	}
 
 	m_ignoreChanges = 0;
 	Calc();
@@ -475,6 +483,7 @@ void MagStructFactDlg::GenerateFromSG()
 	}
 
 	m_ignoreCalc = 0;
+	m_nuclei->setSortingEnabled(true);
 	Calc();
 }
 
@@ -71,6 +71,7 @@ bool StructFactDlg::Load(const QString& filename)
 	BOOST_SCOPE_EXIT(this_)
 	{
 		this_->m_ignoreCalc = false;
+		this_->m_nuclei->setSortingEnabled(true);
 	} BOOST_SCOPE_EXIT_END
 	m_ignoreCalc = true;
 
@@ -259,6 +260,7 @@ void StructFactDlg::ImportTAZ()
 	BOOST_SCOPE_EXIT(this_)
 	{
 		this_->m_ignoreCalc = false;
+		this_->m_nuclei->setSortingEnabled(true);
 	} BOOST_SCOPE_EXIT_END
 	m_ignoreCalc = true;
 
@@ -412,6 +414,7 @@ void StructFactDlg::ImportCIF()
 	BOOST_SCOPE_EXIT(this_)
 	{
 		this_->m_ignoreCalc = false;
+		this_->m_nuclei->setSortingEnabled(true);
 	} BOOST_SCOPE_EXIT_END
 	m_ignoreCalc = true;
 
@@ -83,10 +83,14 @@ void StructFactDlg::AddTabItem(int row,
 
 	Add3DItem(row);
 
-	m_nuclei->scrollToItem(m_nuclei->item(row, 0));
-	m_nuclei->setCurrentCell(row, 0);
+	// in bulk insertions the table is only sorted once at the end
+	if(!m_ignoreCalc)
+	{
+		m_nuclei->scrollToItem(m_nuclei->item(row, 0));
+		m_nuclei->setCurrentCell(row, 0);
 
-	m_nuclei->setSortingEnabled(/*sorting*/ true);
+		m_nuclei->setSortingEnabled(/*sorting*/ true);
+	}
 
 	m_ignoreChanges = 0;
 	Calc();
@@ -382,6 +386,7 @@ void StructFactDlg::GenerateFromSG()
 
 
 	m_ignoreCalc = 0;
+	m_nuclei->setSortingEnabled(true);
 	CalcB(false);
 	Calc();
 }
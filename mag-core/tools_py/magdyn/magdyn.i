@@ -123,12 +123,57 @@
 		double>
 	>;
 
+%template(PathContinuation) tl2_mag::t_PathContinuation<
+	tl2::mat<std::complex<double>>,
+	std::size_t>;
+
 %template(Variable) tl2_mag::t_Variable<
 	std::complex<double>>;
 %template(VecVariable) std::vector<
 	tl2_mag::t_Variable<
 		std::complex<double>>
 	>;
+
+%template(VecSize) std::vector<std::size_t>;
+%template(VecVecD) std::vector<std::vector<double>>;
+%template(ArrSize3) std::array<std::size_t, 3>;
+
+%template(MomentumGrid) tl2_mag::t_MomentumGrid<
+	tl2::vec<double>,
+	std::size_t>;
+
+%template(DensityOfStates) tl2_mag::t_DensityOfStates<
+	double>;
+
+%template(Thermodynamics) tl2_mag::t_Thermodynamics<
+	double>;
+
+%template(SweepAxis) tl2_mag::t_SweepAxis<
+	double,
+	std::size_t>;
+
+%template(VecSweepAxis) std::vector<
+	tl2_mag::t_SweepAxis<
+		double,
+		std::size_t>
+	>;
+
+%template(SweepPoint) tl2_mag::t_SweepPoint<
+	tl2::vec<double>,
+	double,
+	std::size_t>;
+
+%template(VecSweepPoint) std::vector<
+	tl2_mag::t_SweepPoint<
+		tl2::vec<double>,
+		double,
+		std::size_t>
+	>;
+
+%template(SparseMatrix) tl2_mag::t_SparseMatrix<
+	tl2::vec<std::complex<double>>,
+	std::size_t,
+	std::complex<double>>;
 // ----------------------------------------------------------------------------
 
 
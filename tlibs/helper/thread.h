@@ -31,29 +31,417 @@
 #ifndef __TLIBS_THREAD_H__
 #define __TLIBS_THREAD_H__
 
-
-//#define USE_OWN_THREADPOOL
-
-#ifndef USE_OWN_THREADPOOL
-	#include <boost/asio.hpp>
-#endif
-
 #include <future>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
 #include <list>
+#include <deque>
+#include <vector>
 #include <functional>
 #include <algorithm>
 #include <type_traits>
 #include <memory>
+#include <new>
+
+#ifndef __MINGW32__
+	#include <pthread.h>
+#endif
 
 
 namespace tl {
 
 
+enum class TaskPriority : int
+{
+	LOW = 0,
+	NORMAL = 1,
+	HIGH = 2,
+};
+
+
+/**
+ * process-wide, persistent work-stealing scheduler
+ *
+ * each worker thread has its own task deques (one per priority), it takes its own tasks
+ * from the back and steals from the front of the other workers' deques.
+ * workers waiting for nested tasks help by running queued tasks, so nested
+ * fork/join parallelism neither deadlocks nor creates additional threads.
+ */
+class Scheduler
+{
+	public:
+		using t_task = std::function<void()>;
+		static constexpr int NUM_PRIOS = 3;
+
+
+	protected:
+		struct Queue
+		{
+			std::mutex mtx;
+			std::deque<t_task> tasks[NUM_PRIOS];
+		};
+
+		// one queue per possible worker
+		std::vector<std::unique_ptr<Queue>> m_vecQueues;
+		static constexpr unsigned int MIN_QUEUES = 64;
+
+		// allocated on the heap, a forked child must not join them
+		std::vector<std::thread*> m_vecThreads;
+		std::atomic<unsigned int> m_iNumThreads{0};
+		std::mutex m_mtxThreads;
+
+		std::mutex m_mtxWait;
+		std::condition_variable m_cvWait, m_cvPark;
+		std::atomic<std::size_t> m_iNumQueued[NUM_PRIOS];
+		std::atomic<std::size_t> m_iNextQueue{0};
+
+		// number of active workers
+		std::atomic<unsigned int> m_iMaxThreads{1};
+		bool m_bStop = false;
+
+
+	protected:
+		// index of the worker running in the current thread, -1 for other threads
+		static int& worker_index()
+		{
+			static thread_local int iWorker = -1;
+			return iWorker;
+		}
+
+
+		// number of tasks the current thread runs while waiting inside another task
+		static int& help_depth()
+		{
+			static thread_local int iDepth = 0;
+			return iDepth;
+		}
+
+
+		bool PopTask(std::size_t iQueue, int iPrio, t_task& task, bool bBack)
+		{
+			Queue& queue = *m_vecQueues[iQueue];
+			std::lock_guard<std::mutex> lock(queue.mtx);
+			std::deque<t_task>& tasks = queue.tasks[iPrio];
+			if(tasks.empty())
+				return false;
+
+			if(bBack)
+			{
+				task = std::move(tasks.back());
+				tasks.pop_back();
+			}
+			else
+			{
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+
+			--m_iNumQueued[iPrio];
+			return true;
+		}
+
+
+		/**
+		 * get the next task, high priorities first, own tasks before stolen ones
+		 */
+		bool GetTask(t_task& task, int iMinPrio = 0)
+		{
+			const int iWorker = worker_index();
+			const std::size_t iNumQueues = std::max(1u, unsigned(m_iNumThreads));
+			const std::size_t iStart = (iWorker >= 0 ? std::size_t(iWorker) + 1 : 0);
+
+			for(int iPrio = NUM_PRIOS-1; iPrio >= iMinPrio; --iPrio)
+			{
+				if(m_iNumQueued[iPrio] == 0)
+					continue;
+
+				if(iWorker >= 0 && PopTask(std::size_t(iWorker), iPrio, task, true))
+					return true;
+
+				for(std::size_t i = 0; i < iNumQueues; ++i)
+				{
+					std::size_t iQueue = (iStart + i) % iNumQueues;
+					if(int(iQueue) == iWorker)
+						continue;
+					if(PopTask(iQueue, iPrio, task, false))
+						return true;
+				}
+			}
+
+			return false;
+		}
+
+
+		bool HasTasks() const
+		{
+			for(int iPrio = 0; iPrio < NUM_PRIOS; ++iPrio)
+				if(m_iNumQueued[iPrio] > 0)
+					return true;
+			return false;
+		}
+
+
+		void WorkerProc(unsigned int iWorker)
+		{
+			worker_index() = int(iWorker);
+
+			while(true)
+			{
+				// workers beyond the current limit are parked
+				if(iWorker >= m_iMaxThreads)
+				{
+					std::unique_lock<std::mutex> lock(m_mtxWait);
+					m_cvPark.wait(lock, [this, iWorker]() -> bool
+					{
+						return m_bStop || iWorker < m_iMaxThreads;
+					});
+
+					if(m_bStop)
+						break;
+					continue;
+				}
+
+				t_task task;
+				if(GetTask(task))
+				{
+					task();
+					continue;
+				}
+
+				std::unique_lock<std::mutex> lock(m_mtxWait);
+				m_cvWait.wait(lock, [this, iWorker]() -> bool
+				{
+					return m_bStop || HasTasks() || iWorker >= m_iMaxThreads;
+				});
+
+				if(m_bStop)
+					break;
+			}
+		}
+
+
+		/**
+		 * start the workers up to the current limit
+		 */
+		void StartThreads()
+		{
+			if(m_iNumThreads >= m_iMaxThreads)
+				return;
+
+			std::lock_guard<std::mutex> lock(m_mtxThreads);
+			while(m_iNumThreads < m_iMaxThreads)
+			{
+				m_vecThreads.push_back(new std::thread(&Scheduler::WorkerProc, this, unsigned(m_iNumThreads)));
+				++m_iNumThreads;
+			}
+		}
+
+
+#ifndef __MINGW32__
+		/**
+		 * only the forking thread exists in the child, drop the parent's workers and tasks
+		 */
+		static void ForkChild()
+		{
+			Scheduler& sched = Get();
+
+			// the other threads may have held the locks, so nothing is freed or unlocked
+			new(&sched.m_mtxThreads) std::mutex();
+			new(&sched.m_mtxWait) std::mutex();
+			new(&sched.m_cvWait) std::condition_variable();
+			new(&sched.m_cvPark) std::condition_variable();
+			new(&sched.m_vecThreads) std::vector<std::thread*>();
+			sched.m_iNumThreads = 0;
+
+			for(std::unique_ptr<Queue>& pQueue : sched.m_vecQueues)
+			{
+				pQueue.release();
+				pQueue.reset(new Queue());
+			}
+
+			for(int iPrio = 0; iPrio < NUM_PRIOS; ++iPrio)
+				sched.m_iNumQueued[iPrio] = 0;
+		}
+#endif
+
+
+	public:
+		Scheduler(unsigned int iMaxThreads = std::thread::hardware_concurrency())
+		{
+			unsigned int iNumQueues = std::max(unsigned(MIN_QUEUES), std::thread::hardware_concurrency());
+			for(unsigned int iQueue = 0; iQueue < iNumQueues; ++iQueue)
+				m_vecQueues.emplace_back(new Queue());
+			for(int iPrio = 0; iPrio < NUM_PRIOS; ++iPrio)
+				m_iNumQueued[iPrio] = 0;
+
+			SetMaxThreads(iMaxThreads);
+		}
+
+
+		~Scheduler()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mtxWait);
+				m_bStop = true;
+			}
+			m_cvWait.notify_all();
+			m_cvPark.notify_all();
+
+			// queued tasks are discarded, running ones are finished
+			std::lock_guard<std::mutex> lock(m_mtxThreads);
+			for(std::thread* pThread : m_vecThreads)
+			{
+				if(pThread->joinable())
+					pThread->join();
+				delete pThread;
+			}
+			m_vecThreads.clear();
+		}
+
+
+		Scheduler(const Scheduler&) = delete;
+		const Scheduler& operator=(const Scheduler&) = delete;
+
+
+		/**
+		 * the scheduler of the process
+		 */
+		static Scheduler& Get()
+		{
+			static Scheduler sched;
+
+#ifndef __MINGW32__
+			static const int iForkHandler = pthread_atfork(nullptr, nullptr, &Scheduler::ForkChild);
+			(void)iForkHandler;
+#endif
+
+			return sched;
+		}
+
+
+		/**
+		 * is the current thread one of the workers?
+		 */
+		static bool IsWorker()
+		{
+			return worker_index() >= 0;
+		}
+
+
+		/**
+		 * is the current thread running a task while it waits inside another one?
+		 */
+		static bool IsHelping()
+		{
+			return help_depth() > 0;
+		}
+
+
+		/**
+		 * set the number of worker threads, this is the concurrency limit of the process
+		 */
+		void SetMaxThreads(unsigned int iMaxThreads)
+		{
+			iMaxThreads = std::max(1u, std::min<unsigned int>(iMaxThreads, m_vecQueues.size()));
+			if(iMaxThreads == m_iMaxThreads)
+				return;
+
+			{
+				std::lock_guard<std::mutex> lock(m_mtxWait);
+				m_iMaxThreads = iMaxThreads;
+			}
+			m_cvWait.notify_all();
+			m_cvPark.notify_all();
+
+			// otherwise the workers are started with the first task
+			if(m_iNumThreads)
+				StartThreads();
+		}
+
+
+		unsigned int GetMaxThreads() const
+		{
+			return m_iMaxThreads;
+		}
+
+
+		/**
+		 * enqueue a task, tasks from a worker go to its own queue,
+		 * the task must not throw
+		 */
+		void Push(t_task&& task, TaskPriority prio = TaskPriority::NORMAL)
+		{
+			StartThreads();
+
+			const int iPrio = int(prio);
+			const int iWorker = worker_index();
+			std::size_t iQueue = iWorker >= 0 ? std::size_t(iWorker)
+				: (m_iNextQueue++ % m_iMaxThreads);
+
+			{
+				Queue& queue = *m_vecQueues[iQueue];
+				std::lock_guard<std::mutex> lock(queue.mtx);
+				queue.tasks[iPrio].push_back(std::move(task));
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(m_mtxWait);
+				++m_iNumQueued[iPrio];
+			}
+			m_cvWait.notify_one();
+		}
+
+
+		/**
+		 * run a queued task with at least the given priority in the calling thread
+		 */
+		bool RunTask(TaskPriority minprio = TaskPriority::LOW)
+		{
+			t_task task;
+			if(!GetTask(task, int(minprio)))
+				return false;
+
+			++help_depth();
+			task();
+			--help_depth();
+			return true;
+		}
+
+
+		/**
+		 * run queued tasks in the calling thread until the predicate is fulfilled,
+		 * the predicate is also checked when cv is notified.
+		 * only tasks with at least the given priority are run, so that a waiting
+		 * task doesn't recursively pick up the (less important) outer tasks.
+		 */
+		template<class t_pred>
+		void HelpUntil(t_pred pred, std::mutex& mtx, std::condition_variable& cv,
+			TaskPriority minprio = TaskPriority::LOW)
+		{
+			while(!pred())
+			{
+				if(RunTask(minprio))
+					continue;
+
+				std::unique_lock<std::mutex> lock(mtx);
+				cv.wait_for(lock, std::chrono::milliseconds(1), pred);
+			}
+		}
+};
+
+
+
 /**
- * thread pool
+ * group of tasks running on the process-wide scheduler
  * @see, e.g, (Williams 2012), pp. 273-299
+ *
+ * iNumThreads limits the number of concurrently running tasks of the pool,
+ * for iNumThreads == 0 the tasks are not run, but have to be called using GetTasks().
+ * the start function is called once in each worker thread before it runs the pool's
+ * tasks, but not in a worker which only helps with them while waiting inside another task.
  */
 template<class t_func, class t_startfunc = void(void)>
 class ThreadPool
@@ -65,18 +453,12 @@ class ThreadPool
 
 
 	protected:
-#ifdef USE_OWN_THREADPOOL
-		std::list<std::unique_ptr<std::thread>> m_lstThreads;
-		unsigned int m_tp;  // dummy variable to avoid some ifdefs
-
-		// signal to start jobs
-		std::promise<void> m_signalStartIn;
-		std::future<void> m_signalStartOut = std::move(m_signalStartIn.get_future());
-#else
-		boost::asio::thread_pool m_tp;
-#endif
+		Scheduler& m_sched;
+		unsigned int m_iNumThreads = 0;
+		TaskPriority m_prio = TaskPriority::NORMAL;
 
-		std::mutex m_mtx, m_mtxStart;
+		std::mutex m_mtx;
+		std::condition_variable m_cvDone;
 
 		// list of wrapped function to be executed
 		t_task m_lstTasks;
@@ -84,49 +466,66 @@ class ThreadPool
 		// futures with function return values
 		t_fut m_lstFutures;
 
+		// tasks which have not yet been started
+		std::deque<std::packaged_task<t_ret()>*> m_queue;
+
+		// number of tasks running the queued tasks on the scheduler
+		std::atomic<unsigned int> m_iNumRunners{0};
+		bool m_bCancelled = false;
+
 		// function to run before each thread (not task)
 		t_startfunc *m_pThStartFunc = nullptr;
+		std::vector<std::thread::id> m_vecStartedThreads;
 
 
-	public:
-		ThreadPool(unsigned int iNumThreads = std::thread::hardware_concurrency(),
-			t_startfunc* pThStartFunc = nullptr)
-				: m_tp{iNumThreads}, m_pThStartFunc{pThStartFunc}
+	protected:
+		/**
+		 * run queued tasks of this pool
+		 */
+		void RunTasks()
 		{
-#ifdef USE_OWN_THREADPOOL
-			// start 'iNumThreads' threads
-			for(unsigned int iThread = 0; iThread < iNumThreads; ++iThread)
+			std::unique_lock<std::mutex> lock(m_mtx);
+
+			// a helping worker keeps the state of the task it is waiting in
+			if(m_pThStartFunc && !Scheduler::IsHelping())
 			{
-				m_lstThreads.emplace_back(
-					std::make_unique<std::thread>([this, pThStartFunc, iThread]()
-					{
-						// callback to invoke before starting job thread
-						if(pThStartFunc) (*pThStartFunc)();
-						m_signalStartOut.wait();
+				const std::thread::id idThread = std::this_thread::get_id();
+				if(std::find(m_vecStartedThreads.begin(), m_vecStartedThreads.end(), idThread)
+					== m_vecStartedThreads.end())
+				{
+					m_vecStartedThreads.push_back(idThread);
+
+					lock.unlock();
+					(*m_pThStartFunc)();
+					lock.lock();
+				}
+			}
 
-						while(true)
-						{
-							std::unique_lock<std::mutex> lock0(m_mtx);
+			while(!m_bCancelled && m_queue.size())
+			{
+				std::packaged_task<t_ret()>* pTask = m_queue.front();
+				m_queue.pop_front();
 
-							// is a task available
-							if(m_lstTasks.size() == 0)
-								break;
+				lock.unlock();
+				(*pTask)();
+				lock.lock();
+			}
 
-							// pop task from list
-							std::packaged_task<t_ret()> task =
-								std::move(m_lstTasks.front());
-							m_lstTasks.pop_front();
+			if(--m_iNumRunners == 0)
+				m_cvDone.notify_all();
+		}
 
-							lock0.unlock();
 
-							// run start function and task
-							CallStartFunc();
-							task();
-						}
-					}));
-			}
-#endif
-		}
+	public:
+		/**
+		 * nested pools, i.e. ones created by a task, get a higher priority to finish first
+		 */
+		ThreadPool(unsigned int iNumThreads = Scheduler::Get().GetMaxThreads(),
+			t_startfunc* pThStartFunc = nullptr,
+			TaskPriority prio = Scheduler::IsWorker() ? TaskPriority::HIGH : TaskPriority::NORMAL)
+				: m_sched{Scheduler::Get()}, m_iNumThreads{iNumThreads},
+					m_prio{prio}, m_pThStartFunc{pThStartFunc}
+		{}
 
 
 		virtual ~ThreadPool()
@@ -135,6 +534,10 @@ class ThreadPool
 		}
 
 
+		ThreadPool(const ThreadPool&) = delete;
+		const ThreadPool& operator=(const ThreadPool&) = delete;
+
+
 		/**
 		 * add a function to be executed, giving a packaged task and a future.
 		 */
@@ -143,69 +546,83 @@ class ThreadPool
 			std::packaged_task<t_ret()> task(fkt);
 			std::future<t_ret> fut = task.get_future();
 
-			std::lock_guard<std::mutex> lock(m_mtx);
-			m_lstTasks.emplace_back(std::move(task));
-			m_lstFutures.emplace_back(std::move(fut));
-
-#ifndef USE_OWN_THREADPOOL
-			std::packaged_task<t_ret()>* thetask = &m_lstTasks.back();
-
-			boost::asio::post(m_tp, [this, thetask]() -> void
+			bool bNewRunner = false;
 			{
-				CallStartFunc();
-				(*thetask)();
-			});
-#endif
+				std::lock_guard<std::mutex> lock(m_mtx);
+				m_lstFutures.emplace_back(std::move(fut));
+
+				// the task is dropped, its future reports a broken promise
+				if(m_bCancelled)
+					return;
+
+				m_lstTasks.emplace_back(std::move(task));
+				if(!m_iNumThreads)
+					return;
+
+				m_queue.push_back(&m_lstTasks.back());
+				if(m_iNumRunners < m_iNumThreads)
+				{
+					++m_iNumRunners;
+					bNewRunner = true;
+				}
+			}
+
+			if(bNewRunner)
+				m_sched.Push([this]() { RunTasks(); }, m_prio);
 		}
 
 
 		/**
-		 * start tasks (does nothing when using boost threadpool)
+		 * the tasks already run when they are added, but a pool within
+		 * a task runs them to completion here to not block a worker in future::get()
 		 */
 		void Start()
 		{
-#ifdef USE_OWN_THREADPOOL
-			m_signalStartIn.set_value();
-#endif
+			if(Scheduler::IsWorker())
+				Join();
 		}
 
 
 		/**
-		 * wait for all tasks to be finished
+		 * wait for all tasks to be finished, workers help to run them meanwhile
 		 */
 		void Join()
 		{
-#ifdef USE_OWN_THREADPOOL
-			std::for_each(m_lstThreads.begin(), m_lstThreads.end(),
-				[](std::unique_ptr<std::thread>& pThread)
+			if(Scheduler::IsWorker())
 			{
-				if(pThread)
-					pThread->join();
-			});
-#else
-			m_tp.join();
-#endif
+				m_sched.HelpUntil([this]() -> bool { return m_iNumRunners == 0; }, m_mtx, m_cvDone, m_prio);
+
+				// wait for the last runner to release the lock
+				std::lock_guard<std::mutex> lock(m_mtx);
+			}
+			else
+			{
+				std::unique_lock<std::mutex> lock(m_mtx);
+				m_cvDone.wait(lock, [this]() -> bool { return m_iNumRunners == 0; });
+			}
 		}
 
 
-		t_fut& GetResults() { return m_lstFutures; }
+		/**
+		 * don't start any more tasks, their futures report a broken promise
+		 */
+		void Cancel()
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			m_bCancelled = true;
 
-		t_task& GetTasks() { return m_lstTasks; }
+			// the queued tasks are the last ones in the list, destroying them breaks their promises
+			for(std::size_t iTask = 0; iTask < m_queue.size(); ++iTask)
+				m_lstTasks.pop_back();
+			m_queue.clear();
+		}
 
 
-	protected:
-		void CallStartFunc()
-		{
-			// ensure that this is only called per-thread, not per-task
-			std::lock_guard<std::mutex> lockStart(m_mtxStart);
+		void SetPriority(TaskPriority prio) { m_prio = prio; }
 
-			thread_local bool bThreadAlreadySeen{ false };
-			if(m_pThStartFunc && !bThreadAlreadySeen)
-			{
-				bThreadAlreadySeen = true;
-				(*m_pThStartFunc)();
-			}
-		}
+		t_fut& GetResults() { return m_lstFutures; }
+
+		t_task& GetTasks() { return m_lstTasks; }
 };
 
 
@@ -30,31 +30,707 @@
 #include <iomanip>
 #include <cstring>
 #include <chrono>
+#include <algorithm>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+#include <new>
 #include <boost/date_time/c_time.hpp>
 
+#ifndef __MINGW32__
+	#include <pthread.h>
+#endif
+
 
 namespace tl {
+
 std::recursive_mutex Log::s_mtx;
 bool Log::s_bTermCmds = 1;
+std::atomic<int> Log::s_iMinLevel{0};
+
+// messages are queued and written by the background thread
+static std::atomic<bool> s_bAsync{true};
+
+// the writer thread has been shut down, log synchronously
+static std::atomic<bool> s_bShutdown{false};
+
+// the writer has been created
+static std::atomic<bool> s_bWriter{false};
+
+static std::atomic<unsigned int> s_iNumThreads{0};
+
+// the thread's logging state has already been destroyed
+static thread_local bool t_bThreadEnded = false;
+
+
+
+// ----------------------------------------------------------------------------
+// message arguments
+
+void LogArg::Write(std::ostream& ostr) const
+{
+	switch(ty)
+	{
+		case Type::STR: ostr << str; break;
+		case Type::INT: ostr << i; break;
+		case Type::UINT: ostr << u; break;
+		case Type::REAL: ostr << d; break;
+		case Type::LREAL: ostr << ld; break;
+		case Type::CHAR: ostr << c; break;
+		case Type::BOOL: ostr << b; break;
+		case Type::PTR: ostr << p; break;
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// per-thread message queues
+
+struct LogRecord
+{
+	const Log *pLog = nullptr;
+	Log::t_clock::time_point tp{};
+
+	std::vector<LogArg> vecArgs{};
+	std::size_t iNumArgs = 0;
+
+	unsigned long long iSuppressed = 0;
+	unsigned long long iDropped = 0;
+};
+
+
+/**
+ * single-producer, single-consumer ring buffer of messages
+ */
+struct LogRing
+{
+	static constexpr std::size_t SIZE = 1024;
+
+	std::vector<LogRecord> vecRecs;
+
+	std::thread::id idThread;
+	unsigned int iThread = 0;
+
+	// the owning thread has ended
+	std::atomic<bool> bOrphaned{false};
+
+	// keep the indices on different cache lines
+	char pad0[64];
+	std::atomic<std::size_t> iHead{0};	// written by the producer
+	char pad1[64];
+	std::atomic<std::size_t> iTail{0};	// written by the consumer
+	char pad2[64];
+
+
+	LogRing(const std::thread::id& id, unsigned int iTh)
+		: vecRecs(SIZE), idThread(id), iThread(iTh)
+	{}
+
+	bool Empty() const
+	{
+		return iTail.load(std::memory_order_acquire) == iHead.load(std::memory_order_seq_cst);
+	}
+
+	/**
+	 * next free record, nullptr if the ring is full
+	 */
+	LogRecord* Acquire()
+	{
+		const std::size_t iHeadCur = iHead.load(std::memory_order_relaxed);
+		if(iHeadCur - iTail.load(std::memory_order_acquire) >= SIZE)
+			return nullptr;
+		return &vecRecs[iHeadCur % SIZE];
+	}
+
+	void Publish()
+	{
+		iHead.store(iHead.load(std::memory_order_relaxed) + 1, std::memory_order_seq_cst);
+	}
+};
+
+constexpr std::size_t LogRing::SIZE;
+
+
+/**
+ * background thread writing the queued messages
+ */
+class LogWriter
+{
+protected:
+	// registered rings, protected by m_mtxRings
+	std::vector<std::shared_ptr<LogRing>> m_vecRings{};
+	std::mutex m_mtxRings{};
+
+	// allocated on the heap, a forked child must not join it
+	std::thread *m_pThread = nullptr;
+	std::atomic<bool> m_bRunning{false};
+	std::atomic<bool> m_bStop{false};
+
+	// wake-up and flush requests, protected by m_mtx
+	std::mutex m_mtx{};
+	std::condition_variable m_cvWake{}, m_cvFlushed{};
+	std::atomic<bool> m_bSleeping{false};
+	std::atomic<unsigned long long> m_iFlushReq{0};
+	unsigned long long m_iFlushDone = 0;
+
+protected:
+	void Run();
+	bool Pending();
+
+#ifndef __MINGW32__
+	static void ForkPrepare();
+	static void ForkParent();
+	static void ForkChild();
+#endif
+
+public:
+	LogWriter();
+	~LogWriter();
+
+	static LogWriter& Get()
+	{
+		static LogWriter writer;
+		return writer;
+	}
+
+	bool Start();
+	void AddRing(const std::shared_ptr<LogRing>& pRing);
+	void Wake();
+	void Flush();
+};
+
+
+/**
+ * per-thread logging state
+ */
+struct LogThread
+{
+	// rate limiting of repeated messages
+	struct RateState
+	{
+		Log::t_clock::time_point tpWindow{};
+		unsigned int iCount = 0;
+		unsigned long long iSuppressed = 0;
+
+		// first suppressed message, reported when the thread ends
+		const Log *pLog = nullptr;
+		std::vector<LogArg> vecArgs{};
+		std::size_t iNumArgs = 0;
+	};
+
+	std::thread::id idThread;
+	unsigned int iThread = 0;
+
+	std::shared_ptr<LogRing> pRing{};
+	unsigned long long iDropped = 0;
+
+	// nesting depth, e.g. if an argument's operator<< logs itself
+	unsigned int iDepth = 0;
+	LogRecord *pRec = nullptr;
+	std::vector<std::vector<LogArg>> vecSyncArgs{};
+
+	std::unordered_map<std::size_t, RateState> mapRate{};
+
+	// stream to format arguments which are not copied
+	std::ostringstream ostrFmt{};
+	bool bFmtInUse = false;
+
+
+	LogThread() : idThread(std::this_thread::get_id()), iThread(++s_iNumThreads)
+	{}
+
+	~LogThread();
+
+	static LogThread& Get()
+	{
+		static thread_local LogThread th;
+		return th;
+	}
+
+	bool IsAsync() const
+	{
+		return s_bAsync.load(std::memory_order_relaxed)
+			&& !s_bShutdown.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * get a free record in the thread's ring buffer
+	 */
+	LogRecord* Acquire(bool bWait)
+	{
+		if(!pRing)
+		{
+			LogWriter& writer = LogWriter::Get();
+			if(!writer.Start())
+				return nullptr;
+
+			pRing = std::make_shared<LogRing>(idThread, iThread);
+			writer.AddRing(pRing);
+		}
+		else if(!LogWriter::Get().Start())
+		{
+			return nullptr;
+		}
+
+		LogRecord *pRec = pRing->Acquire();
+		while(!pRec && bWait && IsAsync())
+		{
+			LogWriter::Get().Wake();
+			std::this_thread::yield();
+			pRec = pRing->Acquire();
+		}
+
+		return pRec;
+	}
+
+	void Publish(LogRecord *pRec, const Log *pLog, std::size_t iNumArgs, unsigned long long iSuppressed)
+	{
+		pRec->pLog = pLog;
+		pRec->tp = Log::t_clock::now();
+		pRec->iNumArgs = iNumArgs;
+		pRec->iSuppressed = iSuppressed;
+		pRec->iDropped = iDropped;
+		iDropped = 0;
+
+		pRing->Publish();
+		LogWriter::Get().Wake();
+	}
+
+	void WriteSync(const Log *pLog, const LogArg *pArgs, std::size_t iNumArgs, unsigned long long iSuppressed)
+	{
+		std::lock_guard<decltype(Log::s_mtx)> _lck(Log::s_mtx);
+		pLog->WriteMsg(pArgs, iNumArgs, Log::t_clock::now(), idThread, iThread, iSuppressed, iDropped);
+		iDropped = 0;
+	}
+
+	bool CheckRate(const Log *pLog, const LogArg *pArgs, std::size_t iNumArgs, unsigned long long& iSuppressed);
+};
+
+
+LogThread::~LogThread()
+{
+	// report messages which were suppressed at the end of the thread
+	for(auto& pair : mapRate)
+	{
+		RateState& state = pair.second;
+		if(!state.iSuppressed || !state.pLog)
+			continue;
+
+		LogRecord *pRec = IsAsync() ? Acquire(true) : nullptr;
+		if(pRec)
+		{
+			if(pRec->vecArgs.size() < state.iNumArgs)
+				pRec->vecArgs.resize(state.iNumArgs);
+			std::copy(state.vecArgs.begin(), state.vecArgs.begin() + state.iNumArgs, pRec->vecArgs.begin());
+			Publish(pRec, state.pLog, state.iNumArgs, state.iSuppressed);
+		}
+		else
+		{
+			WriteSync(state.pLog, state.vecArgs.data(), state.iNumArgs, state.iSuppressed);
+		}
+	}
+
+	// report messages which were dropped because the queue was full
+	if(iDropped && IsAsync())
+	{
+		LogRecord *pRec = Acquire(true);
+		if(pRec)
+		{
+			if(pRec->vecArgs.empty())
+				pRec->vecArgs.resize(1);
+			static const char strMsg[] = "Log message queue was full.";
+			pRec->vecArgs[0].Set<decltype(strMsg)>(strMsg);
+			Publish(pRec, &log_warn, 1, 0);
+		}
+	}
+
+	if(pRing)
+		pRing->bOrphaned.store(true, std::memory_order_release);
+
+	t_bThreadEnded = true;
+}
+
+
+/**
+ * allow at most the given number of identical messages per second
+ */
+bool LogThread::CheckRate(const Log *pLog, const LogArg *pArgs, std::size_t iNumArgs,
+	unsigned long long& iSuppressed)
+{
+	// messages are identical if they have the same logger and arguments
+	std::size_t iHash = std::hash<const void*>()(pLog);
+	auto combine = [&iHash](std::size_t iVal)
+	{
+		iHash ^= iVal + 0x9e3779b9 + (iHash << 6) + (iHash >> 2);
+	};
+
+	for(std::size_t iArg = 0; iArg < iNumArgs; ++iArg)
+	{
+		const LogArg& arg = pArgs[iArg];
+		combine(std::size_t(arg.ty));
+
+		switch(arg.ty)
+		{
+			case LogArg::Type::STR: combine(std::hash<std::string>()(arg.str)); break;
+			case LogArg::Type::INT: combine(std::hash<long long>()(arg.i)); break;
+			case LogArg::Type::UINT: combine(std::hash<unsigned long long>()(arg.u)); break;
+			case LogArg::Type::REAL: combine(std::hash<double>()(arg.d)); break;
+			case LogArg::Type::LREAL: combine(std::hash<long double>()(arg.ld)); break;
+			case LogArg::Type::CHAR: combine(std::hash<char>()(arg.c)); break;
+			case LogArg::Type::BOOL: combine(std::hash<bool>()(arg.b)); break;
+			case LogArg::Type::PTR: combine(std::hash<const void*>()(arg.p)); break;
+		}
+	}
+
+	RateState& state = mapRate[iHash];
+	const Log::t_clock::time_point tpNow = Log::t_clock::now();
+	if(tpNow - state.tpWindow >= std::chrono::seconds(1) || tpNow < state.tpWindow)
+	{
+		state.tpWindow = tpNow;
+		state.iCount = 0;
+	}
+
+	if(++state.iCount > pLog->m_iRateLimit)
+	{
+		if(state.iSuppressed++ == 0)
+		{
+			state.pLog = pLog;
+			state.vecArgs.assign(pArgs, pArgs + iNumArgs);
+			state.iNumArgs = iNumArgs;
+		}
+		return false;
+	}
+
+	iSuppressed = state.iSuppressed;
+	state.iSuppressed = 0;
+	return true;
+}
+
+
+
+std::ostringstream* LogArg::AcquireFormatStream()
+{
+	if(t_bThreadEnded)
+		return nullptr;
+
+	// the stream may already be in use if an argument's operator<< logs itself
+	LogThread& th = LogThread::Get();
+	if(th.bFmtInUse)
+		return nullptr;
+
+	th.bFmtInUse = true;
+	th.ostrFmt.str("");
+	th.ostrFmt.clear();
+	return &th.ostrFmt;
+}
+
+
+void LogArg::ReleaseFormatStream()
+{
+	if(!t_bThreadEnded)
+		LogThread::Get().bFmtInUse = false;
+}
+
+
+LogWriter::LogWriter()
+{
+	s_bWriter.store(true);
+
+#ifndef __MINGW32__
+	pthread_atfork(&LogWriter::ForkPrepare, &LogWriter::ForkParent, &LogWriter::ForkChild);
+#endif
+}
+
+
+LogWriter::~LogWriter()
+{
+	// log directly from now on
+	s_bShutdown.store(true);
+
+	if(m_pThread)
+	{
+		m_bStop.store(true);
+		{
+			std::lock_guard<std::mutex> _lck(m_mtx);
+			m_cvWake.notify_one();
+		}
+
+		if(m_pThread->joinable())
+			m_pThread->join();
+		delete m_pThread;
+		m_pThread = nullptr;
+	}
+}
+
+
+/**
+ * start the writer thread if it is not yet running
+ */
+bool LogWriter::Start()
+{
+	if(m_bRunning.load(std::memory_order_acquire))
+		return true;
+
+	std::lock_guard<std::mutex> _lck(m_mtxRings);
+	if(m_bRunning.load(std::memory_order_relaxed))
+		return true;
+
+	try
+	{
+		m_bStop.store(false);
+		m_pThread = new std::thread(&LogWriter::Run, this);
+	}
+	catch(const std::exception&)
+	{
+		// no thread available, write the messages directly
+		s_bAsync.store(false);
+		return false;
+	}
+
+	m_bRunning.store(true, std::memory_order_release);
+	return true;
+}
+
+
+void LogWriter::AddRing(const std::shared_ptr<LogRing>& pRing)
+{
+	std::lock_guard<std::mutex> _lck(m_mtxRings);
+	m_vecRings.push_back(pRing);
+}
+
+
+void LogWriter::Wake()
+{
+	if(m_bSleeping.exchange(false))
+	{
+		std::lock_guard<std::mutex> _lck(m_mtx);
+		m_cvWake.notify_one();
+	}
+}
+
+
+/**
+ * wait until all messages queued before the call are written
+ */
+void LogWriter::Flush()
+{
+	if(!m_bRunning.load(std::memory_order_acquire))
+		return;
+
+	std::unique_lock<std::mutex> lck(m_mtx);
+	const unsigned long long iReq = ++m_iFlushReq;
+	m_bSleeping.store(false);
+	m_cvWake.notify_one();
+
+	m_cvFlushed.wait(lck, [this, iReq]() -> bool
+	{
+		return m_iFlushDone >= iReq || !m_bRunning.load();
+	});
+}
+
+
+bool LogWriter::Pending()
+{
+	if(m_bStop.load() || m_iFlushReq.load() != m_iFlushDone)
+		return true;
+
+	std::lock_guard<std::mutex> _lck(m_mtxRings);
+	for(const std::shared_ptr<LogRing>& pRing : m_vecRings)
+	{
+		if(!pRing->Empty())
+			return true;
+	}
+
+	return false;
+}
+
+
+void LogWriter::Run()
+{
+	std::vector<std::shared_ptr<LogRing>> vecRings;
+	std::vector<std::size_t> vecHeads;
+	std::vector<std::pair<const LogRecord*, const LogRing*>> vecRecs;
+	std::vector<std::ostream*> vecOstrs;
+
+	while(1)
+	{
+		const unsigned long long iFlushReq = m_iFlushReq.load();
+		const bool bStop = m_bStop.load();
+
+		{
+			std::lock_guard<std::mutex> _lck(m_mtxRings);
+			vecRings = m_vecRings;
+		}
+
+		// collect the queued messages of all threads
+		vecHeads.clear();
+		vecRecs.clear();
+		for(const std::shared_ptr<LogRing>& pRing : vecRings)
+		{
+			const std::size_t iTail = pRing->iTail.load(std::memory_order_relaxed);
+			const std::size_t iHead = pRing->iHead.load(std::memory_order_acquire);
+			vecHeads.push_back(iHead);
+
+			for(std::size_t iRec = iTail; iRec != iHead; ++iRec)
+				vecRecs.emplace_back(&pRing->vecRecs[iRec % LogRing::SIZE], pRing.get());
+		}
+
+		if(vecRecs.size())
+		{
+			std::stable_sort(vecRecs.begin(), vecRecs.end(),
+				[](const std::pair<const LogRecord*, const LogRing*>& rec1,
+					const std::pair<const LogRecord*, const LogRing*>& rec2) -> bool
+			{
+				return rec1.first->tp < rec2.first->tp;
+			});
+
+			{
+				std::lock_guard<decltype(Log::s_mtx)> _lck(Log::s_mtx);
+				vecOstrs.clear();
+
+				for(const auto& rec : vecRecs)
+				{
+					const LogRecord *pRec = rec.first;
+					const LogRing *pRing = rec.second;
+					pRec->pLog->WriteMsg(pRec->vecArgs.data(), pRec->iNumArgs, pRec->tp,
+						pRing->idThread, pRing->iThread,
+						pRec->iSuppressed, pRec->iDropped, &vecOstrs);
+				}
+
+				for(std::ostream *pOstr : vecOstrs)
+					pOstr->flush();
+			}
+
+			// release the records
+			for(std::size_t iRing = 0; iRing < vecRings.size(); ++iRing)
+				vecRings[iRing]->iTail.store(vecHeads[iRing], std::memory_order_release);
+		}
+
+		// remove the queues of finished threads
+		{
+			std::lock_guard<std::mutex> _lck(m_mtxRings);
+			m_vecRings.erase(std::remove_if(m_vecRings.begin(), m_vecRings.end(),
+				[](const std::shared_ptr<LogRing>& pRing) -> bool
+			{
+				return pRing->bOrphaned.load(std::memory_order_acquire) && pRing->Empty();
+			}), m_vecRings.end());
+		}
+		vecRings.clear();
+
+		std::unique_lock<std::mutex> lck(m_mtx);
+		if(m_iFlushDone != iFlushReq)
+		{
+			m_iFlushDone = iFlushReq;
+			m_cvFlushed.notify_all();
+		}
+
+		if(bStop && vecRecs.empty())
+			break;
+
+		if(vecRecs.empty())
+		{
+			m_bSleeping.store(true);
+			lck.unlock();
+			const bool bPending = Pending();
+			lck.lock();
+
+			if(!bPending && m_bSleeping.load())
+				m_cvWake.wait_for(lck, std::chrono::milliseconds(50));
+			m_bSleeping.store(false);
+		}
+	}
+
+	std::lock_guard<std::mutex> _lck(m_mtx);
+	m_bRunning.store(false);
+	m_cvFlushed.notify_all();
+}
+
+
+#ifndef __MINGW32__
+void LogWriter::ForkPrepare()
+{
+	if(s_bShutdown.load())
+		return;
+
+	LogWriter& writer = Get();
+	writer.m_mtxRings.lock();
+	writer.m_mtx.lock();
+	Log::s_mtx.lock();
+}
+
+
+void LogWriter::ForkParent()
+{
+	if(s_bShutdown.load())
+		return;
+
+	LogWriter& writer = Get();
+	Log::s_mtx.unlock();
+	writer.m_mtx.unlock();
+	writer.m_mtxRings.unlock();
+}
+
 
+/**
+ * only the forking thread exists in the child, the writer is restarted on demand
+ */
+void LogWriter::ForkChild()
+{
+	if(s_bShutdown.load())
+		return;
+
+	LogWriter& writer = Get();
+
+	// the thread object is left alone, the thread does not exist anymore
+	writer.m_pThread = nullptr;
+	writer.m_bRunning.store(false);
+	writer.m_bStop.store(false);
+	writer.m_bSleeping.store(false);
+	writer.m_iFlushDone = writer.m_iFlushReq.load();
+
+	// the parent writes the pending messages
+	const std::thread::id idThis = std::this_thread::get_id();
+	writer.m_vecRings.erase(std::remove_if(writer.m_vecRings.begin(), writer.m_vecRings.end(),
+		[&idThis](const std::shared_ptr<LogRing>& pRing) -> bool
+	{
+		return pRing->idThread != idThis;
+	}), writer.m_vecRings.end());
+
+	for(std::shared_ptr<LogRing>& pRing : writer.m_vecRings)
+		pRing->iTail.store(pRing->iHead.load());
+
+	// the thread id has changed, so the recursive mutex can't be unlocked,
+	// and the parent's writer thread may have been waiting on the condition variables
+	new(&Log::s_mtx) std::recursive_mutex();
+	new(&writer.m_mtx) std::mutex();
+	new(&writer.m_mtxRings) std::mutex();
+	new(&writer.m_cvWake) std::condition_variable();
+	new(&writer.m_cvFlushed) std::condition_variable();
+}
+#endif
+
+// ----------------------------------------------------------------------------
 
-std::string Log::get_timestamp()
+
+
+std::string Log::get_timestamp(const t_clock::time_point& tp)
 {
 	namespace ch = std::chrono;
 	using ch::system_clock;
 	using boost::date_time::c_time;
 
-	system_clock::time_point now = system_clock::now();
-
 	// milliseconds
-	ch::milliseconds msecs = ch::duration_cast<ch::milliseconds>(now.time_since_epoch());
+	ch::milliseconds msecs = ch::duration_cast<ch::milliseconds>(tp.time_since_epoch());
 	auto secs = ch::duration_cast<ch::seconds>(msecs);
 	msecs -= ch::duration_cast<ch::milliseconds>(secs);
 	std::ostringstream ostrmsecs;
 	ostrmsecs << std::setw(3) << std::right << std::setfill('0') << msecs.count();
 
 	// time and date
-	std::time_t tm = system_clock::to_time_t(now);
+	std::time_t tm = system_clock::to_time_t(tp);
 	std::tm tmNow;
 	c_time::localtime(&tm, &tmNow);
 
@@ -75,14 +751,6 @@ std::string Log::get_timestamp()
 }
 
 
-std::string Log::get_thread_id()
-{
-	std::ostringstream ostr;
-	ostr << std::hex << std::this_thread::get_id();
-	return ostr.str();
-}
-
-
 std::string Log::get_color(LogColor col, bool bBold)
 {
 	if(!s_bTermCmds) return "";
@@ -103,13 +771,20 @@ std::string Log::get_color(LogColor col, bool bBold)
 }
 
 
-void Log::begin_log()
+void Log::WriteMsg(const LogArg* pArgs, std::size_t iNumArgs, const t_clock::time_point& tp,
+	const std::thread::id& idThread, unsigned int iThread,
+	unsigned long long iSuppressed, unsigned long long iDropped,
+	std::vector<std::ostream*>* pvecWritten) const
 {
-	s_mtx.lock();
-
-	const std::vector<t_pairOstr>& vecOstrsTh = GetThreadOstrs();
+	static const std::vector<t_pairOstr> vecNoOstrs;
+	t_mapthreadOstrs::const_iterator iterTh = m_mapOstrsTh.find(idThread);
+	const std::vector<t_pairOstr>& vecOstrsTh = (iterTh == m_mapOstrsTh.end() ? vecNoOstrs : iterTh->second);
 	std::vector<t_pairOstr> vecOstrs = arrayunion({m_vecOstrs, vecOstrsTh});
 
+	std::string strTimeStamp;
+	if(m_bShowDate && vecOstrs.size())
+		strTimeStamp = get_timestamp(tp);
+
 	for(t_pairOstr &pairOstr : vecOstrs)
 	{
 		std::ostream *pOstr = pairOstr.first;
@@ -119,128 +794,181 @@ void Log::begin_log()
 			continue;
 		if(bCol)
 			(*pOstr) << get_color(m_col, 1);
-		if(m_bShowDate)
-		{
-			std::string strTimeStamp = get_timestamp();
-			if(strTimeStamp != "")
-				(*pOstr) << strTimeStamp << ", ";
-		}
+		if(m_bShowDate && strTimeStamp != "")
+			(*pOstr) << strTimeStamp << ", ";
 		if(m_bShowThread)
-		{
-			using t_threadmap = std::unordered_map<std::thread::id, std::string>;
-			static t_threadmap s_threadmap;
+			(*pOstr) << "Thread " << iThread << ", ";
+		(*pOstr) << m_strInfo << ": ";
+		if(bCol)
+			(*pOstr) << get_color(m_col, 0);
 
-			using t_mapKey = typename t_threadmap::value_type::first_type;
+		for(std::size_t iArg = 0; iArg < iNumArgs; ++iArg)
+			pArgs[iArg].Write(*pOstr);
 
-			t_mapKey idThread = std::this_thread::get_id();
-			typename t_threadmap::const_iterator iterMap = s_threadmap.find(idThread);
-			if(iterMap == s_threadmap.end())
-			{
-				++m_iNumThreads;
-				std::ostringstream ostrThread;
-				ostrThread << "Thread " << m_iNumThreads;
+		if(iSuppressed)
+			(*pOstr) << " (" << iSuppressed << " repeated messages suppressed)";
+		if(iDropped)
+			(*pOstr) << " (" << iDropped << " earlier messages dropped)";
 
-				iterMap = s_threadmap.insert({idThread, ostrThread.str()}).first;
-			}
+		if(bCol)
+			(*pOstr) << get_color(LogColor::NONE);
 
-			(*pOstr) << iterMap->second << ", ";
+		if(pvecWritten)
+		{
+			(*pOstr) << '\n';
+			if(std::find(pvecWritten->begin(), pvecWritten->end(), pOstr) == pvecWritten->end())
+				pvecWritten->push_back(pOstr);
+		}
+		else
+		{
+			(*pOstr) << std::endl;
 		}
-		(*pOstr) << m_strInfo << ": ";
-		if(bCol)
-			(*pOstr) << get_color(m_col, 0);
 	}
 }
 
 
-void Log::end_log()
+LogArg* Log::BeginMsg(std::size_t iNumArgs)
 {
-        const std::vector<t_pairOstr>& vecOstrsTh = GetThreadOstrs();
-        std::vector<t_pairOstr> vecOstrs = arrayunion({m_vecOstrs, vecOstrsTh});
+	// the thread's state is gone, e.g. in destructors of global objects
+	if(t_bThreadEnded)
+		return new LogArg[iNumArgs + 1];
 
-	for(t_pairOstr& pairOstr : vecOstrs)
+	LogThread& th = LogThread::Get();
+
+	if(th.iDepth == 0 && th.IsAsync())
 	{
-		std::ostream *pOstr = pairOstr.first;
-		bool bCol = pairOstr.second;
+		// only debug messages may be lost, the others wait for the writer
+		LogRecord *pRec = th.Acquire(m_level >= LogLevel::LVL_INFO);
+		if(pRec)
+		{
+			if(pRec->vecArgs.size() < iNumArgs + 1)
+				pRec->vecArgs.resize(iNumArgs + 1);
 
-		if(!pOstr)
-			continue;
-		if(bCol)
-			(*pOstr) << get_color(LogColor::NONE);
-		(*pOstr) << std::endl;
+			th.pRec = pRec;
+			++th.iDepth;
+			return pRec->vecArgs.data();
+		}
+		else if(th.IsAsync())
+		{
+			++th.iDropped;
+			return nullptr;
+		}
 	}
 
-	s_mtx.unlock();
+	// write synchronously
+	if(th.vecSyncArgs.size() <= th.iDepth)
+		th.vecSyncArgs.resize(th.iDepth + 1);
+	std::vector<LogArg>& vecArgs = th.vecSyncArgs[th.iDepth];
+	if(vecArgs.size() < iNumArgs + 1)
+		vecArgs.resize(iNumArgs + 1);
+
+	++th.iDepth;
+	return vecArgs.data();
 }
 
 
-void Log::inc_depth()
+void Log::EndMsg(LogArg* pArgsEnded, std::size_t iNumArgs)
 {
-	std::lock_guard<decltype(s_mtx)> _lck(s_mtx);
+	if(t_bThreadEnded)
+	{
+		// write the queued messages first to keep the order
+		Flush();
 
-	if(m_iDepth++ == 0)
-		begin_log();
-}
+		{
+			std::lock_guard<decltype(s_mtx)> _lck(s_mtx);
+			WriteMsg(pArgsEnded, iNumArgs, t_clock::now(), std::this_thread::get_id(), 0, 0, 0);
+		}
 
+		delete[] pArgsEnded;
+		return;
+	}
 
-void Log::dec_depth()
-{
-	std::lock_guard<decltype(s_mtx)> _lck(s_mtx);
-	if(--m_iDepth <= 0)
+	LogThread& th = LogThread::Get();
+	if(th.iDepth == 0)
+		return;
+
+	LogRecord *pRec = (th.iDepth == 1 ? th.pRec : nullptr);
+	const LogArg *pArgs = pRec ? pRec->vecArgs.data() : th.vecSyncArgs[th.iDepth-1].data();
+
+	unsigned long long iSuppressed = 0;
+	bool bAccept = !m_iRateLimit || th.CheckRate(this, pArgs, iNumArgs, iSuppressed);
+
+	if(pRec)
+	{
+		th.pRec = nullptr;
+		--th.iDepth;
+
+		if(bAccept)
+		{
+			th.Publish(pRec, this, iNumArgs, iSuppressed);
+			if(m_level >= LogLevel::LVL_CRIT)
+				Flush();
+		}
+	}
+	else
 	{
-		m_iDepth = 0;
-		end_log();
+		if(bAccept)
+			th.WriteSync(this, pArgs, iNumArgs, iSuppressed);
+		--th.iDepth;
 	}
 }
 
 
+void Log::SetAsync(bool bAsync)
+{
+	if(!bAsync)
+		Flush();
+	s_bAsync.store(bAsync);
+}
+
+
+void Log::Flush()
+{
+	if(!s_bWriter.load() || s_bShutdown.load())
+		return;
+	LogWriter::Get().Flush();
+}
+
+
 Log::Log() : m_vecOstrs{{&std::cerr, 1}}
 {}
 
 
-Log::Log(const std::string& strInfo, LogColor col, std::ostream* pOstr)
+Log::Log(const std::string& strInfo, LogColor col, std::ostream* pOstr,
+	LogLevel level, unsigned int iRateLimit)
 	: m_vecOstrs{{pOstr ? pOstr : &std::cerr, 1}},
-	  m_strInfo(strInfo), m_col(col)
+	  m_strInfo(strInfo), m_col(col), m_level(level), m_iRateLimit(iRateLimit)
 {}
 
 
 Log::~Log()
 {
-	std::lock_guard<decltype(s_mtx)> _lck(s_mtx);
-	//std::cerr << "Removing " << m_strInfo << " logger for thread " << std::hex << std::this_thread::get_id() << std::endl;
-	//std::cout << boost::stacktrace::stacktrace{} << std::endl;
+	// the writer may still have queued messages of this logger
+	Flush();
 
+	std::lock_guard<decltype(s_mtx)> _lck(s_mtx);
 	m_mapOstrsTh.clear();
 	m_vecOstrs.clear();
 }
 
 
-std::vector<Log::t_pairOstr>& Log::GetThreadOstrs()
-{
-	t_mapthreadOstrs::iterator iter = m_mapOstrsTh.find(std::this_thread::get_id());
-	if(iter == m_mapOstrsTh.end())
-		iter = m_mapOstrsTh.insert({std::this_thread::get_id(), std::vector<t_pairOstr>()}).first;
-
-	return iter->second;
-}
-
-
 void Log::AddOstr(std::ostream* pOstr, bool bCol, bool bThreadLocal)
 {
+	Flush();
+
 	std::lock_guard<decltype(s_mtx)> _lck(s_mtx);
 	if(bThreadLocal)
-	{
-		std::vector<t_pairOstr>& vecOstrsTh = GetThreadOstrs();
-		vecOstrsTh.push_back({pOstr, bCol});
-	}
+		m_mapOstrsTh[std::this_thread::get_id()].push_back({pOstr, bCol});
 	else
-	{
 		m_vecOstrs.push_back({pOstr, bCol});
-	}
 }
 
 
 void Log::RemoveOstr(std::ostream* pOstr)
 {
+	// write the queued messages before the stream is removed
+	Flush();
+
 	std::lock_guard<decltype(s_mtx)> _lck(s_mtx);
 	using t_iter = std::vector<t_pairOstr>::iterator;
 
@@ -263,9 +991,9 @@ void Log::RemoveOstr(std::ostream* pOstr)
 
 
 // use -fvisibility=hidden to avoid multiple calls to the destructors in loaded external libraries
-Log log_info("INFO", LogColor::WHITE, &std::cerr),
-	log_warn("WARNING", LogColor::YELLOW, &std::cerr),
-	log_err("ERROR", LogColor::RED, &std::cerr),
-	log_crit("CRITICAL", LogColor::PURPLE, &std::cerr),
-	log_debug("DEBUG", LogColor::CYAN, &std::cerr);
+Log log_info("INFO", LogColor::WHITE, &std::cerr, LogLevel::LVL_INFO),
+	log_warn("WARNING", LogColor::YELLOW, &std::cerr, LogLevel::LVL_WARN),
+	log_err("ERROR", LogColor::RED, &std::cerr, LogLevel::LVL_ERR),
+	log_crit("CRITICAL", LogColor::PURPLE, &std::cerr, LogLevel::LVL_CRIT),
+	log_debug("DEBUG", LogColor::CYAN, &std::cerr, LogLevel::LVL_DEBUG);
 }
@@ -33,13 +33,27 @@
 #include <unordered_map>
 #include <iostream>
 #include <sstream>
+#include <string>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <chrono>
 #include <utility>
+#include <memory>
+#include <type_traits>
 
 #include "../helper/array.h"
 
 
+/**
+ * messages below this level are never queued or written:
+ * 0: debug, 1: info, 2: warning, 3: error, 4: critical
+ */
+#ifndef TLIBS_LOG_MIN_LEVEL
+	#define TLIBS_LOG_MIN_LEVEL 0
+#endif
+
+
 namespace tl {
 
 enum class LogColor
@@ -50,12 +64,140 @@ enum class LogColor
 	WHITE, BLACK
 };
 
+
+enum class LogLevel : int
+{
+	// prefixed, DEBUG is defined as a macro in debug builds
+	LVL_DEBUG = 0,
+	LVL_INFO = 1,
+	LVL_WARN = 2,
+	LVL_ERR = 3,
+	LVL_CRIT = 4,
+};
+
+
+// ----------------------------------------------------------------------------
+// message arguments
+
+struct LogArgTags
+{
+	struct str {}; struct cstr {};
+	struct integer {}; struct uinteger {}; struct real {}; struct lreal {};
+	struct chr {}; struct boolean {}; struct ptr {}; struct other {};
+};
+
+
+/**
+ * how a message argument of type T is stored
+ */
+template<class T, class t_dec = typename std::decay<T>::type>
+struct LogArgTag
+{
+	using type =
+		typename std::conditional<std::is_same<t_dec, std::string>::value, LogArgTags::str,
+		typename std::conditional<std::is_same<t_dec, const char*>::value
+			|| std::is_same<t_dec, char*>::value, LogArgTags::cstr,
+		typename std::conditional<std::is_same<t_dec, bool>::value, LogArgTags::boolean,
+		typename std::conditional<std::is_same<t_dec, char>::value, LogArgTags::chr,
+		typename std::conditional<std::is_same<t_dec, signed char>::value
+			|| std::is_same<t_dec, unsigned char>::value, LogArgTags::other,
+		typename std::conditional<std::is_integral<t_dec>::value && std::is_signed<t_dec>::value, LogArgTags::integer,
+		typename std::conditional<std::is_integral<t_dec>::value, LogArgTags::uinteger,
+		typename std::conditional<std::is_same<t_dec, long double>::value, LogArgTags::lreal,
+		typename std::conditional<std::is_floating_point<t_dec>::value, LogArgTags::real,
+		typename std::conditional<std::is_pointer<t_dec>::value, LogArgTags::ptr,
+			LogArgTags::other
+		>::type>::type>::type>::type>::type>::type>::type>::type>::type>::type;
+};
+
+
+/**
+ * argument of a log message,
+ * strings and numbers are copied and only formatted by the writer thread,
+ * other types are formatted directly
+ */
+struct LogArg
+{
+	enum class Type : unsigned char
+	{
+		STR, INT, UINT, REAL, LREAL, CHAR, BOOL, PTR
+	};
+
+	Type ty = Type::STR;
+
+	union
+	{
+		long long i;
+		unsigned long long u;
+		double d;
+		long double ld;
+		char c;
+		bool b;
+		const void *p;
+	};
+
+	std::string str{};
+
+
+	LogArg() : ld(0) {}
+
+	template<class T>
+	void Set(const T& val)
+	{
+		SetVal(val, typename LogArgTag<T>::type());
+	}
+
+	void Write(std::ostream& ostr) const;
+
+protected:
+	void SetVal(const std::string& val, LogArgTags::str) { ty = Type::STR; str = val; }
+	void SetVal(const char* val, LogArgTags::cstr) { ty = Type::STR; if(val) str = val; else str.clear(); }
+	template<class T> void SetVal(const T& val, LogArgTags::integer) { ty = Type::INT; i = val; }
+	template<class T> void SetVal(const T& val, LogArgTags::uinteger) { ty = Type::UINT; u = val; }
+	template<class T> void SetVal(const T& val, LogArgTags::real) { ty = Type::REAL; d = val; }
+	void SetVal(long double val, LogArgTags::lreal) { ty = Type::LREAL; ld = val; }
+	void SetVal(char val, LogArgTags::chr) { ty = Type::CHAR; c = val; }
+	void SetVal(bool val, LogArgTags::boolean) { ty = Type::BOOL; b = val; }
+	template<class T> void SetVal(const T& val, LogArgTags::ptr) { ty = Type::PTR; p = static_cast<const void*>(val); }
+
+	template<class T> void SetVal(const T& val, LogArgTags::other)
+	{
+		// format in the calling thread, the argument may not outlive the call
+		std::ostringstream *pOstr = AcquireFormatStream();
+		std::unique_ptr<std::ostringstream> pOstrOwn{pOstr ? nullptr : new std::ostringstream()};
+		if(!pOstr)
+			pOstr = pOstrOwn.get();
+
+		(*pOstr) << val;
+
+		ty = Type::STR;
+		str = pOstr->str();
+		if(!pOstrOwn)
+			ReleaseFormatStream();
+	}
+
+	// the thread's formatting stream, nullptr if it is in use or not available anymore
+	static std::ostringstream* AcquireFormatStream();
+	static void ReleaseFormatStream();
+};
+
+// ----------------------------------------------------------------------------
+
+
+
+/**
+ * logger, the messages are queued per thread and written by a background thread
+ */
 class Log
 {
-private:
-	int m_iDepth = 0;
+	friend class LogWriter;
+	friend struct LogThread;
+
+public:
+	using t_clock = std::chrono::system_clock;
 
 protected:
+	// protects the output streams
 	static std::recursive_mutex s_mtx;
 
 	// pair of ostream and colour flag
@@ -66,88 +208,84 @@ protected:
 
 	std::string m_strInfo = "";
 	LogColor m_col = LogColor::NONE;
+	LogLevel m_level = LogLevel::LVL_INFO;
 
-	bool m_bEnabled = 1;
+	std::atomic<bool> m_bEnabled{true};
 	bool m_bShowDate = 1;
-
 	bool m_bShowThread = 0;
-	unsigned int m_iNumThreads = 0;
+
+	// maximum number of identical messages per second and thread, 0: no limit
+	unsigned int m_iRateLimit = 0;
 
 	static bool s_bTermCmds;
+	static std::atomic<int> s_iMinLevel;
 
 protected:
-	static std::string get_timestamp();
-	static std::string get_thread_id();
+	static std::string get_timestamp(const t_clock::time_point& tp);
 	static std::string get_color(LogColor col, bool bBold=0);
 
-	std::vector<t_pairOstr>& GetThreadOstrs();
+	// get the arguments of a new message, nullptr if it is dropped
+	LogArg* BeginMsg(std::size_t iNumArgs);
+	void EndMsg(LogArg* pArgs, std::size_t iNumArgs);
+
+	// write a message to the output streams, s_mtx has to be locked
+	void WriteMsg(const LogArg* pArgs, std::size_t iNumArgs, const t_clock::time_point& tp,
+		const std::thread::id& idThread, unsigned int iThread,
+		unsigned long long iSuppressed, unsigned long long iDropped,
+		std::vector<std::ostream*>* pvecWritten = nullptr) const;
 
-	void begin_log();
-	void end_log();
+	static void SetArgs(LogArg*) {}
 
-	void inc_depth();
-	void dec_depth();
+	template<typename t_arg, typename ...t_args>
+	static void SetArgs(LogArg* pArgs, t_arg&& arg, t_args&&... args)
+	{
+		pArgs->Set<typename std::remove_reference<t_arg>::type>(arg);
+		SetArgs(pArgs + 1, std::forward<t_args>(args)...);
+	}
 
 public:
 	Log();
-	Log(const std::string& strInfo, LogColor col, std::ostream* = nullptr);
+	Log(const std::string& strInfo, LogColor col, std::ostream* = nullptr,
+		LogLevel level = LogLevel::LVL_INFO, unsigned int iRateLimit = 0);
 	~Log();
 
 	void AddOstr(std::ostream* pOstr, bool bCol=1, bool bThreadLocal=0);
 	void RemoveOstr(std::ostream* pOstr);
 
-#if __cplusplus > 201402L	// C++1z
 	template<typename ...t_args>
 	void operator()(t_args&&... args)
 	{
-		if(!m_bEnabled) return;
-		begin_log();
-
-		const std::vector<t_pairOstr>& vecOstrsTh = GetThreadOstrs();
-		std::vector<t_pairOstr> vecOstrs = arrayunion({m_vecOstrs, vecOstrsTh});
-
-		for(t_pairOstr& pair : vecOstrs)
-		{
-			if(pair.first)
-				((*pair.first) << ... << std::forward<t_args>(args));
-		}
-		end_log();
-	}
-#else
-	template<typename t_arg>
-	void operator()(t_arg&& arg)
-	{
-		if(!m_bEnabled) return;
-
-		inc_depth();
-		const std::vector<t_pairOstr>& vecOstrsTh = GetThreadOstrs();
-		std::vector<t_pairOstr> vecOstrs = arrayunion({m_vecOstrs, vecOstrsTh});
-
-		for(t_pairOstr& pair : vecOstrs)
-		{
-			if(pair.first)
-				(*pair.first) << std::forward<t_arg>(arg);
-		}
-		dec_depth();
+		// disabled messages cost only this check
+		if(int(m_level) < TLIBS_LOG_MIN_LEVEL || !IsActive())
+			return;
+
+		LogArg *pArgs = BeginMsg(sizeof...(args));
+		if(!pArgs)
+			return;
+
+		SetArgs(pArgs, std::forward<t_args>(args)...);
+		EndMsg(pArgs, sizeof...(args));
 	}
 
-	template<typename t_arg, typename... t_args>
-	void operator()(t_arg&& arg, t_args&&... args)
+	bool IsActive() const
 	{
-		if(!m_bEnabled) return;
-
-		inc_depth();
-		(*this)(std::forward<t_arg>(arg));
-		(*this)(std::forward<t_args>(args)...);
-		dec_depth();
+		return m_bEnabled.load(std::memory_order_relaxed)
+			&& int(m_level) >= s_iMinLevel.load(std::memory_order_relaxed);
 	}
-#endif
 
-	void SetEnabled(bool bEnab) { m_bEnabled = bEnab; }
+	void SetEnabled(bool bEnab) { m_bEnabled.store(bEnab, std::memory_order_relaxed); }
 	void SetShowDate(bool bDate) { m_bShowDate = bDate; }
 	void SetShowThread(bool bThread) { m_bShowThread = bThread; }
+	void SetRateLimit(unsigned int iMsgsPerSec) { m_iRateLimit = iMsgsPerSec; }
 
 	static void SetUseTermCmds(bool bCmds) { s_bTermCmds = bCmds; }
+	static void SetMinLevel(LogLevel level) { s_iMinLevel.store(int(level), std::memory_order_relaxed); }
+
+	// write the messages directly instead of using the background thread
+	static void SetAsync(bool bAsync);
+
+	// wait until all queued messages are written
+	static void Flush();
 };
 
 
@@ -32,8 +32,15 @@
 #include "log/log.h"
 #include "calls_thread.h"
 #include "lang/calls.h"
+#include "helper/thread.h"
 #include <thread>
 #include <future>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <algorithm>
 //#include <wait.h>
 #include <cstdlib>
 
@@ -554,6 +561,417 @@ static Symbol* fkt_nthread(const std::vector<Symbol*>& vecSyms,
 	return pArrThreads;
 }
 
+
+// --------------------------------------------------------------------------------
+// parallel built-ins
+
+/**
+ * calls fkt(iBegin, iEnd) on chunks of [0, iNum) using the pool
+ * and rethrows the first error
+ */
+static void run_chunked(std::size_t iNum,
+	const std::function<void(std::size_t, std::size_t, const std::atomic<bool>&)>& fkt)
+{
+	if(iNum == 0)
+		return;
+
+	tl::Scheduler& sched = tl::Scheduler::Get();
+
+	// nested calls get a higher priority to finish first
+	const tl::TaskPriority prio = tl::Scheduler::IsWorker() ? tl::TaskPriority::HIGH : tl::TaskPriority::NORMAL;
+
+	// a few chunks per thread for load balancing
+	std::size_t iNumChunks = std::min<std::size_t>(iNum, 4*sched.GetMaxThreads());
+	std::size_t iChunkLen = iNum / iNumChunks;
+	std::size_t iChunkRest = iNum % iNumChunks;
+
+	std::atomic<std::size_t> iRemaining{iNumChunks};
+	std::atomic<bool> bAbort{0};
+	std::exception_ptr pErr;
+	std::mutex mtx;
+	std::condition_variable cv;
+
+	std::size_t iBegin = 0;
+	for(std::size_t iChunk=0; iChunk<iNumChunks; ++iChunk)
+	{
+		std::size_t iEnd = iBegin + iChunkLen + (iChunk < iChunkRest ? 1 : 0);
+
+		sched.Push([iBegin, iEnd, &fkt, &iRemaining, &bAbort, &pErr, &mtx, &cv]()
+		{
+			try
+			{
+				if(!bAbort)
+					fkt(iBegin, iEnd, bAbort);
+			}
+			catch(...)
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				if(!pErr)
+					pErr = std::current_exception();
+				bAbort = 1;
+			}
+
+			std::lock_guard<std::mutex> lock(mtx);
+			if(--iRemaining == 0)
+				cv.notify_all();
+		}, prio);
+
+		iBegin = iEnd;
+	}
+
+	// run queued tasks meanwhile, this also prevents deadlocks for nested parallel calls
+	sched.HelpUntil([&iRemaining]() -> bool { return iRemaining == 0; }, mtx, cv, prio);
+
+	if(pErr)
+		std::rethrow_exception(pErr);
+}
+
+
+/**
+ * evaluates a script function without cloning or taking ownership of the arguments
+ */
+static Symbol* call_shared(const NodeFunction* pFunc, ParseInfo& info,
+	const std::vector<Symbol*>& vecArgs)
+{
+	SymbolTable table;
+	SymbolArray arrArgs;
+	arrArgs.SetDontDel(1);
+	arrArgs.GetArr() = vecArgs;	// no index update, the arguments stay members of their arrays
+
+	RuntimeInfo runinfo;
+	table.InsertSymbol(T_STR"<args>", &arrArgs);
+
+	Symbol *pRet = 0;
+	try
+	{
+		pRet = pFunc->eval(info, runinfo, &table);
+	}
+	catch(...)
+	{
+		table.RemoveSymbolNoDelete(T_STR"<ret>");
+		table.RemoveSymbolNoDelete(T_STR"<args>");
+		throw;
+	}
+
+	table.RemoveSymbolNoDelete(T_STR"<ret>");
+	table.RemoveSymbolNoDelete(T_STR"<args>");
+
+	Symbol *pRes = 0;
+	if(clone_if_needed(pRet, pRes))
+		safe_delete(pRet, 0, &info);
+	return pRes;
+}
+
+
+/**
+ * gets a function given by its name in the argument list
+ */
+static NodeFunction* get_parallel_func(const std::vector<Symbol*>& vecSyms, std::size_t iArg,
+	const char* pcCall, ParseInfo& info, RuntimeInfo &runinfo)
+{
+	if(vecSyms[iArg]->GetType() != SYMBOL_STRING)
+	{
+		std::ostringstream ostrErr;
+		ostrErr << linenr(runinfo) << pcCall << ": Function identifier needs to be a string." << std::endl;
+		throw tl::Err(ostrErr.str(), 0);
+	}
+
+	const t_string& strIdent = ((SymbolString*)vecSyms[iArg])->GetVal();
+	NodeFunction* pFunc = info.GetFunction(strIdent);
+	if(pFunc == 0)
+	{
+		std::ostringstream ostrErr;
+		ostrErr << linenr(runinfo) << pcCall << ": Function \"" << strIdent
+			<< "\" not defined." << std::endl;
+		throw tl::Err(ostrErr.str(), 0);
+	}
+
+	return pFunc;
+}
+
+
+/**
+ * read-only view of the arguments of a parallel call:
+ * the data is either an array or a range [0, N), the extra arguments are shared
+ */
+class ParallelArgs
+{
+protected:
+	const SymbolArray *m_pArr = 0;
+	t_int m_iBegin = 0;
+	std::size_t m_iNum = 0;
+
+	std::vector<Symbol*> m_vecExtra;
+	std::vector<Symbol*> m_vecConstified;
+
+public:
+	ParallelArgs(const std::vector<Symbol*>& vecSyms, std::size_t iFirstExtra)
+	{
+		for(std::size_t iSym=iFirstExtra; iSym<vecSyms.size(); ++iSym)
+		{
+			Symbol *pSym = vecSyms[iSym];
+
+			// temporary symbols would be taken over by the called function,
+			// marking them as constant makes the function work on its own copy
+			if(pSym && is_tmp_sym(pSym))
+			{
+				pSym->SetConst(1);
+				m_vecConstified.push_back(pSym);
+			}
+
+			m_vecExtra.push_back(pSym);
+		}
+	}
+
+	~ParallelArgs()
+	{
+		for(Symbol *pSym : m_vecConstified)
+			pSym->SetConst(0);
+	}
+
+	void SetData(const Symbol* pData, const char* pcCall, RuntimeInfo &runinfo)
+	{
+		if(pData && pData->GetType() == SYMBOL_ARRAY)
+		{
+			m_pArr = (const SymbolArray*)pData;
+			m_iNum = m_pArr->GetArr().size();
+		}
+		else if(pData && pData->GetType() == SYMBOL_INT)
+		{
+			m_iBegin = 0;
+			t_int iEnd = pData->GetValInt();
+			m_iNum = iEnd > 0 ? std::size_t(iEnd) : 0;
+		}
+		else
+		{
+			std::ostringstream ostrErr;
+			ostrErr << linenr(runinfo) << pcCall
+				<< ": Data has to be an array or an element count." << std::endl;
+			throw tl::Err(ostrErr.str(), 0);
+		}
+	}
+
+	void SetRange(t_int iBegin, t_int iEnd)
+	{
+		m_pArr = 0;
+		m_iBegin = iBegin;
+		m_iNum = iEnd > iBegin ? std::size_t(iEnd - iBegin) : 0;
+	}
+
+	std::size_t GetNum() const { return m_iNum; }
+
+	/**
+	 * calls the function for element iIdx
+	 */
+	Symbol* Call(const NodeFunction* pFunc, ParseInfo& info, std::size_t iIdx) const
+	{
+		std::vector<Symbol*> vecArgs;
+		vecArgs.reserve(m_vecExtra.size() + 1);
+
+		// array elements are cloned by the function as array members,
+		// the range index is passed as a constant
+		SymbolInt symIdx(m_iBegin + t_int(iIdx));
+		symIdx.SetConst(1);
+
+		vecArgs.push_back(m_pArr ? m_pArr->GetArr()[iIdx] : &symIdx);
+		vecArgs.insert(vecArgs.end(), m_vecExtra.begin(), m_vecExtra.end());
+
+		return call_shared(pFunc, info, vecArgs);
+	}
+};
+
+
+/**
+ * combines two function results, the operands are deleted
+ */
+static Symbol* combine_results(const NodeFunction* pFunc, ParseInfo& info, Symbol* pSym1, Symbol* pSym2)
+{
+	if(!pSym1) return pSym2;
+	if(!pSym2) return pSym1;
+
+	pSym1->SetConst(1);
+	pSym2->SetConst(1);
+
+	Symbol *pRes = 0;
+	try
+	{
+		pRes = call_shared(pFunc, info, { pSym1, pSym2 });
+	}
+	catch(...)
+	{
+		delete pSym1;
+		delete pSym2;
+		throw;
+	}
+
+	delete pSym1;
+	delete pSym2;
+	return pRes;
+}
+
+
+// parallel_map(strFunc, arr or N, ...)
+static Symbol* fkt_parallel_map(const std::vector<Symbol*>& vecSyms,
+	ParseInfo& info, RuntimeInfo &runinfo, SymbolTable* pSymTab)
+{
+	if(vecSyms.size() < 2)
+	{
+		std::ostringstream ostrErr;
+		ostrErr << linenr(runinfo)
+			<< "parallel_map needs at least 2 arguments: func, arr." << std::endl;
+		throw tl::Err(ostrErr.str(), 0);
+	}
+
+	const NodeFunction *pFunc = get_parallel_func(vecSyms, 0, "parallel_map", info, runinfo);
+	ParallelArgs args(vecSyms, 2);
+	args.SetData(vecSyms[1], "parallel_map", runinfo);
+
+	std::vector<Symbol*> vecRes(args.GetNum(), nullptr);
+
+	try
+	{
+		run_chunked(args.GetNum(), [&](std::size_t iBegin, std::size_t iEnd, const std::atomic<bool>& bAbort)
+		{
+			for(std::size_t iIdx=iBegin; iIdx<iEnd && !bAbort; ++iIdx)
+			{
+				vecRes[iIdx] = args.Call(pFunc, info, iIdx);
+				if(!vecRes[iIdx])
+					vecRes[iIdx] = new SymbolInt(0);
+			}
+		});
+	}
+	catch(...)
+	{
+		for(Symbol *pSym : vecRes)
+			delete pSym;
+		throw;
+	}
+
+	SymbolArray *pArrRes = new SymbolArray();
+	pArrRes->GetArr() = std::move(vecRes);
+	pArrRes->UpdateIndices();
+	return pArrRes;
+}
+
+
+// parallel_reduce(strFunc, strCombine, arr or N, ...)
+// the combining function has to be associative
+static Symbol* fkt_parallel_reduce(const std::vector<Symbol*>& vecSyms,
+	ParseInfo& info, RuntimeInfo &runinfo, SymbolTable* pSymTab)
+{
+	if(vecSyms.size() < 3)
+	{
+		std::ostringstream ostrErr;
+		ostrErr << linenr(runinfo)
+			<< "parallel_reduce needs at least 3 arguments: func, combine_func, arr." << std::endl;
+		throw tl::Err(ostrErr.str(), 0);
+	}
+
+	const NodeFunction *pFunc = get_parallel_func(vecSyms, 0, "parallel_reduce", info, runinfo);
+	const NodeFunction *pCombine = get_parallel_func(vecSyms, 1, "parallel_reduce", info, runinfo);
+	ParallelArgs args(vecSyms, 3);
+	args.SetData(vecSyms[2], "parallel_reduce", runinfo);
+
+	// partial results of the chunks, in order
+	std::mutex mtxPartial;
+	std::vector<std::pair<std::size_t, Symbol*>> vecPartial;
+
+	try
+	{
+		run_chunked(args.GetNum(), [&](std::size_t iBegin, std::size_t iEnd, const std::atomic<bool>& bAbort)
+		{
+			Symbol *pAcc = 0;
+			try
+			{
+				for(std::size_t iIdx=iBegin; iIdx<iEnd && !bAbort; ++iIdx)
+				{
+					Symbol *pVal = args.Call(pFunc, info, iIdx);
+
+					// the accumulator is handed over to combine_results
+					Symbol *pPrevAcc = pAcc;
+					pAcc = 0;
+					pAcc = combine_results(pCombine, info, pPrevAcc, pVal);
+				}
+			}
+			catch(...)
+			{
+				delete pAcc;
+				throw;
+			}
+
+			std::lock_guard<std::mutex> lock(mtxPartial);
+			vecPartial.push_back(std::make_pair(iBegin, pAcc));
+		});
+	}
+	catch(...)
+	{
+		for(auto& pair : vecPartial)
+			delete pair.second;
+		throw;
+	}
+
+	std::sort(vecPartial.begin(), vecPartial.end(),
+		[](const std::pair<std::size_t, Symbol*>& pair1, const std::pair<std::size_t, Symbol*>& pair2) -> bool
+		{ return pair1.first < pair2.first; });
+
+	Symbol *pRes = 0;
+	for(std::size_t iPartial=0; iPartial<vecPartial.size(); ++iPartial)
+	{
+		Symbol *pPrevRes = pRes;
+		pRes = 0;
+
+		try
+		{
+			pRes = combine_results(pCombine, info, pPrevRes, vecPartial[iPartial].second);
+		}
+		catch(...)
+		{
+			for(std::size_t iRest=iPartial+1; iRest<vecPartial.size(); ++iRest)
+				delete vecPartial[iRest].second;
+			throw;
+		}
+	}
+
+	return pRes;
+}
+
+
+// parallel_for(strFunc, iBegin, iEnd, ...)
+static Symbol* fkt_parallel_for(const std::vector<Symbol*>& vecSyms,
+	ParseInfo& info, RuntimeInfo &runinfo, SymbolTable* pSymTab)
+{
+	if(vecSyms.size() < 3)
+	{
+		std::ostringstream ostrErr;
+		ostrErr << linenr(runinfo)
+			<< "parallel_for needs at least 3 arguments: func, begin, end." << std::endl;
+		throw tl::Err(ostrErr.str(), 0);
+	}
+
+	if(vecSyms[1]->GetType() != SYMBOL_INT || vecSyms[2]->GetType() != SYMBOL_INT)
+	{
+		std::ostringstream ostrErr;
+		ostrErr << linenr(runinfo) << "parallel_for: Range limits have to be integers." << std::endl;
+		throw tl::Err(ostrErr.str(), 0);
+	}
+
+	const NodeFunction *pFunc = get_parallel_func(vecSyms, 0, "parallel_for", info, runinfo);
+	ParallelArgs args(vecSyms, 3);
+	args.SetRange(vecSyms[1]->GetValInt(), vecSyms[2]->GetValInt());
+
+	run_chunked(args.GetNum(), [&](std::size_t iBegin, std::size_t iEnd, const std::atomic<bool>& bAbort)
+	{
+		for(std::size_t iIdx=iBegin; iIdx<iEnd && !bAbort; ++iIdx)
+		{
+			// ignore return value
+			Symbol *pRet = args.Call(pFunc, info, iIdx);
+			safe_delete(pRet, 0, &info);
+		}
+	});
+
+	return 0;
+}
+
 // --------------------------------------------------------------------------------
 
 
@@ -566,6 +984,11 @@ extern void init_ext_thread_calls()
 		t_mapFkts::value_type(T_STR"nthread", fkt_nthread),
 		t_mapFkts::value_type(T_STR"task", fkt_task),
 
+		// parallel primitives on the work-stealing pool
+		t_mapFkts::value_type(T_STR"parallel_map", fkt_parallel_map),
+		t_mapFkts::value_type(T_STR"parallel_reduce", fkt_parallel_reduce),
+		t_mapFkts::value_type(T_STR"parallel_for", fkt_parallel_for),
+
 		t_mapFkts::value_type(T_STR"thread_hwcount", fkt_thread_hwcount),
 		t_mapFkts::value_type(T_STR"join", fkt_thread_join),
 		t_mapFkts::value_type(T_STR"mutex", fkt_mutex),
@@ -44,9 +44,26 @@ int main()
 	for(int i=0; i<10; ++i)
 		tp.AddTask([i]()->int{ return i; });
 
-	tp.StartTasks();
+	// nested pools run on the same workers
+	for(int i=0; i<10; ++i)
+	{
+		tp.AddTask([i]()->int
+		{
+			tl::ThreadPool<int()> tpInner;
+			for(int j=0; j<=i; ++j)
+				tpInner.AddTask([j]()->int{ return j; });
+			tpInner.Start();
+
+			int iSum = 0;
+			for(auto& fut : tpInner.GetResults())
+				iSum += fut.get();
+			return iSum;
+		});
+	}
+
+	tp.Start();
 
-	auto& lstFut = tp.GetFutures();
+	auto& lstFut = tp.GetResults();
 	for(auto& fut : lstFut)
 		std::cout << fut.get() << std::endl;
 	return 0;
@@ -50,6 +50,12 @@
 #include <fstream>
 #include <iomanip>
 #include <cstdint>
+#include <optional>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
 
 #include <boost/container_hash/hash.hpp>
 #include <boost/property_tree/ptree.hpp>
@@ -63,6 +69,7 @@
 #include "phys.h"
 #include "algos.h"
 #include "expr.h"
+#include "thread.h"
 
 // enables debug output
 //#define __TLIBS2_MAGDYN_DEBUG_OUTPUT__
@@ -144,6 +151,300 @@ t_mat get_polarisation(int channel = 0, bool in_chiral_basis = true)
 
 	return tl2::zero<t_mat>(3);
 }
+
+
+
+/**
+ * sparse matrix in compressed row storage
+ */
+template<class t_vec, class t_size = std::size_t,
+	class t_cplx = typename t_vec::value_type>
+#ifndef SWIG  // TODO: remove this as soon as swig understands concepts
+requires tl2::is_vec<t_vec>
+#endif
+struct t_SparseMatrix
+{
+	// row accumulator, mapping column indices to values
+	using t_row = std::unordered_map<t_size, t_cplx>;
+
+	t_size size{};                     // number of rows and columns
+	std::vector<t_size> row_begin{};   // index of the first element of each row (and end index)
+	std::vector<t_size> col_idx{};     // column indices of the elements
+	std::vector<t_cplx> values{};      // values of the elements
+
+
+	/**
+	 * compress the rows of a square matrix
+	 */
+	void SetRows(const std::vector<t_row>& rows)
+	{
+		size = rows.size();
+		row_begin.clear();
+		col_idx.clear();
+		values.clear();
+		row_begin.reserve(size + 1);
+
+		for(const t_row& row : rows)
+		{
+			row_begin.push_back(col_idx.size());
+
+			std::vector<std::pair<t_size, t_cplx>> elems(row.begin(), row.end());
+			std::sort(elems.begin(), elems.end(),
+				[](const auto& elem1, const auto& elem2) -> bool
+			{
+				return elem1.first < elem2.first;
+			});
+
+			for(const auto& [col, val] : elems)
+			{
+				col_idx.push_back(col);
+				values.push_back(val);
+			}
+		}
+
+		row_begin.push_back(col_idx.size());
+	}
+
+
+	/**
+	 * matrix-vector product
+	 */
+	t_vec operator*(const t_vec& vec) const
+	{
+		t_vec result = tl2::zero<t_vec>(size);
+
+		for(t_size row = 0; row < size; ++row)
+		{
+			t_cplx elem{};
+			for(t_size idx = row_begin[row]; idx < row_begin[row + 1]; ++idx)
+				elem += values[idx] * vec[col_idx[idx]];
+			result[row] = elem;
+		}
+
+		return result;
+	}
+
+
+	/**
+	 * number of stored elements
+	 */
+	t_size GetNonZeroCount() const
+	{
+		return values.size();
+	}
+
+
+	/**
+	 * convert to a dense matrix
+	 */
+	template<class t_mat>
+	t_mat GetDense() const
+	{
+		t_mat mat = tl2::zero<t_mat>(size, size);
+
+		for(t_size row = 0; row < size; ++row)
+			for(t_size idx = row_begin[row]; idx < row_begin[row + 1]; ++idx)
+				mat(row, col_idx[idx]) = values[idx];
+
+		return mat;
+	}
+};
+
+
+
+/**
+ * problems of the sparse solver during a calculation,
+ * the counters can be incremented from several threads
+ */
+template<class t_size>
+struct t_SparseStats
+{
+	std::atomic<t_size> dense_fallbacks{};  // hamiltonian not positive definite, dense solver used
+	std::atomic<t_size> unconverged{};      // linear solver did not converge
+
+	t_SparseStats() = default;
+	t_SparseStats(const t_SparseStats& other) { *this = other; }
+
+	t_SparseStats& operator=(const t_SparseStats& other)
+	{
+		dense_fallbacks = other.dense_fallbacks.load();
+		unconverged = other.unconverged.load();
+		return *this;
+	}
+
+	void Add(const t_SparseStats& other)
+	{
+		dense_fallbacks += other.dense_fallbacks.load();
+		unconverged += other.unconverged.load();
+	}
+};
+
+
+
+/**
+ * solves the system A x = b for a hermitian (but possibly indefinite) operator A
+ * using the minimum residual method
+ * @see https://doi.org/10.1137/0712047
+ * @returns [converged, x]
+ */
+template<class t_vec, class t_real, class t_size = std::size_t,
+	class t_cplx = typename t_vec::value_type>
+#ifndef SWIG  // TODO: remove this as soon as swig understands concepts
+requires tl2::is_vec<t_vec>
+#endif
+std::tuple<bool, t_vec> solve_minres(const std::function<t_vec(const t_vec&)>& A,
+	const t_vec& b, t_real tol, t_size max_iter)
+{
+	const t_size N = b.size();
+	t_vec x = tl2::zero<t_vec>(N);
+
+	auto get_norm = [](const t_vec& vec) -> t_real
+	{
+		return std::sqrt(tl2::inner<t_vec>(vec, vec).real());
+	};
+
+	const t_real beta1 = get_norm(b);
+	if(tl2::equals_0<t_real>(beta1, std::numeric_limits<t_real>::min()))
+		return std::make_tuple(true, x);
+
+	t_vec r1 = b, r2 = b, y = b;
+	t_vec w = tl2::zero<t_vec>(N), w1 = w, w2 = w;
+
+	t_real beta = beta1, oldb = 0;
+	t_real dbar = 0, epsln = 0;
+	t_real phibar = beta1;
+	t_real cs = -1, sn = 0;
+
+	for(t_size iter = 0; iter < max_iter; ++iter)
+	{
+		// lanczos step
+		const t_vec v = y / beta;
+		y = A(v);
+		if(iter > 0)
+			y -= r1 * (beta / oldb);
+
+		const t_real alpha = tl2::inner<t_vec>(v, y).real();
+		y -= r2 * (alpha / beta);
+		r1 = std::move(r2);
+		r2 = y;
+
+		oldb = beta;
+		beta = get_norm(r2);
+
+		// apply previous rotation
+		const t_real oldeps = epsln;
+		const t_real delta = cs*dbar + sn*alpha;
+		const t_real gbar = sn*dbar - cs*alpha;
+		epsln = sn * beta;
+		dbar = -cs * beta;
+
+		// compute next rotation
+		const t_real gamma = std::max(std::hypot(gbar, beta),
+			std::numeric_limits<t_real>::epsilon());
+		cs = gbar / gamma;
+		sn = beta / gamma;
+		const t_real phi = cs * phibar;
+		phibar *= sn;
+
+		// update solution
+		w1 = std::move(w2);
+		w2 = std::move(w);
+		w = (v - w1*oldeps - w2*delta) / gamma;
+		x += w * phi;
+
+		if(std::abs(phibar) <= tol * beta1)
+			return std::make_tuple(true, x);
+		if(tl2::equals_0<t_real>(beta, std::numeric_limits<t_real>::min()))
+			break;
+	}
+
+	return std::make_tuple(std::abs(phibar) <= tol * beta1, x);
+}
+
+
+
+/**
+ * estimates the range of the eigenvalues of a hermitian operator A using
+ * the lanczos method with full reorthogonalisation
+ * @note the smallest ritz value is an upper bound for the smallest eigenvalue,
+ *       so a negative value shows that the operator is not positive definite
+ * @returns [ok, E_min, E_max]
+ */
+template<class t_mat, class t_vec, class t_real, class t_size = std::size_t,
+	class t_cplx = typename t_vec::value_type>
+#ifndef SWIG  // TODO: remove this as soon as swig understands concepts
+requires tl2::is_mat<t_mat> && tl2::is_vec<t_vec>
+#endif
+std::tuple<bool, t_real, t_real> lanczos_eigenvalue_range(
+	const std::function<t_vec(const t_vec&)>& A, t_size dim, t_size max_iter)
+{
+	max_iter = std::min(max_iter, dim);
+	if(max_iter == 0)
+		return std::make_tuple(false, t_real(0), t_real(0));
+
+	auto get_norm = [](const t_vec& vec) -> t_real
+	{
+		return std::sqrt(tl2::inner<t_vec>(vec, vec).real());
+	};
+
+	// starting vector, using a fixed seed for reproducible results
+	std::mt19937 rng{ 0 };
+	std::uniform_real_distribution<t_real> dist{ -1., 1. };
+	t_vec v = tl2::create<t_vec>(dim);
+	for(t_size i = 0; i < dim; ++i)
+		v[i] = t_cplx(dist(rng), dist(rng));
+	v /= get_norm(v);
+
+	std::vector<t_vec> V;
+	std::vector<t_real> alphas, betas;
+	V.reserve(max_iter);
+
+	for(t_size iter = 0; iter < max_iter; ++iter)
+	{
+		V.push_back(v);
+		t_vec w = A(v);
+		alphas.push_back(tl2::inner<t_vec>(v, w).real());
+
+		for(int pass = 0; pass < 2; ++pass)
+			for(t_size j = 0; j < V.size(); ++j)
+				w -= V[j] * tl2::inner<t_vec>(V[j], w);
+
+		// invariant subspace found?
+		const t_real beta = get_norm(w);
+		if(beta <= std::numeric_limits<t_real>::epsilon() * (std::abs(alphas.back()) + 1.)
+			|| iter + 1 == max_iter)
+			break;
+
+		betas.push_back(beta);
+		v = w / beta;
+	}
+
+	// eigenvalues of the tridiagonal lanczos matrix
+	const t_size M = alphas.size();
+	t_mat T = tl2::zero<t_mat>(M, M);
+	for(t_size i = 0; i < M; ++i)
+	{
+		T(i, i) = alphas[i];
+		if(i + 1 < M)
+		{
+			T(i, i + 1) = betas[i];
+			T(i + 1, i) = betas[i];
+		}
+	}
+
+	const auto [ok, evals, evecs] =
+		tl2_la::eigenvec<t_mat, t_vec, t_cplx, t_real>(T, true, true, false);
+	if(!ok || evals.size() == 0)
+		return std::make_tuple(false, t_real(0), t_real(0));
+
+	const auto [E_min, E_max] = std::minmax_element(evals.begin(), evals.end(),
+		[](const t_cplx& E1, const t_cplx& E2) -> bool
+	{
+		return E1.real() < E2.real();
+	});
+
+	return std::make_tuple(true, E_min->real(), E_max->real());
+}
 // ----------------------------------------------------------------------------
 
 
@@ -256,6 +557,23 @@ struct t_EnergyAndWeight
 	t_mat S_perp{};
 	t_real weight{};
 	t_real weight_channel[3] = { 0., 0., 0. };
+
+	// index of the branch, consistent along a momentum path (see t_PathContinuation)
+	std::size_t branch{};
+};
+
+
+
+/**
+ * eigenvectors at the previous point of a momentum path,
+ * used to identify the branches at the next point
+ */
+template<class t_mat, class t_size>
+struct t_PathContinuation
+{
+	// eigenvectors for the hamiltonians at Q, Q + ordering, and Q - ordering,
+	// the columns are ordered by branch index (empty: start a new path)
+	std::array<t_mat, 3> evecs{};
 };
 
 
@@ -269,6 +587,82 @@ struct t_Variable
 	std::string name{};
 	t_cplx value{};
 };
+
+
+
+/**
+ * regular momentum grid, reduced by symmetry
+ */
+template<class t_vec_real, class t_size>
+struct t_MomentumGrid
+{
+	std::array<t_size, 3> num_pts{};      // number of grid points along each reciprocal axis
+
+	std::vector<t_vec_real> Qs{};         // irreducible momenta
+	std::vector<t_size> multiplicities{}; // number of grid points mapped onto each irreducible momentum
+	std::vector<t_size> irred_idx{};      // full grid index -> index of the irreducible momentum
+};
+
+
+
+/**
+ * magnon density of states
+ */
+template<class t_real>
+struct t_DensityOfStates
+{
+	std::vector<t_real> E{};              // bin centres
+	std::vector<t_real> dos{};            // states per meV and magnetic unit cell
+	std::vector<t_real> dos_int{};        // integrated number of states
+};
+
+
+
+/**
+ * thermodynamic quantities calculated from the magnon density of states
+ */
+template<class t_real>
+struct t_Thermodynamics
+{
+	t_real T{};                           // temperature in K
+	t_real magnons{};                     // thermal magnon number per magnetic unit cell
+	t_real magnons_per_site{};            // reduction of the ordered moment per site
+	t_real energy{};                      // magnon energy in meV per magnetic unit cell
+	t_real heat_capacity{};               // magnon heat capacity in k_B per magnetic unit cell
+};
+
+
+
+/**
+ * a model parameter varied in a sweep
+ */
+template<class t_real, class t_size>
+struct t_SweepAxis
+{
+	// name of a variable, "B" for the field magnitude,
+	// or "Bx", "By", "Bz" for the components of the field vector
+	std::string name{};
+
+	t_real start{}, end{};
+	t_size num_pts{};
+};
+
+
+
+/**
+ * results at one point of a parameter sweep
+ */
+template<class t_vec_real, class t_real, class t_size>
+struct t_SweepPoint
+{
+	std::vector<t_real> values{};         // parameter values, one per sweep axis
+	t_real E_ground{};                    // classical ground-state energy
+	t_real gap{};                         // lowest magnon creation energy of all momenta
+	t_vec_real Q_gap{};                   // momentum with the lowest energy
+	std::vector<t_vec_real> Qs_soft{};    // momenta with soft modes
+	t_size num_unstable{};                // momenta with a hamiltonian that is not positive definite
+	std::vector<t_real> E_lowest{};       // lowest creation energy at each momentum (optional)
+};
 // ----------------------------------------------------------------------------
 
 
@@ -301,8 +695,19 @@ public:
 
 	using ExternalField = t_ExternalField<t_vec_real, t_real>;
 	using EnergyAndWeight = t_EnergyAndWeight<t_mat, t_real>;
+	using PathContinuation = t_PathContinuation<t_mat, t_size>;
 	using Variable = t_Variable<t_cplx>;
 
+	using MomentumGrid = t_MomentumGrid<t_vec_real, t_size>;
+	using DensityOfStates = t_DensityOfStates<t_real>;
+	using Thermodynamics = t_Thermodynamics<t_real>;
+
+	using SweepAxis = t_SweepAxis<t_real, t_size>;
+	using SweepPoint = t_SweepPoint<t_vec_real, t_real, t_size>;
+
+	using SparseMatrix = t_SparseMatrix<t_vec, t_size, t_cplx>;
+	using SparseStats = t_SparseStats<t_size>;
+
 	using t_indices = std::pair<t_size, t_size>;
 	using t_Jmap = std::unordered_map<t_indices, t_mat, boost::hash<t_indices>>;
 	// --------------------------------------------------------------------
@@ -404,6 +809,13 @@ public:
 	t_real GetTemperature() const { return m_temperature; }
 	t_real GetBoseCutoffEnergy() const { return m_bose_cutoff; }
 
+	t_size GetSparseModes() const { return m_sparse_modes; }
+	std::tuple<t_real, t_real> GetSparseEnergyWindow() const
+	{ return std::make_tuple(m_sparse_E_min, m_sparse_E_max); }
+
+	t_size GetSparseFallbacks() const { return m_sparse_stats.dense_fallbacks; }
+	t_size GetSparseUnconverged() const { return m_sparse_stats.unconverged; }
+
 
 
 	const MagneticSite& GetMagneticSite(t_size idx) const
@@ -545,6 +957,27 @@ public:
 	void SetCholeskyMaxTries(t_size max_tries) { m_tries_chol = max_tries; }
 	void SetCholeskyInc(t_real delta) { m_delta_chol = delta; }
 
+	void SetSparseModes(t_size num_modes) { m_sparse_modes = num_modes; }
+	void SetSparseTolerance(t_real tol) { m_sparse_tol = tol; }
+	void SetSparseMaxIterations(t_size max_iter) { m_sparse_max_iter = max_iter; }
+	void SetSparseBlockSize(t_size block_size) { m_sparse_block = block_size; }
+	void SetSparseCheckIterations(t_size num_iter) { m_sparse_check_iter = num_iter; }
+	void ResetSparseStats() const { m_sparse_stats = SparseStats{}; }
+
+	void SetSaveBranches(bool b) { m_save_branches = b; }
+
+
+
+	/**
+	 * only calculate the modes in the given energy window using the sparse solver
+	 * (disable the window with E_min >= E_max)
+	 */
+	void SetSparseEnergyWindow(t_real E_min, t_real E_max)
+	{
+		m_sparse_E_min = E_min;
+		m_sparse_E_max = E_max;
+	}
+
 
 
 	void SetExternalField(const ExternalField& field)
@@ -1552,11 +1985,14 @@ public:
 
 	/**
 	 * get the energies from a hamiltonian
+	 * (if a path continuation is given, the branches are identified by
+	 * the overlaps with the eigenvectors of the previous point)
 	 * @note implements the formalism given by (Toth 2015)
 	 */
 	std::vector<EnergyAndWeight> CalcEnergiesFromHamiltonian(
 		t_mat _H, const t_vec_real& Qvec,
-		bool only_energies = false) const
+		bool only_energies = false,
+		PathContinuation *path = nullptr, t_size path_idx = 0) const
 	{
 		const t_size N = GetMagneticSitesCount();
 		if(N == 0 || _H.size1() == 0 || _H.size2() == 0)
@@ -1627,9 +2063,14 @@ public:
 
 		// eigenvalues of the hamiltonian correspond to the energies
 		// eigenvectors correspond to the spectral weights
-		const auto [evecs_ok, evals, evecs] =
+		std::vector<t_cplx> evals;
+		std::vector<t_vec> evecs;
+		std::vector<t_size> branches;
+
+		bool evecs_ok = false;
+		std::tie(evecs_ok, evals, evecs) =
 			tl2_la::eigenvec<t_mat, t_vec, t_cplx, t_real>(
-				H_mat, only_energies, is_herm, true);
+				H_mat, only_energies && !path, is_herm, true);
 		if(!evecs_ok)
 		{
 			using namespace tl2_ops;
@@ -1637,14 +2078,36 @@ public:
 				<< Qvec << "." << std::endl;
 		}
 
+		if(path)
+		{
+			t_mat& path_evecs = path->evecs[path_idx];
+			branches = AssignBranches(evals, evecs, path_evecs);
+
+			// keep the eigenvectors, ordered by branch, for the next point
+			if(evecs.size() == evals.size() && evecs.size() > 0)
+			{
+				std::vector<t_vec> evecs_branches(evecs.size());
+				for(t_size idx = 0; idx < evecs.size(); ++idx)
+					evecs_branches[branches[idx]] = evecs[idx];
+				path_evecs = tl2::create<t_mat>(evecs_branches);
+			}
+			else
+			{
+				path_evecs = t_mat{};
+			}
+		}
 
 		std::vector<EnergyAndWeight> energies_and_correlations{};
 		energies_and_correlations.reserve(evals.size());
 
 		// register energies
-		for(const auto& eval : evals)
+		for(t_size idx = 0; idx < evals.size(); ++idx)
 		{
-			const EnergyAndWeight EandS { .E = eval.real(), };
+			const EnergyAndWeight EandS
+			{
+				.E = evals[idx].real(),
+				.branch = branches.size() ? path_idx*H_mat.size1() + branches[idx] : 0,
+			};
 			energies_and_correlations.emplace_back(std::move(EandS));
 		}
 
@@ -1660,6 +2123,71 @@ public:
 
 
 
+	/**
+	 * identify the branches by the overlaps of the eigenvectors with the
+	 * ones of the previous point, whose columns are ordered by branch
+	 * @returns branch index for each eigenvector
+	 */
+	std::vector<t_size> AssignBranches(const std::vector<t_cplx>& evals,
+		const std::vector<t_vec>& evecs, const t_mat& prev_evecs) const
+	{
+		const t_size num = evals.size();
+		std::vector<t_size> branches(num);
+
+		if(evecs.size() != num || prev_evecs.size2() != num ||
+			(num > 0 && prev_evecs.size1() != evecs[0].size()))
+		{
+			// start of a path: number the branches by descending energy
+			const std::vector<t_size> sorting = tl2::get_perm(num,
+				[&evals](t_size idx1, t_size idx2) -> bool
+			{
+				return evals[idx1].real() > evals[idx2].real();
+			});
+
+			for(t_size i = 0; i < num; ++i)
+				branches[sorting[i]] = i;
+			return branches;
+		}
+
+		// overlaps of all eigenvectors with all previous branches
+		struct t_Overlap { t_real overlap; t_size evec_idx; t_size branch; };
+		std::vector<t_Overlap> overlaps;
+		overlaps.reserve(num * num);
+
+		for(t_size branch = 0; branch < num; ++branch)
+		{
+			const t_vec prev_evec = tl2::col<t_mat, t_vec>(prev_evecs, branch);
+			for(t_size evec_idx = 0; evec_idx < num; ++evec_idx)
+			{
+				overlaps.emplace_back(t_Overlap{
+					.overlap = std::norm(tl2::inner<t_vec>(prev_evec, evecs[evec_idx])),
+					.evec_idx = evec_idx, .branch = branch });
+			}
+		}
+
+		// assign the largest overlaps first
+		std::stable_sort(overlaps.begin(), overlaps.end(),
+			[](const t_Overlap& overlap1, const t_Overlap& overlap2) -> bool
+		{
+			return overlap1.overlap > overlap2.overlap;
+		});
+
+		std::vector<bool> evec_assigned(num, false), branch_assigned(num, false);
+		for(const t_Overlap& overlap : overlaps)
+		{
+			if(evec_assigned[overlap.evec_idx] || branch_assigned[overlap.branch])
+				continue;
+
+			branches[overlap.evec_idx] = overlap.branch;
+			evec_assigned[overlap.evec_idx] = true;
+			branch_assigned[overlap.branch] = true;
+		}
+
+		return branches;
+	}
+
+
+
 	/**
 	 * get the dynamical structure factor from a hamiltonian
 	 * @note implements the formalism given by (Toth 2015)
@@ -1691,6 +2219,11 @@ public:
 			E_sqrt(i, i) = std::sqrt(E_sqrt/*L_mat*/(i, i)); // sqrt. of abs. energies
 
 		// re-create energies, to be consistent with the weights
+		std::vector<std::size_t> branches;
+		branches.reserve(sorting.size());
+		for(t_size idx : sorting)
+			branches.push_back(energies_and_correlations[idx].branch);
+
 		energies_and_correlations.clear();
 		for(t_size i = 0; i < L_mat.size1(); ++i)
 		{
@@ -1699,6 +2232,7 @@ public:
 				.E = L_mat(i, i).real(),
 				.S = tl2::zero<t_mat>(3, 3),
 				.S_perp = tl2::zero<t_mat>(3, 3),
+				.branch = i < branches.size() ? branches[i] : 0,
 			};
 
 			energies_and_correlations.emplace_back(std::move(EandS));
@@ -1907,17 +2441,31 @@ public:
 	/**
 	 * get the energies and the spin-correlation at the given momentum
 	 * (also calculates incommensurate contributions and applies weight factors)
+	 * for consecutive points on a momentum path, a path continuation can be given
+	 * to keep the branch indices consistent
 	 * @note implements the formalism given by (Toth 2015)
 	 */
 	std::vector<EnergyAndWeight> CalcEnergies(const t_vec_real& Qvec,
-		bool only_energies = false) const
+		bool only_energies = false, PathContinuation *path = nullptr) const
 	{
+		// use either the dense or the sparse solver
+		const bool use_sparse = m_sparse_modes > 0 || m_sparse_E_min < m_sparse_E_max;
+		auto calc_energies = [this, use_sparse, only_energies, path](
+			const t_vec_real& Q, t_size path_idx) -> std::vector<EnergyAndWeight>
+		{
+			if(use_sparse)
+			{
+				const SparseMatrix H = CalcHamiltonianSparse(Q);
+				return CalcEnergiesFromSparseHamiltonian(H, Q, only_energies);
+			}
+
+			const t_mat H = CalcHamiltonian(Q);
+			return CalcEnergiesFromHamiltonian(H, Q, only_energies, path, path_idx);
+		};
+
 		std::vector<EnergyAndWeight> EandWs;
 		if(m_calc_H)
-		{
-			const t_mat H = CalcHamiltonian(Qvec);
-			EandWs = CalcEnergiesFromHamiltonian(H, Qvec, only_energies);
-		}
+			EandWs = calc_energies(Qvec, 0);
 
 		if(IsIncommensurate())
 		{
@@ -1936,18 +2484,10 @@ public:
 			std::vector<EnergyAndWeight> EandWs_p, EandWs_m;
 
 			if(m_calc_Hp)
-			{
-				const t_mat H_p = CalcHamiltonian(Qvec + m_ordering);
-				EandWs_p = CalcEnergiesFromHamiltonian(
-					H_p, Qvec + m_ordering, only_energies);
-			}
+				EandWs_p = calc_energies(Qvec + m_ordering, 1);
 
 			if(m_calc_Hm)
-			{
-				const t_mat H_m = CalcHamiltonian(Qvec - m_ordering);
-				EandWs_m = CalcEnergiesFromHamiltonian(
-					H_m, Qvec - m_ordering, only_energies);
-			}
+				EandWs_m = calc_energies(Qvec - m_ordering, 2);
 
 			if(!only_energies)
 			{
@@ -1979,11 +2519,11 @@ public:
 
 
 	std::vector<EnergyAndWeight> CalcEnergies(t_real h, t_real k, t_real l,
-		bool only_energies = false) const
+		bool only_energies = false, PathContinuation *path = nullptr) const
 	{
 		// momentum transfer
 		const t_vec_real Qvec = tl2::create<t_vec_real>({ h, k, l });
-		return CalcEnergies(Qvec, only_energies);
+		return CalcEnergies(Qvec, only_energies, path);
 	}
 
 
@@ -2044,44 +2584,1281 @@ public:
 
 
 	// --------------------------------------------------------------------
-	// loading and saving
+	// large systems: sparse hamiltonian and partial spectrum
 	// --------------------------------------------------------------------
 	/**
-	 * generates the dispersion plot along the given q path
+	 * get the hamiltonian at the given momentum as a sparse matrix
+	 * (same as CalcHamiltonian(), but only iterating the couplings)
+	 * @note implements the formalism given by (Toth 2015)
 	 */
-	void SaveDispersion(const std::string& filename,
-		t_real h_start, t_real k_start, t_real l_start,
-		t_real h_end, t_real k_end, t_real l_end,
-		t_size num_qs = 128) const
+	SparseMatrix CalcHamiltonianSparse(const t_vec_real& Qvec) const
 	{
-		std::ofstream ofstr{filename};
-		SaveDispersion(ofstr, h_start, k_start, l_start, h_end, k_end, l_end, num_qs);
-	}
-
+		SparseMatrix H;
 
+		const t_size N = GetMagneticSitesCount();
+		if(N == 0)
+			return H;
 
-	/**
-	 * generates the dispersion plot along the given q path
-	 */
-	void SaveDispersion(std::ostream& ostr,
-		t_real h_start, t_real k_start, t_real l_start,
-		t_real h_end, t_real k_end, t_real l_end,
-		t_size num_qs = 128) const
-	{
-		ostr.precision(m_prec);
+		std::vector<typename SparseMatrix::t_row> rows(N*2);
 
-		ostr
-			<< std::setw(m_prec*2) << std::left << "# h"
-			<< std::setw(m_prec*2) << std::left << "k"
-			<< std::setw(m_prec*2) << std::left << "l"
-			<< std::setw(m_prec*2) << std::left << "E"
-			<< std::setw(m_prec*2) << std::left << "w"
-			<< std::setw(m_prec*2) << std::left << "w_sf1"
-			<< std::setw(m_prec*2) << std::left << "w_sf2"
-			<< std::setw(m_prec*2) << std::left << "w_nsf"
-			<< std::endl;
+		// add the matrix elements of equations (25) and (26)
+		// from (Toth 2015) for the (i, j) coupling
+		auto add_coupling = [this, &rows, N](t_size i, t_size j,
+			const t_mat& J_Q33, const t_mat& J_Q033)
+		{
+			const MagneticSite& s_i = GetMagneticSite(i);
+			const MagneticSite& s_j = GetMagneticSite(j);
+
+			const t_real S_mag = 0.5 * std::sqrt(s_i.spin_mag_calc * s_j.spin_mag_calc);
+
+			const t_cplx A         = S_mag * tl2::inner_noconj<t_vec>(
+				s_i.spin_ortho_calc, J_Q33 * s_j.spin_ortho_conj_calc);
+			const t_cplx A_conj_mQ = S_mag * tl2::inner_noconj<t_vec>(
+				s_i.spin_ortho_conj_calc, J_Q33 * s_j.spin_ortho_calc);
+			const t_cplx B         = S_mag * tl2::inner_noconj<t_vec>(
+				s_i.spin_ortho_calc, J_Q33 * s_j.spin_ortho_calc);
+			const t_cplx C         = s_j.spin_mag_calc * tl2::inner_noconj<t_vec>(
+				s_i.spin_dir_calc, J_Q033 * s_j.spin_dir_calc);
+
+			rows[i][j]         += A;
+			rows[N + i][N + j] += A_conj_mQ;
+			rows[i][N + j]     += B;
+			rows[N + j][i]     += std::conj(B);
+			rows[i][i]         -= C;
+			rows[N + i][N + i] -= C;
+		};
 
-		for(t_size i = 0; i < num_qs; ++i)
+		// iterate couplings
+		for(const ExchangeTerm& term : GetExchangeTerms())
+		{
+			if(!CheckMagneticSite(term.site1_calc) || !CheckMagneticSite(term.site2_calc))
+				continue;
+
+			const t_mat J = CalcRealJ(term);
+			if(J.size1() == 0 || J.size2() == 0)
+				continue;
+			const t_mat J_T = tl2::trans(J);
+
+			// equations (14), (12), (11), and (52) from (Toth 2015)
+			const t_cplx phase = m_phase_sign * s_imag * s_twopi *
+				tl2::inner<t_vec_real>(term.dist_calc, Qvec);
+
+			add_coupling(term.site1_calc, term.site2_calc, J * std::exp(phase), J);
+			add_coupling(term.site2_calc, term.site1_calc, J_T * std::exp(-phase), J_T);
+		}
+
+		// include external field, equation (28) from (Toth 2015)
+		if(!tl2::equals_0<t_real>(m_field.mag, m_eps) && m_field.dir.size() == 3)
+		{
+			const t_vec field = tl2::convert<t_vec>(-m_field.dir) * m_field.mag;
+
+			// bohr magneton in [meV/T]
+			constexpr const t_real muB = tl2::mu_B<t_real>
+				/ tl2::meV<t_real> * tl2::tesla<t_real>;
+
+			for(t_size i = 0; i < N; ++i)
+			{
+				const MagneticSite& s_i = GetMagneticSite(i);
+				const t_vec gv    = s_i.g_e * s_i.spin_dir_calc;
+				const t_cplx Bgv  = tl2::inner_noconj<t_vec>(field, gv);
+
+				rows[i][i]         -= muB * Bgv;
+				rows[N + i][N + i] -= std::conj(muB * Bgv);
+			}
+		}
+
+		H.SetRows(rows);
+		return H;
+	}
+
+
+
+	/**
+	 * print how often the sparse solver had problems since the last ResetSparseStats()
+	 */
+	void ReportSparseStats() const
+	{
+		if(const t_size num = m_sparse_stats.dense_fallbacks; num > 0)
+		{
+			std::cerr << "Warning: Hamiltonian was not positive definite at " << num
+				<< " momentum point(s), used the dense solver for them." << std::endl;
+		}
+
+		if(const t_size num = m_sparse_stats.unconverged; num > 0)
+		{
+			std::cerr << "Warning: Linear solver did not converge at " << num
+				<< " momentum point(s)." << std::endl;
+		}
+	}
+
+
+
+	/**
+	 * get the part of the spectrum selected by SetSparseModes() or SetSparseEnergyWindow()
+	 * from a sparse hamiltonian
+	 *
+	 * the bosonic eigenproblem H x = E g x is solved using the (positive definite) hamiltonian
+	 * as metric, for which both H^(-1) g (eigenvalues 1/E) and its shift-inverted form
+	 * (g - H/E_shift)^(-1) H (eigenvalues 1/(1/E - 1/E_shift)) are self-adjoint;
+	 * their largest eigenvalues are found using a block krylov subspace and
+	 * a minimum residual solver for the linear systems.
+	 * if the hamiltonian is not positive definite, the dense solver is used instead
+	 * @note implements the formalism given by (Toth 2015), equations (30) - (47)
+	 */
+	std::vector<EnergyAndWeight> CalcEnergiesFromSparseHamiltonian(
+		const SparseMatrix& H, const t_vec_real& Qvec,
+		bool only_energies = false) const
+	{
+		const t_size N = GetMagneticSitesCount();
+		const t_size dim = N*2;
+		if(N == 0 || H.size != dim)
+			return {};
+
+		const bool use_window = m_sparse_E_min < m_sparse_E_max;
+		t_real E_shift = use_window ? (m_sparse_E_min + m_sparse_E_max) * 0.5 : 0.;
+		if(use_window && tl2::equals_0<t_real>(E_shift, m_eps))
+			E_shift = m_sparse_E_max;  // avoid shifting to zero energy
+		const t_real inv_shift = use_window ? t_real(1) / E_shift : t_real(0);
+
+		// equation (30) from (Toth 2015)
+		auto apply_g = [N](t_vec vec) -> t_vec
+		{
+			for(t_size i = N; i < 2*N; ++i)
+				vec[i] = -vec[i];
+			return vec;
+		};
+
+		const t_size num_requested = std::min<t_size>(m_sparse_modes, dim);
+
+		// fall back to the dense solver, which regularises the hamiltonian
+		// if needed, and select the same part of the spectrum
+		auto calc_dense = [this, &H, &Qvec, only_energies, use_window, num_requested]()
+			-> std::vector<EnergyAndWeight>
+		{
+			// counted instead of warning at every Q, see ReportSparseStats()
+			++m_sparse_stats.dense_fallbacks;
+
+			std::vector<EnergyAndWeight> EandWs = CalcEnergiesFromHamiltonian(
+				H.template GetDense<t_mat>(), Qvec, only_energies);
+
+			if(use_window)
+			{
+				EandWs.erase(std::remove_if(EandWs.begin(), EandWs.end(),
+					[this](const EnergyAndWeight& EandW) -> bool
+				{
+					return EandW.E < m_sparse_E_min || EandW.E > m_sparse_E_max;
+				}), EandWs.end());
+			}
+			else
+			{
+				// the modes closest to zero energy, as found by the sparse solver
+				std::stable_sort(EandWs.begin(), EandWs.end(),
+					[](const EnergyAndWeight& EandW1, const EnergyAndWeight& EandW2) -> bool
+				{
+					return std::abs(EandW1.E) < std::abs(EandW2.E);
+				});
+
+				if(EandWs.size() > num_requested)
+					EandWs.resize(num_requested);
+			}
+
+			std::stable_sort(EandWs.begin(), EandWs.end(),
+				[](const EnergyAndWeight& EandW1, const EnergyAndWeight& EandW2) -> bool
+			{
+				return EandW1.E > EandW2.E;
+			});
+
+			return EandWs;
+		};
+
+		// the hamiltonian is used as metric, so it has to be positive definite,
+		// see the cholesky decomposition in CalcEnergiesFromHamiltonian()
+		const std::function<t_vec(const t_vec&)> op_H = [&H](const t_vec& vec) -> t_vec
+		{
+			return H * vec;
+		};
+
+		const auto [range_ok, H_min, H_max] = lanczos_eigenvalue_range<t_mat, t_vec, t_real, t_size>(
+			op_H, dim, m_sparse_check_iter);
+		if(!range_ok || H_min <= m_eps * std::max<t_real>(std::abs(H_max), 1.))
+			return calc_dense();
+
+		// operator to invert: H or g - H/E_shift
+		const std::function<t_vec(const t_vec&)> op_inv =
+			[&H, &apply_g, use_window, inv_shift](const t_vec& vec) -> t_vec
+		{
+			if(!use_window)
+				return H * vec;
+			return apply_g(vec) - (H * vec) * inv_shift;
+		};
+
+		bool solver_ok = true;
+		auto apply_op = [this, &H, &op_inv, &apply_g, &solver_ok, use_window](const t_vec& vec) -> t_vec
+		{
+			auto [ok, result] = solve_minres<t_vec, t_real, t_size>(
+				op_inv, use_window ? H * vec : apply_g(vec),
+				m_sparse_tol * 1e-2, m_sparse_max_iter);
+			solver_ok = solver_ok && ok;
+			return result;
+		};
+
+		// converged eigenvalues and -vectors
+		struct t_Ritz { t_real E; t_real theta; t_vec x; };
+		std::vector<t_Ritz> modes;
+
+		const t_size block_size = std::min<t_size>(std::max<t_size>(m_sparse_block, 1), dim);
+		t_size subspace_dim = std::min<t_size>(
+			std::max<t_size>(2*num_requested + block_size, 20), dim);
+
+		// basis of the krylov subspace (orthonormal with respect to H),
+		// the basis vectors multiplied by H, and their images under the operator
+		std::vector<t_vec> V, HV, W;
+
+		// a negative rayleigh quotient found while building the basis
+		bool pos_def = true;
+
+		// orthonormalise a new vector against the basis and add it
+		auto add_basis_vec = [&H, &V, &HV, &pos_def](t_vec vec) -> bool
+		{
+			const t_real norm2_orig = tl2::inner<t_vec>(vec, H * vec).real();
+			const t_real norm_orig = std::sqrt(std::abs(norm2_orig));
+			for(int pass = 0; pass < 2; ++pass)
+				for(t_size j = 0; j < V.size(); ++j)
+					vec -= V[j] * tl2::inner<t_vec>(HV[j], vec);
+
+			t_vec Hvec = H * vec;
+			const t_real norm2 = tl2::inner<t_vec>(vec, Hvec).real();
+			const t_real norm = std::sqrt(std::abs(norm2));
+			if(norm <= norm_orig * std::sqrt(std::numeric_limits<t_real>::epsilon()))
+				return false;
+
+			if(norm2_orig < t_real(0) || norm2 < t_real(0))
+			{
+				pos_def = false;
+				return false;
+			}
+
+			V.emplace_back(vec / norm);
+			HV.emplace_back(Hvec / norm);
+			return true;
+		};
+
+		// starting block, using a fixed seed for reproducible results
+		std::mt19937 rng{ 0 };
+		std::uniform_real_distribution<t_real> dist{ -1., 1. };
+		for(t_size i = 0; i < block_size; ++i)
+		{
+			t_vec vec = tl2::create<t_vec>(dim);
+			for(t_size j = 0; j < dim; ++j)
+				vec[j] = t_cplx(dist(rng), dist(rng));
+			add_basis_vec(vec);
+		}
+
+		t_size next_expand = 0;  // next image to expand the subspace with
+		t_size M_prev = 0;       // previous subspace dimension
+		while(true)
+		{
+			// expand the block krylov subspace
+			while(true)
+			{
+				for(; next_expand < W.size() && V.size() < subspace_dim; ++next_expand)
+					add_basis_vec(W[next_expand]);
+
+				if(W.size() >= V.size())
+					break;
+				W.emplace_back(apply_op(V[W.size()]));
+			}
+
+			if(!pos_def)
+				break;
+
+			// rayleigh-ritz projection, P is hermitian
+			const t_size M = V.size();
+			const bool can_expand = M < dim && M > M_prev;
+			M_prev = M;
+			t_mat P = tl2::create<t_mat>(M, M);
+			for(t_size i = 0; i < M; ++i)
+			{
+				for(t_size j = i; j < M; ++j)
+				{
+					const t_cplx elem_ij = tl2::inner<t_vec>(HV[i], W[j]);
+					const t_cplx elem_ji = tl2::inner<t_vec>(HV[j], W[i]);
+					P(i, j) = (elem_ij + std::conj(elem_ji)) * t_real(0.5);
+					P(j, i) = std::conj(P(i, j));
+				}
+			}
+
+			const auto [ritz_ok, thetas, ritz_vecs] =
+				tl2_la::eigenvec<t_mat, t_vec, t_cplx, t_real>(P, false, true, true);
+			if(!ritz_ok)
+			{
+				using namespace tl2_ops;
+				std::cerr << "Warning: Ritz value calculation failed at Q = "
+					<< Qvec << "." << std::endl;
+				return {};
+			}
+
+			// keep converged eigenpairs
+			modes.clear();
+			for(t_size ritz_idx = 0; ritz_idx < thetas.size(); ++ritz_idx)
+			{
+				const t_real theta = thetas[ritz_idx].real();
+				const t_real inv_E = use_window ? inv_shift + t_real(1) / theta : theta;
+				if(std::abs(theta) <= std::numeric_limits<t_real>::epsilon() ||
+					std::abs(inv_E) <= std::numeric_limits<t_real>::epsilon())
+					continue;
+
+				t_vec x = tl2::zero<t_vec>(dim);
+				t_vec Wx = tl2::zero<t_vec>(dim);
+				for(t_size j = 0; j < M; ++j)
+				{
+					x += V[j] * ritz_vecs[ritz_idx][j];
+					Wx += W[j] * ritz_vecs[ritz_idx][j];
+				}
+
+				// residual in the norm given by H
+				const t_vec residual_vec = Wx - x*theta;
+				const t_real residual = std::sqrt(std::abs(
+					tl2::inner<t_vec>(residual_vec, H * residual_vec).real()));
+				if(residual > m_sparse_tol * std::abs(theta) && can_expand)
+					continue;
+
+				modes.emplace_back(t_Ritz{
+					.E = t_real(1) / inv_E,
+					.theta = std::abs(theta), .x = std::move(x) });
+			}
+
+			// sort by distance to the shift
+			std::stable_sort(modes.begin(), modes.end(),
+				[](const t_Ritz& mode1, const t_Ritz& mode2) -> bool
+			{
+				return mode1.theta > mode2.theta;
+			});
+
+			if(use_window)
+			{
+				// all converged modes inside the window? -> there might be more
+				const bool all_inside = std::all_of(modes.begin(), modes.end(),
+					[this](const t_Ritz& mode) -> bool
+				{
+					return mode.E >= m_sparse_E_min && mode.E <= m_sparse_E_max;
+				});
+
+				if(all_inside && can_expand)
+				{
+					subspace_dim = std::min<t_size>(subspace_dim*2, dim);
+					continue;
+				}
+
+				modes.erase(std::remove_if(modes.begin(), modes.end(),
+					[this](const t_Ritz& mode) -> bool
+				{
+					return mode.E < m_sparse_E_min || mode.E > m_sparse_E_max;
+				}), modes.end());
+				break;
+			}
+			else
+			{
+				if(modes.size() < num_requested && can_expand)
+				{
+					subspace_dim = std::min<t_size>(subspace_dim*3/2 + block_size, dim);
+					continue;
+				}
+
+				if(modes.size() > num_requested)
+					modes.resize(num_requested);
+				break;
+			}
+		}
+
+		if(!pos_def)
+			return calc_dense();
+
+		if(!solver_ok)
+			++m_sparse_stats.unconverged;
+
+		// descending energies, as in the full calculation
+		std::stable_sort(modes.begin(), modes.end(),
+			[](const t_Ritz& mode1, const t_Ritz& mode2) -> bool
+		{
+			return mode1.E > mode2.E;
+		});
+
+		std::vector<EnergyAndWeight> energies_and_correlations;
+		energies_and_correlations.reserve(modes.size());
+		for(const t_Ritz& mode : modes)
+			energies_and_correlations.emplace_back(EnergyAndWeight{ .E = mode.E });
+
+		if(only_energies)
+			return energies_and_correlations;
+
+		// factors of the matrices in equation (44) from (Toth 2015):
+		// M_xy = left_x * right_y^T, see CalcCorrelationsFromHamiltonian()
+		std::array<t_vec, 3> left, right;
+		for(std::uint8_t x_idx = 0; x_idx < 3; ++x_idx)
+		{
+			left[x_idx] = tl2::create<t_vec>(dim);
+			right[x_idx] = tl2::create<t_vec>(dim);
+
+			for(t_size i = 0; i < N; ++i)
+			{
+				const MagneticSite& s_i = GetMagneticSite(i);
+				const t_cplx phase = std::exp(m_phase_sign * s_imag * s_twopi *
+					tl2::inner<t_vec_real>(s_i.pos_calc, Qvec));
+				const t_real S_mag = 2. * std::sqrt(s_i.spin_mag_calc);
+
+				left[x_idx][i]      = phase * S_mag * s_i.spin_ortho_calc[x_idx];
+				left[x_idx][N + i]  = phase * S_mag * s_i.spin_ortho_conj_calc[x_idx];
+				right[x_idx][i]     = std::conj(phase) * S_mag * s_i.spin_ortho_conj_calc[x_idx];
+				right[x_idx][N + i] = std::conj(phase) * S_mag * s_i.spin_ortho_calc[x_idx];
+			}
+		}
+
+		for(t_size mode_idx = 0; mode_idx < modes.size(); ++mode_idx)
+		{
+			// paraunitary normalisation of the eigenvector, see p. 5 in (Toth 2015)
+			const t_vec& x = modes[mode_idx].x;
+			const t_real g_norm = std::abs(tl2::inner<t_vec>(x, apply_g(x)).real());
+			const t_vec trafo = x / std::sqrt(g_norm);
+
+			EnergyAndWeight& EandS = energies_and_correlations[mode_idx];
+			EandS.S = tl2::zero<t_mat>(3, 3);
+			EandS.S_perp = tl2::zero<t_mat>(3, 3);
+
+			// equation (47) from (Toth 2015)
+			for(std::uint8_t x_idx = 0; x_idx < 3; ++x_idx)
+			for(std::uint8_t y_idx = 0; y_idx < 3; ++y_idx)
+			{
+				EandS.S(x_idx, y_idx) =
+					tl2::inner<t_vec>(trafo, left[x_idx]) *
+					tl2::inner_noconj<t_vec>(right[y_idx], trafo) / t_real(2*N);
+			}
+		}
+
+		return energies_and_correlations;
+	}
+	// --------------------------------------------------------------------
+
+
+
+	// --------------------------------------------------------------------
+	// density of states and thermodynamics
+	// --------------------------------------------------------------------
+	/**
+	 * create a Monkhorst-Pack grid spanning one reciprocal unit cell
+	 * and reduce it to its irreducible points using the given symops
+	 * @note the symops have to be the ones of the magnetic structure,
+	 *       e.g. the ones also used in SymmetriseMagneticSites()
+	 * @see https://doi.org/10.1103/PhysRevB.13.5188
+	 */
+	MomentumGrid CalcMomentumGrid(t_size num_h, t_size num_k, t_size num_l,
+		const std::vector<t_mat_real>& symops = {}) const
+	{
+		MomentumGrid grid;
+		grid.num_pts = {{ std::max<t_size>(num_h, 1),
+			std::max<t_size>(num_k, 1), std::max<t_size>(num_l, 1) }};
+
+		const t_size num_total = grid.num_pts[0] * grid.num_pts[1] * grid.num_pts[2];
+		const t_size invalid_idx = num_total;
+		grid.irred_idx.resize(num_total, invalid_idx);
+
+		// momentum coordinate of a grid index
+		auto get_Q = [&grid](t_size idx, t_size axis) -> t_real
+		{
+			const t_real n = t_real(grid.num_pts[axis]);
+			return (t_real(2*idx + 1) - n) / (t_real(2) * n);
+		};
+
+		// grid index of a momentum coordinate, if it lies on the grid
+		auto get_idx = [&grid, this](t_real Q, t_size axis) -> std::optional<t_size>
+		{
+			const t_real n = t_real(grid.num_pts[axis]);
+			const t_real idx = (t_real(2) * n * Q + n - t_real(1)) / t_real(2);
+			const t_real idx_round = std::round(idx);
+			if(!tl2::equals<t_real>(idx, idx_round, m_eps*n))
+				return std::nullopt;
+
+			// wrap back into the grid
+			long long idx_wrapped = static_cast<long long>(idx_round)
+				% static_cast<long long>(grid.num_pts[axis]);
+			if(idx_wrapped < 0)
+				idx_wrapped += static_cast<long long>(grid.num_pts[axis]);
+			return static_cast<t_size>(idx_wrapped);
+		};
+
+		// momentum transformations, Q' = (R^-1)^T Q
+		std::vector<t_mat_real> Q_ops;
+		Q_ops.reserve(symops.size());
+		for(const t_mat_real& op : symops)
+		{
+			const t_mat_real R = tl2::submat<t_mat_real>(op, 0, 0, 3, 3);
+			const auto [R_inv, inv_ok] = tl2::inv<t_mat_real>(R);
+			if(!inv_ok)
+				continue;
+			Q_ops.emplace_back(tl2::trans<t_mat_real>(R_inv));
+		}
+
+		for(t_size h_idx = 0; h_idx < grid.num_pts[0]; ++h_idx)
+		for(t_size k_idx = 0; k_idx < grid.num_pts[1]; ++k_idx)
+		for(t_size l_idx = 0; l_idx < grid.num_pts[2]; ++l_idx)
+		{
+			const t_size idx = (h_idx*grid.num_pts[1] + k_idx)*grid.num_pts[2] + l_idx;
+			if(grid.irred_idx[idx] != invalid_idx)
+				continue;
+
+			// new irreducible point
+			const t_size new_irred_idx = grid.Qs.size();
+			const t_vec_real Q = tl2::create<t_vec_real>({
+				get_Q(h_idx, 0), get_Q(k_idx, 1), get_Q(l_idx, 2) });
+
+			grid.Qs.push_back(Q);
+			grid.multiplicities.push_back(1);
+			grid.irred_idx[idx] = new_irred_idx;
+
+			// mark all symmetry-equivalent grid points
+			for(const t_mat_real& Q_op : Q_ops)
+			{
+				const t_vec_real Q_equiv = Q_op * Q;
+				const auto h_equiv = get_idx(Q_equiv[0], 0);
+				const auto k_equiv = get_idx(Q_equiv[1], 1);
+				const auto l_equiv = get_idx(Q_equiv[2], 2);
+				if(!h_equiv || !k_equiv || !l_equiv)
+					continue;  // symop is not compatible with the grid
+
+				const t_size idx_equiv = (*h_equiv*grid.num_pts[1]
+					+ *k_equiv)*grid.num_pts[2] + *l_equiv;
+				if(grid.irred_idx[idx_equiv] != invalid_idx)
+					continue;
+
+				grid.irred_idx[idx_equiv] = new_irred_idx;
+				++grid.multiplicities[new_irred_idx];
+			}
+		}
+
+		return grid;
+	}
+
+
+
+	/**
+	 * calculate the magnon creation energies at the irreducible points of a momentum grid
+	 * @returns energies in ascending order, the same number of branches for each momentum
+	 */
+	std::vector<std::vector<t_real>> CalcGridEnergies(const MomentumGrid& grid,
+		unsigned int num_threads = 0, std::function<bool(t_size, t_size)> progress = nullptr) const
+	{
+		const t_size num_Qs = grid.Qs.size();
+		std::vector<std::vector<t_real>> energies(num_Qs);
+		if(num_Qs == 0)
+			return energies;
+
+		// a degenerate energy has to be counted in each of its branches
+		MagDyn dyn = *this;
+		dyn.SetUniteDegenerateEnergies(false);
+		dyn.ResetSparseStats();
+
+		// the branches of the shifted hamiltonians H(Q +- k) of an incommensurate
+		// structure span the same states when integrating over the whole brillouin zone
+		if(IsIncommensurate())
+			dyn.SetCalcHamiltonian(true, false, false);
+
+		if(num_threads == 0)
+			num_threads = tl2::Scheduler::Get().GetMaxThreads();
+		num_threads = std::min<unsigned int>(num_threads, num_Qs);
+
+		std::atomic<t_size> next_idx{0}, num_done{0};
+		std::atomic<bool> stop{false};
+
+		auto calc_energies = [&dyn, &grid, &energies, &next_idx, &num_done, &stop, num_Qs]()
+		{
+			while(!stop)
+			{
+				const t_size Q_idx = next_idx++;
+				if(Q_idx >= num_Qs)
+					break;
+
+				const auto EandWs = dyn.CalcEnergies(grid.Qs[Q_idx], true);
+
+				std::vector<t_real> Es;
+				Es.reserve(EandWs.size());
+				for(const EnergyAndWeight& EandW : EandWs)
+					Es.push_back(EandW.E);
+
+				// the energies come in pairs of magnon creation and annihilation,
+				// only keep the upper half, i.e. the creation energies
+				std::sort(Es.begin(), Es.end(), std::greater<t_real>());
+				Es.resize(Es.size() / 2);
+				std::reverse(Es.begin(), Es.end());
+
+				energies[Q_idx] = std::move(Es);
+				++num_done;
+			}
+		};
+
+		// the loops run on the process-wide scheduler
+		tl2::TaskGroup tasks;
+		for(unsigned int thread_idx = 0; thread_idx < num_threads; ++thread_idx)
+			tasks.Run(calc_energies);
+
+		if(progress)
+		{
+			// report the progress from the calling thread
+			while(num_done < num_Qs && !stop)
+			{
+				if(!progress(num_done, num_Qs))
+					stop = true;
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			}
+		}
+
+		tasks.Join();
+		m_sparse_stats.Add(dyn.m_sparse_stats);
+
+		if(stop)
+			return {};
+
+		// use the same number of branches everywhere
+		t_size num_branches = std::numeric_limits<t_size>::max();
+		for(const std::vector<t_real>& Es : energies)
+			num_branches = std::min<t_size>(num_branches, Es.size());
+		for(std::vector<t_real>& Es : energies)
+			Es.resize(num_branches);
+
+		return energies;
+	}
+
+
+
+	/**
+	 * get the energy range covered by the grid energies
+	 */
+	static std::tuple<t_real, t_real> GetGridEnergyRange(
+		const std::vector<std::vector<t_real>>& energies)
+	{
+		t_real E_min = std::numeric_limits<t_real>::max();
+		t_real E_max = std::numeric_limits<t_real>::lowest();
+
+		for(const std::vector<t_real>& Es : energies)
+		{
+			for(t_real E : Es)
+			{
+				if(std::isnan(E) || std::isinf(E))
+					continue;
+				E_min = std::min(E_min, E);
+				E_max = std::max(E_max, E);
+			}
+		}
+
+		if(E_min > E_max)
+			return std::make_tuple(t_real(0), t_real(0));
+		return std::make_tuple(E_min, E_max);
+	}
+
+
+
+	/**
+	 * calculate the density of states using the linear tetrahedron method
+	 * @see https://doi.org/10.1103/PhysRevB.49.16223
+	 */
+	DensityOfStates CalcDOSTetrahedron(const MomentumGrid& grid,
+		const std::vector<std::vector<t_real>>& energies,
+		t_real E_min, t_real E_max, t_size num_E) const
+	{
+		DensityOfStates dos = CreateDOSBins(E_min, E_max, num_E);
+		if(energies.size() == 0 || energies.size() != grid.Qs.size())
+			return dos;
+
+		const t_size num_branches = energies[0].size();
+		const t_size num_total = grid.irred_idx.size();
+		const t_real dE = (E_max - E_min) / t_real(num_E);
+
+		// integrated number of states at the bin edges
+		std::vector<t_real> n_edges(num_E + 1, t_real(0));
+		// states lying completely below a bin edge
+		std::vector<t_real> n_steps(num_E + 2, t_real(0));
+
+		// the grid's cubes are split into six tetrahedra each sharing the main diagonal
+		constexpr const t_size tetras[6][4]
+		{
+			{ 0, 1, 3, 7 }, { 0, 1, 5, 7 }, { 0, 2, 3, 7 },
+			{ 0, 2, 6, 7 }, { 0, 4, 5, 7 }, { 0, 4, 6, 7 },
+		};
+		const t_real tetra_weight = t_real(1) / t_real(6 * num_total);
+
+		auto get_grid_idx = [&grid](t_size h_idx, t_size k_idx, t_size l_idx) -> t_size
+		{
+			h_idx %= grid.num_pts[0];
+			k_idx %= grid.num_pts[1];
+			l_idx %= grid.num_pts[2];
+			return (h_idx*grid.num_pts[1] + k_idx)*grid.num_pts[2] + l_idx;
+		};
+
+		for(t_size h_idx = 0; h_idx < grid.num_pts[0]; ++h_idx)
+		for(t_size k_idx = 0; k_idx < grid.num_pts[1]; ++k_idx)
+		for(t_size l_idx = 0; l_idx < grid.num_pts[2]; ++l_idx)
+		{
+			// irreducible indices of the cube corners (with periodic boundaries)
+			t_size corners[8]{};
+			for(t_size corner = 0; corner < 8; ++corner)
+			{
+				corners[corner] = grid.irred_idx[get_grid_idx(
+					h_idx + (corner & 1), k_idx + ((corner >> 1) & 1),
+					l_idx + ((corner >> 2) & 1))];
+			}
+
+			for(t_size branch = 0; branch < num_branches; ++branch)
+			for(const auto& tetra : tetras)
+			{
+				std::array<t_real, 4> Es{};
+				for(t_size vert = 0; vert < 4; ++vert)
+					Es[vert] = energies[corners[tetra[vert]]][branch];
+				std::sort(Es.begin(), Es.end());
+
+				if(std::isnan(Es[0]) || std::isnan(Es[3]) ||
+					std::isinf(Es[0]) || std::isinf(Es[3]))
+					continue;
+
+				// bin edges intersecting the tetrahedron's energy range
+				long long edge_begin = static_cast<long long>(
+					std::ceil((Es[0] - E_min) / dE));
+				long long edge_end = static_cast<long long>(
+					std::floor((Es[3] - E_min) / dE)) + 1;
+				edge_begin = std::clamp<long long>(edge_begin, 0, num_E + 1);
+				edge_end = std::clamp<long long>(edge_end, 0, num_E + 1);
+
+				for(long long edge = edge_begin; edge < edge_end; ++edge)
+				{
+					const t_real E = E_min + t_real(edge)*dE;
+					n_edges[edge] += tetra_weight * IntegratedTetrahedronStates(E, Es);
+				}
+
+				// the tetrahedron is fully occupied for all higher bin edges
+				n_steps[edge_end] += tetra_weight;
+			}
+		}
+
+		// add the fully occupied tetrahedra
+		t_real n_step = t_real(0);
+		for(t_size edge = 0; edge <= num_E; ++edge)
+		{
+			n_step += n_steps[edge];
+			n_edges[edge] += n_step;
+		}
+
+		for(t_size E_idx = 0; E_idx < num_E; ++E_idx)
+		{
+			dos.dos[E_idx] = (n_edges[E_idx + 1] - n_edges[E_idx]) / dE;
+			dos.dos_int[E_idx] = n_edges[E_idx + 1];
+		}
+
+		return dos;
+	}
+
+
+
+	/**
+	 * calculate the density of states by gaussian broadening of the grid energies
+	 */
+	DensityOfStates CalcDOSGaussian(const MomentumGrid& grid,
+		const std::vector<std::vector<t_real>>& energies,
+		t_real E_min, t_real E_max, t_size num_E, t_real sigma) const
+	{
+		DensityOfStates dos = CreateDOSBins(E_min, E_max, num_E);
+		if(energies.size() == 0 || energies.size() != grid.Qs.size() || sigma <= t_real(0))
+			return dos;
+
+		const t_size num_total = grid.irred_idx.size();
+		const t_real dE = (E_max - E_min) / t_real(num_E);
+		const t_real norm = t_real(1) / (sigma * std::sqrt(s_twopi));
+
+		// only evaluate the gaussian within this range
+		const t_real E_range = t_real(5) * sigma;
+
+		for(t_size Q_idx = 0; Q_idx < energies.size(); ++Q_idx)
+		{
+			const t_real weight = t_real(grid.multiplicities[Q_idx]) / t_real(num_total);
+
+			for(t_real E0 : energies[Q_idx])
+			{
+				if(std::isnan(E0) || std::isinf(E0))
+					continue;
+
+				const long long E_begin = std::clamp<long long>(static_cast<long long>(
+					std::floor((E0 - E_range - E_min) / dE)), 0, num_E);
+				const long long E_end = std::clamp<long long>(static_cast<long long>(
+					std::ceil((E0 + E_range - E_min) / dE)) + 1, 0, num_E);
+
+				for(long long E_idx = E_begin; E_idx < E_end; ++E_idx)
+				{
+					const t_real x = (dos.E[E_idx] - E0) / sigma;
+					dos.dos[E_idx] += weight * norm * std::exp(-t_real(0.5) * x*x);
+				}
+			}
+		}
+
+		// integrated number of states
+		t_real n = t_real(0);
+		for(t_size E_idx = 0; E_idx < num_E; ++E_idx)
+		{
+			n += dos.dos[E_idx] * dE;
+			dos.dos_int[E_idx] = n;
+		}
+
+		return dos;
+	}
+
+
+
+	/**
+	 * calculate the density of states on a symmetry-reduced Monkhorst-Pack grid
+	 * @param sigma gaussian broadening, uses the tetrahedron method if sigma <= 0
+	 * @param E_min, E_max energy range, determined automatically if E_min >= E_max
+	 */
+	DensityOfStates CalcDensityOfStates(
+		t_size num_h, t_size num_k, t_size num_l,
+		const std::vector<t_mat_real>& symops = {},
+		t_real E_min = 0., t_real E_max = 0., t_size num_E = 256,
+		t_real sigma = -1., unsigned int num_threads = 0) const
+	{
+		const MomentumGrid grid = CalcMomentumGrid(num_h, num_k, num_l, symops);
+
+		ResetSparseStats();
+		const auto energies = CalcGridEnergies(grid, num_threads);
+		ReportSparseStats();
+
+		if(E_min >= E_max)
+		{
+			std::tie(E_min, E_max) = GetGridEnergyRange(energies);
+
+			// add some margin for the broadening
+			const t_real margin = std::max<t_real>((E_max - E_min) * 0.05,
+				sigma > t_real(0) ? t_real(3)*sigma : m_eps);
+			E_min = std::max<t_real>(t_real(0), E_min - margin);
+			E_max += margin;
+		}
+
+		if(sigma > t_real(0))
+			return CalcDOSGaussian(grid, energies, E_min, E_max, num_E, sigma);
+		return CalcDOSTetrahedron(grid, energies, E_min, E_max, num_E);
+	}
+
+
+
+	/**
+	 * calculate thermodynamic quantities of the non-interacting magnon gas
+	 * by integrating the bose occupation over the density of states
+	 * @note the moment reduction neglects the zero-point fluctuations and the
+	 *       bogoliubov mixing of the modes
+	 */
+	Thermodynamics CalcThermodynamics(const DensityOfStates& dos, t_real T) const
+	{
+		Thermodynamics thermo{ .T = T };
+
+		if(T <= t_real(0) || dos.E.size() < 2)
+			return thermo;
+
+		// boltzmann constant in meV/K
+		constexpr const t_real kB = tl2::kB<t_real> * tl2::kelvin<t_real> / tl2::meV<t_real>;
+
+		const t_real dE = dos.E[1] - dos.E[0];
+		for(t_size E_idx = 0; E_idx < dos.E.size(); ++E_idx)
+		{
+			const t_real E = dos.E[E_idx];
+			if(E < m_bose_cutoff)
+				continue;
+
+			// written in exp(-x) to not overflow at low temperatures
+			const t_real x = E / (kB * T);
+			const t_real exp_mx = std::exp(-x);
+			const t_real one_m_exp_mx = -std::expm1(-x);
+			const t_real n = exp_mx / one_m_exp_mx;
+			const t_real states = dos.dos[E_idx] * dE;
+
+			thermo.magnons += states * n;
+			thermo.energy += states * E * n;
+			thermo.heat_capacity += states * x*x * exp_mx / (one_m_exp_mx*one_m_exp_mx);
+		}
+
+		if(const t_size N = GetMagneticSitesCount(); N > 0)
+			thermo.magnons_per_site = thermo.magnons / t_real(N);
+
+		return thermo;
+	}
+
+
+
+	// --------------------------------------------------------------------
+	// parameter sweeps
+	// --------------------------------------------------------------------
+	/**
+	 * set a model parameter by its name, see t_SweepAxis
+	 * @note the sites and couplings have to be recalculated afterwards
+	 */
+	bool SetSweepParameter(const std::string& name, t_real value)
+	{
+		// field magnitude
+		if(name == "B")
+		{
+			m_field.mag = value;
+			return true;
+		}
+
+		// field vector components
+		if(name == "Bx" || name == "By" || name == "Bz")
+		{
+			t_vec_real B = m_field.dir.size() == 3
+				? m_field.dir * m_field.mag
+				: tl2::zero<t_vec_real>(3);
+			B[name[1] - 'x'] = value;
+
+			const t_real B_mag = tl2::norm<t_vec_real>(B);
+			m_field.mag = B_mag;
+
+			// keep the previous direction for a vanishing field
+			if(!tl2::equals_0<t_real>(B_mag, m_eps))
+				m_field.dir = B / B_mag;
+			return true;
+		}
+
+		// variable
+		auto iter = std::find_if(m_variables.begin(), m_variables.end(),
+			[&name](const Variable& var) -> bool
+		{
+			return var.name == name;
+		});
+
+		if(iter == m_variables.end())
+			return false;
+
+		iter->value = value;
+		return true;
+	}
+
+
+
+	/**
+	 * check if the hamiltonian is positive definite at the given momentum,
+	 * otherwise the assumed ground state is unstable and the spectrum becomes imaginary
+	 * @note uses the cholesky increment as tolerance for goldstone modes
+	 */
+	bool IsStable(const t_vec_real& Qvec) const
+	{
+		auto is_pos_def = [this](const t_vec_real& Q) -> bool
+		{
+			t_mat H = CalcHamiltonian(Q);
+			if(H.size1() == 0 || H.size2() == 0)
+				return false;
+
+			for(t_size i = 0; i < H.size1(); ++i)
+				H(i, i) += m_delta_chol;
+
+			return std::get<0>(tl2_la::chol<t_mat>(H));
+		};
+
+		if(m_calc_H && !is_pos_def(Qvec))
+			return false;
+
+		if(IsIncommensurate())
+		{
+			if(m_calc_Hp && !is_pos_def(Qvec + m_ordering))
+				return false;
+			if(m_calc_Hm && !is_pos_def(Qvec - m_ordering))
+				return false;
+		}
+
+		return true;
+	}
+
+
+
+	/**
+	 * get the momenta along a straight path
+	 */
+	static std::vector<t_vec_real> GetMomentumPath(
+		const t_vec_real& Q_start, const t_vec_real& Q_end, t_size num_Qs)
+	{
+		std::vector<t_vec_real> Qs;
+		Qs.reserve(num_Qs);
+
+		for(t_size Q_idx = 0; Q_idx < num_Qs; ++Q_idx)
+		{
+			const t_real frac = num_Qs > 1 ? t_real(Q_idx) / t_real(num_Qs - 1) : t_real(0);
+			Qs.emplace_back(Q_start + frac*(Q_end - Q_start));
+		}
+
+		return Qs;
+	}
+
+
+
+	/**
+	 * vary the parameters on a regular grid and calculate the ground-state energy,
+	 * the gap, the soft modes and the stability at the given momenta for each point
+	 * @param E_soft energy below which a mode is regarded as soft
+	 * @param keep_energies also return the lowest creation energy for each momentum
+	 * @returns sweep points with the last axis varying fastest
+	 */
+	std::vector<SweepPoint> CalcSweep(const std::vector<SweepAxis>& axes,
+		const std::vector<t_vec_real>& Qs, t_real E_soft = 0.01,
+		bool keep_energies = false, unsigned int num_threads = 0,
+		std::function<bool(t_size, t_size)> progress = nullptr) const
+	{
+		t_size num_pts = axes.size() ? 1 : 0;
+		for(const SweepAxis& axis : axes)
+		{
+			// check if the parameter exists
+			if(MagDyn dyn = *this; !dyn.SetSweepParameter(axis.name, axis.start))
+			{
+				std::cerr << "Error: Unknown sweep parameter \"" << axis.name << "\"." << std::endl;
+				return {};
+			}
+
+			num_pts *= std::max<t_size>(axis.num_pts, 1);
+		}
+
+		if(num_pts == 0)
+			return {};
+
+		std::vector<SweepPoint> results(num_pts);
+		ResetSparseStats();
+
+		if(num_threads == 0)
+			num_threads = tl2::Scheduler::Get().GetMaxThreads();
+		num_threads = std::min<unsigned int>(num_threads, num_pts);
+
+		std::atomic<t_size> next_idx{0}, num_done{0};
+		std::atomic<bool> stop{false};
+
+		auto calc_point = [this, &axes, &Qs, &results, &next_idx, &num_done, &stop,
+			num_pts, E_soft, keep_energies]()
+		{
+			while(!stop)
+			{
+				const t_size pt_idx = next_idx++;
+				if(pt_idx >= num_pts)
+					break;
+
+				SweepPoint& pt = results[pt_idx];
+				pt.values.resize(axes.size());
+
+				// set the parameters of this point, the last axis varies fastest
+				MagDyn dyn = *this;
+				dyn.ResetSparseStats();
+				t_size remaining_idx = pt_idx;
+				for(t_size axis_idx = axes.size(); axis_idx > 0; --axis_idx)
+				{
+					const SweepAxis& axis = axes[axis_idx - 1];
+					const t_size num_axis = std::max<t_size>(axis.num_pts, 1);
+					const t_size idx = remaining_idx % num_axis;
+					remaining_idx /= num_axis;
+
+					const t_real frac = num_axis > 1 ? t_real(idx) / t_real(num_axis - 1) : t_real(0);
+					pt.values[axis_idx - 1] = std::lerp(axis.start, axis.end, frac);
+					dyn.SetSweepParameter(axis.name, pt.values[axis_idx - 1]);
+				}
+
+				dyn.CalcExternalField();
+				dyn.CalcMagneticSites();
+				dyn.CalcExchangeTerms();
+
+				pt.E_ground = dyn.CalcGroundStateEnergy();
+				pt.gap = std::numeric_limits<t_real>::quiet_NaN();
+				if(keep_energies)
+					pt.E_lowest.resize(Qs.size(), std::numeric_limits<t_real>::quiet_NaN());
+
+				for(t_size Q_idx = 0; Q_idx < Qs.size(); ++Q_idx)
+				{
+					const t_vec_real& Q = Qs[Q_idx];
+					if(!dyn.IsStable(Q))
+					{
+						++pt.num_unstable;
+						continue;
+					}
+
+					// the energies come in pairs of magnon creation and annihilation,
+					// the lowest creation energy is the smallest one of the upper half
+					const auto EandWs = dyn.CalcEnergies(Q, true);
+					if(EandWs.size() < 2)
+						continue;
+
+					std::vector<t_real> Es;
+					Es.reserve(EandWs.size());
+					for(const EnergyAndWeight& EandW : EandWs)
+						Es.push_back(EandW.E);
+					std::sort(Es.begin(), Es.end(), std::greater<t_real>());
+					const t_real E_low = Es[Es.size()/2 - 1];
+
+					if(keep_energies)
+						pt.E_lowest[Q_idx] = E_low;
+					if(std::isnan(pt.gap) || E_low < pt.gap)
+					{
+						pt.gap = E_low;
+						pt.Q_gap = Q;
+					}
+					if(std::abs(E_low) <= E_soft)
+						pt.Qs_soft.push_back(Q);
+				}
+
+				m_sparse_stats.Add(dyn.m_sparse_stats);
+				++num_done;
+			}
+		};
+
+		// the loops run on the process-wide scheduler
+		tl2::TaskGroup tasks;
+		for(unsigned int thread_idx = 0; thread_idx < num_threads; ++thread_idx)
+			tasks.Run(calc_point);
+
+		if(progress)
+		{
+			// report the progress from the calling thread
+			while(num_done < num_pts && !stop)
+			{
+				if(!progress(num_done, num_pts))
+					stop = true;
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			}
+		}
+
+		tasks.Join();
+		ReportSparseStats();
+
+		if(stop)
+			return {};
+		return results;
+	}
+
+
+
+	/**
+	 * write the results of a parameter sweep as a gnuplot-compatible map,
+	 * the lowest energies per momentum follow in a second data block if available
+	 */
+	void SaveSweep(std::ostream& ostr, const std::vector<SweepAxis>& axes,
+		const std::vector<SweepPoint>& results,
+		const std::vector<t_vec_real>& Qs = {}) const
+	{
+		ostr.precision(m_prec);
+
+		// number of points of the fastest axis, separated by blank lines in 2d maps
+		const t_size num_inner = axes.size() > 1
+			? std::max<t_size>(axes.back().num_pts, 1) : 0;
+
+		auto write_values = [this, &ostr](const SweepPoint& pt)
+		{
+			for(t_real value : pt.values)
+				ostr << std::setw(m_prec*2) << std::left << value << " ";
+		};
+
+		ostr << "#\n# Parameter sweep: ground-state energy, gap, soft modes and unstable momenta.\n#\n";
+		ostr << "# ";
+		for(const SweepAxis& axis : axes)
+			ostr << std::setw(m_prec*2) << std::left << axis.name << " ";
+		ostr
+			<< std::setw(m_prec*2) << std::left << "E_ground" << " "
+			<< std::setw(m_prec*2) << std::left << "gap" << " "
+			<< std::setw(m_prec*2) << std::left << "h_gap" << " "
+			<< std::setw(m_prec*2) << std::left << "k_gap" << " "
+			<< std::setw(m_prec*2) << std::left << "l_gap" << " "
+			<< std::setw(m_prec*2) << std::left << "soft" << " "
+			<< std::setw(m_prec*2) << std::left << "unstable" << "\n";
+
+		for(t_size pt_idx = 0; pt_idx < results.size(); ++pt_idx)
+		{
+			const SweepPoint& pt = results[pt_idx];
+			if(num_inner && pt_idx && pt_idx % num_inner == 0)
+				ostr << "\n";
+
+			write_values(pt);
+			ostr
+				<< std::setw(m_prec*2) << std::left << pt.E_ground << " "
+				<< std::setw(m_prec*2) << std::left << pt.gap << " ";
+			for(std::uint8_t i = 0; i < 3; ++i)
+			{
+				ostr << std::setw(m_prec*2) << std::left
+					<< (pt.Q_gap.size() == 3 ? pt.Q_gap[i] : std::numeric_limits<t_real>::quiet_NaN())
+					<< " ";
+			}
+			ostr
+				<< std::setw(m_prec*2) << std::left << pt.Qs_soft.size() << " "
+				<< std::setw(m_prec*2) << std::left << pt.num_unstable << "\n";
+		}
+
+		// lowest energy for each parameter and momentum
+		if(!results.size() || results[0].E_lowest.size() != Qs.size() || !Qs.size())
+			return;
+
+		ostr << "\n\n#\n# Lowest creation energy per momentum.\n#\n";
+		ostr << "# ";
+		for(const SweepAxis& axis : axes)
+			ostr << std::setw(m_prec*2) << std::left << axis.name << " ";
+		ostr
+			<< std::setw(m_prec*2) << std::left << "h" << " "
+			<< std::setw(m_prec*2) << std::left << "k" << " "
+			<< std::setw(m_prec*2) << std::left << "l" << " "
+			<< std::setw(m_prec*2) << std::left << "E" << "\n";
+
+		for(const SweepPoint& pt : results)
+		{
+			for(t_size Q_idx = 0; Q_idx < Qs.size(); ++Q_idx)
+			{
+				write_values(pt);
+				for(std::uint8_t i = 0; i < 3; ++i)
+					ostr << std::setw(m_prec*2) << std::left << Qs[Q_idx][i] << " ";
+				ostr << std::setw(m_prec*2) << std::left << pt.E_lowest[Q_idx] << "\n";
+			}
+			ostr << "\n";
+		}
+	}
+	// --------------------------------------------------------------------
+
+
+
+	// --------------------------------------------------------------------
+	// loading and saving
+	// --------------------------------------------------------------------
+	/**
+	 * generates the dispersion plot along the given q path
+	 */
+	void SaveDispersion(const std::string& filename,
+		t_real h_start, t_real k_start, t_real l_start,
+		t_real h_end, t_real k_end, t_real l_end,
+		t_size num_qs = 128) const
+	{
+		std::ofstream ofstr{filename};
+		SaveDispersion(ofstr, h_start, k_start, l_start, h_end, k_end, l_end, num_qs);
+	}
+
+
+
+	/**
+	 * generates the dispersion plot along the given q path
+	 */
+	void SaveDispersion(std::ostream& ostr,
+		t_real h_start, t_real k_start, t_real l_start,
+		t_real h_end, t_real k_end, t_real l_end,
+		t_size num_qs = 128) const
+	{
+		ostr.precision(m_prec);
+
+		ostr
+			<< std::setw(m_prec*2) << std::left << "# h"
+			<< std::setw(m_prec*2) << std::left << "k"
+			<< std::setw(m_prec*2) << std::left << "l"
+			<< std::setw(m_prec*2) << std::left << "E"
+			<< std::setw(m_prec*2) << std::left << "w"
+			<< std::setw(m_prec*2) << std::left << "w_sf1"
+			<< std::setw(m_prec*2) << std::left << "w_sf2"
+			<< std::setw(m_prec*2) << std::left << "w_nsf";
+		if(m_save_branches)
+			ostr << std::setw(m_prec*2) << std::left << "branch";
+		ostr << std::endl;
+
+		// track the branches along the path
+		PathContinuation path;
+		ResetSparseStats();
+
+		for(t_size i = 0; i < num_qs; ++i)
 		{
 			// get Q
 			const t_real h = std::lerp(h_start, h_end, t_real(i)/t_real(num_qs-1));
@@ -2089,7 +3866,8 @@ public:
 			const t_real l = std::lerp(l_start, l_end, t_real(i)/t_real(num_qs-1));
 
 			// get E and S(Q, E)
-			const auto energies_and_correlations = CalcEnergies(h, k, l, false);
+			const auto energies_and_correlations = CalcEnergies(h, k, l, false,
+				m_save_branches ? &path : nullptr);
 			for(const auto& E_and_S : energies_and_correlations)
 			{
 				ostr
@@ -2100,10 +3878,14 @@ public:
 					<< std::setw(m_prec*2) << E_and_S.weight
 					<< std::setw(m_prec*2) << E_and_S.weight_channel[0]
 					<< std::setw(m_prec*2) << E_and_S.weight_channel[1]
-					<< std::setw(m_prec*2) << E_and_S.weight_channel[2]
-					<< std::endl;
+					<< std::setw(m_prec*2) << E_and_S.weight_channel[2];
+				if(m_save_branches)
+					ostr << std::setw(m_prec*2) << E_and_S.branch;
+				ostr << std::endl;
 			}
 		}
+
+		ReportSparseStats();
 	}
 
 
@@ -2518,6 +4300,63 @@ public:
 
 
 protected:
+	/**
+	 * create the energy bins for the density of states
+	 */
+	static DensityOfStates CreateDOSBins(t_real E_min, t_real E_max, t_size num_E)
+	{
+		DensityOfStates dos;
+		dos.E.resize(num_E);
+		dos.dos.resize(num_E, t_real(0));
+		dos.dos_int.resize(num_E, t_real(0));
+
+		const t_real dE = (E_max - E_min) / t_real(num_E);
+		for(t_size E_idx = 0; E_idx < num_E; ++E_idx)
+			dos.E[E_idx] = E_min + (t_real(E_idx) + t_real(0.5))*dE;
+
+		return dos;
+	}
+
+
+
+	/**
+	 * integrated number of states of a single tetrahedron with sorted corner energies
+	 * @see equation (A2) - (A4) in https://doi.org/10.1103/PhysRevB.49.16223
+	 */
+	static t_real IntegratedTetrahedronStates(t_real E, const std::array<t_real, 4>& Es)
+	{
+		const auto [E1, E2, E3, E4] = Es;
+
+		if(E < E1)
+			return t_real(0);
+
+		if(E < E2)
+		{
+			return std::pow(E - E1, t_real(3)) /
+				((E2 - E1) * (E3 - E1) * (E4 - E1));
+		}
+
+		if(E < E3)
+		{
+			const t_real E21 = E2 - E1, E31 = E3 - E1, E41 = E4 - E1;
+			const t_real E32 = E3 - E2, E42 = E4 - E2;
+			const t_real dE = E - E2;
+
+			return (E21*E21 + t_real(3)*E21*dE + t_real(3)*dE*dE
+				- (E31 + E42) / (E32 * E42) * dE*dE*dE) / (E31 * E41);
+		}
+
+		if(E < E4)
+		{
+			return t_real(1) - std::pow(E4 - E, t_real(3)) /
+				((E4 - E1) * (E4 - E2) * (E4 - E3));
+		}
+
+		return t_real(1);
+	}
+
+
+
 	/**
 	 * converts the rotation matrix rotating the local spins to ferromagnetic
 	 * [001] directions into the vectors comprised of the matrix columns
@@ -2598,6 +4437,18 @@ private:
 	t_size m_tries_chol{ 50 };
 	t_real m_delta_chol{ 0.0025 };
 
+	// settings for the sparse solver (0 modes and no energy window: use the dense solver)
+	t_size m_sparse_modes{ 0 };
+	t_real m_sparse_E_min{ 0. }, m_sparse_E_max{ 0. };
+	t_real m_sparse_tol{ 1e-6 };
+	t_size m_sparse_max_iter{ 5000 };
+	t_size m_sparse_block{ 4 };
+	t_size m_sparse_check_iter{ 64 };  // lanczos steps to check if the hamiltonian is positive definite
+	mutable SparseStats m_sparse_stats{};
+
+	// write the branch indices in SaveDispersion()
+	bool m_save_branches{ false };
+
 	// precisions
 	t_real m_eps{ 1e-6 };
 	int m_prec{ 6 };
@@ -0,0 +1,506 @@
+/**
+ * tlibs2 -- process-wide task scheduler
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @note Forked on 7-Nov-2018 from my privately and TUM-PhD-developed "tlibs" project (https://github.com/t-weber/tlibs).
+ * @license GPLv3, see 'LICENSE' file
+ * @desc see, e.g, (Williams 2012), pp. 273-299
+ *
+ * ----------------------------------------------------------------------------
+ * tlibs
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2015-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __TLIBS2_THREAD_H__
+#define __TLIBS2_THREAD_H__
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <array>
+#include <functional>
+#include <algorithm>
+#include <memory>
+#include <new>
+
+#ifndef __MINGW32__
+	#include <pthread.h>
+#endif
+
+
+namespace tl2 {
+
+
+enum class TaskPriority : int
+{
+	LOW = 0,
+	NORMAL = 1,
+	HIGH = 2,
+};
+
+
+/**
+ * process-wide, persistent work-stealing scheduler
+ *
+ * each worker thread has its own task deques (one per priority), it takes its own tasks
+ * from the back and steals from the front of the other workers' deques.
+ * threads waiting for nested tasks help by running queued tasks, so nested
+ * fork/join parallelism neither deadlocks nor creates additional threads.
+ */
+class Scheduler
+{
+public:
+	using t_task = std::function<void()>;
+	static constexpr int NUM_PRIOS = 3;
+	static constexpr unsigned int MIN_QUEUES = 64;
+
+
+protected:
+	struct Queue
+	{
+		std::mutex mtx{};
+		std::array<std::deque<t_task>, NUM_PRIOS> tasks{};
+	};
+
+	// one queue per possible worker
+	std::vector<std::unique_ptr<Queue>> m_queues{};
+
+	// allocated on the heap, a forked child must not join them
+	std::vector<std::thread*> m_threads{};
+	std::atomic<unsigned int> m_num_threads{0};
+	std::mutex m_mtx_threads{};
+
+	std::mutex m_mtx_wait{};
+	std::condition_variable m_cv_wait{}, m_cv_park{};
+	std::array<std::atomic<std::size_t>, NUM_PRIOS> m_num_queued{};
+	std::atomic<std::size_t> m_next_queue{0};
+
+	// number of active workers
+	std::atomic<unsigned int> m_max_threads{1};
+	bool m_stop{false};
+
+
+protected:
+	// index of the worker running in the current thread, -1 for other threads
+	static int& worker_index()
+	{
+		static thread_local int worker = -1;
+		return worker;
+	}
+
+
+	bool PopTask(std::size_t queue_idx, int prio, t_task& task, bool back)
+	{
+		Queue& queue = *m_queues[queue_idx];
+		std::lock_guard<std::mutex> _lck{queue.mtx};
+		std::deque<t_task>& tasks = queue.tasks[prio];
+		if(tasks.empty())
+			return false;
+
+		if(back)
+		{
+			task = std::move(tasks.back());
+			tasks.pop_back();
+		}
+		else
+		{
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+
+		--m_num_queued[prio];
+		return true;
+	}
+
+
+	/**
+	 * get the next task, high priorities first, own tasks before stolen ones
+	 */
+	bool GetTask(t_task& task, int min_prio = 0)
+	{
+		const int worker = worker_index();
+		const std::size_t num_queues = std::max(1u, m_num_threads.load());
+		const std::size_t start = (worker >= 0 ? std::size_t(worker) + 1 : 0);
+
+		for(int prio = NUM_PRIOS - 1; prio >= min_prio; --prio)
+		{
+			if(m_num_queued[prio] == 0)
+				continue;
+
+			if(worker >= 0 && PopTask(std::size_t(worker), prio, task, true))
+				return true;
+
+			for(std::size_t i = 0; i < num_queues; ++i)
+			{
+				const std::size_t queue_idx = (start + i) % num_queues;
+				if(int(queue_idx) == worker)
+					continue;
+				if(PopTask(queue_idx, prio, task, false))
+					return true;
+			}
+		}
+
+		return false;
+	}
+
+
+	bool HasTasks() const
+	{
+		return std::any_of(m_num_queued.begin(), m_num_queued.end(),
+			[](const std::atomic<std::size_t>& num) -> bool { return num > 0; });
+	}
+
+
+	void WorkerProc(unsigned int worker)
+	{
+		worker_index() = int(worker);
+
+		while(true)
+		{
+			// workers beyond the current limit are parked
+			if(worker >= m_max_threads)
+			{
+				std::unique_lock<std::mutex> lock{m_mtx_wait};
+				m_cv_park.wait(lock, [this, worker]() -> bool
+				{
+					return m_stop || worker < m_max_threads;
+				});
+
+				if(m_stop)
+					break;
+				continue;
+			}
+
+			t_task task;
+			if(GetTask(task))
+			{
+				task();
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock{m_mtx_wait};
+			m_cv_wait.wait(lock, [this, worker]() -> bool
+			{
+				return m_stop || HasTasks() || worker >= m_max_threads;
+			});
+
+			if(m_stop)
+				break;
+		}
+	}
+
+
+	/**
+	 * start the workers up to the current limit
+	 */
+	void StartThreads()
+	{
+		if(m_num_threads >= m_max_threads)
+			return;
+
+		std::lock_guard<std::mutex> _lck{m_mtx_threads};
+		while(m_num_threads < m_max_threads)
+		{
+			m_threads.push_back(new std::thread(&Scheduler::WorkerProc, this, m_num_threads.load()));
+			++m_num_threads;
+		}
+	}
+
+
+#ifndef __MINGW32__
+	/**
+	 * only the forking thread exists in the child, drop the parent's workers and tasks
+	 */
+	static void ForkChild()
+	{
+		Scheduler& sched = Get();
+
+		// the other threads may have held the locks, so nothing is freed or unlocked
+		new(&sched.m_mtx_threads) std::mutex();
+		new(&sched.m_mtx_wait) std::mutex();
+		new(&sched.m_cv_wait) std::condition_variable();
+		new(&sched.m_cv_park) std::condition_variable();
+		new(&sched.m_threads) std::vector<std::thread*>();
+		sched.m_num_threads = 0;
+
+		for(std::unique_ptr<Queue>& queue : sched.m_queues)
+		{
+			queue.release();
+			queue.reset(new Queue());
+		}
+
+		for(std::atomic<std::size_t>& num : sched.m_num_queued)
+			num = 0;
+	}
+#endif
+
+
+public:
+	Scheduler(unsigned int max_threads = std::thread::hardware_concurrency())
+	{
+		const unsigned int num_queues = std::max(MIN_QUEUES, std::thread::hardware_concurrency());
+		m_queues.reserve(num_queues);
+		for(unsigned int queue_idx = 0; queue_idx < num_queues; ++queue_idx)
+			m_queues.emplace_back(std::make_unique<Queue>());
+
+		SetMaxThreads(max_threads);
+	}
+
+
+	~Scheduler()
+	{
+		{
+			std::lock_guard<std::mutex> _lck{m_mtx_wait};
+			m_stop = true;
+		}
+		m_cv_wait.notify_all();
+		m_cv_park.notify_all();
+
+		// queued tasks are discarded, running ones are finished
+		std::lock_guard<std::mutex> _lck{m_mtx_threads};
+		for(std::thread* thread : m_threads)
+		{
+			if(thread->joinable())
+				thread->join();
+			delete thread;
+		}
+		m_threads.clear();
+	}
+
+
+	Scheduler(const Scheduler&) = delete;
+	const Scheduler& operator=(const Scheduler&) = delete;
+
+
+	/**
+	 * the scheduler of the process
+	 */
+	static Scheduler& Get()
+	{
+		static Scheduler sched{};
+
+#ifndef __MINGW32__
+		[[maybe_unused]] static const int fork_handler =
+			pthread_atfork(nullptr, nullptr, &Scheduler::ForkChild);
+#endif
+
+		return sched;
+	}
+
+
+	/**
+	 * is the current thread one of the workers?
+	 */
+	static bool IsWorker()
+	{
+		return worker_index() >= 0;
+	}
+
+
+	/**
+	 * set the number of worker threads, this is the concurrency limit of the process
+	 */
+	void SetMaxThreads(unsigned int max_threads)
+	{
+		max_threads = std::clamp<unsigned int>(max_threads, 1, m_queues.size());
+		if(max_threads == m_max_threads)
+			return;
+
+		{
+			std::lock_guard<std::mutex> _lck{m_mtx_wait};
+			m_max_threads = max_threads;
+		}
+		m_cv_wait.notify_all();
+		m_cv_park.notify_all();
+
+		// otherwise the workers are started with the first task
+		if(m_num_threads)
+			StartThreads();
+	}
+
+
+	unsigned int GetMaxThreads() const
+	{
+		return m_max_threads;
+	}
+
+
+	/**
+	 * enqueue a task, tasks from a worker go to its own queue,
+	 * the task must not throw
+	 */
+	void Push(t_task&& task, TaskPriority prio = TaskPriority::NORMAL)
+	{
+		StartThreads();
+
+		const int prio_idx = int(prio);
+		const int worker = worker_index();
+		const std::size_t queue_idx = worker >= 0 ? std::size_t(worker)
+			: (m_next_queue++ % m_max_threads);
+
+		{
+			Queue& queue = *m_queues[queue_idx];
+			std::lock_guard<std::mutex> _lck{queue.mtx};
+			queue.tasks[prio_idx].push_back(std::move(task));
+		}
+
+		{
+			std::lock_guard<std::mutex> _lck{m_mtx_wait};
+			++m_num_queued[prio_idx];
+		}
+		m_cv_wait.notify_one();
+	}
+
+
+	/**
+	 * run a queued task with at least the given priority in the calling thread
+	 */
+	bool RunTask(TaskPriority min_prio = TaskPriority::LOW)
+	{
+		t_task task;
+		if(!GetTask(task, int(min_prio)))
+			return false;
+
+		task();
+		return true;
+	}
+
+
+	/**
+	 * run queued tasks in the calling thread until the predicate is fulfilled,
+	 * the predicate is also checked when cv is notified.
+	 * only tasks with at least the given priority are run, so that a waiting
+	 * task doesn't recursively pick up the (less important) outer tasks.
+	 */
+	template<class t_pred>
+	void HelpUntil(t_pred pred, std::mutex& mtx, std::condition_variable& cv,
+		TaskPriority min_prio = TaskPriority::LOW)
+	{
+		while(!pred())
+		{
+			if(RunTask(min_prio))
+				continue;
+
+			std::unique_lock<std::mutex> lock{mtx};
+			cv.wait_for(lock, std::chrono::milliseconds(1), pred);
+		}
+	}
+};
+
+
+
+/**
+ * group of tasks running on the process-wide scheduler
+ */
+class TaskGroup
+{
+protected:
+	Scheduler& m_sched{Scheduler::Get()};
+	TaskPriority m_prio{TaskPriority::NORMAL};
+
+	std::mutex m_mtx{};
+	std::condition_variable m_cv_done{};
+
+	std::atomic<std::size_t> m_num_pending{0};
+	std::atomic<bool> m_cancelled{false};
+
+
+public:
+	/**
+	 * nested groups, i.e. ones created by a task, get a higher priority to finish first
+	 */
+	TaskGroup(TaskPriority prio = Scheduler::IsWorker() ? TaskPriority::HIGH : TaskPriority::NORMAL)
+		: m_prio{prio}
+	{}
+
+
+	~TaskGroup()
+	{
+		Join();
+	}
+
+
+	TaskGroup(const TaskGroup&) = delete;
+	const TaskGroup& operator=(const TaskGroup&) = delete;
+
+
+	/**
+	 * run a task on the scheduler, it is skipped if the group has been cancelled before it starts
+	 */
+	void Run(std::function<void()> task)
+	{
+		if(m_cancelled)
+			return;
+
+		++m_num_pending;
+		m_sched.Push([this, task = std::move(task)]()
+		{
+			if(!m_cancelled)
+				task();
+
+			std::lock_guard<std::mutex> _lck{m_mtx};
+			if(--m_num_pending == 0)
+				m_cv_done.notify_all();
+		}, m_prio);
+	}
+
+
+	/**
+	 * wait for all tasks to be finished, workers help to run them meanwhile
+	 */
+	void Join()
+	{
+		if(Scheduler::IsWorker())
+		{
+			m_sched.HelpUntil([this]() -> bool { return m_num_pending == 0; },
+				m_mtx, m_cv_done, m_prio);
+
+			// wait for the last task to release the lock
+			std::lock_guard<std::mutex> _lck{m_mtx};
+		}
+		else
+		{
+			std::unique_lock<std::mutex> lock{m_mtx};
+			m_cv_done.wait(lock, [this]() -> bool { return m_num_pending == 0; });
+		}
+	}
+
+
+	/**
+	 * don't start any more tasks
+	 */
+	void Cancel()
+	{
+		m_cancelled = true;
+	}
+
+
+	bool IsCancelled() const
+	{
+		return m_cancelled;
+	}
+};
+
+
+}
+#endif
@@ -45,8 +45,26 @@ t_astret LLAsm::visit(const ASTStmts* ast)
 {
 	t_astret lastres = nullptr;
 
-	for(const auto& stmt : ast->GetStatementList())
-		lastres = stmt->accept(this);
+	const auto& stmts = ast->GetStatementList();
+	for(auto iter = stmts.begin(); iter != stmts.end(); ++iter)
+	{
+		lastres = (*iter)->accept(this);
+
+		// the last statement of a function body is its implicit return value
+		if(std::next(iter) == stmts.end() && !m_funcstack.empty())
+		{
+			const ASTFunc* func = m_funcstack.top().func;
+			if(func->GetStatements().get() == ast && std::get<0>(func->GetRetType()) == SymbolType::COMP)
+				continue;
+		}
+
+		// release the memory block of a discarded multi-return function call
+		if(auto iterMark = m_heapmarks.find(lastres); iterMark != m_heapmarks.end())
+		{
+			(*m_ostr) << "call void @ext_heap_release(i64 %" << iterMark->second->name << ")\n";
+			m_heapmarks.erase(iterMark);
+		}
+	}
 
 	return lastres;
 }
@@ -591,7 +609,7 @@ bool LLAsm::check_sym_compat(
 /**
  * product between a scalar and a matrix (or vector)
  */
-t_astret LLAsm::scalar_matrix_prod(t_astret scalar, t_astret matrix, bool mul_or_div)
+t_astret LLAsm::scalar_matrix_prod(t_astret scalar, t_astret matrix, bool mul_or_div, t_astret dest)
 {
 	scalar = convert_sym(scalar, SymbolType::SCALAR);
 
@@ -599,9 +617,8 @@ t_astret LLAsm::scalar_matrix_prod(t_astret scalar, t_astret matrix, bool mul_or
 	if(matrix->ty == SymbolType::MATRIX)
 		dim *= std::get<1>(matrix->dims);
 
-	// allocate double array for result
-	t_astret vec_mem = get_tmp_var(matrix->ty, &matrix->dims);
-	(*m_ostr) << "%" << vec_mem->name << " = alloca [" << dim << " x double]\n";
+	// element-wise operation, so the result can also overwrite the matrix
+	t_astret vec_mem = get_array_mem(matrix->ty, matrix->dims, dest);
 
 	// copy matrix elements in a loop
 	generate_loop(0, dim, [this, dim, matrix, scalar, vec_mem, mul_or_div](t_astret ctrval)
@@ -639,6 +656,50 @@ t_astret LLAsm::scalar_matrix_prod(t_astret scalar, t_astret matrix, bool mul_or
 }
 
 
+/**
+ * get (and reset) the destination variable of the current assignment,
+ * this has to be called before visiting the operands, which must not use it
+ */
+t_astret LLAsm::take_dest()
+{
+	t_astret dest = m_dest;
+	m_dest = nullptr;
+	return dest;
+}
+
+
+/**
+ * get the memory for an array result, this is the assignment's destination
+ * if its old value is not needed anymore, otherwise a new stack array
+ */
+t_astret LLAsm::get_array_mem(SymbolType ty, const std::array<std::size_t, 2>& dims,
+	t_astret dest, std::initializer_list<t_astret> operands)
+{
+	bool use_dest = dest && dest->ty == ty
+		&& std::get<0>(dest->dims) == std::get<0>(dims)
+		&& (ty != SymbolType::MATRIX || std::get<1>(dest->dims) == std::get<1>(dims));
+
+	// the destination is still needed if it is an operand
+	for(t_astret operand : operands)
+	{
+		if(operand == dest)
+			use_dest = false;
+	}
+
+	if(use_dest)
+		return dest;
+
+	// allocate double array for result
+	std::size_t dim = std::get<0>(dims);
+	if(ty == SymbolType::MATRIX)
+		dim *= std::get<1>(dims);
+
+	t_astret mem = get_tmp_var(ty, &dims);
+	(*m_ostr) << "%" << mem->name << " = alloca [" << dim << " x double]\n";
+	return mem;
+}
+
+
 /**
  * copy the memory of a compound symbol
  */
@@ -42,6 +42,8 @@
 #include <stack>
 #include <optional>
 #include <functional>
+#include <unordered_map>
+#include <initializer_list>
 
 
 /**
@@ -204,6 +206,18 @@ protected:
 	t_astret cp_mem_vec(t_astret mem, t_astret sym, bool alloc_sym=true);
 	t_astret cp_mem_str(t_astret mem, t_astret sym, bool alloc_sym=true);
 
+	/**
+	 * get (and reset) the destination variable of the current assignment
+	 */
+	t_astret take_dest();
+
+	/**
+	 * get the memory for an array result: the assignment's destination if it
+	 * is not read by any of the given operands, otherwise a new stack array
+	 */
+	t_astret get_array_mem(SymbolType ty, const std::array<std::size_t, 2>& dims,
+		t_astret dest = nullptr, std::initializer_list<t_astret> operands = {});
+
 
 private:
 	std::size_t m_varCount = 0; 	// # of tmp vars
@@ -215,8 +229,14 @@ private:
 
 	std::ostream* m_ostr = &std::cout;
 
+	// destination of an array assignment, the result of its operation can be written directly into it
+	t_astret m_dest = nullptr;
+
+	// arena marks for the memory blocks of multi-return function calls
+	std::unordered_map<t_astret, t_astret> m_heapmarks{};
+
 	// helper functions to reduce code redundancy
-	t_astret scalar_matrix_prod(t_astret scalar, t_astret matrix, bool mul_or_div=1);
+	t_astret scalar_matrix_prod(t_astret scalar, t_astret matrix, bool mul_or_div=1, t_astret dest=nullptr);
 
 	// TODO: nested functions
 	std::stack<Func> m_funcstack;
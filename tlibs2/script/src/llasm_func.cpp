@@ -119,6 +119,16 @@ t_astret LLAsm::visit(const ASTCall* ast)
 	t_astret retvar = get_tmp_var(func->retty, &func->retdims);
 	std::string retty = LLAsm::get_type_name(func->retty);
 
+	// returned arrays and strings escape from the function and are allocated in the arena,
+	// remember its state to release everything allocated during the call afterwards
+	t_astret heapmark = nullptr;
+	if(func->retty == SymbolType::STRING || func->retty == SymbolType::VECTOR
+		|| func->retty == SymbolType::MATRIX || func->retty == SymbolType::COMP)
+	{
+		heapmark = get_tmp_var(SymbolType::INT);
+		(*m_ostr) << "%" << heapmark->name << " = call i64 @ext_heap_mark()\n";
+	}
+
 	// call function
 	if(func->retty != SymbolType::VOID)
 		(*m_ostr) << "%" << retvar->name << " = ";
@@ -139,8 +149,8 @@ t_astret LLAsm::visit(const ASTCall* ast)
 		t_astret symcpy = get_tmp_var(func->retty, &func->retdims);
 		retvar = cp_mem_str(retvar, symcpy, true);
 
-		// free heap return value (TODO: check if it really is on the heap)
-		(*m_ostr) << "call void @ext_heap_free(i8* %" << retvar->name << ")\n";
+		// release the returned string
+		(*m_ostr) << "call void @ext_heap_release(i64 %" << heapmark->name << ")\n";
 	}
 
 	// allocate memory for local array copy
@@ -153,8 +163,8 @@ t_astret LLAsm::visit(const ASTCall* ast)
 		t_astret symcpy = get_tmp_var(func->retty, &func->retdims);
 		retvar = cp_mem_vec(memcast, symcpy, true);
 
-		// free heap return value (TODO: check if it really is on the heap)
-		(*m_ostr) << "call void @ext_heap_free(i8* %" << memcast->name << ")\n";
+		// release the returned array
+		(*m_ostr) << "call void @ext_heap_release(i64 %" << heapmark->name << ")\n";
 	}
 
 	// multiple return values
@@ -162,6 +172,9 @@ t_astret LLAsm::visit(const ASTCall* ast)
 	{
 		// copy multi-return types
 		const_cast<Symbol*>(retvar)->elems = func->elems;
+
+		// the memory block is released after the multi-assignment
+		m_heapmarks[retvar] = heapmark;
 	}
 
 	return retvar;
@@ -39,6 +39,7 @@
 
 t_astret LLAsm::visit(const ASTUMinus* ast)
 {
+	t_astret dest = take_dest();
 	t_astret term = ast->GetTerm()->accept(this);
 	t_astret var = get_tmp_var(term->ty, &term->dims);
 
@@ -49,9 +50,8 @@ t_astret LLAsm::visit(const ASTUMinus* ast)
 		if(term->ty == SymbolType::MATRIX)
 			dim *= std::get<1>(term->dims);
 
-		// allocate double array for result
-		t_astret vec_mem = get_tmp_var(term->ty, &term->dims);
-		(*m_ostr) << "%" << vec_mem->name << " = alloca [" << dim << " x double]\n";
+		// element-wise operation, so the result can also overwrite the operand
+		t_astret vec_mem = get_array_mem(term->ty, term->dims, dest);
 
 		// copy array elements in a loop
 		generate_loop(0, dim, [this, term, vec_mem, dim](t_astret ctrval)
@@ -99,6 +99,7 @@ t_astret LLAsm::visit(const ASTUMinus* ast)
 
 t_astret LLAsm::visit(const ASTPlus* ast)
 {
+	t_astret dest = take_dest();
 	t_astret term1 = ast->GetTerm1()->accept(this);
 	t_astret term2 = ast->GetTerm2()->accept(this);
 
@@ -126,9 +127,8 @@ t_astret LLAsm::visit(const ASTPlus* ast)
 			dim *= std::get<1>(term1->dims);
 		}
 
-		// allocate double array for result
-		t_astret vec_mem = get_tmp_var(term1->ty, &term1->dims);
-		(*m_ostr) << "%" << vec_mem->name << " = alloca [" << dim << " x double]\n";
+		// element-wise operation, so the result can also overwrite an operand
+		t_astret vec_mem = get_array_mem(term1->ty, term1->dims, dest);
 
 		std::string op = ast->IsInverted() ? "fsub" : "fadd";
 
@@ -235,6 +235,7 @@ t_astret LLAsm::visit(const ASTPlus* ast)
 
 t_astret LLAsm::visit(const ASTMult* ast)
 {
+	t_astret dest = take_dest();
 	t_astret term1 = ast->GetTerm1()->accept(this);
 	t_astret term2 = ast->GetTerm2()->accept(this);
 
@@ -318,8 +319,7 @@ t_astret LLAsm::visit(const ASTMult* ast)
 
 		// result vector w
 		std::array<std::size_t, 2> w_dims{{dim_i, 1}};
-		t_astret w_mem = get_tmp_var(SymbolType::VECTOR, &w_dims);
-		(*m_ostr) << "%" << w_mem->name << " = alloca [" << dim_i << " x double]\n";
+		t_astret w_mem = get_array_mem(SymbolType::VECTOR, w_dims, dest, {term1, term2});
 
 		// loop i
 		generate_loop(0, dim_i, [this, term1, term2, dim_i, dim_j, w_mem](t_astret ctr_i_val)
@@ -403,8 +403,7 @@ t_astret LLAsm::visit(const ASTMult* ast)
 
 		// result Matrix L
 		std::array<std::size_t, 2> L_dims{{dim_i, dim_j}};
-		t_astret L_mem = get_tmp_var(SymbolType::MATRIX, &L_dims);
-		(*m_ostr) << "%" << L_mem->name << " = alloca [" << dim_i*dim_j << " x double]\n";
+		t_astret L_mem = get_array_mem(SymbolType::MATRIX, L_dims, dest, {term1, term2});
 
 		// loop i
 		generate_loop(0, dim_i, [this, term1, term2, dim_i, dim_j, dim_k, L_mem](t_astret ctr_i_val)
@@ -504,7 +503,7 @@ t_astret LLAsm::visit(const ASTMult* ast)
 				+ "\" by vector or matrix \"" + term2->name + "\".\n");
 		}
 
-		return scalar_matrix_prod(term1, term2, 1);
+		return scalar_matrix_prod(term1, term2, 1, dest);
 	}
 
 	// scalar-matrix/vector product
@@ -512,7 +511,7 @@ t_astret LLAsm::visit(const ASTMult* ast)
 		&& (term1->ty == SymbolType::MATRIX || term1->ty == SymbolType::VECTOR))
 	{
 		bool bMul = !ast->IsInverted();
-		return scalar_matrix_prod(term2, term1, bMul);
+		return scalar_matrix_prod(term2, term1, bMul, dest);
 	}
 
 	// scalar types
@@ -575,6 +574,7 @@ t_astret LLAsm::visit(const ASTMod* ast)
 
 t_astret LLAsm::visit(const ASTPow* ast)
 {
+	t_astret dest = take_dest();
 	t_astret term1 = ast->GetTerm1()->accept(this);
 	t_astret term2 = ast->GetTerm2()->accept(this);
 
@@ -595,9 +595,8 @@ t_astret LLAsm::visit(const ASTPow* ast)
 		(*m_ostr) << "%" << termptr->name << " = bitcast ["
 			<< dim << " x double]* %" << term1->name << " to double*\n";
 
-		// allocate result matrix
-		t_astret result_mem = get_tmp_var(SymbolType::MATRIX, &term1->dims);
-		(*m_ostr) << "%" << result_mem->name << " = alloca [" << dim << " x double]\n";
+		// result matrix, ext_power copies its input, so it can also overwrite the operand
+		t_astret result_mem = get_array_mem(SymbolType::MATRIX, term1->dims, dest);
 
 		// cast result matrix pointer to element pointer
 		t_astret result_ptr = get_tmp_var();
@@ -640,6 +639,7 @@ t_astret LLAsm::visit(const ASTPow* ast)
 
 t_astret LLAsm::visit(const ASTTransp* ast)
 {
+	t_astret dest = take_dest();
 	t_astret term = ast->GetTerm()->accept(this);
 
 	if(term->ty == SymbolType::MATRIX)
@@ -650,8 +650,7 @@ t_astret LLAsm::visit(const ASTTransp* ast)
 
 		// allocate result matrix
 		std::array<std::size_t, 2> dimtrans{{dim2, dim1}};
-		t_astret result_mem = get_tmp_var(SymbolType::MATRIX, &dimtrans);
-		(*m_ostr) << "%" << result_mem->name << " = alloca [" << dim << " x double]\n";
+		t_astret result_mem = get_array_mem(SymbolType::MATRIX, dimtrans, dest, {term});
 
 
 		// copy elements in a loop
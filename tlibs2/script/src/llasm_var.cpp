@@ -120,7 +120,29 @@ t_astret LLAsm::visit(const ASTVarDecl* ast)
 
 t_astret LLAsm::visit(const ASTAssign* ast)
 {
+	// array operations can write their result directly into the assigned variable
+	if(!ast->IsMultiAssign())
+	{
+		t_astret sym = get_sym(ast->GetIdent());
+		if(sym && (sym->ty == SymbolType::VECTOR || sym->ty == SymbolType::MATRIX))
+		{
+			switch(ast->GetExpr()->type())
+			{
+				case ASTType::UMinus:
+				case ASTType::Plus:
+				case ASTType::Mult:
+				case ASTType::Pow:
+				case ASTType::Transp:
+					m_dest = sym;
+					break;
+				default:
+					break;
+			}
+		}
+	}
+
 	t_astret expr = ast->GetExpr()->accept(this);
+	m_dest = nullptr;
 
 	// multiple assignments
 	if(ast->IsMultiAssign())
@@ -209,8 +231,16 @@ t_astret LLAsm::visit(const ASTAssign* ast)
 			elemidx += get_bytesize(sym);
 		}
 
-		// free heap return value (TODO: check if it really is on the heap)
-		(*m_ostr) << "call void @ext_heap_free(i8* %" << expr->name << ")\n";
+		// release the returned memory block and everything else the function has allocated
+		if(auto iter = m_heapmarks.find(expr); iter != m_heapmarks.end())
+		{
+			(*m_ostr) << "call void @ext_heap_release(i64 %" << iter->second->name << ")\n";
+			m_heapmarks.erase(iter);
+		}
+		else
+		{
+			(*m_ostr) << "call void @ext_heap_free(i8* %" << expr->name << ")\n";
+		}
 	}
 
 	// single assignment
@@ -242,6 +272,11 @@ t_astret LLAsm::visit(const ASTAssign* ast)
 			(*m_ostr) << "store " << ty << " %" << expr->name << ", "<< ty << "* %" << var << "\n";
 		}
 
+		// nothing to copy if the result has been computed in place
+		else if((sym->ty == SymbolType::VECTOR || sym->ty == SymbolType::MATRIX) && expr == sym)
+		{
+		}
+
 		else if(sym->ty == SymbolType::VECTOR || sym->ty == SymbolType::MATRIX)
 		{
 			std::size_t dimDst = get_arraydim(sym);
@@ -324,6 +324,8 @@ declare i8* @memcpy(i8*, i8*, i64)
 
 declare i8* @ext_heap_alloc(i64, i64)
 declare void @ext_heap_free(i8*)
+declare i64 @ext_heap_mark()
+declare void @ext_heap_release(i64)
 
 declare void @ext_init()
 declare void @ext_deinit()
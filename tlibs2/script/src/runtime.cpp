@@ -31,8 +31,10 @@
 #include <cstdint>
 #include <cfloat>
 #include <vector>
-#include <unordered_set>
+#include <memory>
+#include <algorithm>
 #include <iostream>
+#include <iomanip>
 
 #include "maths.h"
 using namespace tl2_ops;
@@ -54,13 +56,151 @@ extern "C" {
 // ----------------------------------------------------------------------------
 // heap management
 // ----------------------------------------------------------------------------
-static std::unordered_set<void*> heap;
+
+/**
+ * per-thread arena for the memory blocks which escape from functions (return values),
+ * the blocks are stacked in reused chunks and are released in bulk up to a mark
+ */
+struct HeapArena
+{
+	// header in front of each block, used to pop the topmost block in ext_heap_free
+	struct Header
+	{
+		uint64_t prev_top;
+		uint64_t size;
+	};
+
+	// saved arena state
+	struct Mark
+	{
+		std::size_t chunk, offs;
+		uint64_t top;
+		std::size_t count;
+	};
+
+	static constexpr uint64_t NO_TOP = ~uint64_t(0);
+	static constexpr std::size_t ALIGN = 16;
+	static constexpr std::size_t MIN_CHUNK = 64*1024;
+
+	std::vector<std::unique_ptr<uint8_t[]>> chunks{};
+	std::vector<std::size_t> chunksizes{};
+
+	// current chunk and its fill level
+	std::size_t chunk = 0;
+	std::size_t offs = 0;
+
+	// header offset of the topmost block in the current chunk
+	uint64_t top = NO_TOP;
+
+	// number of live blocks
+	std::size_t count = 0;
+
+	std::vector<Mark> marks{};
+
+
+	void* alloc(std::size_t size)
+	{
+		size = (size + ALIGN-1) / ALIGN * ALIGN;
+		const std::size_t needed = size + sizeof(Header);
+
+		if(chunks.empty() || offs + needed > chunksizes[chunk])
+		{
+			// use the next chunk, chunks after the current one are unused
+			std::size_t next = chunks.empty() ? 0 : chunk + 1;
+			if(next >= chunks.size() || chunksizes[next] < needed)
+			{
+				std::size_t chunksize = std::max(needed, MIN_CHUNK);
+				if(!chunksizes.empty())
+					chunksize = std::max(chunksize, 2*chunksizes.back());
+
+				if(next >= chunks.size())
+				{
+					chunks.emplace_back(new uint8_t[chunksize]);
+					chunksizes.push_back(chunksize);
+				}
+				else
+				{
+					chunks[next].reset(new uint8_t[chunksize]);
+					chunksizes[next] = chunksize;
+				}
+			}
+
+			chunk = next;
+			offs = 0;
+			top = NO_TOP;
+		}
+
+		Header *hdr = reinterpret_cast<Header*>(chunks[chunk].get() + offs);
+		hdr->prev_top = top;
+		hdr->size = size;
+
+		top = offs;
+		offs += needed;
+		++count;
+
+		return hdr + 1;
+	}
+
+
+	void dealloc(void* mem)
+	{
+		if(count)
+			--count;
+
+		// only the topmost block can be reclaimed directly, the others are reclaimed by release()
+		Header *hdr = reinterpret_cast<Header*>(mem) - 1;
+		if(top != NO_TOP && chunks[chunk].get() + top == reinterpret_cast<uint8_t*>(hdr))
+		{
+			offs = top;
+			top = hdr->prev_top;
+		}
+	}
+
+
+	t_int mark()
+	{
+		marks.emplace_back(Mark{.chunk = chunk, .offs = offs, .top = top, .count = count});
+		return t_int(marks.size() - 1);
+	}
+
+
+	void release(t_int idx)
+	{
+		if(idx < 0 || std::size_t(idx) >= marks.size())
+			return;
+
+		const Mark& mark = marks[idx];
+		chunk = mark.chunk;
+		offs = mark.offs;
+		top = mark.top;
+		count = mark.count;
+
+		marks.resize(idx);
+	}
+
+
+	void clear(bool free_chunks)
+	{
+		chunk = offs = count = 0;
+		top = NO_TOP;
+		marks.clear();
+
+		if(free_chunks)
+		{
+			chunks.clear();
+			chunksizes.clear();
+		}
+	}
+};
+
+
+// every thread running compiled code has its own arena
+static thread_local HeapArena heap;
 
 
 void* ext_heap_alloc(uint64_t num, uint64_t elemsize)
 {
-	void *mem = new uint8_t[num * elemsize];
-	heap.insert(mem);
+	void *mem = heap.alloc(num * elemsize);
 
 	if(g_debug)
 	{
@@ -80,8 +220,7 @@ void ext_heap_free(void* mem)
 	if(!mem)
 		return;
 
-	delete[] reinterpret_cast<uint8_t*>(mem);
-	heap.erase(mem);
+	heap.dealloc(mem);
 
 	if(g_debug)
 	{
@@ -92,9 +231,32 @@ void ext_heap_free(void* mem)
 }
 
 
+/**
+ * remember the current arena state, e.g. before calling a function returning a memory block
+ */
+t_int ext_heap_mark()
+{
+	return heap.mark();
+}
+
+
+/**
+ * release all memory blocks allocated since the given mark
+ */
+void ext_heap_release(t_int mark)
+{
+	if(g_debug)
+	{
+		std::cerr << __func__ << ": mark=" << std::dec << mark << std::endl;
+	}
+
+	heap.release(mark);
+}
+
+
 void ext_init()
 {
-	heap.clear();
+	heap.clear(false);
 }
 
 
@@ -102,17 +264,11 @@ void ext_deinit()
 {
 	if(g_debug)
 	{
-		std::cerr << __func__ << ": " << heap.size() << " memory leaks detected." << std::endl;
-
-		auto iter = heap.begin();
-		for(std::size_t i=0; i<heap.size(); ++i)
-		{
-			std::cerr << "Leak " << i << ": "
-				<< ", mem=" << std::setw(8) << std::setfill('0') << std::hex << (void*)*iter
-				<< std::endl;
-			++iter;
-		}
+		std::cerr << __func__ << ": " << std::dec << heap.count
+			<< " memory leaks detected." << std::endl;
 	}
+
+	heap.clear(true);
 }
 
 
@@ -0,0 +1,170 @@
+/**
+ * magnon density of states and thermodynamics test
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ *
+ * g++ -std=c++20 -DUSE_LAPACK -I.. -o magdyn_dos magdyn_dos.cpp -llapacke
+ *
+ * ----------------------------------------------------------------------------
+ * tlibs
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2015-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#define BOOST_TEST_MODULE Magnon DOS
+#include <boost/test/included/unit_test.hpp>
+namespace test = boost::unit_test;
+namespace testtools = boost::test_tools;
+
+#include <iostream>
+#include <string>
+#include <limits>
+
+#include "libs/magdyn.h"
+
+
+using t_real = double;
+using t_cplx = std::complex<t_real>;
+using t_size = std::size_t;
+using t_vec_real = tl2::vec<t_real, std::vector>;
+using t_mat_real = tl2::mat<t_real, std::vector>;
+using t_vec = tl2::vec<t_cplx, std::vector>;
+using t_mat = tl2::mat<t_cplx, std::vector>;
+using t_magdyn = tl2_mag::MagDyn<t_mat, t_vec, t_mat_real, t_vec_real, t_cplx, t_real, t_size>;
+
+
+/**
+ * ferromagnetic chain along a with the given number of sites per unit cell
+ */
+static void create_chain(t_magdyn& dyn, t_size num_sites)
+{
+	for(t_size i = 0; i < num_sites; ++i)
+	{
+		t_magdyn::MagneticSite site;
+		site.name = "s" + std::to_string(i);
+		site.pos = { std::to_string(t_real(i) / t_real(num_sites)), "0", "0" };
+		site.spin_dir = { "0", "0", "1" };
+		site.spin_mag = "1";
+		dyn.AddMagneticSite(std::move(site));
+	}
+
+	for(t_size i = 0; i < num_sites; ++i)
+	{
+		t_magdyn::ExchangeTerm term;
+		term.name = "J" + std::to_string(i);
+		term.site1 = "s" + std::to_string(i);
+		term.site2 = "s" + std::to_string((i + 1) % num_sites);
+		term.dist = { i + 1 == num_sites ? "1" : "0", "0", "0" };
+		term.J = "-1";
+		dyn.AddExchangeTerm(std::move(term));
+	}
+
+	dyn.CalcExternalField();
+	dyn.CalcMagneticSites();
+	dyn.CalcExchangeTerms();
+}
+
+
+BOOST_AUTO_TEST_CASE(test_dos)
+{
+	for(t_size num_sites : { 1, 2 })
+	{
+		t_magdyn dyn;
+		create_chain(dyn, num_sites);
+		dyn.SetUniteDegenerateEnergies(false);
+
+		// top of the band, the dispersion is E(h) = E_top/2 * (1 - cos(2 pi h))
+		t_real E_top = 0.;
+		for(const auto& EandW : dyn.CalcEnergies(0.5 * t_real(num_sites), 0., 0., true))
+			E_top = std::max(E_top, EandW.E);
+		BOOST_TEST(E_top > 0.);
+
+		for(t_real sigma : { -1., 0.01 })
+		{
+			// include the tail of the broadened modes below zero
+			const t_size num_E = 512;
+			const t_magdyn::DensityOfStates dos = dyn.CalcDensityOfStates(
+				256, 1, 1, {}, -0.2*E_top, 1.2*E_top, num_E, sigma);
+			BOOST_TEST(dos.E.size() == num_E);
+
+			// one mode per site and magnetic unit cell
+			const t_real num_modes = dos.dos_int.back();
+
+			// the mean energy over the zone is the centre of the cosine band
+			const t_real dE = dos.E[1] - dos.E[0];
+			t_real E_mean = 0.;
+			for(t_size E_idx = 0; E_idx < num_E; ++E_idx)
+				E_mean += dos.E[E_idx] * dos.dos[E_idx] * dE;
+			E_mean /= num_modes;
+
+			std::cout << "sites: " << num_sites << ", sigma: " << sigma
+				<< ", modes: " << num_modes << ", mean E: " << E_mean
+				<< ", band top: " << E_top << std::endl;
+
+			BOOST_TEST(num_modes == t_real(num_sites), testtools::tolerance(1e-3));
+			BOOST_TEST(E_mean == 0.5*E_top, testtools::tolerance(1e-2));
+		}
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(test_thermodynamics)
+{
+	t_magdyn dyn;
+	create_chain(dyn, 2);
+	dyn.SetUniteDegenerateEnergies(false);
+
+	// open a gap using a field which stabilises the spins
+	t_magdyn::ExternalField field;
+	field.dir = tl2::create<t_vec_real>({ 0., 0., -1. });
+	field.mag = 1.;
+	field.align_spins = false;
+	dyn.SetExternalField(field);
+	dyn.CalcExternalField();
+
+	t_real E_gap = std::numeric_limits<t_real>::max();
+	for(const auto& EandW : dyn.CalcEnergies(0., 0., 0., true))
+	{
+		if(EandW.E > 0.)
+			E_gap = std::min(E_gap, EandW.E);
+	}
+	BOOST_TEST(E_gap > 0.);
+
+	const t_magdyn::DensityOfStates dos = dyn.CalcDensityOfStates(256, 1, 1);
+
+	// boltzmann constant in meV/K
+	const t_real kB = tl2::kB<t_real> * tl2::kelvin<t_real> / tl2::meV<t_real>;
+	const t_real E_max = dos.E.back();
+
+	// classical limit, k_B T >> band width: every mode contributes k_B
+	const t_magdyn::Thermodynamics thermo_hi = dyn.CalcThermodynamics(dos, 1e3 * E_max / kB);
+	std::cout << "gap: " << E_gap << ", C(T >> E) = " << thermo_hi.heat_capacity << std::endl;
+	BOOST_TEST(thermo_hi.heat_capacity == 2., testtools::tolerance(1e-2));
+
+	// k_B T << gap: the magnons freeze out
+	const t_magdyn::Thermodynamics thermo_lo = dyn.CalcThermodynamics(dos, 0.02 * E_gap / kB);
+	std::cout << "C(T << gap) = " << thermo_lo.heat_capacity << std::endl;
+	BOOST_TEST(thermo_lo.heat_capacity < 1e-12);
+	BOOST_TEST(thermo_lo.magnons < 1e-12);
+
+	// no magnons at zero temperature
+	const t_magdyn::Thermodynamics thermo_0 = dyn.CalcThermodynamics(dos, 0.);
+	BOOST_TEST(thermo_0.heat_capacity == 0.);
+	BOOST_TEST(thermo_0.magnons == 0.);
+}
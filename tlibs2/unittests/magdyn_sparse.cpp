@@ -0,0 +1,194 @@
+/**
+ * sparse magnon solver test, compared with the dense solver
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ *
+ * g++ -std=c++20 -DUSE_LAPACK -I.. -o magdyn_sparse magdyn_sparse.cpp -llapacke
+ *
+ * ----------------------------------------------------------------------------
+ * tlibs
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2015-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#define BOOST_TEST_MODULE Sparse Magnon Solver
+#include <boost/test/included/unit_test.hpp>
+namespace test = boost::unit_test;
+namespace testtools = boost::test_tools;
+
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <cmath>
+
+#include "libs/magdyn.h"
+
+
+using t_real = double;
+using t_cplx = std::complex<t_real>;
+using t_size = std::size_t;
+using t_vec_real = tl2::vec<t_real, std::vector>;
+using t_mat_real = tl2::mat<t_real, std::vector>;
+using t_vec = tl2::vec<t_cplx, std::vector>;
+using t_mat = tl2::mat<t_cplx, std::vector>;
+using t_magdyn = tl2_mag::MagDyn<t_mat, t_vec, t_mat_real, t_vec_real, t_cplx, t_real, t_size>;
+
+
+/**
+ * ferromagnetic chain along a with differing couplings and
+ * a field along the given direction along the spins (-1) or against them (+1)
+ */
+static void create_chain(t_magdyn& dyn, t_size num_sites, t_real field_dir)
+{
+	for(t_size i = 0; i < num_sites; ++i)
+	{
+		t_magdyn::MagneticSite site;
+		site.name = "s" + std::to_string(i);
+		site.pos = { std::to_string(t_real(i) / t_real(num_sites)), "0", "0" };
+		site.spin_dir = { "0", "0", "1" };
+		site.spin_mag = "1";
+		dyn.AddMagneticSite(std::move(site));
+	}
+
+	for(t_size i = 0; i < num_sites; ++i)
+	{
+		t_magdyn::ExchangeTerm term;
+		term.name = "J" + std::to_string(i);
+		term.site1 = "s" + std::to_string(i);
+		term.site2 = "s" + std::to_string((i + 1) % num_sites);
+		term.dist = { i + 1 == num_sites ? "1" : "0", "0", "0" };
+		term.J = std::to_string(-1. - 0.1*t_real(i));
+		dyn.AddExchangeTerm(std::move(term));
+	}
+
+	t_magdyn::ExternalField field;
+	field.dir = tl2::create<t_vec_real>({ 0., 0., field_dir });
+	field.mag = 0.5;
+	field.align_spins = false;
+	dyn.SetExternalField(field);
+
+	dyn.CalcExternalField();
+	dyn.CalcMagneticSites();
+	dyn.CalcExchangeTerms();
+	dyn.SetUniteDegenerateEnergies(false);
+}
+
+
+/**
+ * energies in descending order
+ */
+static std::vector<t_real> get_energies(const t_magdyn& dyn, const t_vec_real& Q)
+{
+	std::vector<t_real> Es;
+	for(const auto& EandW : dyn.CalcEnergies(Q, true))
+		Es.push_back(EandW.E);
+
+	std::sort(Es.begin(), Es.end(), std::greater<t_real>());
+	return Es;
+}
+
+
+/**
+ * the given number of modes closest to zero energy, in descending order
+ */
+static std::vector<t_real> get_lowest(std::vector<t_real> Es, t_size num)
+{
+	std::stable_sort(Es.begin(), Es.end(), [](t_real E1, t_real E2) -> bool
+	{
+		return std::abs(E1) < std::abs(E2);
+	});
+
+	Es.resize(std::min(num, Es.size()));
+	std::sort(Es.begin(), Es.end(), std::greater<t_real>());
+	return Es;
+}
+
+
+static void check_energies(const std::vector<t_real>& Es_sparse, const std::vector<t_real>& Es_dense)
+{
+	BOOST_TEST(Es_sparse.size() == Es_dense.size());
+	for(t_size idx = 0; idx < std::min(Es_sparse.size(), Es_dense.size()); ++idx)
+		BOOST_TEST(Es_sparse[idx] == Es_dense[idx], testtools::tolerance(1e-4));
+}
+
+
+BOOST_AUTO_TEST_CASE(test_sparse)
+{
+	const t_size num_sites = 12;
+	const t_size num_modes = 6;  // three pairs of magnon creation and annihilation
+
+	// the field along the spins opens a gap, the hamiltonian is positive definite
+	t_magdyn dyn;
+	create_chain(dyn, num_sites, -1.);
+
+	for(t_real h : { 0.05, 0.13, 0.37 })
+	{
+		const t_vec_real Q = tl2::create<t_vec_real>({ h, 0., 0. });
+
+		dyn.SetSparseModes(0);
+		dyn.SetSparseEnergyWindow(0., 0.);
+		const std::vector<t_real> Es_dense = get_energies(dyn, Q);
+		BOOST_TEST(Es_dense.size() == 2*num_sites);
+
+		// lowest modes
+		dyn.ResetSparseStats();
+		dyn.SetSparseModes(num_modes);
+		const std::vector<t_real> Es_lowest = get_energies(dyn, Q);
+		std::cout << "h = " << h << ", lowest E = " << Es_lowest.front() << std::endl;
+		check_energies(Es_lowest, get_lowest(Es_dense, num_modes));
+		BOOST_TEST(dyn.GetSparseFallbacks() == 0);
+
+		// energy window between the second and the fifth positive mode
+		const t_real E_min = 0.5 * (Es_dense[num_sites - 2] + Es_dense[num_sites - 3]);
+		const t_real E_max = 0.5 * (Es_dense[num_sites - 5] + Es_dense[num_sites - 6]);
+		dyn.SetSparseModes(0);
+		dyn.SetSparseEnergyWindow(E_min, E_max);
+		const std::vector<t_real> Es_window = get_energies(dyn, Q);
+
+		std::vector<t_real> Es_dense_window;
+		std::copy_if(Es_dense.begin(), Es_dense.end(), std::back_inserter(Es_dense_window),
+			[E_min, E_max](t_real E) -> bool { return E >= E_min && E <= E_max; });
+		BOOST_TEST(Es_dense_window.size() == 3);
+		check_energies(Es_window, Es_dense_window);
+		BOOST_TEST(dyn.GetSparseFallbacks() == 0);
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(test_sparse_fallback)
+{
+	const t_size num_sites = 12;
+	const t_size num_modes = 6;
+
+	// the field against the spins destabilises the chain at small momenta,
+	// the hamiltonian is not positive definite and the dense solver is used
+	t_magdyn dyn;
+	create_chain(dyn, num_sites, 1.);
+
+	const t_vec_real Q = tl2::create<t_vec_real>({ 0.01, 0., 0. });
+	const std::vector<t_real> Es_dense = get_energies(dyn, Q);
+
+	dyn.ResetSparseStats();
+	dyn.SetSparseModes(num_modes);
+	const std::vector<t_real> Es_sparse = get_energies(dyn, Q);
+
+	std::cout << "fallbacks: " << dyn.GetSparseFallbacks() << std::endl;
+	BOOST_TEST(dyn.GetSparseFallbacks() == 1);
+	check_energies(Es_sparse, get_lowest(Es_dense, num_modes));
+}
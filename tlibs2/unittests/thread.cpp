@@ -0,0 +1,96 @@
+/**
+ * task scheduler test
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ *
+ * ----------------------------------------------------------------------------
+ * tlibs
+ * Copyright (C) 2017-2026  Tobias WEBER (Institut Laue-Langevin (ILL),
+ *                          Grenoble, France).
+ * Copyright (C) 2015-2017  Tobias WEBER (Technische Universitaet Muenchen
+ *                          (TUM), Garching, Germany).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#define BOOST_TEST_MODULE Thread
+#include <boost/test/included/unit_test.hpp>
+namespace test = boost::unit_test;
+namespace testtools = boost::test_tools;
+
+#include <iostream>
+#include <atomic>
+
+#include "libs/thread.h"
+
+
+BOOST_AUTO_TEST_CASE(test_nested)
+{
+	tl2::Scheduler& sched = tl2::Scheduler::Get();
+	sched.SetMaxThreads(4);
+	BOOST_TEST(sched.GetMaxThreads() == 4);
+
+	std::atomic<int> num_running{0}, max_running{0};
+	std::atomic<int> sum{0};
+
+	{
+		// the inner groups are run by the same workers
+		tl2::TaskGroup group;
+		for(int i = 0; i < 64; ++i)
+		{
+			group.Run([&sum, &num_running, &max_running]()
+			{
+				tl2::TaskGroup inner;
+				for(int j = 0; j < 16; ++j)
+				{
+					inner.Run([&sum, &num_running, &max_running]()
+					{
+						int running = ++num_running;
+						int max = max_running;
+						while(running > max && !max_running.compare_exchange_weak(max, running))
+							;
+						++sum;
+						--num_running;
+					});
+				}
+			});
+		}
+	}
+
+	std::cout << "maximum number of concurrent tasks: " << max_running << std::endl;
+	BOOST_TEST(sum == 64*16);
+	BOOST_TEST(max_running <= 4);
+}
+
+
+BOOST_AUTO_TEST_CASE(test_cancel)
+{
+	std::atomic<int> num_run{0};
+
+	tl2::TaskGroup group;
+	for(int i = 0; i < 1000; ++i)
+	{
+		group.Run([&group, &num_run]()
+		{
+			++num_run;
+			group.Cancel();
+		});
+	}
+	group.Join();
+
+	std::cout << "tasks run after cancelling: " << num_run << std::endl;
+	BOOST_TEST(group.IsCancelled());
+	BOOST_TEST(num_run < 1000);
+}